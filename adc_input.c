@@ -8,9 +8,11 @@
 #include "defines.h"
 #include "chprintf.h"
 #include "adc_input.h"
+#include "afsk.h"
 
 
 #define RADIO_ADC_SAMPLE_FREQ    9600 
+#define RADIO_ADC_SAMPLE_FREQ_HI 38400    /* For 9600 baud (G3RUH) */
 #define RADIO_ADC_NUM_CHANNELS   1
 #define RADIO_ADC_CHANNELS       ADC_TEENSY_PIN11
 #define RADIO_ADC_BUFSIZE        1
@@ -27,8 +29,13 @@ static uint8_t dcoffset = 0;
  static adcsample_t samples[RADIO_ADC_NUM_CHANNELS * RADIO_ADC_BUFSIZE];
  static adcsample_t samples2[BATT_NUM_CHANNELS * BATT_NUM_BUFSIZE]; 
  
- extern void afsk_process_sample(int8_t curr_sample);
+ static bool sampling = false;
+ static const ADCConversionGroup *rxgrp;
+ 
+ MUTEX_DECL(adc_mutex);
+ 
  static void adc_sample(GPTDriver *gptp);
+ static msg_t adc_convert(const ADCConversionGroup *grp, adcsample_t *buf);
  static void adc_sample_cb(ADCDriver *adcp, adcsample_t *buffer, size_t n);
  
  
@@ -94,12 +101,39 @@ static uint8_t dcoffset = 0;
  };
  
  
+/*************************************************************
+  * Config of ADC for sampling radio signal at the higher rate.
+  * A conversion must complete well within 26 us, so we use a 
+  * faster ADC clock and no averaging. 
+  *************************************************************/
+ 
+ static const ADCConversionGroup adc_grpcfg_hi = {
+   false, 
+   RADIO_ADC_NUM_CHANNELS,        
+   adc_sample_cb, NULL,
+   RADIO_ADC_CHANNELS,
+   
+   /* CFG1 Register - ADCCLK = BUSCLK / 4 */
+   ADCx_CFG1_ADIV(ADCx_CFG1_ADIV_DIV_2) |
+   ADCx_CFG1_ADICLK(ADCx_CFG1_ADIVCLK_BUS_CLOCK_DIV_2) |
+   ADCx_CFG1_MODE( ADCx_CFG1_MODE_8_OR_9_BITS ),
+   
+   /* SC3 Register - No averaging */
+   0
+ };
+ 
+ 
 /* GPT timer config */ 
  static const GPTConfig radio_gpt_cfg = {
    RADIO_ADC_SAMPLE_FREQ,  
    adc_sample    /* Timer callback.*/
  };
  
+ static const GPTConfig radio_gpt_cfg_hi = {
+   RADIO_ADC_SAMPLE_FREQ_HI,  
+   adc_sample 
+ };
+ 
 
  
  
@@ -110,15 +144,62 @@ static uint8_t dcoffset = 0;
 void adc_init()
 {
    adcStart(&ADCD1, &adc_cfg);
+   rxgrp = &adc_grpcfg;
    gptStart(&RADIO_ADC_GPT, &radio_gpt_cfg);
    adc_calibrate();
 }
 
 void adc_calibrate() {
-   if (adcConvert(&ADCD1, &adc_grpcfg, samples, 1) == MSG_OK)
+   if (adc_convert(&adc_grpcfg, samples) == MSG_OK)
       dcoffset = (uint8_t) samples[0];
 }
 
+
+
+/***************************************************
+ * Single conversion. The receiver is sampling 
+ * continuously while the radio is on, so we pause 
+ * it while doing this. 
+ ***************************************************/
+
+static msg_t adc_convert(const ADCConversionGroup *grp, adcsample_t *buf)
+{
+   msg_t res;
+   chMtxLock(&adc_mutex);
+   if (sampling) {
+      gptStopTimer(&RADIO_ADC_GPT);
+      sleep(1);   /* Let ongoing conversion complete */
+   }
+   res = adcConvert(&ADCD1, grp, buf, 1);
+   if (sampling)
+      gptStartContinuous(&RADIO_ADC_GPT, 1);
+   chMtxUnlock(&adc_mutex);
+   return res;
+}
+
+
+
+/***************************************************
+ * Select sampling rate for the receiver: 9600 Hz
+ * (AFSK 1200) or 38400 Hz (G3RUH 9600). 
+ ***************************************************/
+
+void adc_set_highrate(bool hi)
+{
+   chMtxLock(&adc_mutex);
+   if (sampling) {
+      gptStopTimer(&RADIO_ADC_GPT);
+      sleep(1);
+   }
+   gptStop(&RADIO_ADC_GPT);
+   rxgrp = (hi ? &adc_grpcfg_hi : &adc_grpcfg);
+   gptStart(&RADIO_ADC_GPT, (hi ? &radio_gpt_cfg_hi : &radio_gpt_cfg));
+   if (sampling)
+      gptStartContinuous(&RADIO_ADC_GPT, 1);
+   chMtxUnlock(&adc_mutex);
+}
+
+
 uint8_t adc_dcoffset() {
     return dcoffset;
 }
@@ -133,7 +214,7 @@ uint8_t adc_dcoffset() {
 
 uint16_t adc_read_batt()
 {
-  if (adcConvert(&ADCD1, &adc_grpcfg2, samples2, 1) != MSG_OK)
+  if (adc_convert(&adc_grpcfg2, samples2) != MSG_OK)
     return 0; 
  
   uint16_t batt = (uint16_t) samples2[0];
@@ -146,7 +227,7 @@ uint16_t adc_read_batt()
 
 int8_t adc_read_input()
 {
-  if (adcConvert(&ADCD1, &adc_grpcfg, samples, 1) != MSG_OK)
+  if (adc_convert(&adc_grpcfg, samples) != MSG_OK)
     return 0;
   return (int8_t) (samples[0] - dcoffset);
 }
@@ -159,7 +240,12 @@ int8_t adc_read_input()
  ***************************************************/
 
 void adc_start_sampling() {
-   gptStartContinuous(&RADIO_ADC_GPT, 1);  
+   chMtxLock(&adc_mutex);
+   if (!sampling) {
+      sampling = true;
+      gptStartContinuous(&RADIO_ADC_GPT, 1);  
+   }
+   chMtxUnlock(&adc_mutex);
 }
 
 
@@ -168,7 +254,12 @@ void adc_start_sampling() {
  ***************************************************/
 
 void adc_stop_sampling() {
-   gptStopTimer(&RADIO_ADC_GPT);
+   chMtxLock(&adc_mutex);
+   if (sampling) {
+      sampling = false;
+      gptStopTimer(&RADIO_ADC_GPT);
+   }
+   chMtxUnlock(&adc_mutex);
 }
 
 
@@ -178,13 +269,16 @@ void adc_stop_sampling() {
 
 static void adc_sample(GPTDriver *gptp) {
     (void)gptp;
-    adcStartConversionI(&ADCD1, &adc_grpcfg, samples, RADIO_ADC_BUFSIZE);    
+    adcStartConversionI(&ADCD1, rxgrp, samples, RADIO_ADC_BUFSIZE);    
 }
 
+/*
+ * Hand the sample over to the demodulator. This is all we do in 
+ * interrupt context. 
+ */
 static void adc_sample_cb(ADCDriver *adcp, adcsample_t *buffer, size_t n) {
     (void)adcp;
     (void)n;
-    
-    afsk_process_sample((int8_t) (buffer[0] - dcoffset));
+    afsk_rx_sample((int8_t) (buffer[0] - dcoffset));
 }
 
@@ -7,5 +7,6 @@
  int8_t adc_read_input(void);
  void adc_start_sampling(void);
  void adc_stop_sampling(void);
+ void adc_set_highrate(bool hi);
  
 #endif
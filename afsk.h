@@ -12,21 +12,68 @@
  #define AFSK_MARK  1200
  #define AFSK_SPACE 2200
  
+ /* Modem modes */
+ #define MODEM_AFSK1200   0
+ #define MODEM_G3RUH9600  1
+ 
  void tone_setHigh(bool hi);
  void tone_toggle(void);
  void tone_start(void);
  void tone_stop(void);
+ void afsk_tx_nextBit(void);
  
- output_queue_t* afsk_tx_init(void);
+ void afsk_tx_init(void);
+ void afsk_tx_send(const uint8_t* buf, uint16_t nbits, uint16_t preamble, uint16_t postamble, bool loop);
+ void afsk_tx_cancel(void);
+ void afsk_tx_wait(void);
  void afsk_tx_start(void);
  void afsk_tx_stop(void);
+ uint32_t afsk_tx_irqCount(void);
+ uint32_t tone_irqCount(void);
  void afsk_PTT(bool on);
+ void afsk_tx_setMode(uint8_t m);
+ uint8_t afsk_tx_mode(void);
+ 
+ void afsk_rx_init(void);
+ input_queue_t* afsk_rx_queue(uint8_t i);
  
- input_queue_t* afsk_rx_init(void);
+ /* Size of records in the queue from the demodulator: Octet + confidence of each bit */
+ #define AFSK_RX_RECSIZE 5
  void afsk_rx_enable(void); 
  void afsk_rx_disable(void);
+ uint32_t afsk_rx_overruns(void);
+ void afsk_rx_sample(int8_t x);
+ void afsk_rx_setAgc(uint8_t decay, uint8_t minpeak);
+ bool afsk_rx_dcd(void);
+ void afsk_rx_setMode(uint8_t m);
+ uint8_t afsk_rx_mode(void);
+ 
+ /* Profiling of demodulator stages (CPU cycles) */
+ #define AFSK_PROF_BANDPASS 0
+ #define AFSK_PROF_AGC      1
+ #define AFSK_PROF_LOWPASS  2
+ #define AFSK_PROF_PLL      3
+ #define AFSK_PROF_STAGES   4
+ 
+ typedef struct {
+    uint32_t samples; 
+    uint32_t cycles[AFSK_PROF_STAGES];
+    uint32_t overflows;    // Samples dropped (sample ring full)
+    uint16_t ring_hwm;     // Max number of samples waiting in ring
+    uint32_t isr_max;      // Max CPU cycles spent in ADC callback
+ } afsk_prof_t;
+ 
+ void afsk_rx_getProfile(afsk_prof_t* p, bool reset);
+ 
+ /* Demodulator statistics */
+ typedef struct {
+    uint32_t iq_overflows; // Octets dropped (HDLC decoder queue full)
+    uint32_t pll_adjust;   // Bit clock adjustments
+    uint8_t peak;          // Peak audio level (0-128) 
+    uint8_t avg;           // Average audio level (0-128)
+ } afsk_rxstat_t;
  
- void trx_sq_handler(EXTDriver *extp, expchannel_t channel);
+ void afsk_rx_getStats(afsk_rxstat_t* st, bool reset);
 
  
 #endif
\ No newline at end of file
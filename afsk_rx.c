@@ -7,16 +7,16 @@
  */
 
 #include "hal.h"
-#include "fifo.h"       
 #include <string.h>
 #include "defines.h"
 #include "afsk.h"
 #include "ui/ui.h"
-#include "fifo.h"
 #include "adc_input.h"
+#include "config.h"
+#include "radio.h"
 
-#define ARM_MATH_CM4
-#include "arm_math.h"
+#include "util/cycles.h"
+#include "util/ring.h"
 
 
 #define SAMPLERATE 9600                             // The rate at which we are sampling 
@@ -31,45 +31,296 @@
 #define PHASE_MAX    (SAMPLESPERBIT * PHASE_BITS)   // Resolution of our phase counter = 64
 #define PHASE_THRESHOLD  (PHASE_MAX / 2)            // Target transition point of our phase window
 
+/* 
+ * G3RUH 9600 baud mode. The ADC is sampling at 38400 Hz, i.e. 4 samples per bit. 
+ * The phase counter has the same resolution (PHASE_MAX) as for AFSK.
+ */
+#define SAMPLERATE_9600    38400
+#define BITRATE_9600       9600
+#define SAMPLESPERBIT_9600 (SAMPLERATE_9600 / BITRATE_9600)
+#define PHASE_BITS_9600    (PHASE_MAX / SAMPLESPERBIT_9600)  // 16
+#define PHASE_INC_9600     2
+
 
 /* Detect transition */
 #define BITS_DIFFER(bits1, bits2) (((bits1)^(bits2)) & 0x01)
 #define TRANSITION_FOUND(bits) BITS_DIFFER((bits), (bits) >> 1)
 
 
-/* Qeue of decoded bits. To be used by HDLC packet decoder */
-static uint8_t _buf[AFSK_RX_QUEUE_SIZE];
-static input_queue_t iq;
+/* 
+ * Samples from the ADC, waiting to be demodulated. The ADC callback puts
+ * samples into the ring and signals the demodulator thread for each 
+ * AFSK_RX_BLOCKSIZE samples. 
+ */
+static int8_t _samples[AFSK_RX_RINGSIZE];
+static ring_t rxring; 
+static uint16_t rxcount = 0;
+static uint32_t isr_max = 0;
+BSEMAPHORE_DECL(rxready, true);
+
+/* Profiling of the demodulator stages */
+static afsk_prof_t prof;
+
+THREAD_STACK(afsk_rxdemod, STACK_AFSKDEMOD);
+
+
+#define ABS(x) ((x) < 0 ? -(x) : (x))
+
+
+/************************************************
+ * FIR filtering 
+ * 
+ * Block based kernels working on 16 bit samples 
+ * with 7 bit fractional coefficients. Coefficient 
+ * tables are constant (flash) and the delay lines
+ * are kept separately. The delay line is stored 
+ * twice, so that the last 'taps' samples are 
+ * always found in one contiguous window, without 
+ * any shifting or wrap-around in the inner loop. 
+ * 
+ * With the DSP extension (Cortex-M4) two taps are 
+ * computed per instruction (SMLAD). Otherwise we 
+ * use a portable C version of the same thing.
+ ************************************************/
+
+#define FIR_MAX_TAPS 12      /* Number of taps must be even. Pad with zeroes */
+
+
+typedef struct FIR
+{
+  uint8_t taps;
+  const int16_t *coef;
+} FIR;
+
+
+typedef struct FirState
+{
+  uint8_t pos;
+  int16_t mem[2*FIR_MAX_TAPS];
+} FirState;
+
+
+enum fir_filters
+{
+  FIR_1200_BP=0,
+  FIR_2200_BP=1,
+  FIR_1200_BP_W=2,
+  FIR_2200_BP_W=3,
+  FIR_1200_LP=4,
+  FIR_9600_LP=5
+};
+
+#define FIR_BANDPASS FIR_1200_LP     /* Number of bandpass filters */
+
+
+static const int16_t coef_1200_bp[] __attribute__((aligned(4))) = 
+   { -12, -16, -15, 0, 20, 29, 20, 0, -15, -16, -12, 0 };
+   
+static const int16_t coef_2200_bp[] __attribute__((aligned(4))) = 
+   { 11, 15, -8, -26, 4, 30, 4, -26, -8, 15, 11, 0 };
+   
+static const int16_t coef_1200_bp_w[] __attribute__((aligned(4))) = 
+   { -3, -13, -10, 15, 42, 42, 15, -10, -13, -3 };
+   
+static const int16_t coef_2200_bp_w[] __attribute__((aligned(4))) = 
+   { 4, 4, -24, -21, 34, 34, -21, -24, 4, 4 };
+   
+static const int16_t coef_1200_lp[] __attribute__((aligned(4))) = 
+   { -9, 3, 26, 47, 47, 26, 3, -9 };
+   
+/* 9600 baud receive filter, 5 kHz cutoff at 38400 Hz (Hamming window) */
+static const int16_t coef_9600_lp[] __attribute__((aligned(4))) = 
+   { -1, -1, 1, 9, 22, 34, 34, 22, 9, 1, -1, -1 };
+
+
+static const FIR fir_table[] =
+{
+  [FIR_1200_BP] = { .taps = 12, .coef = coef_1200_bp },
+  [FIR_2200_BP] = { .taps = 12, .coef = coef_2200_bp },
+  [FIR_1200_BP_W] = { .taps = 10, .coef = coef_1200_bp_w },
+  [FIR_2200_BP_W] = { .taps = 10, .coef = coef_2200_bp_w },
+  [FIR_1200_LP] = { .taps = 8,  .coef = coef_1200_lp },
+  [FIR_9600_LP] = { .taps = 12, .coef = coef_9600_lp }
+};
+
+
+
+
+static inline int16_t sat16(int32_t x)
+{
+#if defined(__ARM_FEATURE_DSP)
+  return (int16_t) __SSAT(x, 16);
+#else
+  return (int16_t) (x > INT16_MAX ? INT16_MAX : (x < INT16_MIN ? INT16_MIN : x));
+#endif
+}
+
+
+#if defined(__ARM_FEATURE_DSP)
+/* Two 16 bit samples, may be unaligned (LDR allows this on Cortex-M4) */
+static inline uint32_t read_q15x2(const int16_t* p)
+{
+  uint32_t x;
+  memcpy(&x, p, sizeof(x));
+  return x;
+}
+#endif
+
+
+
+/*
+ * Filter a block of n samples using the given delay line. 
+ * 'in' and 'out' may be the same buffer. 
+ */
+static void fir_filter(enum fir_filters f, FirState* st, const int16_t* in, int16_t* out, size_t n)
+{
+  const uint8_t taps = fir_table[f].taps;
+  const int16_t *coef = fir_table[f].coef;
+  
+  for (size_t i=0; i<n; i++) 
+  {
+    if (st->pos == 0)
+       st->pos = taps;
+    st->pos--;
+    st->mem[st->pos] = st->mem[st->pos + taps] = in[i];
+    
+    /* x[0] is the newest sample, x[taps-1] is the oldest */
+    const int16_t *x = &st->mem[st->pos];
+    int32_t y = 0;
+    
+#if defined(__ARM_FEATURE_DSP)
+    for (uint8_t k = 0; k < taps; k += 2)
+       y = __SMLAD(read_q15x2(&x[k]), read_q15x2(&coef[k]), y);
+#else
+    for (uint8_t k = 0; k < taps; k++)
+       y += x[k] * coef[k];
+#endif
+    out[i] = sat16(y >> 7);
+  }
+}
+
+
+
+/*********************************************************
+ * Demodulator variants. We may run several demodulators 
+ * in parallel on the same samples (see AFSK_RX_VARIANTS), 
+ * each with its own HDLC decoder. They differ in the 
+ * bandpass filter pair, how hard the PLL is nudged on 
+ * transitions and the threshold of the slicer. 
+ * The first entry is the standard demodulator. 
+ *********************************************************/
+
+#define SLICER_BIAS 12    /* Around 10% of the AGC output range */
+
+typedef struct AfskVariant
+{
+   enum fir_filters mark, space;  // Bandpass filter pair 
+   int8_t  phase_inc;             // PLL adjustment on transitions
+   int16_t bias;                  // Slicer threshold (positive favours mark) 
+} AfskVariant;
+
+
+static const AfskVariant variants[] = 
+{
+   { FIR_1200_BP,   FIR_2200_BP,   PHASE_INC,   0 },            /* Standard */
+   { FIR_1200_BP_W, FIR_2200_BP_W, PHASE_INC,   0 },            /* Wider filters, more tolerant to twist */
+   { FIR_1200_BP,   FIR_2200_BP,   PHASE_INC*2, 0 },            /* Faster clock recovery */
+   { FIR_1200_BP,   FIR_2200_BP,   PHASE_INC,   SLICER_BIAS },  /* Biased towards mark */
+   { FIR_1200_BP,   FIR_2200_BP,   PHASE_INC,   -SLICER_BIAS }  /* Biased towards space */
+};
+
+#if AFSK_RX_VARIANTS < 1 || AFSK_RX_VARIANTS > 5
+#error "AFSK_RX_VARIANTS must be in range 1-5"
+#endif
+
 
 
 /*********************************************************
  * This is our primary modem struct. It defines
- * the values we need to demodulate data.
+ * the values we need to demodulate data. One 
+ * instance for each variant. 
  *********************************************************/
 
 typedef struct AfskRx
 {
-   int16_t iirX[2];         // Filter X cells
-   int16_t iirY[2];         // Filter Y cells
-  
+   const AfskVariant *var;  // Parameters for this demodulator 
+   FirState lp;             // Delay line for lowpass filter 
+   
    uint8_t sampled_bits;    // Bits sampled by the demodulator (at ADC speed)
    int8_t  curr_phase;      // Current phase of the demodulator
    uint8_t found_bits;      // Actual found bits at correct bitrate
   
-   bool    cd;              // Carrier detect 
-   uint8_t cd_state;
+   bool    cd;              // Carrier detect (bit clock is locked)
+   uint16_t cd_hist;        // Last transitions, 1 if close to expected time
+   uint8_t since_trans;     // Samples since last transition 
+   
+   int16_t prev_sample;     // Last slicer input 
+   uint8_t level_conf;      // Confidence of last found bit
+   
+   uint8_t octet;           // Bits to be sent to HDLC decoder
+   uint32_t conf;           // Confidence of each bit in octet (4 bits each)
+   uint8_t bit_count; 
+   
+   uint32_t scrambler;      // Last received bits, for descrambling (G3RUH)
+   int32_t dc;              // Slicer threshold x 256 (G3RUH)
+   
+   uint32_t pll_adjust;     // Statistics
+   uint32_t iq_overflows;
+   
+   /* Qeue of decoded bits. To be used by HDLC packet decoder */
+   input_queue_t iq;
+   uint8_t buf[AFSK_RX_QUEUE_SIZE];
   
 } AfskRx;
 
-static AfskRx afsk;
+static AfskRx afsk[AFSK_RX_VARIANTS];
+
+
+/* AGC state */
+#define AGC_LEVEL 125
+
+typedef struct Agc 
+{
+   uint16_t peak;           // Twice the peak level of envelope
+   uint16_t gain;           // Fixed point 8.8
+} Agc;
+
+
+/* Bandpass filter and AGC state shared by the variants */
+static FirState bp_state[FIR_BANDPASS];
+static Agc bp_agc[FIR_BANDPASS];
+static int16_t bp_out[FIR_BANDPASS][AFSK_RX_BLOCKSIZE];
+static uint8_t bp_used = 0; 
+
 
+/* Audio level (statistics) */
+static uint8_t level_peak = 0;
+static uint16_t level_avg = 0;    // x 16
 
-static void add_bit(bool bit);
+/* Data carrier detect */
+static bool dcd = false;
+static uint8_t dcd_level = 0;
 
-int8_t delay_buf[100];
-int8_t delay_buf1[100]; 
+/* 
+ * Modem mode. To change it, sampling is stopped and the demodulator 
+ * thread discards the samples not processed, switches to new_mode and
+ * signals mode_set. Then sampling is restarted at the new rate. 
+ */
+static uint8_t mode = MODEM_AFSK1200;
+static uint8_t new_mode = MODEM_AFSK1200;
+static bool enabled = false;       // Sampling turned on by afsk_rx_enable
+static MUTEX_DECL(mode_mutex);     // Protects enabled and mode changes
+static BSEMAPHORE_DECL(mode_set, true);
 
-fifo_t fifo, fifo1; 
+static void add_bit(AfskRx* rx, bool bit, uint8_t conf);
+static void dcd_update(uint8_t ratio);
+static void afsk_process_sample(AfskRx* rx, int16_t sample);
+static void afsk_process_block(int8_t* block, size_t n);
+static void g3ruh_process_block(int8_t* block, size_t n);
+static void g3ruh_process_sample(AfskRx* rx, int16_t sample);
+static void audio_level(int8_t* block, size_t n);
+static void rx_reset(void);
+static THD_FUNCTION(afsk_rxdemod, arg);
 
 
 
@@ -77,21 +328,45 @@ fifo_t fifo, fifo1;
   Modem Initialization                             
  *******************************************/
 
-input_queue_t* afsk_rx_init() {
+void afsk_rx_init() {
   /* Allocate memory for struct */
-  memset(&afsk, 0, sizeof(afsk));
+  memset(afsk, 0, sizeof(afsk));
   
-  fifo_init(&fifo, delay_buf, sizeof(delay_buf));
-  fifo_init(&fifo1, delay_buf1, sizeof(delay_buf1));
+  memset(&prof, 0, sizeof(prof));
+  cycles_init();
+  ring_init(&rxring, _samples, AFSK_RX_RINGSIZE);
   
-  /* Fill sample FIFO with 0 */
-  for (int i = 0; i < SAMPLESPERBIT / 2; i++) {
-    fifo_push(&fifo, 0);
-    fifo_push(&fifo1, 0);
+  for (int i = 0; i < AFSK_RX_VARIANTS; i++) {
+    afsk[i].var = &variants[i];
+    bp_used |= (1 << variants[i].mark) | (1 << variants[i].space);
+    iqObjectInit(&afsk[i].iq, afsk[i].buf, AFSK_RX_QUEUE_SIZE, NULL, NULL);
+  }
+  afsk_rx_setAgc(GET_BYTE_PARAM(AGC_DECAY), GET_BYTE_PARAM(AGC_FLOOR));
+  for (int i = 0; i < FIR_BANDPASS; i++) {
+    bp_agc[i].peak = 2*AGC_LEVEL;
+    bp_agc[i].gain = 1 << 8;
   }
   
-  iqObjectInit(&iq, _buf,  AFSK_RX_QUEUE_SIZE, NULL, NULL);
-  return &iq;
+  setPinMode(LED_DCD, PAL_MODE_OUTPUT_PUSHPULL);
+  clearPin(LED_DCD);
+  /* Thread is not running and sampling is off, set the mode directly */
+  mode = new_mode = GET_BYTE_PARAM(MODEM);
+  if (mode > MODEM_G3RUH9600)
+     mode = new_mode = MODEM_AFSK1200;
+  adc_set_highrate(mode == MODEM_G3RUH9600);
+  THREAD_START(afsk_rxdemod, NORMALPRIO+3, NULL);
+}
+
+
+
+/*********************************************
+ * Get queue of decoded bits from demodulator 
+ * variant i. 
+ *********************************************/
+
+input_queue_t* afsk_rx_queue(uint8_t i)
+{
+  return (i < AFSK_RX_VARIANTS ? &afsk[i].iq : NULL);
 }
 
 
@@ -100,171 +375,427 @@ input_queue_t* afsk_rx_init() {
  *********************************************/
 
 void afsk_rx_enable() 
-   { adc_start_sampling(); }
+{ 
+   chMtxLock(&mode_mutex);
+   enabled = true;
+   adc_start_sampling(); 
+   chMtxUnlock(&mode_mutex);
+}
    
 void afsk_rx_disable() 
-   { adc_stop_sampling(); }
+{ 
+   chMtxLock(&mode_mutex);
+   enabled = false;
+   adc_stop_sampling(); 
+   dcd_level = 0;
+   dcd_update(0);
+   chMtxUnlock(&mode_mutex);
+}
+  
+  
+/*********************************************
+ * Set modem mode: MODEM_AFSK1200 or 
+ * MODEM_G3RUH9600. Sampling is stopped, the 
+ * demodulator thread discards samples taken 
+ * at the old rate and resets its state, then
+ * sampling is restarted at the new rate. 
+ *********************************************/
+
+void afsk_rx_setMode(uint8_t m)
+{
+   if (m > MODEM_G3RUH9600)
+      m = MODEM_AFSK1200;
+   chMtxLock(&mode_mutex);
+   if (m == new_mode) {
+      chMtxUnlock(&mode_mutex);
+      return;
+   }
+   if (enabled) {
+      adc_stop_sampling();
+      sleep(1);   // Let a conversion in progress complete
+   }
+   new_mode = m;
+   chBSemSignal(&rxready);
+   chBSemWait(&mode_set);
+   adc_set_highrate(m == MODEM_G3RUH9600);
+   if (enabled)
+      adc_start_sampling();
+   chMtxUnlock(&mode_mutex);
+}
 
 
+uint8_t afsk_rx_mode()
+   { return new_mode; }
+   
+   
+   
 /*********************************************
- * Handler for squelch on/off signal
+ * Reset the state of the demodulators, 
+ * when changing mode. 
  *********************************************/
 
-void trx_sq_handler(EXTDriver *extp, expchannel_t channel) {
-   (void) extp;
-   (void) channel;
-}  
-  
-  
-#define ABS(x) ((x) < 0 ? -(x) : (x))
+static void rx_reset()
+{
+   for (uint8_t v=0; v<AFSK_RX_VARIANTS; v++) {
+      AfskRx *rx = &afsk[v];
+      memset(&rx->lp, 0, sizeof(rx->lp));
+      rx->sampled_bits = rx->found_bits = 0;
+      rx->curr_phase = 0;
+      rx->cd = false;
+      rx->cd_hist = 0;
+      rx->since_trans = 0;
+      rx->prev_sample = 0;
+      rx->dc = 0;
+      rx->level_conf = 0;
+      rx->octet = rx->bit_count = 0;
+      rx->conf = rx->scrambler = 0;
+   }
+   dcd_level = 0;
+   dcd_update(0);
+}
 
 
-#define FIR_MAX_TAPS 16
+  
+/******************************************************************************
+   Automatic gain control. 
+   Track the peak of the envelope of a tone and scale the envelope so that 
+   the peak is at AGC_LEVEL. The peak (kept at twice the envelope level for 
+   resolution) decays by agc_decay each sample, but not below agc_floor, 
+   to avoid amplifying noise too much. 
+   
+   Integer only (no FPU): The gain is a 8.8 fixed point number, and it is 
+   recomputed only when the peak changes. 
+*******************************************************************************/
 
+static uint8_t agc_decay;
+static uint8_t agc_floor;
 
-/************************************************
- * FIR filtering 
- ************************************************/
 
-typedef struct FIR
+static inline int16_t agc (int16_t in, Agc* a)
 {
-  int8_t taps;
-  int8_t coef[FIR_MAX_TAPS];
-  int16_t mem[FIR_MAX_TAPS];
-} FIR;
+    uint16_t peak = a->peak; 
+    if (peak > agc_floor + agc_decay)
+       peak -= agc_decay;
+    else 
+       peak = agc_floor;
+    if (in*2 > peak)
+       peak = in*2;
+    
+    if (peak != a->peak) {
+       a->peak = peak;
+       a->gain = ((uint32_t) AGC_LEVEL*2 << 8) / peak;
+    }
+    return (int16_t) (((int32_t) in * a->gain) >> 8);
+}
 
 
-enum fir_filters
-{
-  FIR_1200_BP=0,
-  FIR_2200_BP=1,
-  FIR_1200_LP=2
-};
 
+/******************************************************************************
+   Set AGC peak tracking constants: Decay per sample and floor (minimum
+   peak level).
+*******************************************************************************/
 
-static FIR fir_table[] =
+void afsk_rx_setAgc(uint8_t decay, uint8_t minpeak)
 {
-  [FIR_1200_BP] = {
-    .taps = 11,
-    .coef = {
-      -12, -16, -15, 0, 20, 29, 20, 0, -15, -16, -12
-    },
-    .mem = {
-      0,
-    },
-  },
-  [FIR_2200_BP] = {
-    .taps = 11,
-    .coef = {
-      11, 15, -8, -26, 4, 30, 4, -26, -8, 15, 11
-    },
-    .mem = {
-      0,
-    },
-  },
-  [FIR_1200_LP] = {
-    .taps = 8,
-    .coef = {
-      -9, 3, 26, 47, 47, 26, 3, -9
-    },
-    .mem = {
-      0,
-    },
-  },
-};
+    if (minpeak == 0)
+       minpeak = 1;
+    agc_decay = decay;
+    agc_floor = minpeak;
+}
 
 
-static int8_t fir_filter(int8_t s, enum fir_filters f)
+
+/***************************************************************
+ * Hand over a sample from the ADC to the demodulator thread. 
+ * To be called from the ADC callback (ISR). The sample is put
+ * into the ring without locking. The system is locked only 
+ * to wake up the thread, once per block. If the demodulator
+ * cannot keep up and the ring is full, the sample is dropped 
+ * and counted as an overflow. 
+ ***************************************************************/
+
+void afsk_rx_sample(int8_t x)
 {
-  int8_t Q = fir_table[f].taps - 1;
-  int8_t *B = fir_table[f].coef;
-  int16_t *Bmem = fir_table[f].mem;
-  
-  int8_t i;
-  int16_t y;
-  
-  Bmem[0] = s;
-  y = 0;
-  
-  for (i = Q; i >= 0; i--)
-  {
-    y += Bmem[i] * B[i];
-    Bmem[i + 1] = Bmem[i];
-  }
-  
-  return (int8_t) (y / 128);
+    uint32_t t = cycles_get();
+    ring_put(&rxring, x);
+    if (++rxcount >= AFSK_RX_BLOCKSIZE) {
+       rxcount = 0;
+       chSysLockFromISR();
+       chBSemSignalI(&rxready);
+       chSysUnlockFromISR();
+    }
+    t = cycles_get() - t;
+    if (t > isr_max)
+       isr_max = t;
 }
 
 
+uint32_t afsk_rx_overruns()
+   { return rxring.overflows; }
 
-/******************************************************************************
-   Automatic gain control. 
-   
-*******************************************************************************/
 
-#define DECAY 5
 
-static uint8_t peak_mk = 250;
-static uint8_t peak_sp = 250;
+/***************************************************************
+ * Demodulator thread. Wait for samples from the ADC and run 
+ * them through the demodulator, a block at a time. 
+ ***************************************************************/
+
+__attribute__((noreturn))
+static THD_FUNCTION(afsk_rxdemod, arg)
+{
+    (void)arg;
+    int8_t block[AFSK_RX_BLOCKSIZE];
+    chRegSetThreadName("AFSK RX Demodulator");
+    while (true) {
+       chBSemWait(&rxready);
+       if (new_mode != mode) {
+          /* Sampling is stopped. Discard what is left at the old rate */
+          uint16_t n;
+          while ((n = ring_len(&rxring)) > 0)
+             ring_read(&rxring, block, (n < AFSK_RX_BLOCKSIZE ? n : AFSK_RX_BLOCKSIZE));
+          rxcount = 0;
+          mode = new_mode;
+          rx_reset();
+          chBSemSignal(&mode_set);
+          continue;
+       }
+       while (ring_len(&rxring) >= AFSK_RX_BLOCKSIZE) {
+          ring_read(&rxring, block, AFSK_RX_BLOCKSIZE);
+          afsk_process_block(block, AFSK_RX_BLOCKSIZE);
+       }
+    }
+}
+
+
 
+/***************************************************************
+ * Demodulate a block of samples. Each stage of the demodulator
+ * is run over the whole block before the next, and the time 
+ * spent in each stage is accumulated for profiling. 
+ ***************************************************************/
 
-static int8_t agc (int8_t in, uint8_t *ppeak)
+static void afsk_process_block(int8_t* block, size_t n)
 {
-    if (*ppeak > 100) 
-       *ppeak -= DECAY; 
-    if (in*2 > *ppeak)
-       *ppeak = in*2;
+    int16_t x[AFSK_RX_BLOCKSIZE];
+    uint32_t t0, t1;
+    size_t i;
+    uint8_t f, v;
+    
+    if (n > AFSK_RX_BLOCKSIZE)
+       n = AFSK_RX_BLOCKSIZE;
+    audio_level(block, n);
+    if (mode == MODEM_G3RUH9600) {
+       g3ruh_process_block(block, n);
+       return;
+    }
+    t0 = cycles_get();
+    
+    /* Bandpass filters for mark and space tones. Each filter is
+     * run once, even if it is used by more than one variant */
+    for (i=0; i<n; i++)
+       x[i] = block[i];
+    for (f=0; f<FIR_BANDPASS; f++)
+       if (bp_used & (1 << f))
+          fir_filter(f, &bp_state[f], x, bp_out[f], n);
+    t1 = cycles_get(); 
+    prof.cycles[AFSK_PROF_BANDPASS] += t1 - t0; 
+    t0 = t1;
+    
+    /* Tone energy ratio for DCD, before gain control. Close to 1 if one
+     * of the tones dominates, lower for noise */
+    uint32_t diff = 0, sum = 0;
+    for (i=0; i<n; i++) {
+       int16_t m = ABS(bp_out[FIR_1200_BP][i]);
+       int16_t s = ABS(bp_out[FIR_2200_BP][i]);
+       diff += ABS(m - s);
+       sum += m + s;
+    }
+    
+    /* Envelope with gain control */
+    for (f=0; f<FIR_BANDPASS; f++)
+       if (bp_used & (1 << f))
+          for (i=0; i<n; i++)
+             bp_out[f][i] = agc(ABS(bp_out[f][i]), &bp_agc[f]);
+    t1 = cycles_get(); 
+    prof.cycles[AFSK_PROF_AGC] += t1 - t0; 
+    t0 = t1;
     
-    float factor = 250.0f / *ppeak;
-    return (int8_t) factor * (float) in;
+    for (v=0; v<AFSK_RX_VARIANTS; v++) {
+       AfskRx *rx = &afsk[v];
+       const int16_t *mark = bp_out[rx->var->mark];
+       const int16_t *space = bp_out[rx->var->space];
+       
+       /* Difference between tones. Lowpass filter */
+       for (i=0; i<n; i++)
+          x[i] = space[i] - mark[i];
+       fir_filter(FIR_1200_LP, &rx->lp, x, x, n);
+       t1 = cycles_get(); 
+       prof.cycles[AFSK_PROF_LOWPASS] += t1 - t0; 
+       t0 = t1;
+    
+       /* Slicer, bit clock recovery and decoding */
+       for (i=0; i<n; i++)
+          afsk_process_sample(rx, x[i] - rx->var->bias);
+       t1 = cycles_get(); 
+       prof.cycles[AFSK_PROF_PLL] += t1 - t0; 
+       t0 = t1;
+    }
+    prof.samples += n;
+    dcd_update(sum > 0 ? (diff << 8) / sum : 0);
 }
 
 
 
 /***************************************************************
-  This routine should be called 9600
-  times each second to analyze samples taken from
-  the physical medium. 
-****************************************************************/
+ * Demodulate a block of samples in G3RUH 9600 baud mode. This
+ * is baseband FSK, so we just need a lowpass (receive) filter 
+ * in front of the slicer. Only the first demodulator is used. 
+ ***************************************************************/
 
-void afsk_process_sample(int8_t curr_sample) 
-{ 
-    chSysLock();
-    afsk.iirY[0] = fir_filter(curr_sample, FIR_1200_BP);
-    afsk.iirY[1] = fir_filter(curr_sample, FIR_2200_BP);
-    afsk.iirY[0] = ABS(afsk.iirY[0]);
-    afsk.iirY[1] = ABS(afsk.iirY[1]);
+static void g3ruh_process_block(int8_t* block, size_t n)
+{
+    int16_t x[AFSK_RX_BLOCKSIZE];
+    AfskRx *rx = &afsk[0];
+    uint32_t t0, t1;
+    size_t i;
     
-    afsk.iirY[0] = agc(afsk.iirY[0], &peak_mk);
-    afsk.iirY[1] = agc(afsk.iirY[1], &peak_sp);
+    t0 = cycles_get();
+    for (i=0; i<AFSK_RX_BLOCKSIZE; i++)
+       x[i] = (i < n ? block[i] : 0);
+    fir_filter(FIR_9600_LP, &rx->lp, x, x, n);
+    t1 = cycles_get(); 
+    prof.cycles[AFSK_PROF_LOWPASS] += t1 - t0; 
+    t0 = t1;
     
+    for (i=0; i<n; i++)
+       g3ruh_process_sample(rx, x[i]);
+    prof.cycles[AFSK_PROF_PLL] += cycles_get() - t0; 
+    prof.samples += n;
     
-    afsk.sampled_bits <<= 1;
-    afsk.sampled_bits |= fir_filter(afsk.iirY[1] - afsk.iirY[0], FIR_1200_LP) > 0;
+    /* There are no tones to compare, DCD depends on the bit clock only */
+    dcd_update(255);
+}
+
+
+
+/*******************************************************************
+ * Get profiling info: Number of samples processed and CPU cycles 
+ * spent in each stage of the demodulator. 
+ *******************************************************************/
+
+void afsk_rx_getProfile(afsk_prof_t* p, bool reset)
+{
+    chSysLock();
+    *p = prof;
+    p->overflows = rxring.overflows;
+    p->ring_hwm = rxring.hwm;
+    p->isr_max = isr_max;
+    if (reset) {
+       memset(&prof, 0, sizeof(prof));
+       rxring.overflows = 0;
+       rxring.hwm = 0;
+       isr_max = 0;
+    }
+    chSysUnlock();
+}
+
+
+
+/*******************************************************************
+ * Audio level of a block of samples: Peak since last reset and 
+ * average of absolute value (smoothed over about 16 blocks). 
+ *******************************************************************/
+
+static void audio_level(int8_t* block, size_t n)
+{
+    uint16_t sum = 0;
+    for (size_t i=0; i<n; i++) {
+       uint8_t x = ABS(block[i]);
+       sum += x;
+       if (x > level_peak)
+          level_peak = x;
+    }
+    level_avg = level_avg - (level_avg >> 4) + sum / n;
+}
+
+
+
+/*******************************************************************
+ * Get statistics from the demodulators. Counters are the sum of 
+ * all variants. 
+ *******************************************************************/
+
+void afsk_rx_getStats(afsk_rxstat_t* st, bool reset)
+{
+    memset(st, 0, sizeof(afsk_rxstat_t));
+    chSysLock();
+    for (uint8_t v=0; v<AFSK_RX_VARIANTS; v++) {
+       st->pll_adjust += afsk[v].pll_adjust;
+       st->iq_overflows += afsk[v].iq_overflows;
+       if (reset)
+          afsk[v].pll_adjust = afsk[v].iq_overflows = 0;
+    }
+    st->peak = level_peak;
+    st->avg = (uint8_t) (level_avg >> 4);
+    if (reset)
+       level_peak = 0;
+    chSysUnlock();
+}
+
+
+
+/***************************************************************
+  This routine should be called 9600 times each second with 
+  the input to the slicer (the lowpass filtered difference 
+  between the mark and space tone energy, minus the bias). 
+  It recovers the bit clock and the bits. 
+****************************************************************/
+
+#define CONF_SHIFT 3     /* Slicer input to confidence (0-15) */
+#define DCD_MAXRUN (8 * SAMPLESPERBIT)
+
+static void afsk_process_sample(AfskRx* rx, int16_t sample) 
+{ 
+    int16_t mid = rx->prev_sample;
+    rx->prev_sample = sample;
+    rx->sampled_bits <<= 1;
+    rx->sampled_bits |= (sample > 0);
     
     /* 
      * If there is a transition, adjust the phase of our sampler
      * to stay in sync with the transmitter. 
      */ 
-    if (TRANSITION_FOUND(afsk.sampled_bits)) {
-        if (afsk.curr_phase < PHASE_THRESHOLD) {
-            afsk.curr_phase += PHASE_INC;
+    if (TRANSITION_FOUND(rx->sampled_bits)) {
+        /* A good transition is within one sample of the expected time */
+        int8_t err = rx->curr_phase - PHASE_THRESHOLD; 
+        rx->cd_hist = (rx->cd_hist << 1) | (ABS(err) <= PHASE_BITS);
+        rx->since_trans = 0;
+        
+        if (rx->curr_phase < PHASE_THRESHOLD) {
+            rx->curr_phase += rx->var->phase_inc;
         } else {
-            afsk.curr_phase -= PHASE_INC;
+            rx->curr_phase -= rx->var->phase_inc;
         }
+        rx->pll_adjust++;
+    }
+
+    else if (++rx->since_trans >= DCD_MAXRUN) {
+        /* Too long without transitions to be data */
+        rx->cd_hist <<= 1;
+        rx->since_trans = 0;
     }
 
-    afsk.curr_phase += PHASE_BITS;
+    rx->curr_phase += PHASE_BITS;
 
     /* Check if we have reached the end of
      * our sampling window.
      */ 
-    if (afsk.curr_phase >= PHASE_MAX) 
+    if (rx->curr_phase >= PHASE_MAX) 
     { 
-        afsk.curr_phase %= PHASE_MAX;
+        rx->curr_phase %= PHASE_MAX;
 
         /* Shift left to make room for the next bit */
-        afsk.found_bits <<= 1;
+        rx->found_bits <<= 1;
 
         /*
          * Determine bit value by reading the last 3 sampled bits.
@@ -272,46 +803,179 @@ void afsk_process_sample(int8_t curr_sample)
          * otherwise is a 0.
          * This algorithm presumes that there are 8 samples per bit.
          */
-        uint8_t bits = afsk.sampled_bits & 0x07;
+        uint8_t bits = rx->sampled_bits & 0x07;
         if ( bits == 0x07     // 111, 3 bits set to 
               || bits == 0x06 // 110, 2 bits
               || bits == 0x05 // 101, 2 bits
               || bits == 0x03 // 011, 2 bits
            )
-           afsk.found_bits |= 1;
+           rx->found_bits |= 1;
+        
+        /*
+         * Confidence of the bit is given by the distance from the 
+         * slicer threshold in the middle of the 3 samples. Halve it
+         * if the samples do not agree. 
+         */
+        uint8_t conf = ABS(mid) >> CONF_SHIFT;
+        if (conf > 15)
+           conf = 15;
+        if (bits != 0x07 && bits != 0x00)
+           conf >>= 1;
 
         /* 
          * Now we can pass the actual bit to the HDLC parser.
          * We are using NRZI coding, so if 2 consecutive bits
          * have the same value, we have a 1, otherwise a 0.
          * We use the TRANSITION_FOUND function to determine this.
+         * The decoded bit depends on both, so its confidence is 
+         * the lowest of the two. 
          */
-        add_bit( !TRANSITION_FOUND(afsk.found_bits) );
+        add_bit(rx, !TRANSITION_FOUND(rx->found_bits), 
+                 (conf < rx->level_conf ? conf : rx->level_conf) );
+        rx->level_conf = conf;
     }
-    chSysUnlock();
 } 
 
 
 
+/***************************************************************
+  G3RUH 9600 baud. This routine should be called 38400 times 
+  each second with the lowpass filtered signal. The slicer 
+  threshold follows the DC level of the signal (slowly, the 
+  time constant is 64 bits). Bit clock 
+  recovery is like in the AFSK case, but with 4 samples per 
+  bit, the bit is decided from the sample at the middle of the 
+  bit. 
+  
+  The transmitter scrambles the NRZI encoded bits with the 
+  polynomial x^17 + x^12 + 1. The descrambler is self 
+  synchronising: The output is the received bit XOR the bits 
+  received 12 and 17 bits earlier. 
+****************************************************************/
+
+#define CONF_SHIFT_9600 2
+#define DCD_MAXRUN_9600 (8 * SAMPLESPERBIT_9600)
+
+static void g3ruh_process_sample(AfskRx* rx, int16_t sample)
+{
+    rx->dc += sample - (rx->dc >> 8);
+    sample -= (int16_t) (rx->dc >> 8);
+    rx->sampled_bits <<= 1;
+    rx->sampled_bits |= (sample > 0);
+    
+    if (TRANSITION_FOUND(rx->sampled_bits)) {
+        int8_t err = rx->curr_phase - PHASE_THRESHOLD; 
+        rx->cd_hist = (rx->cd_hist << 1) | (ABS(err) <= PHASE_BITS_9600);
+        rx->since_trans = 0;
+        
+        if (rx->curr_phase < PHASE_THRESHOLD) 
+            rx->curr_phase += PHASE_INC_9600;
+        else 
+            rx->curr_phase -= PHASE_INC_9600;
+        rx->pll_adjust++;
+    }
+    else if (++rx->since_trans >= DCD_MAXRUN_9600) {
+        rx->cd_hist <<= 1;
+        rx->since_trans = 0;
+    }
+    
+    rx->curr_phase += PHASE_BITS_9600;
+    if (rx->curr_phase >= PHASE_MAX) 
+    { 
+        rx->curr_phase %= PHASE_MAX;
+        
+        uint8_t bit = rx->sampled_bits & 0x01; 
+        uint8_t conf = ABS(sample) >> CONF_SHIFT_9600;
+        if (conf > 15)
+           conf = 15;
+        if (TRANSITION_FOUND(rx->sampled_bits))
+           conf >>= 1;
+        
+        /* Descramble */
+        uint8_t dbit = bit ^ ((rx->scrambler >> 11) & 0x01) ^ ((rx->scrambler >> 16) & 0x01);
+        rx->scrambler = (rx->scrambler << 1) | bit;
+        
+        /* NRZI decoding. An error in the received bit affects three 
+         * descrambled bits, so the confidence is only an indication */
+        rx->found_bits = (rx->found_bits << 1) | dbit; 
+        add_bit(rx, !TRANSITION_FOUND(rx->found_bits), 
+                 (conf < rx->level_conf ? conf : rx->level_conf) );
+        rx->level_conf = conf;
+    }
+}
+
+
+
 /*********************************************************
- * Send a single bit to the HDLC decoder
+ * Send a single bit to the HDLC decoder, with its 
+ * confidence (0-15). For each 8 bits, a record of 
+ * AFSK_RX_RECSIZE bytes is put into the queue: The 
+ * octet (first bit in LSB) and the confidence of 
+ * each bit (4 bits each, first bit in the low nibble 
+ * of the first byte). 
  *********************************************************/
 
-static uint8_t bit_count = 0;
-
-static void add_bit(bool bit)
+static void add_bit(AfskRx* rx, bool bit, uint8_t conf)
 { 
-  static uint8_t octet;
-  octet = (octet >> 1) | (bit ? 0x80 : 0x00);
-  bit_count++;
+  rx->octet = (rx->octet >> 1) | (bit ? 0x80 : 0x00);
+  rx->conf = (rx->conf >> 4) | ((uint32_t) conf << 28);
+  rx->bit_count++;
   
-  if (bit_count == 8) 
+  if (rx->bit_count == 8) 
   {        
-//    chSysLock();
-    if  (!iqIsFullI(&iq)) 
-       iqPutI(&iq, octet);
-//    chSysUnlock();
-    bit_count = 0;
+    chSysLock();
+    if  (iqGetEmptyI(&rx->iq) >= AFSK_RX_RECSIZE) {
+       iqPutI(&rx->iq, rx->octet);
+       for (uint8_t i=0; i<4; i++)
+          iqPutI(&rx->iq, (uint8_t) (rx->conf >> (i*8)));
+    }
+    else
+       rx->iq_overflows++;
+    chSysUnlock();
+    rx->bit_count = 0;
   }
 }
 
+
+
+/*********************************************************
+ * Data carrier detect. 
+ * 
+ * DCD is on when the bit clock of at least one of the 
+ * demodulators is locked, i.e. most of the last 16 
+ * transitions came close to the expected time, and the 
+ * tone energy ratio (smoothed, 0-255) is high. It is 
+ * turned off with some hysteresis. Called for each block.
+ *********************************************************/
+
+#define DCD_GOOD_ON   12      /* Good transitions of 16 to turn on */
+#define DCD_GOOD_OFF   8      /* .. and to stay on */
+#define DCD_RATIO_ON 150      /* Tone energy ratio to turn on */
+#define DCD_RATIO_OFF 110     /* .. and to stay on */
+
+static void dcd_update(uint8_t ratio)
+{
+   uint8_t good = 0; 
+   for (uint8_t v=0; v<AFSK_RX_VARIANTS; v++) {
+      AfskRx *rx = &afsk[v];
+      uint8_t g = __builtin_popcount(rx->cd_hist);
+      rx->cd = (g >= (rx->cd ? DCD_GOOD_OFF : DCD_GOOD_ON));
+      if (rx->cd && g > good)
+         good = g;
+   }
+   dcd_level = (uint8_t) (((uint16_t) dcd_level * 3 + ratio) / 4);
+   
+   bool on = (good > 0 && dcd_level >= (dcd ? DCD_RATIO_OFF : DCD_RATIO_ON));
+   if (on == dcd)
+      return;
+   dcd = on;
+   if (on)
+      setPin(LED_DCD);
+   else
+      clearPin(LED_DCD);
+   radio_dcd(on);
+}
+
+
+bool afsk_rx_dcd()
+   { return dcd; }
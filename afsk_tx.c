@@ -10,26 +10,61 @@
 #include "radio.h"
 #include "afsk.h"
 #include "defines.h"
+#include "config.h"
+#include "util/DAC.h"
 
 
 #define CLOCK_FREQ 1200
 
+/* G3RUH 9600 baud: Baseband signal, 4 DAC samples per bit */
+#define G3RUH_BITRATE     9600
+#define G3RUH_OVERSAMPLE  4
+#define G3RUH_CLOCK_FREQ  (G3RUH_BITRATE * G3RUH_OVERSAMPLE)
+#define DAC_MIDLEVEL      2048
 
 
-static uint8_t _buf[AFSK_TX_QUEUE_SIZE];
-static output_queue_t oq; 
 
+/* NRZI encoded flag, when the level before it is 0 or 1 */
+static const uint8_t flag_nrzi[2] = {0x7F, 0x80};
+
+
+/* 
+ * Transmission being sent: Preamble flags, pre-rendered bits and 
+ * postamble flags. Set by afsk_tx_send and walked by the bit clock. 
+ */
+static const uint8_t* tx_buf; 
+static uint16_t tx_nbits;          // Number of bits in tx_buf
+static uint16_t tx_pos;            // Next bit to load from tx_buf
+static uint16_t tx_pre, tx_post;   // Flags remaining before/after 
+static bool     tx_loop = false;   // Repeat tx_buf until cancelled
+static volatile bool tx_busy = false; 
+static BSEMAPHORE_DECL(tx_done, true);
 
 static bool transmit = false; 
+static uint8_t mode = MODEM_AFSK1200;
+static bool clock_on = false;      // Bit clock (GPT) running
+static MUTEX_DECL(clock_mutex);    // Protects clock_on, held while starting/stopping
+static uint32_t clock_irqs = 0;    // Number of bit clock interrupts
 
+static void afsk_txBitClock(GPTDriver *gptp);
+static void g3ruh_txSample(GPTDriver *gptp);
+static void clock_start(void);
+static void clock_stop(void);
 
-output_queue_t* afsk_tx_init()
+void afsk_tx_init()
 {
-  oqObjectInit(&oq, _buf, AFSK_TX_QUEUE_SIZE, NULL, NULL);
-  return &oq;
+  tx_busy = false;
+  chBSemObjectInit(&tx_done, true);
+  mode = GET_BYTE_PARAM(MODEM);
+  if (mode > MODEM_G3RUH9600)
+     mode = MODEM_AFSK1200;
 }
 
 
+uint32_t afsk_tx_irqCount()
+   { return clock_irqs; }
+
+
 /*********************************************************************
  * Turn on/off transmitter and tone generator
  *********************************************************************/
@@ -37,7 +72,12 @@ output_queue_t* afsk_tx_init()
 void afsk_PTT(bool on) {
    transmit = on; 
    radio_PTT(on);
-   if (on) 
+   if (mode == MODEM_G3RUH9600) {
+      if (on)
+         dac_init();
+      analogWrite(DAC_MIDLEVEL);
+   }
+   else if (on) 
       tone_start();
    else
       tone_stop();
@@ -45,71 +85,148 @@ void afsk_PTT(bool on) {
 
 
 
+/***************************************************************************
+ * Send a pre-rendered transmission: 'preamble' flags, 'nbits' bits from 
+ * 'buf' (NRZI encoded, first bit in LSB, starting at level 0) and 
+ * 'postamble' flags. If 'loop' is true, the bits are repeated until 
+ * afsk_tx_cancel is called. The buffer must not be changed until the 
+ * transmission is finished (see afsk_tx_wait). The bit clock is started
+ * if not already running. 
+ ***************************************************************************/
+
+void afsk_tx_send(const uint8_t* buf, uint16_t nbits, uint16_t preamble, uint16_t postamble, bool loop)
+{
+   afsk_tx_wait();
+   chMtxLock(&clock_mutex);
+   clock_start();
+   chSysLock();
+   tx_buf = buf;
+   tx_nbits = nbits;
+   tx_pos = 0;
+   tx_pre = preamble;
+   tx_post = postamble;
+   tx_loop = loop && nbits > 0;
+   tx_busy = true;
+   chSysUnlock();
+   chMtxUnlock(&clock_mutex);
+}
+
+
+/* Stop repeating the bits of a looping transmission */
+void afsk_tx_cancel()
+   { tx_loop = false; }
+
+
+/* Wait until transmission is finished */
+void afsk_tx_wait()
+{
+   while (tx_busy)
+      chBSemWait(&tx_done);
+}
+
+
+
 /**************************************************************************
- * Get next bit from stream
- * Note: see also get_bit() in hdlc_decoder.c 
+ * Get next bit (line level) of transmission.
  * Note: The next_byte must ALWAYS be called before get_bit is called
- * to get new bytes from stream. 
+ * to get new bytes. 
  *************************************************************************/
 
 static uint8_t bits;
 static uint8_t bit_count = 0;
+static uint8_t last_bit = 0;
 
 static uint8_t get_bit(void)
 {
    if (bit_count == 0) 
-     return 0;
-   uint8_t bit = bits & 0x01;
+     return last_bit;
+   last_bit = bits & 0x01;
    bits >>= 1;
    bit_count--;
-   return bit;
+   return last_bit;
 }
 
 
 static void next_byte(void)
 {
-   if (bit_count == 0) 
-   {
-      /* Turn off TX if queue is empty (have reached end of frame) */
-      if (oqIsEmptyI(&oq)) { 
-         afsk_PTT(false);  
-         return;
-      }
-      bits = oqGetI(&oq); 
-      bit_count = 8;    
-   } 
+   if (bit_count > 0) 
+      return;
+   if (tx_pre > 0) {
+      tx_pre--;
+      bits = flag_nrzi[0]; 
+      bit_count = 8;
+      last_bit = 0;
+      return;
+   }
+   if (tx_pos >= tx_nbits && tx_loop) 
+      tx_pos = 0;
+   if (tx_pos < tx_nbits) {
+      bits = tx_buf[tx_pos >> 3]; 
+      bit_count = (tx_nbits - tx_pos < 8 ? tx_nbits - tx_pos : 8); 
+      tx_pos += bit_count;
+      return;
+   }
+   if (tx_post > 0) {
+      tx_post--;
+      bits = flag_nrzi[last_bit];
+      bit_count = 8;
+      return;
+   }
+   
+   /* Turn off TX when all is sent */
+   if (transmit) {
+      afsk_PTT(false);  
+      chSysLockFromISR();
+      tx_busy = false;
+      chBSemSignalI(&tx_done);
+      chSysUnlockFromISR();
+   }
 }
 
 
 
 /*******************************************************************************
- * If transmitting, this function should be called periodically, 
- * at same rate as wanted baud rate.
- *
- * It is responsible for transmitting frames by toggling the frequency of
- * the tone generated by the timer handler below. 
+ * Called periodically, at same rate as wanted baud rate. Starts the 
+ * transmitter when there is something to send. 
  *******************************************************************************/ 
 
 static void afsk_txBitClock(GPTDriver *gptp) {
      (void)gptp;
      
-     if (!transmit) {
-       if (oqIsEmptyI(&oq))
-         return;
-       else {
-         /* If bytes in queue, start transmitting */
+     clock_irqs++;
+     if (!transmit && tx_busy) {
+         /* If a transmission is waiting, start transmitting */
+         last_bit = 0;
          next_byte();
          afsk_PTT(true);
-       }
      }       
-     if ( ! get_bit() ) 
-       /* Toggle TX frequency */ 
-       tone_toggle(); 
-     
-     /* Update byte from stream if necessary. We do this 
-      * separately, after the get_bit, to make the timing more precise 
+}
+
+
+
+/*******************************************************************************
+ * Called by the tone generator at each bit boundary while transmitting.
+ *
+ * It is responsible for transmitting frames by toggling the frequency of
+ * the tone. The bits are already NRZI encoded, so the frequency is 
+ * toggled when the level changes. 
+ *******************************************************************************/ 
+
+void afsk_tx_nextBit() {
+     /* Update byte from stream if necessary. When all is sent, this 
+      * turns off the transmitter, at the end of the last bit and not 
+      * at its start. The new frequency takes effect from the next 
+      * sample put in the DAC buffer, so the order does not matter 
+      * for the timing. 
       */  
      next_byte();  
+     if (!transmit)
+       return;
+     
+     uint8_t prev = last_bit;
+     if ( get_bit() != prev ) 
+       /* Toggle TX frequency */ 
+       tone_toggle(); 
 }
  
 
@@ -124,27 +241,147 @@ static void afsk_txBitClock(GPTDriver *gptp) {
    afsk_txBitClock   /* Timer callback.*/
  };
  
+ static const GPTConfig g3ruh_cfg = {
+   G3RUH_CLOCK_FREQ,  
+   g3ruh_txSample  
+ };
+ 
+ 
+ 
+/*******************************************************************************
+ * G3RUH 9600 baud baseband transmitter. Called 4 times per bit. 
+ * 
+ * The bits (already NRZI encoded) are scrambled with the polynomial 
+ * x^17 + x^12 + 1. To limit the bandwidth, each bit is shaped as a 
+ * raised cosine pulse (alpha=1) spanning 4 bits. The output is the sum 
+ * of the pulses of the last 4 bits, which is precomputed for each 
+ * combination of bits and for each of the 4 samples within the bit. 
+ *******************************************************************************/
+ 
+ /* DAC levels. Index is last 4 bits (newest bit in LSB) and sample within bit */
+ static const uint16_t g3ruh_shape[16][G3RUH_OVERSAMPLE] = {
+   {  237,  240,  240,  237 },
+   {  254,  266,  195,  148 },
+   {  462, 1397, 2718, 3706 },
+   {  479, 1423, 2673, 3617 },
+   { 3706, 2718, 1397,  462 },
+   { 3723, 2744, 1352,  373 },
+   { 3931, 3875, 3875, 3931 },
+   { 3948, 3901, 3830, 3842 },
+   {  148,  195,  266,  254 },
+   {  165,  221,  221,  165 },
+   {  373, 1352, 2744, 3723 },
+   {  390, 1378, 2699, 3634 },
+   { 3617, 2673, 1423,  479 },
+   { 3634, 2699, 1378,  390 },
+   { 3842, 3830, 3901, 3948 },
+   { 3859, 3856, 3856, 3859 }
+ };
+ 
+ static uint8_t  tx_phase = 0;      // Sample within bit
+ static uint8_t  tx_bits = 0;       // Last 4 bits sent (after scrambling) 
+ static uint32_t tx_scrambler = 0; 
+ 
+ 
+ static void g3ruh_txSample(GPTDriver *gptp) {
+     (void)gptp;
+     
+     clock_irqs++;
+     if (!transmit) {
+       tx_phase = 0;
+       if (!tx_busy)
+         return;
+       else {
+         last_bit = 0;
+         next_byte();
+         afsk_PTT(true);
+       }
+     }
+     if (tx_phase == 0) {
+       /* Turn off only after the 4 samples of the last bit are out */
+       next_byte();
+       if (!transmit)
+         return;
+       uint8_t bit = get_bit() ^ ((tx_scrambler >> 11) & 0x01) ^ ((tx_scrambler >> 16) & 0x01);
+       tx_scrambler = (tx_scrambler << 1) | bit;
+       tx_bits = ((tx_bits << 1) | bit) & 0x0f;
+     }
+     analogWrite(g3ruh_shape[tx_bits][tx_phase]);
+     if (++tx_phase == G3RUH_OVERSAMPLE)
+       tx_phase = 0;
+ }
+ 
  
  
  /***********************************************************
-  *  Start transmitter.
+  *  Start transmitter: Bit clock and DAC. This is done when 
+  *  a transmission is ready, before waiting for the channel, 
+  *  so that keying is not delayed. The encoder thread and the 
+  *  test signal commands may both start and stop the clock, 
+  *  so this is done while holding clock_mutex. 
   ***********************************************************/
  
  void afsk_tx_start() {
-   gptStart(&AFSK_TX_GPT, &bitclock_cfg);
+   chMtxLock(&clock_mutex);
+   clock_start();
+   chMtxUnlock(&clock_mutex);
+ }
+ 
+ static void clock_start() {
+   if (clock_on)
+      return;
+   dac_init();
+   gptStart(&AFSK_TX_GPT, (mode == MODEM_G3RUH9600 ? &g3ruh_cfg : &bitclock_cfg));
    gptStartContinuous(&AFSK_TX_GPT, 1);  
+   clock_on = true;
  }
  
  
  
  /***********************************************************
-  *  Stop transmitter.
+  *  Stop transmitter, unless a transmission is in progress.
   ***********************************************************/
  
  void afsk_tx_stop() {
+   chMtxLock(&clock_mutex);
+   clock_stop();
+   chMtxUnlock(&clock_mutex);
+ }
+ 
+ static void clock_stop() {
+   if (!clock_on || tx_busy)
+      return;
    gptStopTimer(&AFSK_TX_GPT);
    gptStop(&AFSK_TX_GPT);
+   dac_stop();
+   clock_on = false;
+ }
+ 
+ 
+ 
+ /***********************************************************
+  *  Set modem mode: MODEM_AFSK1200 or MODEM_G3RUH9600.
+  *  Wait until ongoing transmission is finished. 
+  ***********************************************************/
+ 
+ void afsk_tx_setMode(uint8_t m) {
+   if (m > MODEM_G3RUH9600)
+      m = MODEM_AFSK1200;
+   if (m == mode)
+      return;
+   chMtxLock(&clock_mutex);
+   afsk_tx_wait();    // No new transmission can start while we hold the mutex
+   bool running = clock_on;
+   clock_stop();
+   chSysLock();
+   mode = m; 
+   tx_scrambler = 0;
+   chSysUnlock();
+   if (running)
+      clock_start();
+   chMtxUnlock(&clock_mutex);
  }
  
  
- 
\ No newline at end of file
+ uint8_t afsk_tx_mode() 
+   { return mode; }
@@ -252,11 +252,22 @@ void ax25_display_frame(Stream* out, FBUF *b)
     }
     if (ctrl == FTYPE_UI)
     {
+       /* 
+        * Write the info field a span at a time, leaving out 
+        * line breaks and control characters. 
+        */
+       const char *data; 
+       uint16_t n, start, j;
        putch(out, ':');    
-       for (i=0; i < fbuf_length(b) - AX25_HDR_LEN(ndigis); i++) {
-          register char c = fbuf_getChar(b); 
-          if (c!='\n' && c!='\r' && c>=(char) 28)
-              putch(out, c);
+       while ((n = fbuf_getSpan(b, &data)) > 0) {
+          for (start=j=0; j < n; j++) {
+             register char c = data[j]; 
+             if (c=='\n' || c=='\r' || c<(char) 28) {
+                streamWrite(out, (const uint8_t*) data+start, j-start);
+                start = j+1;
+             }
+          }
+          streamWrite(out, (const uint8_t*) data+start, n-start);
        }
     }
 
@@ -104,6 +104,13 @@ DEFINE_PARAM ( HTTP_USER,          328, credential );
 DEFINE_PARAM ( HTTP_PASSWD,        361, credential );
 DEFINE_PARAM ( SOFTAP_PASSWD,      394, credential ); // 380
 DEFINE_PARAM ( WIFIAP,             427, __aplist_t );   /* 6 instances = 390 bytes */
+DEFINE_PARAM ( FCS_TRIES,          817, Byte );
+DEFINE_PARAM ( AGC_DECAY,          819, Byte );
+DEFINE_PARAM ( AGC_FLOOR,          821, Byte );
+DEFINE_PARAM ( MODEM,              823, Byte );
+DEFINE_PARAM ( PERSISTENCE,        825, Byte );
+DEFINE_PARAM ( SLOTTIME,           827, Byte );
+DEFINE_PARAM ( CSMA_ADAPT_ON,      829, Byte );
 
 #if defined __CONFIG_C__
 
@@ -162,6 +169,13 @@ DEFAULT_PARAM( HTTP_USER )           = "user";
 DEFAULT_PARAM( HTTP_PASSWD )         = "password";
 DEFAULT_PARAM( SOFTAP_PASSWD )       = "password"; 
 DEFAULT_PARAM( WIFIAP )              = {"", ""}; 
+DEFAULT_PARAM( FCS_TRIES )           = 30;
+DEFAULT_PARAM( AGC_DECAY )           = 5;
+DEFAULT_PARAM( AGC_FLOOR )           = 100;
+DEFAULT_PARAM( MODEM )               = 0;
+DEFAULT_PARAM( PERSISTENCE )         = 80;    /* p = x/255 */
+DEFAULT_PARAM( SLOTTIME )            = 10;    /* Milliseconds/10 */
+DEFAULT_PARAM( CSMA_ADAPT_ON )       = 0;
 
 #endif
 
@@ -0,0 +1,161 @@
+/*
+ * Channel access: P-persistence CSMA and measurement of channel 
+ * utilisation. 
+ */
+
+#include "ch.h"
+#include "hal.h"
+#include "defines.h"
+#include "config.h"
+#include "radio.h"
+#include "csma.h"
+
+
+/*
+ * Channel utilisation is the fraction of time the channel is busy 
+ * (squelch open or data carrier detected). It is measured in each 
+ * interval of LOAD_INTERVAL seconds and averaged over 1, 5 and 15 
+ * minutes (exponentially decaying, like a unix load average). 
+ * Fixed point with FSHIFT bits of fraction. 
+ */
+#define LOAD_INTERVAL  5
+#define FSHIFT         11
+#define FIXED_1        (1 << FSHIFT)
+
+/* FIXED_1 * exp(-LOAD_INTERVAL / window) */
+static const uint16_t load_exp[3] = {1884, 2014, 2037};
+
+static bool busy = false;
+static systime_t busy_since;
+static systime_t busy_time = 0;      // Busy time in current interval
+static uint32_t load[3];
+static virtual_timer_t load_timer;
+
+/* Unique id of MCU (low and mid-low words). Used to seed the random generator */
+#define SIM_UIDML  (*(volatile uint32_t *)0x4004805C)
+#define SIM_UIDL   (*(volatile uint32_t *)0x40048060)
+
+static uint32_t seed = 2463534242UL;
+
+
+
+/*******************************************************
+ * Pseudo random function (xorshift).
+ *******************************************************/
+
+uint8_t rand_u8()
+{
+   seed ^= seed << 13;
+   seed ^= seed >> 17;
+   seed ^= seed << 5;
+   return seed >> 24;
+}
+
+
+
+/*******************************************************
+ * Channel busy or not. Called (with system locked) 
+ * when squelch or DCD changes. 
+ *******************************************************/
+
+void csma_busyI(bool b)
+{
+   systime_t now = chVTGetSystemTimeX();
+   if (b && !busy)
+      busy_since = now;
+   else if (!b && busy)
+      busy_time += now - busy_since;
+   busy = b;
+}
+
+
+
+/*******************************************************
+ * Update utilisation averages. Timer callback, 
+ * every LOAD_INTERVAL seconds. 
+ *******************************************************/
+
+static void load_update(void* p)
+{
+   (void)p;
+   chSysLockFromISR();
+   if (busy) {
+      systime_t now = chVTGetSystemTimeX();
+      busy_time += now - busy_since;
+      busy_since = now;
+   }
+   uint32_t frac = ((uint32_t) busy_time << FSHIFT) / S2ST(LOAD_INTERVAL);
+   if (frac > FIXED_1)
+      frac = FIXED_1;
+   for (uint8_t i=0; i<3; i++)
+      load[i] = (load[i] * load_exp[i] + frac * (FIXED_1 - load_exp[i])) >> FSHIFT;
+   busy_time = 0;
+   chVTSetI(&load_timer, S2ST(LOAD_INTERVAL), load_update, NULL);
+   chSysUnlockFromISR();
+}
+
+
+
+/*******************************************************
+ * Channel utilisation in percent. 
+ * i is CSMA_LOAD_1MIN, CSMA_LOAD_5MIN or CSMA_LOAD_15MIN
+ *******************************************************/
+
+uint8_t csma_load(uint8_t i)
+{
+   if (i > CSMA_LOAD_15MIN)
+      return 0;
+   return (load[i] * 100 + FIXED_1/2) >> FSHIFT;
+}
+
+
+
+/*******************************************************
+ * Persistence to use (p = x/255). In adaptive mode, 
+ * it is lowered as the utilisation over the last 
+ * minute rises, down to 1/4 of the PERSISTENCE 
+ * parameter on a fully busy channel. 
+ *******************************************************/
+
+uint8_t csma_persistence()
+{
+   uint8_t p = GET_BYTE_PARAM(PERSISTENCE);
+   if (GET_BYTE_PARAM(CSMA_ADAPT_ON))
+      p = (p * (FIXED_1 - load[CSMA_LOAD_1MIN] * 3 / 4)) >> FSHIFT;
+   return p;
+}
+
+
+
+/*******************************************************
+ * Wait until we may transmit: 
+ * P-persistence algorithm 
+ *******************************************************/
+
+void csma_wait()
+{
+   uint8_t p = csma_persistence();
+   uint8_t slottime = GET_BYTE_PARAM(SLOTTIME);
+   
+   radio_wait_enabled();  
+   for (;;) {
+      wait_channel_ready(); 
+      if (rand_u8() > p)
+         sleep(slottime*10); 
+      else 
+         break;
+   } 
+}
+
+
+
+void csma_init()
+{
+#if defined(K20x_MCUCONF)
+   seed ^= SIM_UIDL ^ SIM_UIDML;
+   if (seed == 0)
+      seed = 1;
+#endif
+   chVTObjectInit(&load_timer);
+   chVTSet(&load_timer, S2ST(LOAD_INTERVAL), load_update, NULL);
+}
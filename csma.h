@@ -0,0 +1,19 @@
+
+#if !defined __CSMA_H__
+#define __CSMA_H__
+
+#include "ch.h"
+
+/* Channel utilisation windows */
+#define CSMA_LOAD_1MIN   0
+#define CSMA_LOAD_5MIN   1
+#define CSMA_LOAD_15MIN  2
+
+void    csma_init(void);
+void    csma_wait(void);
+void    csma_busyI(bool busy);
+uint8_t csma_load(uint8_t i);
+uint8_t csma_persistence(void);
+uint8_t rand_u8(void);
+
+#endif /* __CSMA_H__ */
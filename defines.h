@@ -16,9 +16,13 @@
 #define FEET2M 3.2898
 
 
-/* Buffers */
-#define FBUF_SLOTS   900
-#define FBUF_SLOTSIZE  32
+/* Buffers. Small slots for headers, large slots for payload. 
+ * LSLOTSIZE must be a multiple of SLOTSIZE, and at most 255. 
+ */
+#define FBUF_SLOTS     396
+#define FBUF_SLOTSIZE   32
+#define FBUF_LSLOTS    256
+#define FBUF_LSLOTSIZE  64
 
 
 /* ADC ports for Teensy 3.1 */
@@ -27,17 +31,26 @@
 
 
 /* Queues for AFSK encoder/decoder */
-#define AFSK_RX_QUEUE_SIZE      128
-#define AFSK_TX_QUEUE_SIZE      128
+#define AFSK_RX_BLOCKSIZE        32
+#define AFSK_RX_RINGSIZE        512   /* Samples from ADC. Must be power of 2 */
+#define AFSK_RX_QUEUE_SIZE      320
+#define HDLC_TXBUF_SIZE        1024
 #define HDLC_DECODER_QUEUE_SIZE  16
-#define HDLC_ENCODER_QUEUE_SIZE  16
+#define HDLC_TXCLASS_QUEUE_SIZE   8   /* For each class of frames to be sent */
 #define INET_RX_QUEUE_SIZE       32
+#define INET_LOWWATER            20   /* Drop incoming lines when fewer buffer units available */
+#define INET_LINE_HINT          100   /* Typical length of incoming lines (bytes) */
+
+/* Number of AFSK demodulator variants to run in parallel (1-5).
+ * May be given on the compiler command line. */
+#ifndef AFSK_RX_VARIANTS
+#define AFSK_RX_VARIANTS          1
+#endif
 
 
 /* Hardware timers */
 #define AFSK_RX_GPT      GPTD4
 #define AFSK_TX_GPT      GPTD2
-#define AFSK_TONEGEN_GPT GPTD3
 #define BUZZER_GPT       GPTD1
 
 
@@ -159,7 +172,9 @@ extern uint16_t blink_length, blink_interval;
 
 /* Stack sizes for static threads */
 #define STACK_NMEALISTENER 1500
+#define STACK_AFSKDEMOD     512
 #define STACK_HDLCDECODER   640
+#define STACK_HDLCDELIVER   384
 #define STACK_HDLCENCODER   512
 #define STACK_UI            256
 #define STACK_UI_SRV        640
@@ -170,7 +185,6 @@ extern uint16_t blink_length, blink_interval;
 /* Dynamic threads */
 /* FIXME: Check sizes and order of startup to minimize memory 
  * fragmentation */
-#define STACK_HDLC_TEST     256
 #define STACK_MONITOR       512
 #define STACK_TRACKER      1536
 #define STACK_DIGIPEATER   1024
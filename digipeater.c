@@ -28,9 +28,9 @@
    
 static bool digi_on = false;
 static FBQ rxqueue;
+static hdlc_sub_t digi_sub;
 static thread_t* digithr=NULL;
 
-extern fbq_t* outframes; 
 extern fbq_t* mon_q;
 
 static void check_frame(FBUF *f);
@@ -108,7 +108,7 @@ void digipeater_activate(bool m)
  
    if (tstart) {
       /* Subscribe to RX packets and start treads */
-      hdlc_subscribe_rx(mq, 1);
+      hdlc_subscribe_rx(&digi_sub, "digipeater", mq, HDLC_DROP_OLDEST, 0);
       digithr = THREAD_DSTART(digipeater, STACK_DIGIPEATER, NORMALPRIO, NULL);  
       hlist_start();
       
@@ -124,7 +124,7 @@ void digipeater_activate(bool m)
       if (digithr != NULL)
         chThdWait(digithr);
       digithr = NULL;
-      hdlc_subscribe_rx(NULL, 1);
+      hdlc_unsubscribe_rx(&digi_sub);
    }
 }
 
@@ -199,17 +199,21 @@ static void check_frame(FBUF *f)
           digis2[j++] = digis[i];
    
    /* Write a new header -> newHdr */
-   fbuf_new(&newHdr);
+   fbuf_new(&newHdr, FBUF_ACC_TX, AX25_HDR_LEN(j));
    ax25_encode_header(&newHdr, &from, &to, digis2, j, ctrl, pid);
 
    /* Replace header in original packet with new header. 
     * Do this non-destructively: Just add rest of existing packet to new header 
+    * Drop it if we ran out of buffer space. 
     */
-   fbuf_connect(&newHdr, f, AX25_HDR_LEN(ndigis) );
+   if (!fbuf_writable(&newHdr) || !fbuf_connect(&newHdr, f, AX25_HDR_LEN(ndigis))) {
+      fbuf_release(&newHdr);
+      return;
+   }
 
    /* Send packet */
    beeps("- ");
-   fbq_put(outframes, newHdr);  
+   hdlc_tx_put(newHdr, HDLC_TX_DIGI, HDLC_TTL_DIGI);  
 }
 
 
@@ -3,6 +3,8 @@
  */ 
 #include "fbuf.h"
 #include "defines.h"
+#include "util/crc16.h"
+#include "util/atomic.h"
 #include <string.h>
 
 
@@ -14,87 +16,381 @@
  *    - Index of next buffer in chain (NILPTR if this is the last)
  *    - Storage for actual content
  *
+ * There are two classes of slots: Small slots (FBUF_SLOTSIZE) for 
+ * headers and short frames and large slots (FBUF_LSLOTSIZE) for 
+ * payload, so that a typical frame needs fewer slots and less 
+ * bookkeeping. Both are indexed the same way (small slots first) 
+ * and may be mixed in a chain. The class of a new slot is chosen 
+ * from the number of bytes expected to be written into it. 
+ *
+ * Free slots are kept in a list for each class, linked through the 
+ * 'next' field, so that allocating and freeing a slot take constant
+ * time. Slots from _fresh and up have never been used and are not 
+ * in the list. This way the pool needs no initialisation. 
  *********************************************************************/
 
 
 
 typedef struct _slot {
-   uint8_t   refcnt; 
+   volatile uint8_t refcnt; 
    uint8_t   length; 
    fbindex_t next; 
-   char      buf[FBUF_SLOTSIZE]; 
 } fbslot_t; 
 
+#define NSLOTS (FBUF_SLOTS + FBUF_LSLOTS)
+#define LUNITS (FBUF_LSLOTSIZE / FBUF_SLOTSIZE)
 
-static fbslot_t _pool[FBUF_SLOTS]; 
-
+static fbslot_t _pool[NSLOTS]; 
+static char _sbuf[FBUF_SLOTS][FBUF_SLOTSIZE];
+static char _lbuf[FBUF_LSLOTS][FBUF_LSLOTSIZE];
 
-static fbindex_t _free_slots = FBUF_SLOTS; 
+#define SLOT_CLASS(i) ((i) >= FBUF_SLOTS ? FBUF_LARGE : FBUF_SMALL)
+#define SLOT_BUF(i)   ((i) >= FBUF_SLOTS ? _lbuf[(i)-FBUF_SLOTS] : _sbuf[(i)])
+#define SLOT_SIZE(i)  ((i) >= FBUF_SLOTS ? FBUF_LSLOTSIZE : FBUF_SLOTSIZE)
+#define SLOT_UNITS(i) ((i) >= FBUF_SLOTS ? LUNITS : 1)
 
-static void(*memFullError)(void) = NULL;
+/* Class of slot to use when n more bytes are expected */
+#define SLOT_CLASS_FOR(n) ((n) > FBUF_SLOTSIZE ? FBUF_LARGE : FBUF_SMALL)
 
-static fbindex_t _split(fbindex_t islot, uint16_t pos);
-static fbindex_t _fbuf_newslot (void);
+static const fbindex_t _first[2] = {0, FBUF_SLOTS};
+static const fbindex_t _end[2] = {FBUF_SLOTS, NSLOTS};
+static fbindex_t _free_slots[2] = {FBUF_SLOTS, FBUF_LSLOTS}; 
+static fbindex_t _free_list[2] = {NILPTR, NILPTR};  // First slot in lists of free slots
+static fbindex_t _fresh[2] = {0, FBUF_SLOTS};       // First slot never used
+static fbindex_t _free_units = FBUF_UNITS;
+static uint8_t _slot_acc[NSLOTS];                   // Account of each slot in use
 
 
-fbindex_t fbuf_freeSlots()
-   { return _free_slots; }
 
-fbindex_t fbuf_usedSlots()
-   { return FBUF_SLOTS - _free_slots; }
+/********************************************************************
+ * Pool accounts. A subsystem can always get its reserved minimum of
+ * slots, but never more than its max. Slots not reserved by other 
+ * accounts are shared. _reserved is the number of reserved units not
+ * in use, i.e. the sum of (min - used) for accounts below their min. 
+ * When allocation fails, the caller gets an error. Usage is counted 
+ * in units of small slots. 
+ * 
+ * Note that a slot counts on the account that allocated it, also if 
+ * it is shared with other subsystems, e.g. a received frame passed on
+ * to the monitor, digipeater and igate by reference. 
+ ********************************************************************/
+
+static fbacc_t _acc[FBUF_ACCOUNTS] = {
+   /* name       min  max */
+   { "other",      0, 100,  0, 0, 0, 0, false, NULL },
+   { "rx",       200, FBUF_UNITS, 0, 0, 0, 0, false, NULL },
+   { "tx",       100, 400,  0, 0, 0, 0, false, NULL },
+   { "igate",     20, 100,  0, 0, 0, 0, false, NULL },
+   { "inet",      40, 300,  0, 0, 0, 0, false, NULL },
+   { "tracker",   20, 100,  0, 0, 0, 0, false, NULL }
+};
+
+static fbindex_t _reserved = 0;         // Sum of min above, see fbuf_init
+
+static bool _split(FBUF* b, fbindex_t islot, uint16_t pos, fbindex_t* rest);
+static fbindex_t _slot_at(fbindex_t s, uint16_t* pos);
+static fbindex_t _fbuf_newslot (uint8_t acc, uint8_t cls);
+static bool _addslot(FBUF* b, uint16_t n);
+static uint8_t _fbuf_unref(fbindex_t i);
+static uint8_t _release(FBUF* bb);
+static uint8_t _check_low(void);
+static void _signal_low(uint8_t changed);
+
+
+fbindex_t fbuf_freeSlots(uint8_t cls)
+   { return _free_slots[cls & 0x01]; }
+
+fbindex_t fbuf_usedSlots(uint8_t cls)
+   { return _end[cls & 0x01] - _first[cls & 0x01] - _free_slots[cls & 0x01]; }
    
 uint16_t fbuf_freeMem()
-   { return _free_slots * FBUF_SLOTSIZE; } 
+   { return _free_slots[FBUF_SMALL] * FBUF_SLOTSIZE + _free_slots[FBUF_LARGE] * FBUF_LSLOTSIZE; } 
+
+/* Reserved units of an account not in use */
+static inline fbindex_t _unmet(fbacc_t* a)
+   { return (a->used < a->min ? a->min - a->used : 0); }
+
+/* Number of bytes expected to be written to b */
+static inline uint16_t _expected(FBUF* b)
+   { return (b->hint > b->length ? b->hint - b->length : 0); }
    
    
    
 /*
- * Note: We assume that FBUF objects are not shared between 
- * ISRs/threads. 
+ * Sharing of buffers between threads and ISRs: 
+ * 
+ * Slots may be shared between FBUF objects (by fbuf_newRef, fbuf_insert 
+ * and fbuf_connect), typically to hand the same frame to several threads. 
+ * Reference counts are updated atomically and the free list is protected 
+ * by a lock, so the following are safe from any thread or ISR, on 
+ * different FBUF objects referring to the same slots: 
+ *    - fbuf_new, fbuf_newRef, fbuf_release
+ *    - reading (fbuf_getChar, fbuf_read, fbuf_print, fbuf_crc, etc..) 
+ *    - fbuf_connect(b, x, pos) with x shared. It does not change the 
+ *      slots of x (b must be the caller's own). 
  * 
- * We also assume that FBUF objects are not accessed from interrupt handlers. 
- * That may change later. In that case, check if we need to protect parts of 
- * code by using locks/disabling interrupts. slots may be shared between
- * FBUF objects but it is complicated and this should be tested and 
- * analysed more. We should disallow writing to a FBUF that contains
- * shared slots.
+ * A FBUF object itself (read/write position) must only be used by one 
+ * thread at a time. Operations that change the content or the chain 
+ * (fbuf_putChar, fbuf_write, fbuf_nextSlot, fbuf_setChar, fbuf_removeLast,
+ * fbuf_insert) must only be done by the owner, before the buffer is 
+ * shared. Writing is disallowed after fbuf_insert and fbuf_connect.
+ * fbuf_print and fbuf_streamRead may block and are not for ISRs. 
  */
 
 
-void fbuf_errorHandler( void(*f)(void) ) 
-  { memFullError = f; }
+
+/******************************************************
+    Internal: Allocate a new buffer slot of class cls. 
+    If no slot of that class is free, use the other. 
+ ******************************************************/
+ 
+static fbindex_t _fbuf_newslot (uint8_t acc, uint8_t cls)
+{
+   register fbindex_t i, u, unmet; 
+   register fbacc_t* a = &_acc[acc];
+   uint8_t changed; 
+   syssts_t sts = chSysGetStatusAndLockX();
+   
+   if (_free_slots[cls] == 0)
+       cls ^= 0x01;
+   u = (cls == FBUF_LARGE ? LUNITS : 1);
+   unmet = _unmet(a);
+   
+   /* Beyond the reserved minimum, do not take units reserved by others */
+   if (_free_slots[cls] == 0 || a->used + u > a->max || _free_units - _reserved + unmet < u) {
+       a->fails++;
+       chSysRestoreStatusX(sts);
+       return NILPTR; 
+   }
+   if (_free_list[cls] != NILPTR) {
+       i = _free_list[cls]; 
+       _free_list[cls] = _pool[i].next;
+   }
+   else
+       i = _fresh[cls]++; 
+   _free_slots[cls]--;
+   _free_units -= u;
+   a->used += u;
+   _reserved -= unmet - _unmet(a);
+   if (a->used > a->hwm)
+       a->hwm = a->used;
+   _slot_acc[i] = acc;
+   _pool[i].refcnt = 1;
+   _pool[i].length = 0;
+   _pool[i].next = NILPTR; 
+   changed = _check_low();
+   chSysRestoreStatusX(sts);
+   _signal_low(changed);
+   return i; 
+}
 
 
 
 /******************************************************
-    Internal: Allocate a new buffer slot 
+    Internal: Decrement the reference count of a slot 
+    and put it on the free list when it reaches zero. 
+    Note that this overwrites the next field, so the 
+    caller must get it first. Returns the accounts 
+    that crossed their low water mark (bitmask). The 
+    caller must signal them (see _signal_low) when 
+    it does not hold the system lock. 
  ******************************************************/
  
-static fbindex_t _fbuf_newslot ()
+static uint8_t _fbuf_unref(fbindex_t i)
+{
+   uint8_t changed = 0;
+   if (atomic_dec_nz_u8(&_pool[i].refcnt) == 1) {
+       register fbacc_t* a = &_acc[_slot_acc[i]];
+       register uint8_t cls = SLOT_CLASS(i);
+       syssts_t sts = chSysGetStatusAndLockX();
+       fbindex_t unmet = _unmet(a);
+       _pool[i].next = _free_list[cls];
+       _free_list[cls] = i;
+       _free_slots[cls]++;
+       _free_units += SLOT_UNITS(i);
+       a->used -= SLOT_UNITS(i);
+       _reserved += _unmet(a) - unmet;
+       changed = _check_low();
+       chSysRestoreStatusX(sts);
+   }
+   return changed;
+}
+
+
+
+/******************************************************
+    Number of units that can be allocated on an 
+    account now. 
+ ******************************************************/
+
+static fbindex_t _available(uint8_t acc)
+{
+   register fbacc_t* a = &_acc[acc];
+   register fbindex_t n = _free_units - _reserved + _unmet(a);
+   if (n > a->max - a->used)
+      n = a->max - a->used;
+   return n;
+}
+
+fbindex_t fbuf_available(uint8_t acc)
+   { return (acc < FBUF_ACCOUNTS ? _available(acc) : 0); }
+
+
+
+/******************************************************
+    Low water marks. With system locked, find the 
+    accounts that went below or above their low 
+    water mark (bitmask). Then call the callbacks 
+    after the lock is released. 
+ ******************************************************/
+
+static uint8_t _check_low()
+{
+   uint8_t changed = 0;
+   for (uint8_t i=0; i<FBUF_ACCOUNTS; i++) {
+      if (_acc[i].lowcb == NULL)
+         continue;
+      bool low = (_available(i) <= _acc[i].lowmark);
+      if (low != _acc[i].low) {
+         _acc[i].low = low;
+         changed |= (1 << i);
+      }
+   }
+   return changed;
+}
+
+
+static void _signal_low(uint8_t changed)
+{
+   for (uint8_t i=0; changed != 0; i++, changed >>= 1)
+      if (changed & 0x01)
+         (*_acc[i].lowcb)(i, _acc[i].low);
+}
+
+
+
+/******************************************************
+    Set low water mark and callback for an account. 
+    The callback is called when the number of slots 
+    available to the account drops to the mark or 
+    below, and when it rises above it again. It is 
+    called from whatever thread or ISR allocates or 
+    releases slots at that moment, so it must not 
+    block. It should just set a flag, or signal a 
+    thread using an I-class function in a lock zone 
+    of its own (chSysGetStatusAndLockX). 
+ ******************************************************/
+
+void fbuf_setLowWater(uint8_t acc, fbindex_t mark, void (*cb)(uint8_t, bool))
+{
+   if (acc >= FBUF_ACCOUNTS)
+      return;
+   syssts_t sts = chSysGetStatusAndLockX();
+   _acc[acc].lowmark = mark;
+   _acc[acc].low = false;
+   _acc[acc].lowcb = cb;
+   chSysRestoreStatusX(sts);
+}
+
+
+
+/******************************************************
+    Get a copy of an account (for statistics)
+ ******************************************************/
+
+void fbuf_getAccount(uint8_t acc, fbacc_t* a)
+{
+   if (acc >= FBUF_ACCOUNTS)
+      return;
+   syssts_t sts = chSysGetStatusAndLockX();
+   *a = _acc[acc];
+   chSysRestoreStatusX(sts);
+}
+
+
+
+/******************************************************
+    Check the consistency of the pool: Slots on the 
+    free list must be unreferenced and unused slots 
+    must be on the free list of its class. The number 
+    of free slots and the usage of each account must 
+    match the counters. Returns false if not. 
+ ******************************************************/
+
+bool fbuf_check()
+{
+   bool ok = true;
+   fbindex_t used[FBUF_ACCOUNTS] = {0};
+   fbindex_t reserved = 0, units = 0;
+   syssts_t sts = chSysGetStatusAndLockX();
+   
+   for (uint8_t c = 0; c < 2; c++) {
+      uint16_t listed = 0, unref = 0; 
+      for (fbindex_t i = _free_list[c]; i != NILPTR; i = _pool[i].next) {
+          if (i < _first[c] || i >= _fresh[c] || _pool[i].refcnt != 0 
+                || ++listed > _fresh[c] - _first[c]) {
+             ok = false; 
+             break;
+          }
+      }
+      for (fbindex_t i = _first[c]; i < _fresh[c]; i++) {
+          if (_pool[i].refcnt == 0)
+             unref++;
+          else
+             used[_slot_acc[i]] += SLOT_UNITS(i);
+      }
+      if (listed != unref || _free_slots[c] != listed + _end[c] - _fresh[c])
+          ok = false;
+      units += _free_slots[c] * (c == FBUF_LARGE ? LUNITS : 1);
+   }
+   for (uint8_t i = 0; i < FBUF_ACCOUNTS; i++) {
+       if (used[i] != _acc[i].used)
+          ok = false;
+       if (used[i] < _acc[i].min)
+          reserved += _acc[i].min - used[i];
+   }
+   if (units != _free_units || reserved != _reserved)
+       ok = false;
+   
+   chSysRestoreStatusX(sts);
+   return ok;
+}
+
+
+/*******************************************************
+    Initialise the pool: All units reserved by the 
+    accounts are unused. Call once at startup, before 
+    any buffer is allocated. 
+ *******************************************************/
+
+void fbuf_init()
 {
-   register fbindex_t i; 
-   for (i=0; i<FBUF_SLOTS; i++)
-       if (_pool[i].refcnt == 0) 
-       {
-           _pool[i].refcnt = 1;
-           _pool[i].length = 0;
-           _pool[i].next = NILPTR; 
-           _free_slots--;
-           return i; 
-       }
-   return NILPTR; 
+    _reserved = 0;
+    for (uint8_t i=0; i<FBUF_ACCOUNTS; i++)
+        _reserved += _acc[i].min;
 }
 
 
+
 /*******************************************************
-    initialise a buffer chain
+    initialise a buffer chain, drawing slots from 
+    account acc. hint is the expected size in bytes 
+    (0 if not known), used to choose the class of 
+    slots. Returns false if no slot could be allocated. 
+    The buffer is then empty and not writable.  
  *******************************************************/
  
-void fbuf_new (FBUF* bb)
+bool fbuf_new (FBUF* bb, uint8_t acc, uint16_t hint)
 {
-    bb->head = bb->wslot = bb->rslot = _fbuf_newslot();
-    bb->rpos = 0;
+    if (acc >= FBUF_ACCOUNTS)
+        acc = FBUF_ACC_OTHER;
+    bb->acc = acc;
+    bb->hint = hint;
+    bb->head = bb->wslot = bb->rslot = bb->tail = _fbuf_newslot(acc, SLOT_CLASS_FOR(hint));
+    bb->rpos = bb->rbase = 0;
     bb->length = 0;
+    bb->tag = 0;
+    return (bb->head != NILPTR);
 }
 
 
@@ -103,19 +399,24 @@ void fbuf_new (FBUF* bb)
  *******************************************************/
 
 void fbuf_release(FBUF* bb)
+   { _signal_low(_release(bb)); }
+
+
+/* Internal: Release without calling low water callbacks */
+static uint8_t _release(FBUF* bb)
 {
     register fbindex_t b = bb->head;
+    uint8_t changed = 0;
     while (b != NILPTR) 
     {
-       if (_pool[b].refcnt > 0) {
-           _pool[b].refcnt--;
-           if (_pool[b].refcnt == 0)
-             _free_slots++;
-       }
-       b = _pool[b].next; 
+       register fbindex_t next = _pool[b].next;
+       changed |= _fbuf_unref(b);
+       b = next; 
     } 
-    bb->head = bb->wslot = bb->rslot = NILPTR;
-    bb->rpos = bb->length = 0;
+    bb->head = bb->wslot = bb->rslot = bb->tail = NILPTR;
+    bb->rpos = bb->rbase = bb->length = 0;
+    bb->tag = 0;
+    return changed;
 }
 
 
@@ -129,11 +430,15 @@ FBUF fbuf_newRef(FBUF* bb)
   register fbindex_t b = bb->head;
   while (b != NILPTR) 
   {
-    _pool[b].refcnt++; 
+    atomic_inc_u8(&_pool[b].refcnt); 
     b = _pool[b].next; 
   } 
   newb.head = bb->head; 
+  newb.tail = bb->tail; 
   newb.length = bb->length; 
+  newb.tag = bb->tag;
+  newb.acc = bb->acc;
+  newb.hint = bb->hint;
   fbuf_reset(&newb);
   newb.wslot = bb->wslot;
   return newb;
@@ -147,17 +452,25 @@ FBUF fbuf_newRef(FBUF* bb)
 void fbuf_reset(FBUF* b)
 {
     b->rslot = b->head; 
-    b->rpos = 0;
+    b->rpos = b->rbase = 0;
 }
 
+
+/* 
+ * rbase is the position of the first byte in the current read 
+ * slot, so seeking forward can start from there instead of from 
+ * the head of the chain. 
+ */
 void fbuf_rseek(FBUF* b, const uint16_t pos)
 {
-   register uint16_t i=pos;
-   if (pos > b->length)
+   if (b->head == NILPTR || pos > b->length)
        return;
-   fbuf_reset(b);
-   while (i > _pool[b->rslot].length) {
+   if (b->rslot == NILPTR || pos < b->rbase)
+       fbuf_reset(b);
+   register uint16_t i = pos - b->rbase;
+   while (i >= _pool[b->rslot].length && _pool[b->rslot].next != NILPTR) {
         i -= _pool[b->rslot].length;
+        b->rbase += _pool[b->rslot].length;
         b->rslot = _pool[b->rslot].next;
    }
    b->rpos = i;
@@ -168,33 +481,44 @@ void fbuf_rseek(FBUF* b, const uint16_t pos)
 
 /*******************************************************
     Add a byte to a buffer chain. 
-    Add new slots to it if necessary
+    Add new slots to it if necessary. Returns false if 
+    not allowed or if the account is out of slots. In 
+    the latter case, the buffer is made read-only so 
+    that the content is not silently truncated. The 
+    caller should check and drop it. 
  *******************************************************/
  
-void fbuf_putChar (FBUF* b, const char c)
+bool fbuf_putChar (FBUF* b, const char c)
 {
     /* if wslot is NIL it means that writing is not allowed */
     if (b->wslot == NILPTR)
-       return;
+       return false;
     
-    register uint8_t pos = _pool[b->wslot].length; 
-    if (pos == FBUF_SLOTSIZE || b->head == NILPTR)
-    {
-        pos = 0; 
-        register fbindex_t newslot = _fbuf_newslot();
-        if (newslot == NILPTR) {
-            if (memFullError != NULL)
-               (*memFullError)();
-            else
-               return;
-        }  
-        b->wslot = _pool[b->wslot].next = newslot; 
-        if (b->head == NILPTR)
-            b->rslot = b->head = newslot;
-    }
-    _pool[b->wslot].buf [pos] =  c; 
+    if (_pool[b->wslot].length == SLOT_SIZE(b->wslot) && !_addslot(b, _expected(b)))
+        return false;
+    SLOT_BUF(b->wslot) [_pool[b->wslot].length] =  c; 
     _pool[b->wslot].length++; 
     b->length++;
+    return true;
+}
+
+
+
+/*******************************************************
+    Internal: Add a slot to the end of a buffer chain, 
+    to write n more bytes into. If it can not be 
+    allocated, the buffer is made read-only. 
+ *******************************************************/
+
+static bool _addslot(FBUF* b, uint16_t n)
+{
+    register fbindex_t newslot = _fbuf_newslot(b->acc, SLOT_CLASS_FOR(n));
+    if (newslot == NILPTR) {
+        b->wslot = NILPTR;
+        return false;
+    }  
+    b->wslot = b->tail = _pool[b->wslot].next = newslot; 
+    return true;
 }
 
 
@@ -205,32 +529,68 @@ void fbuf_putChar (FBUF* b, const char c)
  * at position pos
  * 
  * Note: After calling this, writing into the buffers
- * are disallowed.
+ * are disallowed. The chain of x continues into the 
+ * rest of b, but x still has its own length. Returns 
+ * false if a slot was needed (to split) and could not 
+ * be allocated. b and x are unchanged in that case. 
+ * If b is empty, it just gets the chain of x. 
  *******************************************************/
  
-void fbuf_insert(FBUF* b, FBUF* x, uint16_t pos)
+bool fbuf_insert(FBUF* b, FBUF* x, uint16_t pos)
 {
-    register fbindex_t islot = b->head;    
-    while (pos >= FBUF_SLOTSIZE) {
-        pos -= _pool[islot].length; 
-        if (pos > 0) 
-            islot = _pool[islot].next;
+    fbindex_t rest = NILPTR;
+    if (pos > b->length)
+        return false;
+    if (x->length == 0) {
+        b->wslot = x->wslot = NILPTR; // Disallow writing
+        return true;
+    }
+    uint16_t p = pos;
+    register fbindex_t islot = NILPTR;
+    if (b->length > 0) {
+        islot = _slot_at(b->head, &p);
+        if (p > 0 && !_split(b, islot, p, &rest))
+            return false;
     }
+    b->wslot = x->wslot = NILPTR; // Disallow writing
     
-    /* Find last slot in x chain and increment reference count*/
+    /* Increment reference count of slots in x chain */
     register fbindex_t xlast = x->head;
-    _pool[xlast].refcnt++;
-    while (_pool[xlast].next != NILPTR) {
+    atomic_inc_u8(&_pool[xlast].refcnt);
+    while (xlast != x->tail) {
         xlast = _pool[xlast].next;
-        _pool[xlast].refcnt++;
+        atomic_inc_u8(&_pool[xlast].refcnt);
     }
     
-    /* Insert x chain after islot */  
-    _pool[xlast].next = _split(islot, pos); 
-    _pool[islot].next = x->head;
+    if (b->length == 0) {
+        /* Replace the empty slot of b (if any) with the x chain */
+        uint8_t tag = b->tag;
+        fbuf_release(b);
+        b->tag = tag;
+        b->head = x->head;
+        b->tail = x->tail;
+    }
+    else if (p == 0) {
+        /* Insert x chain before head */
+        _pool[xlast].next = b->head;
+        b->head = x->head;
+    }
+    else {
+        /* Insert x chain after islot */  
+        _pool[xlast].next = rest; 
+        _pool[islot].next = x->head;
+        if (islot == b->tail)
+            b->tail = xlast;
+    }
     
-    b->wslot = x->wslot = NILPTR; // Disallow writing
+    /* The x chain now continues into the rest of b. Reference it */
+    while (_pool[xlast].next != NILPTR) {
+        xlast = _pool[xlast].next;
+        atomic_inc_u8(&_pool[xlast].refcnt);
+    }
     b->length += x->length;
+    fbuf_reset(b);
+    return true;
 }
 
 
@@ -241,69 +601,179 @@ void fbuf_insert(FBUF* b, FBUF* x, uint16_t pos)
  * this mean that we get two buffers, with different
  * headers but with a shared last part. 
  * 
+ * The slots of x are not changed, so x may be shared 
+ * with other threads (b must not be). If pos is within 
+ * a slot, the rest of that slot is copied into a new 
+ * slot of b. Frames are split at a slot boundary after 
+ * the header when received, so that this is not needed
+ * (see fbuf_nextSlot). 
+ * 
  * Note: After calling this, writing into the buffers
- * is not allowed. 
+ * is not allowed. Returns false if a slot was needed 
+ * and could not be allocated. b and x are unchanged in 
+ * that case. 
  *****************************************************/
 
-void fbuf_connect(FBUF* b, FBUF* x, uint16_t pos)
+bool fbuf_connect(FBUF* b, FBUF* x, uint16_t pos)
 {
-    register fbindex_t islot = x->head;  
-    register uint16_t p = pos;
-    while (p >= FBUF_SLOTSIZE) {
-        p -= _pool[islot].length; 
-        if (p > 0) 
-            islot = _pool[islot].next;
+    fbindex_t rest, shared, s;
+    if (pos > x->length)
+        return false;
+    uint16_t p = pos;
+    register fbindex_t islot = _slot_at(x->head, &p);
+    if (p == 0)
+        rest = shared = islot;
+    else if (p >= _pool[islot].length)
+        rest = shared = _pool[islot].next;
+    else {
+        uint8_t n = _pool[islot].length - p;
+        rest = _fbuf_newslot(b->acc, SLOT_CLASS_FOR(n));
+        if (rest == NILPTR)
+            return false;
+        if (SLOT_SIZE(rest) < n) {
+            _signal_low(_fbuf_unref(rest));
+            return false;
+        }
+        memcpy(SLOT_BUF(rest), SLOT_BUF(islot) + p, n);
+        _pool[rest].length = n;
+        shared = _pool[rest].next = _pool[islot].next;
+    }
+    b->wslot = x->wslot = NILPTR; // Disallow writing
+    if (rest == NILPTR)
+        return true;
+
+    /* Reference the shared part of x and connect last slot of b to it */
+    for (s = shared; s != NILPTR; s = _pool[s].next)
+        atomic_inc_u8(&_pool[s].refcnt);
+    _pool[b->tail].next = rest;
+    b->tail = (shared == NILPTR ? rest : x->tail);
+    
+    /* Drop the head slot of b if empty, readers expect no empty slots */
+    if (b->length == 0) {
+        _pool[b->head].next = NILPTR;
+        _signal_low(_fbuf_unref(b->head));
+        b->head = rest;
     }
+    fbuf_reset(b);
+    b->length = b->length + x->length - pos;
+    return true;
+}
 
-    /* Find last slot of b and connect it to rest of x */
-    register fbindex_t xlast = b->head;
-    while (_pool[xlast].next != NILPTR) 
-        xlast = _pool[xlast].next;
 
-    _pool[xlast].next = _split(islot, p);
 
-    /* Increment reference count of rest of x */
-    while (_pool[xlast].next != NILPTR) {
-        xlast = _pool[xlast].next;
-        _pool[xlast].refcnt++;
-    }
+/*****************************************************
+ * Make the bytes written next go into a new slot, for 
+ * n more bytes expected. Typically after the header of 
+ * a frame, so that fbuf_connect can connect to the rest 
+ * of it without copying. Returns false if the slot 
+ * could not be allocated. 
+ *****************************************************/
 
-    b->wslot = x->wslot = NILPTR; // Disallow writing
-    b->length = b->length + x->length - pos;
+bool fbuf_nextSlot(FBUF* b, uint16_t n)
+{
+    if (b->wslot == NILPTR)
+        return false;
+    b->hint = b->length + n;
+    if (_pool[b->wslot].length == 0)
+        return true;
+    return _addslot(b, n);
+}
+
+
+
+/*****************************************************
+ * Internal: Find the slot that contains position pos, 
+ * starting from slot s. Slots may be partly filled. 
+ * On return, pos is the position within the slot 
+ * (0 < pos <= length, or 0 if at the very start). 
+ *****************************************************/
+
+static fbindex_t _slot_at(fbindex_t s, uint16_t* pos)
+{
+    while (*pos > _pool[s].length && _pool[s].next != NILPTR) {
+        *pos -= _pool[s].length; 
+        s = _pool[s].next;
+    }
+    return s;
 }
 
 
 
-static fbindex_t _split(fbindex_t islot, uint16_t pos)
+/*****************************************************
+ * Internal: Split slot islot at pos and get the 
+ * first slot of the part after pos (rest). Keep the 
+ * tail of b (the chain having islot) updated. Return 
+ * false if a new slot could not be allocated. 
+ *****************************************************/
+
+static bool _split(FBUF* b, fbindex_t islot, uint16_t pos, fbindex_t* rest)
 {
-      if (pos == 0)
-          return _pool[islot].next;
-      register fbindex_t newslot = _fbuf_newslot();
+      if (pos == 0) {
+          *rest = islot;
+          return true;
+      }
+      if (pos >= _pool[islot].length) {
+          *rest = _pool[islot].next;
+          return true;
+      }
+      register fbindex_t newslot = _fbuf_newslot(b->acc, SLOT_CLASS_FOR(_pool[islot].length - pos));
+      if (newslot == NILPTR)
+          return false;
+      
+      /* The other class may have been used, if this one ran out */
+      if (SLOT_SIZE(newslot) < _pool[islot].length - pos) {
+          _signal_low(_fbuf_unref(newslot));
+          return false;
+      }
       _pool[newslot].next = _pool[islot].next;
       _pool[islot].next = newslot;
       _pool[newslot].refcnt = _pool[islot].refcnt; 
+      if (islot == b->tail)
+          b->tail = newslot;
       
       /* Copy last part of slot to newslot */
-      for (uint8_t i = 0; i<_pool[islot].length - pos; i++)
-          _pool[newslot].buf[i] = _pool[islot].buf[pos+i];   
+      memcpy(SLOT_BUF(newslot), SLOT_BUF(islot) + pos, _pool[islot].length - pos);
 
       _pool[newslot].length = _pool[islot].length - pos;
       _pool[islot].length = pos; 
-      return newslot;
+      *rest = newslot;
+      return true;
 }
 
 
 
 
 /*******************************************************
-    Write a string to a buffer chain
+    Write a string to a buffer chain. 
+    Fill the slots using memcpy, a slot at a time. 
  *******************************************************/
  
-void fbuf_write (FBUF* b, const char* data, const uint16_t size)
+bool fbuf_write (FBUF* b, const char* data, const uint16_t size)
 {
-    register uint16_t i; 
-    for (i=0; i<size; i++)
-        fbuf_putChar(b, data[i]);
+    uint16_t done = 0; 
+    while (done < size) 
+    {
+        if (b->wslot == NILPTR)
+           return false;
+        
+        /* Add a new slot when the last one is full */
+        if (_pool[b->wslot].length == SLOT_SIZE(b->wslot)) {
+           uint16_t n = size - done; 
+           if (n < _expected(b))
+              n = _expected(b);
+           if (!_addslot(b, n))
+              return false;
+        }
+        fbslot_t *slot = &_pool[b->wslot];
+        uint16_t n = SLOT_SIZE(b->wslot) - slot->length;
+        if (n > size - done)
+           n = size - done;
+        memcpy(SLOT_BUF(b->wslot) + slot->length, data + done, n);
+        slot->length += n;
+        b->length += n;
+        done += n;
+    }
+    return true;
 }
 
 
@@ -312,11 +782,8 @@ void fbuf_write (FBUF* b, const char* data, const uint16_t size)
     Write a null terminated string to a buffer chain
  *******************************************************/
  
-void fbuf_putstr(FBUF* b, const char *data)
-{ 
-    while (*data != 0)
-        fbuf_putChar(b, *(data++));
-}
+bool fbuf_putstr(FBUF* b, const char *data)
+    { return fbuf_write(b, data, strlen(data)); }
 
 
 
@@ -328,9 +795,10 @@ void fbuf_putstr(FBUF* b, const char *data)
  
 char fbuf_getChar(FBUF* b)
 {
-    register char x = _pool[b->rslot].buf[b->rpos]; 
+    register char x = SLOT_BUF(b->rslot)[b->rpos]; 
     if (b->rpos == _pool[b->rslot].length-1)
     {
+        b->rbase += _pool[b->rslot].length;
         b->rslot = _pool[b->rslot].next;
         b->rpos = 0;
     }
@@ -339,15 +807,65 @@ char fbuf_getChar(FBUF* b)
     return x;          
 }
 
+/*******************************************************
+    Get the rest of the current read slot as a span 
+    (pointer to the data and length), and move the 
+    read position to the start of the next slot. 
+    Returns 0 at end of buffer chain. The data must 
+    not be changed. Typical use: 
+    
+      fbuf_reset(b); 
+      while ((n = fbuf_getSpan(b, &data)) > 0)
+         ... 
+ *******************************************************/
+
+uint16_t fbuf_getSpan(FBUF* b, const char** data)
+{
+    while (b->rslot != NILPTR && b->rbase + b->rpos < b->length) {
+        register uint16_t n = _pool[b->rslot].length - b->rpos; 
+        if (n > b->length - b->rbase - b->rpos)
+            n = b->length - b->rbase - b->rpos;
+        *data = SLOT_BUF(b->rslot) + b->rpos;
+        b->rbase += _pool[b->rslot].length;
+        b->rslot = _pool[b->rslot].next;
+        b->rpos = 0;
+        if (n > 0)
+            return n;
+    }
+    return 0;
+}
+
+
+
+/*******************************************************
+    Replace the byte at a given position. 
+ *******************************************************/
+ 
+void fbuf_setChar(FBUF* b, uint16_t pos, const char c)
+{
+    register fbindex_t s = b->head;
+    if (pos >= b->length)
+        return;
+    while (pos >= _pool[s].length) {
+        pos -= _pool[s].length;
+        s = _pool[s].next;
+    }
+    SLOT_BUF(s)[pos] = c;
+}
+
+
+
 /********************************************************
     Print a buffer chain to a stream.
  ********************************************************/ 
 
 void fbuf_print(Stream *chp, FBUF* b) 
 {
+    const char* data; 
+    uint16_t n; 
     fbuf_reset(b);
-    for (int i=0; i < b->length; i++)
-        streamPut(chp, fbuf_getChar(b));
+    while ((n = fbuf_getSpan(b, &data)) > 0)
+        streamWrite(chp, (const uint8_t*) data, n);
 }
   
   
@@ -384,48 +902,72 @@ uint16_t fbuf_read (FBUF* b, uint16_t size, char *buf)
     if (b->length < size || size == 0)
        size = b->length; 
     bb = b->head; 
-    while ( bb != NILPTR )
+    while ( bb != NILPTR && r < size )
     {
        n = size - r; 
        if (n > _pool[bb].length) 
            n = _pool[bb].length;
-            
-       strncpy(buf+r, _pool[bb].buf, n);
+       
+       /* Binary data. Do not stop at null characters */
+       memcpy(buf+r, SLOT_BUF(bb), n);
        r += n; 
        bb = _pool[bb].next;
-       if (r >= size ) 
-           break;
     }
-    // buf[r] = '\0';
     // Should not null terminate. Return number of read characters. 
-    
     return r; 
 }
 
 
+/**************************************************************
+  Update a CRC-CCITT with the content of a buffer chain, from 
+  position 'pos' to the end. Whole slots are processed at once. 
+  Does not change the read position.  
+ **************************************************************/
+ 
+uint16_t fbuf_crc(FBUF* b, uint16_t pos, uint16_t crc)
+{
+    register fbindex_t s = b->head;
+    if (pos >= b->length)
+        return crc;
+    while (s != NILPTR && pos >= _pool[s].length) {
+        pos -= _pool[s].length;
+        s = _pool[s].next;
+    }
+    while (s != NILPTR) {
+        crc = crc_ccitt_block(crc, SLOT_BUF(s) + pos, _pool[s].length - pos);
+        pos = 0;
+        s = _pool[s].next;
+    }
+    return crc;
+}
+
+
 /*******************************************************
-  Remove the last byte of a buffer chain.
+  Remove the last byte of a buffer chain. Only when the 
+  last slot becomes empty, we need to walk the chain to 
+  find the slot before it. 
  *******************************************************/
 
 void fbuf_removeLast(FBUF* x)
 {
-  register fbindex_t xlast = x->head;
-  register fbindex_t prev = xlast;
-  
-  while (_pool[xlast].next != NILPTR) {
-    xlast = _pool[xlast].next;
-    if (_pool[xlast].next != NILPTR)
-      prev = xlast;
-  }
+  register fbindex_t xlast = x->tail;
+  if (x->length == 0)
+    return;
   
   _pool[xlast].length--;
-  if (_pool[xlast].length == 0 && prev != xlast) {
-    _pool[xlast].refcnt--;
-    if (_pool[xlast].refcnt == 0)
-      _free_slots++;
+  x->length--;
+  if (_pool[xlast].length == 0 && xlast != x->head) {
+    register fbindex_t prev = x->head;
+    while (_pool[prev].next != xlast)
+      prev = _pool[prev].next;
     _pool[prev].next = NILPTR;
+    _signal_low(_fbuf_unref(xlast));
+    x->tail = prev;
+    if (x->wslot == xlast)
+      x->wslot = prev;
+    if (x->rslot == xlast)
+      fbuf_reset(x);
   }
-  x->length--;
 }
 
 
@@ -453,19 +995,22 @@ void _fbq_init(FBQ* q, FBUF* buf, const uint16_t sz)
  * Clear a queue. Release all items and reset semaphores. 
  * IMPORTANT: Be sure that no thread blocks on the queue when calling this.
  * TODO: Check that this is correct wrt thread behaviour.  
+ * Low water callbacks are called after the system is unlocked. 
  ****************************************************************************/
 
 void fbq_clear(FBQ* q)
 {
+  uint8_t changed = 0;
   chSysLock();
   uint16_t i;
-  for (i = q->index;  i < q->index + chSemGetCounterI(&q->length);  i++)
-    fbuf_release(&q->buf[(uint8_t) (i % q->size)]);
+  for (i = q->index+1;  i <= q->index + chSemGetCounterI(&q->length);  i++)
+    changed |= _release(&q->buf[(uint8_t) (i % q->size)]);
   chSemResetI(&q->length, 0);
   chSemResetI(&q->capacity, q->size);    
   q->index = 0;
   q->cnt = 0;
   chSysUnlock();
+  _signal_low(changed);
 }
 
 
@@ -490,6 +1035,31 @@ void fbq_put(FBQ* q, FBUF b)
 
 
 
+/**********************************************************************
+ * Put a buffer chain into the queue. Wait at most 'timeout' for room
+ * (TIME_IMMEDIATE to not wait at all). Return false if the queue is
+ * still full. The buffer is not released in that case.
+ **********************************************************************/
+
+bool fbq_putTimeout(FBQ* q, FBUF b, systime_t timeout)
+{
+  bool ok = false;
+  chSysLock();
+  if (chSemWaitTimeoutS(&q->capacity, timeout) == MSG_OK) {
+    q->cnt++;
+    uint8_t i = (q->index + q->cnt) % q->size; 
+    q->buf[i] = b; 
+    ok = true;
+    
+    chSemSignalI(&q->length);
+    chSchRescheduleS();
+  }
+  chSysUnlock();
+  return ok;
+}
+
+
+
 /*********************************************************
  *   get a buffer chain from the queue (block if empty)
  *********************************************************/
@@ -512,15 +1082,42 @@ FBUF fbq_get(FBQ* q)
 
 
 
+/**********************************************************************
+ * Get the oldest buffer chain from the queue without waiting. 
+ * Return false if the queue is empty. 
+ **********************************************************************/
+
+bool fbq_tryGet(FBQ* q, FBUF* b)
+{
+  bool ok = false;
+  chSysLock();
+  if (chSemWaitTimeoutS(&q->length, TIME_IMMEDIATE) == MSG_OK) {  
+    q->index = (q->index + 1) % q->size;
+    *b = q->buf[q->index];
+    q->cnt--;
+    ok = true;
+    
+    chSemSignalI(&q->capacity);
+    chSchRescheduleS();
+  }
+  chSysUnlock();
+  return ok;
+}
+
+
+
 
 /**********************************************************
- * put an empty buffer onto the queue. 
+ * put an empty buffer onto the queue. If no slot can be 
+ * allocated, the buffer has no slots at all. It is still 
+ * an empty buffer (to the reader) and can be released, 
+ * so the signal is not lost. 
  **********************************************************/
  
 void fbq_signal(FBQ* q)
 {
    FBUF b; 
-   fbuf_new(&b);
+   fbuf_new(&b, FBUF_ACC_OTHER, 0);   /* Empty, also if it fails */
    fbq_put(q, b);
 }
 
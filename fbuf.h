@@ -19,38 +19,87 @@ typedef uint16_t fbindex_t;
  *********************************/
 typedef struct _fb
 {
-   fbindex_t head, wslot, rslot; 
-   uint16_t  rpos; 
+   fbindex_t head, wslot, rslot, tail; 
+   uint16_t  rpos, rbase;   /* Read position in slot and position of slot */
    uint16_t  length;
+   uint8_t   tag;       /* Decoded by demodulators (bitmask), 0 if not received */
+   uint8_t   acc;       /* Pool account that new slots are drawn from */
+   uint16_t  hint;      /* Expected size in bytes, 0 if not known */
 }
 FBUF; 
 
 
+/* Slot classes */
+#define FBUF_SMALL 0
+#define FBUF_LARGE 1
+
+/* Size of pool in units of small slots */
+#define FBUF_UNITS (FBUF_SLOTS + FBUF_LSLOTS * (FBUF_LSLOTSIZE / FBUF_SLOTSIZE))
+
+
+/*********************************************************
+   Pool accounts. Each subsystem draws slots from its own
+   account, with a reserved minimum and a cap. Counted in
+   units of small slots (a large slot is several units). 
+ *********************************************************/
+
+#define FBUF_ACC_OTHER    0
+#define FBUF_ACC_RX       1
+#define FBUF_ACC_TX       2
+#define FBUF_ACC_IGATE    3
+#define FBUF_ACC_INET     4
+#define FBUF_ACC_TRACKER  5
+#define FBUF_ACCOUNTS     6
+
+typedef struct _fbacc
+{
+   const char* name; 
+   fbindex_t min, max;     /* Reserved units and max units */
+   fbindex_t used, hwm;    /* Units in use and high water mark */
+   uint32_t  fails;        /* Allocations refused */ 
+   fbindex_t lowmark;      /* Low water mark (units available) */
+   bool      low;          /* Below low water mark */
+   void      (*lowcb)(uint8_t acc, bool low); 
+}
+fbacc_t;
+
+
 /****************************************
    Operations for packet buffer chain
  ****************************************/
 
-void     fbuf_new       (FBUF* b);
+void     fbuf_init      (void);
+bool     fbuf_new       (FBUF* b, uint8_t acc, uint16_t hint);
 FBUF     fbuf_newRef    (FBUF* b);
 void     fbuf_release   (FBUF* b);
 void     fbuf_reset     (FBUF* b);
 void     fbuf_rseek     (FBUF* b, const uint16_t pos);
-void     fbuf_putChar   (FBUF* b, const char c);
-void     fbuf_write     (FBUF* b, const char* data, const uint16_t size);
-void     fbuf_putstr    (FBUF* b, const char *data);
+bool     fbuf_putChar   (FBUF* b, const char c);
+bool     fbuf_write     (FBUF* b, const char* data, const uint16_t size);
+bool     fbuf_putstr    (FBUF* b, const char *data);
 char     fbuf_getChar   (FBUF* b);
+uint16_t fbuf_getSpan   (FBUF* b, const char** data);
+void     fbuf_setChar   (FBUF* b, uint16_t pos, const char c);
 void     fbuf_streamRead(Stream *chp, FBUF* b);
 uint16_t fbuf_read      (FBUF* b, uint16_t size, char *buf);
+uint16_t fbuf_crc       (FBUF* b, uint16_t pos, uint16_t crc);
 void     fbuf_print     (Stream *chp, FBUF* b); 
-void     fbuf_insert    (FBUF* b, FBUF* x, uint16_t pos);
-void     fbuf_connect   (FBUF* b, FBUF* x, uint16_t pos);
+bool     fbuf_insert    (FBUF* b, FBUF* x, uint16_t pos);
+bool     fbuf_connect   (FBUF* b, FBUF* x, uint16_t pos);
+bool     fbuf_nextSlot  (FBUF* b, uint16_t n);
 void     fbuf_removeLast(FBUF* b);
 
-fbindex_t fbuf_usedSlots(void);
-fbindex_t fbuf_freeSlots(void);
+fbindex_t fbuf_usedSlots(uint8_t cls);
+fbindex_t fbuf_freeSlots(uint8_t cls);
 uint16_t fbuf_freeMem(void);
+bool      fbuf_check(void);
+
+fbindex_t fbuf_available(uint8_t acc);
+void      fbuf_getAccount(uint8_t acc, fbacc_t* a);
+void      fbuf_setLowWater(uint8_t acc, fbindex_t mark, void (*cb)(uint8_t, bool));
 
 #define fbuf_eof(b) ((b)->rslot == NILPTR)
+#define fbuf_writable(b) ((b)->wslot != NILPTR)
 #define fbuf_length(b) ((b)->length)
 #define fbuf_empty(b) ((b)->length == 0)
 
@@ -76,7 +125,9 @@ typedef struct _fbq
 void  _fbq_init (FBQ* q, FBUF* buf, const uint16_t size); 
 void  fbq_clear (FBQ* q);
 void  fbq_put   (FBQ* q, FBUF b); 
+bool  fbq_putTimeout(FBQ* q, FBUF b, systime_t timeout);
 FBUF  fbq_get   (FBQ* q);
+bool  fbq_tryGet(FBQ* q, FBUF* b);
 void  fbq_signal(FBQ* q);
 
 
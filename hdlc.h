@@ -13,12 +13,84 @@ void hdlc_wait_idle(void);
 void hdlc_monitor_tx(FBQ* m);
 void hdlc_test_on(uint8_t b);
 void hdlc_test_off(void);
-FBQ* hdlc_init_encoder(output_queue_t *oq);
-fbq_t* hdlc_get_encoder_queue(void);
+void hdlc_init_encoder(void);
 bool hdlc_enc_packets_waiting(void);
-uint8_t rand_u8(void);
 
-void hdlc_subscribe_rx(fbq_t* q, uint8_t i);
-void hdlc_init_decoder (input_queue_t *s);
+/* 
+ * Classes of frames to be sent, in order of priority, and 
+ * default time to live for them. 
+ */
+#define HDLC_TX_DIGI      0   // Digipeated frames
+#define HDLC_TX_BEACON    1   // Own position reports
+#define HDLC_TX_REPORT    2   // Object and status reports
+#define HDLC_TX_OTHER     3   // Test packets, converse mode, etc..
+#define HDLC_TX_CLASSES   4
+
+#define HDLC_TTL_NONE     0
+#define HDLC_TTL_DIGI     S2ST(5)
+#define HDLC_TTL_BEACON   S2ST(30)
+
+/* Transmit statistics for each class */
+typedef struct {
+   uint32_t sent;           // Frames sent 
+   uint32_t expired;        // Frames dropped since they waited too long
+   uint32_t oversize;       // Frames dropped since they did not fit in txbuf
+   uint32_t wait_total;     // Sum of time waited in queue (ms)
+   uint32_t wait_max;       // Max time waited in queue (ms)
+} hdlc_txstat_t;
+
+void hdlc_tx_put(FBUF b, uint8_t cls, systime_t ttl);
+uint8_t hdlc_tx_waiting(uint8_t cls);
+void hdlc_tx_getStats(uint8_t cls, hdlc_txstat_t* st, bool reset);
+
+
+/* 
+ * Subscriber to received frames. Each subscriber has its own queue 
+ * and a policy for what to do when the queue is full.  
+ */
+#define HDLC_DROP_NEWEST 0   // Drop the frame being delivered
+#define HDLC_DROP_OLDEST 1   // Drop the oldest frame in the queue
+#define HDLC_BLOCK       2   // Wait for room, at most 'timeout'
+
+#define HDLC_MAX_SUBSCRIBERS 6
+
+typedef struct _hdlc_sub {
+   const char* name; 
+   fbq_t* q;                // Queue of received frames
+   uint8_t policy;          // When queue is full
+   systime_t timeout;       // Max wait with HDLC_BLOCK
+   uint32_t delivered;      // Frames put into queue
+   uint32_t dropped;        // Frames dropped since queue was full
+   uint8_t busy;            // Deliveries in progress
+   struct _hdlc_sub* next;
+} hdlc_sub_t;
+
+/* Copy of the counters of a subscriber */
+typedef struct {
+   const char* name; 
+   uint32_t delivered; 
+   uint32_t dropped;
+} hdlc_substat_t;
+
+void hdlc_subscribe_rx(hdlc_sub_t* s, const char* name, fbq_t* q, uint8_t policy, systime_t timeout);
+void hdlc_unsubscribe_rx(hdlc_sub_t* s);
+uint8_t hdlc_rx_subStats(hdlc_substat_t* st, uint8_t max);
+
+void hdlc_init_decoder (input_queue_t *s, uint8_t i);
+uint32_t hdlc_rx_frames(void);
+void hdlc_rx_variantStats(uint8_t i, uint32_t* decoded, uint32_t* unique, uint32_t* recovered);
+void hdlc_rx_setFcsTries(uint8_t n);
+
+/* Receiver statistics */
+typedef struct {
+   uint32_t flags;          // Flags seen
+   uint32_t frames;         // Frames started 
+   uint32_t aborts;         // More than 5 consecutive ones 
+   uint32_t oversize;       // Frames longer than MAX_HDLC_FRAME_SIZE
+   uint32_t fcs_errors;     // Frames with bad FCS (that could not be repaired)
+   uint32_t delivered;      // Frames delivered to subscribers
+} hdlc_rxstat_t;
+
+void hdlc_rx_getStats(hdlc_rxstat_t* st, bool reset);
 
 #endif
\ No newline at end of file
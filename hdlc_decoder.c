@@ -9,170 +9,754 @@
 #include "util/crc16.h"
 #include "defines.h"
 #include <stdlib.h>
+#include <string.h>
 #include "hdlc.h"
 #include "ax25.h"
 #include "hal.h"
 #include "fbuf.h"
 #include "ui/ui.h"
+#include "hdlc_table.h"
 
 
-static input_queue_t *inq;
-static fbuf_t fbuf;
-static fbq_t* mqueue[3];
+#define WEAK_BITS 12          /* Number of least confident bits to remember */
+#define FCS_RESIDUE 0xF0B8    /* CRC of frame including a correct FCS */
 
-static uint8_t get_bit (void); 
-static bool crc_match(FBUF*, uint8_t);
 
-THREAD_STACK(hdlc_rxdecoder, STACK_HDLCDECODER);
+/* 
+ * Decoder instance. One for each demodulator variant 
+ */
+typedef struct {
+   uint8_t id;              // Demodulator variant 
+   input_queue_t *inq;      // Bits from demodulator
+   
+   /* Deframer state */
+   uint8_t ones;            // Consecutive one bits received (max 7)
+   bool in_frame;           // Flag seen, receiving frame
+   uint16_t acc;            // De-stuffed bits not yet put into frame
+   uint64_t acc_conf;       // Confidence of these bits (4 bits each)
+   uint8_t nacc;            // Number of bits in acc
+   uint16_t length;         // Octets received in frame
+   uint16_t crc;            // FCS computed so far 
+   uint8_t frame[MAX_HDLC_FRAME_SIZE];   // Frame being received
+   
+   /* The least confident bits of the frame being received */
+   uint8_t nweak; 
+   uint8_t weak_max;        // Index of the most confident of them
+   uint16_t weak_pos[WEAK_BITS];
+   uint8_t weak_conf[WEAK_BITS];
    
+   hdlc_rxstat_t stat;      // Statistics 
+} hdlc_rx_t; 
+
+static hdlc_rx_t decoder[AFSK_RX_VARIANTS];
+static hdlc_sub_t* subscribers = NULL;
+static uint8_t nsubscribers = 0;
+static MUTEX_DECL(sub_mutex);
+static CONDVAR_DECL(sub_idle);     // Signalled when deliveries to a subscriber end
+
+static void deframe_octet(hdlc_rx_t* rx, uint8_t octet, uint32_t conf);
+static void deframe_bit(hdlc_rx_t* rx, uint8_t bit, uint8_t conf);
+static void frame_end(hdlc_rx_t* rx);
+static void weak_add(hdlc_rx_t* rx, uint16_t pos, uint8_t conf);
+static bool fcs_recover(hdlc_rx_t* rx, uint16_t length, uint16_t residue);
+
+static THD_WORKING_AREA(wa_hdlc_rxdecoder[AFSK_RX_VARIANTS], STACK_HDLCDECODER);
+
+
+
+/*
+ * Frames recently received. When more than one demodulator is 
+ * running, the same frame is normally decoded more than once. 
+ * Frames with the same FCS and length within DEDUP_WINDOW are 
+ * regarded as duplicates. The first decoder to get a frame puts
+ * it on the held queue and goes on decoding. The deliver thread 
+ * releases it DEDUP_WAIT after it was received, to give the other 
+ * decoders a chance, tagged with the demodulators that decoded it.
+ */
+#define DEDUP_SIZE      8
+#define DEDUP_WINDOW  500 
+#define DEDUP_WAIT     20
+
+typedef struct {
+   uint16_t fcs; 
+   uint16_t length;
+   systime_t time;
+   uint8_t mask;
+} rxframe_t;
+
+static rxframe_t recent[DEDUP_SIZE];
+static uint8_t recent_next = 0;
+static uint32_t rx_frames = 0;
+static uint32_t rx_decoded[AFSK_RX_VARIANTS];
+static uint32_t rx_unique[AFSK_RX_VARIANTS];
+static uint32_t rx_recovered[AFSK_RX_VARIANTS];
+static MUTEX_DECL(dedup_mutex);
+
+/* Frames waiting for DEDUP_WAIT, in order of arrival */
+typedef struct {
+   FBUF fb;                 // Frame (empty if not to be delivered)
+   rxframe_t* f;            // Entry in recent
+   systime_t time;          // When received
+   uint16_t fcs, length;
+   uint8_t id;              // Demodulator variant that got it first
+} rxheld_t;
+
+static rxheld_t held[DEDUP_SIZE];
+static uint8_t held_first = 0, held_cnt = 0;
+static SEMAPHORE_DECL(held_frames, 0);
+
+THREAD_STACK(hdlc_rxdeliver, STACK_HDLCDELIVER);
+static rxframe_t* rx_dedup(hdlc_rx_t* rx, uint16_t fcs, uint16_t length);
+static void rx_release(rxheld_t* h);
+
 
 
 /***********************************************************
- * Subscribe or unsubscribe to packets from decoder
- * packets are put into the given buffer queue.
+ * Subscribe to packets from decoder. Packets are put into 
+ * the given buffer queue. The subscriber object must stay 
+ * allocated until unsubscribed. Subscribing again just 
+ * updates the queue and policy. 
  ***********************************************************/
  
-void hdlc_subscribe_rx(fbq_t* q, uint8_t i)
+void hdlc_subscribe_rx(hdlc_sub_t* s, const char* name, fbq_t* q, uint8_t policy, systime_t timeout)
 {
-    if (i > 2)
-        return;
-    if (mqueue[i] != NULL)
-        fbq_clear(mqueue[i]);
-    mqueue[i] = q;
+    hdlc_sub_t* x;
+    chMtxLock(&sub_mutex);
+    s->name = name;
+    s->q = q;
+    s->policy = policy;
+    s->timeout = timeout; 
+    for (x = subscribers; x != NULL && x != s; x = x->next)
+        ;
+    if (x == NULL) {
+        chDbgAssert(nsubscribers < HDLC_MAX_SUBSCRIBERS, "too many subscribers");
+        s->busy = 0;
+        s->next = subscribers;
+        subscribers = s;
+        nsubscribers++;
+    }
+    chMtxUnlock(&sub_mutex);
 }
 
 
 
+/***********************************************************
+ * Unsubscribe. Waits until deliveries to the subscriber in 
+ * progress are finished. Then all frames still in the queue 
+ * are released, also frames put there by others than the 
+ * decoder (the igate queue also gets frames from the 
+ * tracker, see tracker_setGate).  
+ ***********************************************************/
+
+void hdlc_unsubscribe_rx(hdlc_sub_t* s)
+{
+    hdlc_sub_t** x;
+    bool found = false;
+    chMtxLock(&sub_mutex);
+    for (x = &subscribers; *x != NULL; x = &(*x)->next) 
+        if (*x == s) {
+            *x = s->next;
+            s->next = NULL;
+            nsubscribers--;
+            found = true;
+            break;
+        }
+    while (found && s->busy > 0)
+        chCondWait(&sub_idle);
+    chMtxUnlock(&sub_mutex);
+    if (found)
+        fbq_clear(s->q);
+}
+
 
 
 /***********************************************************
- * Get a bit from the demodulator layer.
- * .. or a FLAG
+ * Copy the counters of the subscribers into st (at most 
+ * max of them). Return the number of subscribers copied.
  ***********************************************************/
- 
-static uint8_t get_bit ()
-{
-   static uint16_t bits = 0xffff;
-   static uint8_t bit_count = 0;
-   if (bit_count < 8) {
-      register uint8_t byte = iqGet(inq);
-      bits |= ((uint16_t) byte << bit_count);
-      bit_count += 8;
-   }
-   if ((uint8_t) (bits & 0x00ff) == HDLC_FLAG) {
-      bits >>= 8;
-      bit_count -= 8;
-      return HDLC_FLAG;
-   } 
-   else {
-      uint8_t bit = (uint8_t) bits & 0x0001;
-      bits >>= 1;
-      bit_count--;
-      return bit;
-  }
+
+uint8_t hdlc_rx_subStats(hdlc_substat_t* st, uint8_t max)
+{
+    uint8_t n = 0;
+    chMtxLock(&sub_mutex);
+    chSysLock();
+    for (hdlc_sub_t* s = subscribers; s != NULL && n < max; s = s->next, n++) {
+        st[n].name = s->name;
+        st[n].delivered = s->delivered;
+        st[n].dropped = s->dropped;
+    }
+    chSysUnlock();
+    chMtxUnlock(&sub_mutex);
+    return n;
+}
+
+
+
+/***********************************************************
+ * Put a frame into the queue of a subscriber according to 
+ * its policy. If it can not be delivered, it is released. 
+ * Called without holding sub_mutex (it may block with 
+ * HDLC_BLOCK), the subscriber is marked as busy instead. 
+ ***********************************************************/
+
+static void deliver(hdlc_sub_t* s, FBUF fb)
+{
+    FBUF old;
+    bool ok;
+    uint8_t dropped = 0;
+    if (s->policy == HDLC_BLOCK)
+        ok = fbq_putTimeout(s->q, fb, s->timeout);
+    else {
+        ok = fbq_putTimeout(s->q, fb, TIME_IMMEDIATE);
+        if (!ok && s->policy == HDLC_DROP_OLDEST && fbq_tryGet(s->q, &old)) {
+            fbuf_release(&old);
+            dropped++;
+            ok = fbq_putTimeout(s->q, fb, TIME_IMMEDIATE);
+        }
+    }
+    if (!ok) {
+        fbuf_release(&fb);
+        dropped++;
+    }
+    chSysLock();
+    if (ok)
+        s->delivered++;
+    s->dropped += dropped;
+    chSysUnlock();
+}
+
+
+
+
+
+/***********************************************************
+ * Remember the position of a bit in the frame if it is 
+ * among the WEAK_BITS least confident bits so far.
+ ***********************************************************/
+
+static void weak_add(hdlc_rx_t* rx, uint16_t pos, uint8_t conf)
+{
+   uint8_t i;
+   if (rx->nweak < WEAK_BITS) 
+      i = rx->nweak++;
+   else if (conf < rx->weak_conf[rx->weak_max])
+      i = rx->weak_max;
+   else
+      return;
+   
+   rx->weak_pos[i] = pos;
+   rx->weak_conf[i] = conf;
+   if (rx->nweak == WEAK_BITS) {
+      rx->weak_max = 0;
+      for (i=1; i<WEAK_BITS; i++)
+         if (rx->weak_conf[i] > rx->weak_conf[rx->weak_max])
+            rx->weak_max = i;
+   }
 }
 
 
 
 
 /***********************************************************
- * Main decoder thread.
+ * Main decoder thread. One for each demodulator variant.
+ * Get records from the demodulator: An octet of received 
+ * bits and the confidence of each bit. 
  ***********************************************************/
 __attribute__((noreturn))
 static THD_FUNCTION(hdlc_rxdecoder, arg)
 {  
-   (void)arg;
-   uint8_t bit;
+   hdlc_rx_t *rx = (hdlc_rx_t*) arg;
    chRegSetThreadName("HDLC RX Decoder");
    
-   /* Sync to next flag */
-   flag_sync:
-   do {  
-      bit = get_bit ();
-   }  while (bit != HDLC_FLAG);
-
-   
-   /* Sync to next frame */
-   frame_sync:
-   do {     
-      bit = get_bit ();
-   }  while (bit == HDLC_FLAG);
-
-   /* Receiving frame */
-   uint8_t bit_count = 0;
-   uint8_t ones_count = 0;
-   uint16_t length = 0;
-   uint8_t octet = 0;
-   
-   fbuf_release (&fbuf); // In case we had an abort or checksum
-   fbuf_new(&fbuf);      // mismatch on the previous frame
-   do {
-      if (length > MAX_HDLC_FRAME_SIZE) 
-         goto flag_sync; // Lost termination flag or only receiving noise?
-      
-          
-      for (bit_count = 0; bit_count < 8; bit_count++) 
-      {
-         octet = (bit ? 0x80 : 0x00) | (octet >> 1);
-         if (bit) ones_count++;   
-         else ones_count = 0; 
-         if (bit == HDLC_FLAG)    // Not very likely, but could happen
-            goto frame_sync;
-         bit = get_bit ();
-         if (ones_count == 5) {
-            if (bit)              // Got more than five consecutive one bits,
-               goto flag_sync;    // which is a certain error
-            ones_count = 0;
-            bit = get_bit();      // Bit stuffing - skip one bit
-         }
+   while (true) {
+      uint8_t octet = iqGet(rx->inq);
+      uint32_t conf = 0;
+      for (uint8_t i=0; i<4; i++)
+         conf |= (uint32_t) ((uint8_t) iqGet(rx->inq)) << (i*8);
+      deframe_octet(rx, octet, conf);
+   }
+}
+
+
+
+/***********************************************************
+ * Put de-stuffed bits (first bit in LSB) with their 
+ * confidence into the frame. Each complete octet is added 
+ * to the receive buffer and to the FCS computation, and its 
+ * least confident bits are remembered for FCS repair. 
+ ***********************************************************/
+
+static inline void add_bits(hdlc_rx_t* rx, uint8_t bits, uint8_t n, uint32_t conf)
+{
+   if (!rx->in_frame)
+      return;
+   rx->acc |= (uint16_t) bits << rx->nacc;
+   rx->acc_conf |= (uint64_t) conf << (rx->nacc * 4);
+   rx->nacc += n; 
+   if (rx->nacc < 8)
+      return;
+   
+   uint8_t octet = (uint8_t) rx->acc;
+   conf = (uint32_t) rx->acc_conf;
+   rx->acc >>= 8;
+   rx->acc_conf >>= 32;
+   rx->nacc -= 8;
+   
+   if (rx->length >= MAX_HDLC_FRAME_SIZE) {
+      /* Lost termination flag or only receiving noise? */
+      rx->stat.oversize++;
+      rx->in_frame = false;
+      return;
+   }
+   if (rx->length == 0) {
+      rx->crc = 0xFFFF;
+      rx->nweak = 0;
+      rx->stat.frames++;
+   }
+   for (uint8_t i=0; i<8; i++, conf >>= 4) {
+      uint8_t c = conf & 0x0f;
+      if (rx->nweak < WEAK_BITS || c < rx->weak_conf[rx->weak_max])
+         weak_add(rx, rx->length*8 + i, c);
+   }
+   rx->frame[rx->length++] = octet;
+   rx->crc = crc_ccitt_update(rx->crc, octet);
+}
+
+
+
+/***********************************************************
+ * Deframer. Process an octet of received bits using the
+ * state transition table (see hdlc_table.h): The number of
+ * consecutive ones so far and the octet give the de-stuffed
+ * bits and the new number of ones. If a flag or an abort 
+ * may be found in the octet, it is processed a bit at a 
+ * time instead. 
+ ***********************************************************/
+
+static void deframe_octet(hdlc_rx_t* rx, uint8_t octet, uint32_t conf)
+{
+   uint32_t e = (rx->ones < 6 ? hdlc_dtab[rx->ones][octet] : HDLC_DT_SLOW);
+   if (e & HDLC_DT_SLOW) {
+      for (uint8_t i=0; i<8; i++, octet >>= 1, conf >>= 4)
+         deframe_bit(rx, octet & 0x01, conf & 0x0f);
+      return;
+   }
+   rx->ones = HDLC_DT_ONES(e);
+   if (!rx->in_frame)
+      return;
+   
+   /* Remove the confidence of stuffing bits (at most 2) */
+   uint8_t n = HDLC_DT_NBITS(e);
+   uint8_t stuffed = ~HDLC_DT_KEEP(e);
+   while (stuffed) {
+      uint8_t i = 31 - __builtin_clz(stuffed);
+      uint32_t low = conf & ((1UL << (i*4)) - 1);
+      conf = ((conf >> 4) & ~((1UL << (i*4)) - 1)) | low;
+      stuffed &= ~(1 << i);
+   }
+   add_bits(rx, HDLC_DT_OUT(e), n, conf);
+}
+
+
+
+/***********************************************************
+ * Process a single received bit. Six ones followed by a 
+ * zero is a flag. More than six ones is an abort. A zero 
+ * after five ones is stuffing, to be removed. The zero and 
+ * five ones of a flag are added to the frame before we 
+ * know it is a flag, so a frame ending at an octet boundary 
+ * has exactly six bits left when the flag is found. 
+ ***********************************************************/
+
+static void deframe_bit(hdlc_rx_t* rx, uint8_t bit, uint8_t conf)
+{
+   if (bit) {
+      if (rx->ones < 7)
+         rx->ones++;
+      if (rx->ones < 6)
+         add_bits(rx, 1, 1, conf);
+      else if (rx->ones == 7 && rx->in_frame) {
+         /* Got more than six consecutive one bits, which is an abort */
+         rx->stat.aborts++; 
+         rx->in_frame = false;
       }
-      fbuf_putChar(&fbuf, octet);
-      length++;
-   } while (bit != HDLC_FLAG);
-
-   if (length > AX25_HDR_LEN(0)+2 && crc_match(&fbuf, length)) 
-   {     
-      /* Send packets to subscribers, if any. 
-       * Note that every receiver should release the buffers after use. 
-       * Note also that receiver queues should not share the fbuf, use newRef to create a new reference
-       */
-      fbuf_removeLast(&fbuf);
-      fbuf_removeLast(&fbuf);
-
-      if (mqueue[0] || mqueue[1] || mqueue[2]) { 
-         if (mqueue[0]) fbq_put( mqueue[0], fbuf);               /* Monitor */
-         if (mqueue[1]) fbq_put( mqueue[1], fbuf_newRef(&fbuf)); /* Digipeater */
-         if (mqueue[2]) fbq_put( mqueue[2], fbuf_newRef(&fbuf)); /* Igate */
+      return;
+   }
+   
+   if (rx->ones == 6) {
+      rx->stat.flags++;
+      if (rx->in_frame && rx->nacc == 6)
+         frame_end(rx);
+      else if (rx->in_frame && rx->length > AX25_HDR_LEN(0)+2)
+         rx->stat.fcs_errors++;     /* Does not end at octet boundary */
+      
+      /* Two consecutive frames may share the same flag */
+      rx->in_frame = true;
+      rx->length = 0; 
+      rx->acc = 0;
+      rx->acc_conf = 0;
+      rx->nacc = 0;
+   }
+   else if (rx->ones < 5)
+      add_bits(rx, 0, 1, conf);
+   rx->ones = 0;
+}
+
+
+
+/***********************************************************
+ * Length of the AX.25 header (addresses, control and PID), 
+ * with the digipeaters counted as ax25_decode_header does. 
+ ***********************************************************/
+
+static uint16_t hdr_length(const uint8_t* f, uint16_t length)
+{
+   uint8_t i = 0;
+   if (!(f[13] & 0x01))
+      for (i=1; i<8 && 13 + i*7 < length && !(f[13 + i*7] & 0x01); i++)
+         ;
+   return (AX25_HDR_LEN(i) < length ? AX25_HDR_LEN(i) : length);
+}
+
+
+
+/***********************************************************
+ * A complete frame is received. Check the FCS and try to 
+ * repair it if it is wrong. The CRC over the whole frame, 
+ * including the FCS field, is FCS_RESIDUE if the frame is 
+ * correct. Only then the frame (without the FCS field) is 
+ * copied into a frame buffer and delivered to subscribers.
+ ***********************************************************/
+
+static void frame_end(hdlc_rx_t* rx)
+{
+   uint16_t length = rx->length; 
+   uint16_t fcs;
+   rxheld_t h;
+   
+   if (length <= AX25_HDR_LEN(0)+2)
+      return;
+   if (rx->crc != FCS_RESIDUE && !fcs_recover(rx, length, rx->crc)) {
+      rx->stat.fcs_errors++;
+      return;
+   }
+   fcs = (uint16_t) (rx->frame[length-2] ^ 0xFF) | (uint16_t) (rx->frame[length-1] ^ 0xFF) << 8;
+      
+   /* Drop it if another demodulator got it first */
+   if ((h.f = rx_dedup(rx, fcs, length)) == NULL)
+      return;
+   
+   /* Copy it into a frame buffer, the header in slots of its own, so 
+    * that the digipeater and igate can connect a new header to the rest 
+    * without copying. If there are no subscribers (or no buffer space) 
+    * it is held anyway, to count it. 
+    */
+   uint16_t hlen = hdr_length(rx->frame, length-2);
+   fbuf_new(&h.fb, FBUF_ACC_RX, hlen);
+   if (subscribers == NULL || !fbuf_write(&h.fb, (char*) rx->frame, hlen)
+         || !fbuf_nextSlot(&h.fb, length-2-hlen)
+         || !fbuf_write(&h.fb, (char*) rx->frame + hlen, length-2-hlen))
+      fbuf_release(&h.fb);
+   h.time = chVTGetSystemTime();
+   h.fcs = fcs;
+   h.length = length;
+   h.id = rx->id;
+   
+   /* Hold it for DEDUP_WAIT, unless it is the only demodulator 
+    * or the held queue is full 
+    */
+   if (AFSK_RX_VARIANTS > 1) {
+      chSysLock();
+      if (held_cnt < DEDUP_SIZE) {
+         held[(held_first + held_cnt) % DEDUP_SIZE] = h;
+         held_cnt++;
+         chSemSignalI(&held_frames);
+         chSchRescheduleS();
+         chSysUnlock();
+         return;
       }
-      if (mqueue[0]==NULL)
-         fbuf_release(&fbuf); 
-      fbuf_new(&fbuf);
+      chSysUnlock();
    }
+   rx_release(&h);
+}
+
+
 
-   goto frame_sync; // Two consecutive frames may share the same flag
+/***********************************************************
+ * Deliver thread. Takes frames from the held queue when 
+ * they have waited DEDUP_WAIT, and delivers them. 
+ ***********************************************************/
+
+__attribute__((noreturn))
+static THD_FUNCTION(hdlc_rxdeliver, arg)
+{
+   (void)arg;
+   rxheld_t h;
+   chRegSetThreadName("HDLC RX Deliver");
+   
+   while (true) {
+      chSemWait(&held_frames);
+      chSysLock();
+      h = held[held_first];
+      held_first = (held_first + 1) % DEDUP_SIZE;
+      held_cnt--;
+      chSysUnlock();
+      
+      systime_t waited = chVTTimeElapsedSinceX(h.time);
+      if (waited < MS2ST(DEDUP_WAIT))
+         chThdSleep(MS2ST(DEDUP_WAIT) - waited);
+      rx_release(&h);
+   }
 }
 
 
 
 /***********************************************************
- * CRC check
+ * Tag a frame with the demodulators that decoded it, count 
+ * it and send it to subscribers. A full queue does not hold 
+ * up the receiver (except with HDLC_BLOCK, up to its 
+ * timeout). Every subscriber gets its own reference and 
+ * should release it after use. 
  ***********************************************************/
 
-bool crc_match(FBUF* b, uint8_t length)
+static void rx_release(rxheld_t* h)
 {
-   /* Calculate FCS from frame content */
-   uint16_t crc = 0xFFFF;
+   uint8_t bit = 1 << h->id;
+   uint8_t tag;
+   
+   chMtxLock(&dedup_mutex);
+   tag = (h->f->fcs == h->fcs && h->f->length == h->length ? h->f->mask : bit);
+   if (tag == bit)
+      rx_unique[h->id]++;
+   rx_frames++;
+   chMtxUnlock(&dedup_mutex);
+   
+   if (fbuf_empty(&h->fb))
+      return;
+   h->fb.tag = tag;
+   FBUF fb = h->fb;
+   
+   /* Collect the subscribers, then deliver without holding the mutex, 
+    * so that a slow subscriber does not hold up (un)subscribing. 
+    */
+   hdlc_sub_t* targets[HDLC_MAX_SUBSCRIBERS];
+   uint8_t n = 0;
+   chMtxLock(&sub_mutex);
+   for (hdlc_sub_t* s = subscribers; s != NULL && n < HDLC_MAX_SUBSCRIBERS; s = s->next) {
+      s->busy++;
+      targets[n++] = s;
+   }
+   chMtxUnlock(&sub_mutex);
+   
+   for (uint8_t i=0; i<n; i++)
+      deliver(targets[i], fbuf_newRef(&fb));
+   
+   /* Counted under the same locks as hdlc_rx_getStats reads and 
+    * resets it, since this may run in the deliver thread as well 
+    * as in the decoder thread. 
+    */
+   chMtxLock(&sub_mutex);
+   for (uint8_t i=0; i<n; i++)
+      targets[i]->busy--;
+   chCondBroadcast(&sub_idle);
+   chSysLock();
+   decoder[h->id].stat.delivered++;
+   chSysUnlock();
+   chMtxUnlock(&sub_mutex);
+   fbuf_release(&fb); 
+}
+
+
+
+/***********************************************************
+ * Try to repair a frame with a bad FCS by flipping the 
+ * least confident bits, first one at a time and then in 
+ * pairs, up to FCS_TRIES attempts. The CRC is linear, so 
+ * the effect of an error in a given bit on the residue 
+ * can be computed without going through the frame again: 
+ * It is the CRC (starting at zero) of a one bit followed 
+ * by the rest of the frame as zeros. 
+ * 
+ * Errors that change the bit stuffing can not be repaired 
+ * this way. A repaired frame must have a valid looking 
+ * address field, to reduce the chance of making garbage 
+ * from noise.  
+ ***********************************************************/
+
+static inline void flip_bit(uint8_t* frame, uint16_t pos)
+   { frame[pos >> 3] ^= (1 << (pos & 0x07)); }
+
+
+static bool addr_valid(const uint8_t* frame)
+{
+   for (uint8_t i=0; i<14; i++) {
+      char c = frame[i];
+      if (i % 7 == 6) 
+         continue;          /* SSID byte */
+      if (c & 0x01)
+         return false;
+      c = (c >> 1) & 0x7f;
+      if (c != ' ' && (c < '0' || c > '9') && (c < 'A' || c > 'Z'))
+         return false;
+   }
+   return true;
+}
+
+
+/* FCS_TRIES setting, kept here to not read EEPROM for every bad frame */
+static uint8_t fcs_tries = 0;
+
+void hdlc_rx_setFcsTries(uint8_t n)
+   { fcs_tries = n; }
+
+
+static bool fcs_recover(hdlc_rx_t* rx, uint16_t length, uint16_t residue)
+{
+   uint8_t  tries = fcs_tries;
+   uint16_t syndrome = residue ^ FCS_RESIDUE;
+   uint16_t err[WEAK_BITS];
+   uint8_t  order[WEAK_BITS];
+   uint8_t  n = rx->nweak;
+   uint8_t  i, j, k;
+   int8_t   flip1 = -1, flip2 = -1;
+   
+   if (tries == 0 || n == 0)
+      return false;
+   
+   /* Sort weak bits by position, last bit first */
+   for (i=0; i<n; i++) {
+      for (j=i; j>0 && rx->weak_pos[order[j-1]] < rx->weak_pos[i]; j--)
+         order[j] = order[j-1];
+      order[j] = i;
+   }
+   
+   /* Compute the effect of an error in each of them */
+   uint16_t reg = 0x8408;
+   uint16_t pos = length*8 - 1; 
+   for (i=0; i<n; i++) {
+      for (; pos > rx->weak_pos[order[i]]; pos--)
+         reg = (reg & 0x0001) ? (reg >> 1) ^ 0x8408 : (reg >> 1);
+      err[order[i]] = reg;
+   }
+   
+   /* Sort weak bits by confidence, least confident first */
+   for (i=0; i<n; i++) {
+      for (j=i; j>0 && rx->weak_conf[order[j-1]] > rx->weak_conf[i]; j--)
+         order[j] = order[j-1];
+      order[j] = i;
+   }
+   
+   /* Try single bits, then pairs of bits */
+   for (i=0; i<n && tries > 0 && flip1 < 0; i++, tries--)
+      if (err[order[i]] == syndrome)
+         flip1 = order[i];
+   for (k=1; k<n && tries > 0 && flip1 < 0; k++)
+      for (i=0; i+k<n && tries > 0 && flip1 < 0; i++, tries--) 
+         if ((err[order[i]] ^ err[order[i+k]]) == syndrome) {
+            flip1 = order[i];
+            flip2 = order[i+k];
+         }
+   if (flip1 < 0)
+      return false;
+   
+   flip_bit(rx->frame, rx->weak_pos[flip1]);
+   if (flip2 >= 0)
+      flip_bit(rx->frame, rx->weak_pos[flip2]);
+   if (!addr_valid(rx->frame))
+      return false;
+   rx_recovered[rx->id]++;
+   return true;
+}
+
+
+
+/***********************************************************
+ * Check if a frame is already received by another 
+ * demodulator. If the frame is new and should be delivered,
+ * return its entry in recent. It is tagged with the mask
+ * of the demodulators when released (see rx_release). 
+ * Return NULL if it is a duplicate.
+ ***********************************************************/
+
+static rxframe_t* rx_dedup(hdlc_rx_t* rx, uint16_t fcs, uint16_t length)
+{
+   uint8_t bit = 1 << rx->id;
+   rxframe_t *f;
    uint8_t i;
-   for (i=0; i<length-2; i++)
-       crc = _crc_ccitt_update(crc, fbuf_getChar(b)); 
-       
-   /* Get FCS from 2 last bytes of frame */
-   uint16_t rcrc; 
-   fbuf_rseek(b, length-2);
-   rcrc = (uint16_t) fbuf_getChar(b) ^ 0xFF;
-   rcrc |= (uint16_t) (fbuf_getChar(b) ^ 0xFF) << 8;
- 
-   return (crc==rcrc);
+   
+   chMtxLock(&dedup_mutex);
+   rx_decoded[rx->id]++;
+   for (i=0; i<DEDUP_SIZE; i++) {
+      f = &recent[i];
+      if (f->mask != 0 && f->fcs == fcs && f->length == length
+            && chVTTimeElapsedSinceX(f->time) < MS2ST(DEDUP_WINDOW)) {
+         f->mask |= bit;
+         chMtxUnlock(&dedup_mutex);
+         return NULL;
+      }
+   }
+   f = &recent[recent_next];
+   recent_next = (recent_next + 1) % DEDUP_SIZE;
+   f->fcs = fcs; 
+   f->length = length;
+   f->time = chVTGetSystemTime();
+   f->mask = bit;
+   chMtxUnlock(&dedup_mutex);
+   return f;
+}
+
+
+
+/***********************************************************
+ * Receiver statistics: Number of frames delivered, number 
+ * of frames decoded by demodulator variant i, number of 
+ * frames decoded by that variant only and number of frames 
+ * repaired by flipping bits (included in decoded).
+ ***********************************************************/
+
+uint32_t hdlc_rx_frames()
+   { return rx_frames; }
+   
+void hdlc_rx_variantStats(uint8_t i, uint32_t* decoded, uint32_t* unique, uint32_t* recovered)
+{
+   if (i >= AFSK_RX_VARIANTS)
+      return; 
+   chMtxLock(&dedup_mutex);
+   *decoded = rx_decoded[i];
+   *unique = rx_unique[i];
+   *recovered = rx_recovered[i];
+   chMtxUnlock(&dedup_mutex);
+}
+
+
+
+
+/***********************************************************
+ * Get statistics of the decoders, summed over all 
+ * variants. Optionally reset the counters. 
+ ***********************************************************/
+
+void hdlc_rx_getStats(hdlc_rxstat_t* st, bool reset)
+{
+   memset(st, 0, sizeof(hdlc_rxstat_t));
+   chMtxLock(&sub_mutex);
+   chSysLock();
+   for (uint8_t v=0; v<AFSK_RX_VARIANTS; v++) {
+      hdlc_rxstat_t *s = &decoder[v].stat; 
+      st->flags += s->flags;
+      st->frames += s->frames;
+      st->aborts += s->aborts;
+      st->oversize += s->oversize;
+      st->fcs_errors += s->fcs_errors;
+      st->delivered += s->delivered;
+      if (reset)
+         memset(s, 0, sizeof(hdlc_rxstat_t));
+   }
+   if (reset)
+      for (hdlc_sub_t* x = subscribers; x != NULL; x = x->next)
+         x->delivered = x->dropped = 0;
+   chSysUnlock();
+   chMtxUnlock(&sub_mutex);
 }
 
 
@@ -182,10 +766,19 @@ bool crc_match(FBUF* b, uint8_t length)
  * init hdlc-deoder
  ***********************************************************/
 
-void hdlc_init_decoder (input_queue_t *s)
+void hdlc_init_decoder (input_queue_t *s, uint8_t i)
 {   
-  inq = s;
-  mqueue[0] = mqueue[1] = mqueue[2] = NULL;
-  fbuf_new(&fbuf);
-  THREAD_START (hdlc_rxdecoder, NORMALPRIO, NULL);
+  if (i >= AFSK_RX_VARIANTS || s == NULL)
+     return;
+  hdlc_rx_t *rx = &decoder[i];
+  rx->id = i;
+  rx->inq = s;
+  rx->ones = 0;
+  rx->in_frame = false;
+  if (i == 0) {
+     hdlc_rx_setFcsTries(GET_BYTE_PARAM(FCS_TRIES));
+     THREAD_START(hdlc_rxdeliver, NORMALPRIO, NULL);
+  }
+  chThdCreateStatic(wa_hdlc_rxdecoder[i], sizeof(wa_hdlc_rxdecoder[i]), 
+     NORMALPRIO, hdlc_rxdecoder, rx);
 }
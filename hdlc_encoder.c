@@ -9,22 +9,57 @@
 #include "defines.h"
 #include "chprintf.h"
 #include <stdlib.h>
+#include <string.h>
 #include "hdlc.h"
 #include "hal.h"
 #include "radio.h"
+#include "afsk.h"
+#include "csma.h"
+#include "hdlc_txtable.h"
 
 
-output_queue_t *outqueue; 
-FBQ encoder_queue; 
 FBQ *mqueue = NULL;
-static FBUF buffer; 
-
-#define BUFFER_EMPTY (fbuf_eof(&buffer))            
 
+/* 
+ * The transmission being rendered: Frames with FCS, bit stuffing 
+ * and flags between them, NRZI encoded. First bit in LSB. 
+ */
+static uint8_t txbuf[HDLC_TXBUF_SIZE];
+static uint16_t txbits;          // Number of bits in txbuf
+static uint8_t ones;             // Consecutive one bits (stuffing state)
+static uint16_t txdelay, txtail;
+
+/* 
+ * Frames waiting to be sent. One queue for each class, in order of 
+ * priority. Each frame has a time to live: If it has waited longer, 
+ * it is dropped. 
+ */
+typedef struct {
+   FBUF frame;
+   systime_t time;               // When queued
+   systime_t ttl;                // Time to live (0 = no limit)
+} txentry_t;
+
+typedef struct {
+   txentry_t q[HDLC_TXCLASS_QUEUE_SIZE];
+   uint8_t first, cnt;
+   semaphore_t capacity;
+   hdlc_txstat_t stat;
+} txclass_t;
+
+static txclass_t txclass[HDLC_TX_CLASSES];
+static semaphore_t tx_frames;    // Number of frames in all queues
+
+/* 
+ * Frame taken from the queues but not sent yet. It may be left for the 
+ * next transmission, so its time to live is checked again when encoding.
+ */
+static txentry_t current;
+static bool pending = false;     // Frame in current not sent yet
+static uint8_t pending_cls;      // Class of that frame
 
-/* FIXME: Those should be parameters stored in EEPROM ! */
-#define PERSISTENCE 80 /* p = x/255 */
-#define SLOTTIME    10 /* Milliseconds/10 */
+/* Max number of bits for a frame of n bytes, FCS and flag after it */
+#define FRAME_MAXBITS(n) (((n)+2) * 10 + 8)
 
 THREAD_STACK(hdlc_txencoder, STACK_HDLCENCODER);
 
@@ -37,9 +72,11 @@ BSEMAPHORE_DECL(enc_idle, false);
 static bool hdlc_idle = true;
 
 // static msg_t hdlc_txencoder(void*);
+static bool tx_get(txentry_t* e, uint8_t* cls, bool wait);
+static bool tx_expired(txentry_t* e, uint8_t cls);
 static void hdlc_encode_frames(void);
 static void hdlc_encode_byte(uint8_t txbyte, bool flag);
-// static msg_t hdlc_testsignal(void *);
+static void nrzi_encode(uint8_t* buf, uint16_t nbits);
 
 
 extern Stream* shell; 
@@ -47,13 +84,8 @@ extern Stream* shell;
 void hdlc_monitor_tx(FBQ* m)
    { mqueue = m; }
 
-fbq_t* hdlc_get_encoder_queue()
-   { return &encoder_queue; }
-
-
-
 bool hdlc_enc_packets_waiting()
-   { return !fbq_eof(&encoder_queue) || !BUFFER_EMPTY; }
+   { return chSemGetCounterI(&tx_frames) > 0 || pending; }
 
 
 void hdlc_wait_idle()
@@ -63,58 +95,164 @@ void hdlc_wait_idle()
    
    
 /*******************************************************
- * Pseudo random function.
+ * Put a frame into the queue of the given class, to be 
+ * sent. 'ttl' is the max time it may wait (0 = no 
+ * limit). Blocks if the queue of the class is full. 
  *******************************************************/
 
-static uint64_t seed = 123456789;
-uint8_t rand_u8()
+void hdlc_tx_put(FBUF b, uint8_t cls, systime_t ttl)
 {
-   seed = (1103515245 * seed + 12345) % 2147483647;
-   return seed % 256;
+   if (cls >= HDLC_TX_CLASSES)
+      cls = HDLC_TX_OTHER;
+   txclass_t* c = &txclass[cls];
+   chSemWait(&c->capacity);
+   chSysLock();
+   txentry_t* e = &c->q[(c->first + c->cnt) % HDLC_TXCLASS_QUEUE_SIZE];
+   e->frame = b;
+   e->time = chVTGetSystemTimeX();
+   e->ttl = ttl;
+   c->cnt++;
+   chSemSignalI(&tx_frames);
+   chSchRescheduleS();
+   chSysUnlock();
 }
 
 
+
 /*******************************************************
- * Code for generating a test signal
+ * Get the next frame to be sent. The class given by 
+ * 'cls' is preferred, if it has frames waiting. 
+ * Otherwise, the frame is taken from the class with 
+ * highest priority. Expired frames are dropped. 
+ * Return false if no frames (and not 'wait'). 
  *******************************************************/
 
-static bool test_active;
-static uint8_t testbyte;
+static bool tx_get(txentry_t* e, uint8_t* cls, bool wait)
+{
+   while (true) {
+      if (wait)
+         chSemWait(&tx_frames);
+      else if (chSemWaitTimeout(&tx_frames, TIME_IMMEDIATE) != MSG_OK)
+         return false;
+         
+      chSysLock();
+      uint8_t i = *cls;
+      if (i >= HDLC_TX_CLASSES || txclass[i].cnt == 0)
+         for (i=0; i<HDLC_TX_CLASSES && txclass[i].cnt == 0; i++)
+            ;
+      txclass_t* c = &txclass[i];
+      *e = c->q[c->first];
+      c->first = (c->first + 1) % HDLC_TXCLASS_QUEUE_SIZE;
+      c->cnt--;
+      chSemSignalI(&c->capacity);
+      chSysUnlock();
+      
+      if (tx_expired(e, i))
+         continue;
+      *cls = i;
+      return true;
+   }
+}
 
-static THD_FUNCTION(hdlc_testsignal, arg)
-{  
-   (void)arg;
-   chRegSetThreadName("HDLC TX Test Signal"); 
-   hdlc_idle = false;
-  
-   while(test_active) 
-     oqPut(outqueue, testbyte);
-   
-   hdlc_idle = true; 
-   return;
+
+
+/*******************************************************
+ * If the frame has waited longer than its time to 
+ * live, drop it, count it and return true. 
+ *******************************************************/
+
+static bool tx_expired(txentry_t* e, uint8_t cls)
+{
+   if (e->ttl == 0 || chVTGetSystemTime() - e->time <= e->ttl)
+      return false;
+   fbuf_release(&e->frame);
+   chSysLock();
+   txclass[cls].stat.expired++;
+   chSysUnlock();
+   return true;
 }
 
-static thread_t* testt=NULL; 
+
+
+/*******************************************************
+ * Update statistics when a frame is encoded for 
+ * transmission. 
+ *******************************************************/
+
+static void tx_sent(txentry_t* e, uint8_t cls)
+{
+   uint32_t waited = ST2MS(chVTGetSystemTime() - e->time);
+   hdlc_txstat_t* st = &txclass[cls].stat;
+   chSysLock();
+   st->sent++;
+   st->wait_total += waited;
+   if (waited > st->wait_max)
+      st->wait_max = waited;
+   chSysUnlock();
+}
+
+
+
+/*******************************************************
+ * Get statistics for a class of frames. 
+ *******************************************************/
+
+void hdlc_tx_getStats(uint8_t cls, hdlc_txstat_t* st, bool reset)
+{
+   if (cls >= HDLC_TX_CLASSES)
+      return;
+   chSysLock();
+   *st = txclass[cls].stat;
+   if (reset)
+      memset(&txclass[cls].stat, 0, sizeof(hdlc_txstat_t));
+   chSysUnlock();
+}
+
+
+uint8_t hdlc_tx_waiting(uint8_t cls)
+   { return (cls < HDLC_TX_CLASSES ? txclass[cls].cnt : 0); }
+
+
+
+/*******************************************************
+ * Code for generating a test signal. The byte is 
+ * repeated until turned off. Two copies of it have an 
+ * even number of zero bits, so the NRZI level is the 
+ * same at the start of each repetition. 
+ *******************************************************/
+
+static bool test_active = false;
+static uint8_t testbuf[2];
+
 void hdlc_test_on(uint8_t b)
 { 
-   testbyte = b;
+   if (test_active)
+      hdlc_test_off();
+   hdlc_idle = false;
    test_active = true;
-   testt = THREAD_DSTART(hdlc_testsignal, STACK_HDLC_TEST, NORMALPRIO, NULL);
+   testbuf[0] = testbuf[1] = b;
+   nrzi_encode(testbuf, 16);
+   afsk_tx_send(testbuf, 16, 0, 0, true);
 }
 
 void hdlc_test_off()
-  { test_active=false; 
-    if (testt!=NULL) chThdWait(testt);
-    testt=NULL;
-  }
+{ 
+   if (!test_active)
+      return;
+   afsk_tx_cancel();
+   afsk_tx_wait();
+   afsk_tx_stop();
+   test_active = false;
+   hdlc_idle = true;
+}
 
 
 
 /*******************************************************************************
  * TX encoder thread
  *
- * This function gets a frame from buffer-queue, and starts the transmitter
- * as soon as the channel is free.   
+ * This function gets a frame from buffer-queue, renders the transmission 
+ * and starts the transmitter as soon as the channel is free.   
  *******************************************************************************/
 extern SerialUSBDriver SDU1;
 __attribute__((noreturn))
@@ -125,25 +263,34 @@ static THD_FUNCTION(hdlc_txencoder, arg)
   chRegSetThreadName("HDLC TX Encoder");
   while (true)  
   {
-     /* Get frame from buffer-queue when available. 
-      * This is a blocking call.
+     /* Get frame from the queues when available, unless one 
+      * was left from the previous transmission. This is a blocking call.
       */  
-     buffer = fbq_get(&encoder_queue); 
-
-     /* Wait until channel is free 
-      * P-persistence algorithm 
-      */
-     radio_wait_enabled();  
+     if (!pending) {
+        pending_cls = HDLC_TX_CLASSES;
+        pending = tx_get(&current, &pending_cls, true); 
+     }
      hdlc_idle = false;
-     for (;;) {
-        wait_channel_ready(); 
-        uint8_t r  = rand_u8();    
-        if (r > PERSISTENCE)
-           sleep(SLOTTIME*10); 
-        else 
-           break;
-      } 
-      hdlc_encode_frames();
+     
+     /* Render the transmission before keying the transmitter */
+     hdlc_encode_frames();
+     if (txbits == 0) {
+        hdlc_idle = true;
+        SIGNAL_IDLE;
+        continue;
+     }
+
+      /* Start bit clock and DAC now, while waiting for the channel */
+      afsk_tx_start();
+      
+      /* Wait until channel is free */
+      csma_wait();
+      afsk_tx_send(txbuf, txbits, txdelay, txtail, false);
+      afsk_tx_wait();
+      
+      /* Stop bit clock and DAC if nothing more to send */
+      if (!hdlc_enc_packets_waiting())
+         afsk_tx_stop();
       hdlc_idle = true; 
       SIGNAL_IDLE;
       sleep(50);
@@ -156,98 +303,153 @@ static THD_FUNCTION(hdlc_txencoder, arg)
  * Initialize hdlc encoder
  *************************************************************/
 
-FBQ* hdlc_init_encoder(output_queue_t *oq) 
+void hdlc_init_encoder() 
 {
-  outqueue = oq;
-  FBQ_INIT(encoder_queue, HDLC_ENCODER_QUEUE_SIZE);
+  chSemObjectInit(&tx_frames, 0);
+  for (uint8_t i=0; i<HDLC_TX_CLASSES; i++) 
+     chSemObjectInit(&txclass[i].capacity, HDLC_TXCLASS_QUEUE_SIZE);
   THREAD_START(hdlc_txencoder, NORMALPRIO, NULL);
-  return &encoder_queue; 
 }
 
 
 
 
 /*******************************************************************************
- * HDLC encode and transmit one or more frames (one single transmission)
- * It is responsible for computing checksum, bit stuffing and for adding 
- * flags at start and end of frames.
+ * HDLC encode one or more frames (one single transmission) into txbuf. 
+ * It is responsible for computing checksum, bit stuffing, NRZI encoding and 
+ * for adding flags between frames. The preamble and postamble flags are 
+ * added by the transmitter. A frame that does not fit into txbuf is left 
+ * pending for the next transmission. Frames of the same class as the 
+ * first one are bundled first, then frames of other classes in order of 
+ * priority, up to MAXFRAME frames. Frames after those are left in the 
+ * queues, so that the next transmission starts with the frame of highest 
+ * priority waiting then. 
  *******************************************************************************/
 
 static void hdlc_encode_frames()
 {
-   uint16_t crc = 0xffff;
-   uint8_t txbyte, i; 
-   uint8_t txdelay = GET_BYTE_PARAM(TXDELAY);
-   uint8_t txtail  = GET_BYTE_PARAM(TXTAIL);
+   uint16_t crc, n;
+   const char* data;
+   uint8_t i; 
    uint8_t maxfr   = GET_BYTE_PARAM(MAXFRAME);
+   uint8_t cls     = pending_cls;
+   
+   txdelay = GET_BYTE_PARAM(TXDELAY);
+   txtail  = GET_BYTE_PARAM(TXTAIL);
+   
+   /* TXDELAY and TXTAIL are given as number of flags at 1200 baud */
+   if (afsk_tx_mode() == MODEM_G3RUH9600) {
+      txdelay *= 8;
+      txtail *= 8;
+   }
+   /* At least one flag to open and close the frames */
+   if (txdelay == 0) txdelay = 1;
+   if (txtail == 0) txtail = 1;
+   
+   txbits = 0;
+   txbuf[0] = 0;
+   ones = 0;
+   
+   /* A frame left from the previous transmission may have expired since */
+   while (pending && tx_expired(&current, pending_cls))
+      pending = tx_get(&current, &pending_cls, false);
+   if (pending)
+      cls = pending_cls;
   
-   /* Preamble of TXDELAY flags */
-   for (i=0; i<txdelay; i++)
-      hdlc_encode_byte(HDLC_FLAG, true);
-
-   for (i=0;i<maxfr;i++) 
+   for (i=0; i<maxfr && pending; i++) 
    { 
-      fbuf_reset(&buffer);
-      crc = 0xffff;
-
-      while(!BUFFER_EMPTY)
-      {
-         txbyte = fbuf_getChar(&buffer);
-         crc = _crc_ccitt_update (crc, txbyte);
-         hdlc_encode_byte(txbyte, false);
+      if (txbits + FRAME_MAXBITS(fbuf_length(&current.frame)) > (HDLC_TXBUF_SIZE-2) * 8) {
+         if (i == 0) {
+            /* Too large for txbuf. Drop it */
+            fbuf_release(&current.frame);
+            pending = false;
+            chSysLock();
+            txclass[pending_cls].stat.oversize++;
+            chSysUnlock();
+         }
+         break;
       }
+      if (i > 0)
+         hdlc_encode_byte(HDLC_FLAG, true);
+      tx_sent(&current, pending_cls);
+      fbuf_reset(&current.frame);
+      crc = fbuf_crc(&current.frame, 0, 0xffff);
+
+      while ((n = fbuf_getSpan(&current.frame, &data)) > 0)
+         for (uint16_t j=0; j<n; j++)
+            hdlc_encode_byte(data[j], false);
+      
+      hdlc_encode_byte(crc^0xFF, false);       // Send FCS, LSB first
+      hdlc_encode_byte((crc>>8)^0xFF, false);  // MSB
+      
       if (mqueue != NULL) {
          /* 
-          * Put packet on monitor queue, if active
+          * Put packet on monitor queue, if active. Do not wait for 
+          * the monitor, drop the copy if its queue is full. 
           */
-          fbq_put(mqueue, buffer);
+          if (!fbq_putTimeout(mqueue, current.frame, TIME_IMMEDIATE))
+             fbuf_release(&current.frame);
       }
       else 
-          fbuf_release(&buffer);   
-    
-      hdlc_encode_byte(crc^0xFF, false);       // Send FCS, LSB first
-      hdlc_encode_byte((crc>>8)^0xFF, false);  // MSB
+          fbuf_release(&current.frame);   
     
-      if (!fbq_eof(&encoder_queue) && i < maxfr) {
-         hdlc_encode_byte(HDLC_FLAG, true);
-         buffer = fbq_get(&encoder_queue); 
-      }
-      else
-         break;
+      /* Take the next frame only if it may go into this transmission */
+      pending_cls = cls;
+      pending = (i+1 < maxfr && tx_get(&current, &pending_cls, false));
    }
-
-   /* Postamble of TXTAIL flags */  
-   for (i=0; i<txtail; i++)
-      hdlc_encode_byte(HDLC_FLAG, true);
+   /* Stuffed zero before the postamble flags (bits after txbits are zero) */
+   if (ones == 5)
+      txbits++;
+   nrzi_encode(txbuf, txbits);
 }
 
 
 
-
 /*******************************************************************************
- * HDLC encode and transmit a single byte. Includes bit stuffing if not flag
+ * HDLC encode a single byte into txbuf. Includes bit stuffing if not flag. 
+ * A zero is inserted before a data bit if the five bits before it are ones. 
+ * If a frame ends with five ones, the zero goes before the flag after it.
  *******************************************************************************/
  
  static void hdlc_encode_byte(uint8_t txbyte, bool flag)
  {    
-    static uint8_t outbits = 0;
-    static uint8_t outbyte;
-   
-    for (uint8_t i=1; i<8+1; i++)
-    { 
-       if (!flag && (outbyte & 0x7c) == 0x7c) 
-          i--;
-     
-       else {
-          outbyte |= ((txbyte & 0x01) << 7);
-          txbyte >>= 1;  
-       }
-     
-       if (++outbits == 8) {
-          oqPut(outqueue, outbyte);
-          outbits = 0;
+    uint16_t bits = txbyte; 
+    uint8_t n = 8; 
+    if (flag) {
+       if (ones == 5) {
+          bits <<= 1;
+          n++;
        }
-       outbyte >>= 1;      
-    }   
+       ones = 0;
+    }
+    else {
+       uint16_t e = hdlc_stab[ones][txbyte];
+       bits = HDLC_ST_BITS(e);
+       n = HDLC_ST_NBITS(e);
+       ones = HDLC_ST_ONES(e);
+    }
+    
+    /* Append to txbuf. Bytes after the last one are not in use yet */
+    uint16_t i = txbits >> 3; 
+    uint32_t x = (uint32_t) bits << (txbits & 0x07);
+    txbuf[i] |= (uint8_t) x; 
+    txbuf[i+1] = (uint8_t) (x >> 8);
+    txbuf[i+2] = (uint8_t) (x >> 16);
+    txbits += n;
  }
  
+ 
+ 
+/*******************************************************************************
+ * NRZI encode bits in buffer (in place). Starts at level 0. 
+ * The level changes for each zero bit. 
+ *******************************************************************************/
+
+static void nrzi_encode(uint8_t* buf, uint16_t nbits)
+{
+   uint8_t level = 0;
+   for (uint16_t i=0; i < (nbits+7)/8; i++) {
+      buf[i] = hdlc_nrzi[buf[i]] ^ level;
+      level = (buf[i] & 0x80) ? 0xFF : 0;
+   }
+}
@@ -0,0 +1,288 @@
+/*
+ * State transition table for the HDLC deframer. 
+ * Generated by tools/mk_hdlc_table.py. Do not edit. 
+ */
+
+#if !defined __HDLC_TABLE_H__
+#define __HDLC_TABLE_H__
+
+#define HDLC_DT_SLOW        0x00008000
+#define HDLC_DT_OUT(e)      ((uint8_t) (e))
+#define HDLC_DT_NBITS(e)    (((e) >> 8) & 0x0f)
+#define HDLC_DT_ONES(e)     (((e) >> 12) & 0x07)
+#define HDLC_DT_KEEP(e)     ((uint8_t) ((e) >> 16))
+
+static const uint32_t hdlc_dtab[6][256] = {
+  { /* 0 ones */
+    0x00ff0800, 0x00ff0801, 0x00ff0802, 0x00ff0803, 0x00ff0804, 0x00ff0805,
+    0x00ff0806, 0x00ff0807, 0x00ff0808, 0x00ff0809, 0x00ff080a, 0x00ff080b,
+    0x00ff080c, 0x00ff080d, 0x00ff080e, 0x00ff080f, 0x00ff0810, 0x00ff0811,
+    0x00ff0812, 0x00ff0813, 0x00ff0814, 0x00ff0815, 0x00ff0816, 0x00ff0817,
+    0x00ff0818, 0x00ff0819, 0x00ff081a, 0x00ff081b, 0x00ff081c, 0x00ff081d,
+    0x00ff081e, 0x00df071f, 0x00ff0820, 0x00ff0821, 0x00ff0822, 0x00ff0823,
+    0x00ff0824, 0x00ff0825, 0x00ff0826, 0x00ff0827, 0x00ff0828, 0x00ff0829,
+    0x00ff082a, 0x00ff082b, 0x00ff082c, 0x00ff082d, 0x00ff082e, 0x00ff082f,
+    0x00ff0830, 0x00ff0831, 0x00ff0832, 0x00ff0833, 0x00ff0834, 0x00ff0835,
+    0x00ff0836, 0x00ff0837, 0x00ff0838, 0x00ff0839, 0x00ff083a, 0x00ff083b,
+    0x00ff083c, 0x00ff083d, 0x00bf073e, 0x00008000, 0x00ff0840, 0x00ff0841,
+    0x00ff0842, 0x00ff0843, 0x00ff0844, 0x00ff0845, 0x00ff0846, 0x00ff0847,
+    0x00ff0848, 0x00ff0849, 0x00ff084a, 0x00ff084b, 0x00ff084c, 0x00ff084d,
+    0x00ff084e, 0x00ff084f, 0x00ff0850, 0x00ff0851, 0x00ff0852, 0x00ff0853,
+    0x00ff0854, 0x00ff0855, 0x00ff0856, 0x00ff0857, 0x00ff0858, 0x00ff0859,
+    0x00ff085a, 0x00ff085b, 0x00ff085c, 0x00ff085d, 0x00ff085e, 0x00df073f,
+    0x00ff0860, 0x00ff0861, 0x00ff0862, 0x00ff0863, 0x00ff0864, 0x00ff0865,
+    0x00ff0866, 0x00ff0867, 0x00ff0868, 0x00ff0869, 0x00ff086a, 0x00ff086b,
+    0x00ff086c, 0x00ff086d, 0x00ff086e, 0x00ff086f, 0x00ff0870, 0x00ff0871,
+    0x00ff0872, 0x00ff0873, 0x00ff0874, 0x00ff0875, 0x00ff0876, 0x00ff0877,
+    0x00ff0878, 0x00ff0879, 0x00ff087a, 0x00ff087b, 0x007f077c, 0x007f077d,
+    0x00008000, 0x00008000, 0x00ff1880, 0x00ff1881, 0x00ff1882, 0x00ff1883,
+    0x00ff1884, 0x00ff1885, 0x00ff1886, 0x00ff1887, 0x00ff1888, 0x00ff1889,
+    0x00ff188a, 0x00ff188b, 0x00ff188c, 0x00ff188d, 0x00ff188e, 0x00ff188f,
+    0x00ff1890, 0x00ff1891, 0x00ff1892, 0x00ff1893, 0x00ff1894, 0x00ff1895,
+    0x00ff1896, 0x00ff1897, 0x00ff1898, 0x00ff1899, 0x00ff189a, 0x00ff189b,
+    0x00ff189c, 0x00ff189d, 0x00ff189e, 0x00df175f, 0x00ff18a0, 0x00ff18a1,
+    0x00ff18a2, 0x00ff18a3, 0x00ff18a4, 0x00ff18a5, 0x00ff18a6, 0x00ff18a7,
+    0x00ff18a8, 0x00ff18a9, 0x00ff18aa, 0x00ff18ab, 0x00ff18ac, 0x00ff18ad,
+    0x00ff18ae, 0x00ff18af, 0x00ff18b0, 0x00ff18b1, 0x00ff18b2, 0x00ff18b3,
+    0x00ff18b4, 0x00ff18b5, 0x00ff18b6, 0x00ff18b7, 0x00ff18b8, 0x00ff18b9,
+    0x00ff18ba, 0x00ff18bb, 0x00ff18bc, 0x00ff18bd, 0x00bf177e, 0x00008000,
+    0x00ff28c0, 0x00ff28c1, 0x00ff28c2, 0x00ff28c3, 0x00ff28c4, 0x00ff28c5,
+    0x00ff28c6, 0x00ff28c7, 0x00ff28c8, 0x00ff28c9, 0x00ff28ca, 0x00ff28cb,
+    0x00ff28cc, 0x00ff28cd, 0x00ff28ce, 0x00ff28cf, 0x00ff28d0, 0x00ff28d1,
+    0x00ff28d2, 0x00ff28d3, 0x00ff28d4, 0x00ff28d5, 0x00ff28d6, 0x00ff28d7,
+    0x00ff28d8, 0x00ff28d9, 0x00ff28da, 0x00ff28db, 0x00ff28dc, 0x00ff28dd,
+    0x00ff28de, 0x00df277f, 0x00ff38e0, 0x00ff38e1, 0x00ff38e2, 0x00ff38e3,
+    0x00ff38e4, 0x00ff38e5, 0x00ff38e6, 0x00ff38e7, 0x00ff38e8, 0x00ff38e9,
+    0x00ff38ea, 0x00ff38eb, 0x00ff38ec, 0x00ff38ed, 0x00ff38ee, 0x00ff38ef,
+    0x00ff48f0, 0x00ff48f1, 0x00ff48f2, 0x00ff48f3, 0x00ff48f4, 0x00ff48f5,
+    0x00ff48f6, 0x00ff48f7, 0x00ff58f8, 0x00ff58f9, 0x00ff58fa, 0x00ff58fb,
+    0x00008000, 0x00008000, 0x00008000, 0x00008000
+  },
+  { /* 1 ones */
+    0x00ff0800, 0x00ff0801, 0x00ff0802, 0x00ff0803, 0x00ff0804, 0x00ff0805,
+    0x00ff0806, 0x00ff0807, 0x00ff0808, 0x00ff0809, 0x00ff080a, 0x00ff080b,
+    0x00ff080c, 0x00ff080d, 0x00ff080e, 0x00ef070f, 0x00ff0810, 0x00ff0811,
+    0x00ff0812, 0x00ff0813, 0x00ff0814, 0x00ff0815, 0x00ff0816, 0x00ff0817,
+    0x00ff0818, 0x00ff0819, 0x00ff081a, 0x00ff081b, 0x00ff081c, 0x00ff081d,
+    0x00ff081e, 0x00008000, 0x00ff0820, 0x00ff0821, 0x00ff0822, 0x00ff0823,
+    0x00ff0824, 0x00ff0825, 0x00ff0826, 0x00ff0827, 0x00ff0828, 0x00ff0829,
+    0x00ff082a, 0x00ff082b, 0x00ff082c, 0x00ff082d, 0x00ff082e, 0x00ef071f,
+    0x00ff0830, 0x00ff0831, 0x00ff0832, 0x00ff0833, 0x00ff0834, 0x00ff0835,
+    0x00ff0836, 0x00ff0837, 0x00ff0838, 0x00ff0839, 0x00ff083a, 0x00ff083b,
+    0x00ff083c, 0x00ff083d, 0x00bf073e, 0x00008000, 0x00ff0840, 0x00ff0841,
+    0x00ff0842, 0x00ff0843, 0x00ff0844, 0x00ff0845, 0x00ff0846, 0x00ff0847,
+    0x00ff0848, 0x00ff0849, 0x00ff084a, 0x00ff084b, 0x00ff084c, 0x00ff084d,
+    0x00ff084e, 0x00ef072f, 0x00ff0850, 0x00ff0851, 0x00ff0852, 0x00ff0853,
+    0x00ff0854, 0x00ff0855, 0x00ff0856, 0x00ff0857, 0x00ff0858, 0x00ff0859,
+    0x00ff085a, 0x00ff085b, 0x00ff085c, 0x00ff085d, 0x00ff085e, 0x00008000,
+    0x00ff0860, 0x00ff0861, 0x00ff0862, 0x00ff0863, 0x00ff0864, 0x00ff0865,
+    0x00ff0866, 0x00ff0867, 0x00ff0868, 0x00ff0869, 0x00ff086a, 0x00ff086b,
+    0x00ff086c, 0x00ff086d, 0x00ff086e, 0x00ef073f, 0x00ff0870, 0x00ff0871,
+    0x00ff0872, 0x00ff0873, 0x00ff0874, 0x00ff0875, 0x00ff0876, 0x00ff0877,
+    0x00ff0878, 0x00ff0879, 0x00ff087a, 0x00ff087b, 0x007f077c, 0x007f077d,
+    0x00008000, 0x00008000, 0x00ff1880, 0x00ff1881, 0x00ff1882, 0x00ff1883,
+    0x00ff1884, 0x00ff1885, 0x00ff1886, 0x00ff1887, 0x00ff1888, 0x00ff1889,
+    0x00ff188a, 0x00ff188b, 0x00ff188c, 0x00ff188d, 0x00ff188e, 0x00ef174f,
+    0x00ff1890, 0x00ff1891, 0x00ff1892, 0x00ff1893, 0x00ff1894, 0x00ff1895,
+    0x00ff1896, 0x00ff1897, 0x00ff1898, 0x00ff1899, 0x00ff189a, 0x00ff189b,
+    0x00ff189c, 0x00ff189d, 0x00ff189e, 0x00008000, 0x00ff18a0, 0x00ff18a1,
+    0x00ff18a2, 0x00ff18a3, 0x00ff18a4, 0x00ff18a5, 0x00ff18a6, 0x00ff18a7,
+    0x00ff18a8, 0x00ff18a9, 0x00ff18aa, 0x00ff18ab, 0x00ff18ac, 0x00ff18ad,
+    0x00ff18ae, 0x00ef175f, 0x00ff18b0, 0x00ff18b1, 0x00ff18b2, 0x00ff18b3,
+    0x00ff18b4, 0x00ff18b5, 0x00ff18b6, 0x00ff18b7, 0x00ff18b8, 0x00ff18b9,
+    0x00ff18ba, 0x00ff18bb, 0x00ff18bc, 0x00ff18bd, 0x00bf177e, 0x00008000,
+    0x00ff28c0, 0x00ff28c1, 0x00ff28c2, 0x00ff28c3, 0x00ff28c4, 0x00ff28c5,
+    0x00ff28c6, 0x00ff28c7, 0x00ff28c8, 0x00ff28c9, 0x00ff28ca, 0x00ff28cb,
+    0x00ff28cc, 0x00ff28cd, 0x00ff28ce, 0x00ef276f, 0x00ff28d0, 0x00ff28d1,
+    0x00ff28d2, 0x00ff28d3, 0x00ff28d4, 0x00ff28d5, 0x00ff28d6, 0x00ff28d7,
+    0x00ff28d8, 0x00ff28d9, 0x00ff28da, 0x00ff28db, 0x00ff28dc, 0x00ff28dd,
+    0x00ff28de, 0x00008000, 0x00ff38e0, 0x00ff38e1, 0x00ff38e2, 0x00ff38e3,
+    0x00ff38e4, 0x00ff38e5, 0x00ff38e6, 0x00ff38e7, 0x00ff38e8, 0x00ff38e9,
+    0x00ff38ea, 0x00ff38eb, 0x00ff38ec, 0x00ff38ed, 0x00ff38ee, 0x00ef377f,
+    0x00ff48f0, 0x00ff48f1, 0x00ff48f2, 0x00ff48f3, 0x00ff48f4, 0x00ff48f5,
+    0x00ff48f6, 0x00ff48f7, 0x00ff58f8, 0x00ff58f9, 0x00ff58fa, 0x00ff58fb,
+    0x00008000, 0x00008000, 0x00008000, 0x00008000
+  },
+  { /* 2 ones */
+    0x00ff0800, 0x00ff0801, 0x00ff0802, 0x00ff0803, 0x00ff0804, 0x00ff0805,
+    0x00ff0806, 0x00f70707, 0x00ff0808, 0x00ff0809, 0x00ff080a, 0x00ff080b,
+    0x00ff080c, 0x00ff080d, 0x00ff080e, 0x00008000, 0x00ff0810, 0x00ff0811,
+    0x00ff0812, 0x00ff0813, 0x00ff0814, 0x00ff0815, 0x00ff0816, 0x00f7070f,
+    0x00ff0818, 0x00ff0819, 0x00ff081a, 0x00ff081b, 0x00ff081c, 0x00ff081d,
+    0x00ff081e, 0x00008000, 0x00ff0820, 0x00ff0821, 0x00ff0822, 0x00ff0823,
+    0x00ff0824, 0x00ff0825, 0x00ff0826, 0x00f70717, 0x00ff0828, 0x00ff0829,
+    0x00ff082a, 0x00ff082b, 0x00ff082c, 0x00ff082d, 0x00ff082e, 0x00008000,
+    0x00ff0830, 0x00ff0831, 0x00ff0832, 0x00ff0833, 0x00ff0834, 0x00ff0835,
+    0x00ff0836, 0x00f7071f, 0x00ff0838, 0x00ff0839, 0x00ff083a, 0x00ff083b,
+    0x00ff083c, 0x00ff083d, 0x00bf073e, 0x00008000, 0x00ff0840, 0x00ff0841,
+    0x00ff0842, 0x00ff0843, 0x00ff0844, 0x00ff0845, 0x00ff0846, 0x00f70727,
+    0x00ff0848, 0x00ff0849, 0x00ff084a, 0x00ff084b, 0x00ff084c, 0x00ff084d,
+    0x00ff084e, 0x00008000, 0x00ff0850, 0x00ff0851, 0x00ff0852, 0x00ff0853,
+    0x00ff0854, 0x00ff0855, 0x00ff0856, 0x00f7072f, 0x00ff0858, 0x00ff0859,
+    0x00ff085a, 0x00ff085b, 0x00ff085c, 0x00ff085d, 0x00ff085e, 0x00008000,
+    0x00ff0860, 0x00ff0861, 0x00ff0862, 0x00ff0863, 0x00ff0864, 0x00ff0865,
+    0x00ff0866, 0x00f70737, 0x00ff0868, 0x00ff0869, 0x00ff086a, 0x00ff086b,
+    0x00ff086c, 0x00ff086d, 0x00ff086e, 0x00008000, 0x00ff0870, 0x00ff0871,
+    0x00ff0872, 0x00ff0873, 0x00ff0874, 0x00ff0875, 0x00ff0876, 0x00f7073f,
+    0x00ff0878, 0x00ff0879, 0x00ff087a, 0x00ff087b, 0x007f077c, 0x007f077d,
+    0x00008000, 0x00008000, 0x00ff1880, 0x00ff1881, 0x00ff1882, 0x00ff1883,
+    0x00ff1884, 0x00ff1885, 0x00ff1886, 0x00f71747, 0x00ff1888, 0x00ff1889,
+    0x00ff188a, 0x00ff188b, 0x00ff188c, 0x00ff188d, 0x00ff188e, 0x00008000,
+    0x00ff1890, 0x00ff1891, 0x00ff1892, 0x00ff1893, 0x00ff1894, 0x00ff1895,
+    0x00ff1896, 0x00f7174f, 0x00ff1898, 0x00ff1899, 0x00ff189a, 0x00ff189b,
+    0x00ff189c, 0x00ff189d, 0x00ff189e, 0x00008000, 0x00ff18a0, 0x00ff18a1,
+    0x00ff18a2, 0x00ff18a3, 0x00ff18a4, 0x00ff18a5, 0x00ff18a6, 0x00f71757,
+    0x00ff18a8, 0x00ff18a9, 0x00ff18aa, 0x00ff18ab, 0x00ff18ac, 0x00ff18ad,
+    0x00ff18ae, 0x00008000, 0x00ff18b0, 0x00ff18b1, 0x00ff18b2, 0x00ff18b3,
+    0x00ff18b4, 0x00ff18b5, 0x00ff18b6, 0x00f7175f, 0x00ff18b8, 0x00ff18b9,
+    0x00ff18ba, 0x00ff18bb, 0x00ff18bc, 0x00ff18bd, 0x00bf177e, 0x00008000,
+    0x00ff28c0, 0x00ff28c1, 0x00ff28c2, 0x00ff28c3, 0x00ff28c4, 0x00ff28c5,
+    0x00ff28c6, 0x00f72767, 0x00ff28c8, 0x00ff28c9, 0x00ff28ca, 0x00ff28cb,
+    0x00ff28cc, 0x00ff28cd, 0x00ff28ce, 0x00008000, 0x00ff28d0, 0x00ff28d1,
+    0x00ff28d2, 0x00ff28d3, 0x00ff28d4, 0x00ff28d5, 0x00ff28d6, 0x00f7276f,
+    0x00ff28d8, 0x00ff28d9, 0x00ff28da, 0x00ff28db, 0x00ff28dc, 0x00ff28dd,
+    0x00ff28de, 0x00008000, 0x00ff38e0, 0x00ff38e1, 0x00ff38e2, 0x00ff38e3,
+    0x00ff38e4, 0x00ff38e5, 0x00ff38e6, 0x00f73777, 0x00ff38e8, 0x00ff38e9,
+    0x00ff38ea, 0x00ff38eb, 0x00ff38ec, 0x00ff38ed, 0x00ff38ee, 0x00008000,
+    0x00ff48f0, 0x00ff48f1, 0x00ff48f2, 0x00ff48f3, 0x00ff48f4, 0x00ff48f5,
+    0x00ff48f6, 0x00f7477f, 0x00ff58f8, 0x00ff58f9, 0x00ff58fa, 0x00ff58fb,
+    0x00008000, 0x00008000, 0x00008000, 0x00008000
+  },
+  { /* 3 ones */
+    0x00ff0800, 0x00ff0801, 0x00ff0802, 0x00fb0703, 0x00ff0804, 0x00ff0805,
+    0x00ff0806, 0x00008000, 0x00ff0808, 0x00ff0809, 0x00ff080a, 0x00fb0707,
+    0x00ff080c, 0x00ff080d, 0x00ff080e, 0x00008000, 0x00ff0810, 0x00ff0811,
+    0x00ff0812, 0x00fb070b, 0x00ff0814, 0x00ff0815, 0x00ff0816, 0x00008000,
+    0x00ff0818, 0x00ff0819, 0x00ff081a, 0x00fb070f, 0x00ff081c, 0x00ff081d,
+    0x00ff081e, 0x00008000, 0x00ff0820, 0x00ff0821, 0x00ff0822, 0x00fb0713,
+    0x00ff0824, 0x00ff0825, 0x00ff0826, 0x00008000, 0x00ff0828, 0x00ff0829,
+    0x00ff082a, 0x00fb0717, 0x00ff082c, 0x00ff082d, 0x00ff082e, 0x00008000,
+    0x00ff0830, 0x00ff0831, 0x00ff0832, 0x00fb071b, 0x00ff0834, 0x00ff0835,
+    0x00ff0836, 0x00008000, 0x00ff0838, 0x00ff0839, 0x00ff083a, 0x00fb071f,
+    0x00ff083c, 0x00ff083d, 0x00bf073e, 0x00008000, 0x00ff0840, 0x00ff0841,
+    0x00ff0842, 0x00fb0723, 0x00ff0844, 0x00ff0845, 0x00ff0846, 0x00008000,
+    0x00ff0848, 0x00ff0849, 0x00ff084a, 0x00fb0727, 0x00ff084c, 0x00ff084d,
+    0x00ff084e, 0x00008000, 0x00ff0850, 0x00ff0851, 0x00ff0852, 0x00fb072b,
+    0x00ff0854, 0x00ff0855, 0x00ff0856, 0x00008000, 0x00ff0858, 0x00ff0859,
+    0x00ff085a, 0x00fb072f, 0x00ff085c, 0x00ff085d, 0x00ff085e, 0x00008000,
+    0x00ff0860, 0x00ff0861, 0x00ff0862, 0x00fb0733, 0x00ff0864, 0x00ff0865,
+    0x00ff0866, 0x00008000, 0x00ff0868, 0x00ff0869, 0x00ff086a, 0x00fb0737,
+    0x00ff086c, 0x00ff086d, 0x00ff086e, 0x00008000, 0x00ff0870, 0x00ff0871,
+    0x00ff0872, 0x00fb073b, 0x00ff0874, 0x00ff0875, 0x00ff0876, 0x00008000,
+    0x00ff0878, 0x00ff0879, 0x00ff087a, 0x00fb073f, 0x007f077c, 0x007f077d,
+    0x00008000, 0x00008000, 0x00ff1880, 0x00ff1881, 0x00ff1882, 0x00fb1743,
+    0x00ff1884, 0x00ff1885, 0x00ff1886, 0x00008000, 0x00ff1888, 0x00ff1889,
+    0x00ff188a, 0x00fb1747, 0x00ff188c, 0x00ff188d, 0x00ff188e, 0x00008000,
+    0x00ff1890, 0x00ff1891, 0x00ff1892, 0x00fb174b, 0x00ff1894, 0x00ff1895,
+    0x00ff1896, 0x00008000, 0x00ff1898, 0x00ff1899, 0x00ff189a, 0x00fb174f,
+    0x00ff189c, 0x00ff189d, 0x00ff189e, 0x00008000, 0x00ff18a0, 0x00ff18a1,
+    0x00ff18a2, 0x00fb1753, 0x00ff18a4, 0x00ff18a5, 0x00ff18a6, 0x00008000,
+    0x00ff18a8, 0x00ff18a9, 0x00ff18aa, 0x00fb1757, 0x00ff18ac, 0x00ff18ad,
+    0x00ff18ae, 0x00008000, 0x00ff18b0, 0x00ff18b1, 0x00ff18b2, 0x00fb175b,
+    0x00ff18b4, 0x00ff18b5, 0x00ff18b6, 0x00008000, 0x00ff18b8, 0x00ff18b9,
+    0x00ff18ba, 0x00fb175f, 0x00ff18bc, 0x00ff18bd, 0x00bf177e, 0x00008000,
+    0x00ff28c0, 0x00ff28c1, 0x00ff28c2, 0x00fb2763, 0x00ff28c4, 0x00ff28c5,
+    0x00ff28c6, 0x00008000, 0x00ff28c8, 0x00ff28c9, 0x00ff28ca, 0x00fb2767,
+    0x00ff28cc, 0x00ff28cd, 0x00ff28ce, 0x00008000, 0x00ff28d0, 0x00ff28d1,
+    0x00ff28d2, 0x00fb276b, 0x00ff28d4, 0x00ff28d5, 0x00ff28d6, 0x00008000,
+    0x00ff28d8, 0x00ff28d9, 0x00ff28da, 0x00fb276f, 0x00ff28dc, 0x00ff28dd,
+    0x00ff28de, 0x00008000, 0x00ff38e0, 0x00ff38e1, 0x00ff38e2, 0x00fb3773,
+    0x00ff38e4, 0x00ff38e5, 0x00ff38e6, 0x00008000, 0x00ff38e8, 0x00ff38e9,
+    0x00ff38ea, 0x00fb3777, 0x00ff38ec, 0x00ff38ed, 0x00ff38ee, 0x00008000,
+    0x00ff48f0, 0x00ff48f1, 0x00ff48f2, 0x00fb477b, 0x00ff48f4, 0x00ff48f5,
+    0x00ff48f6, 0x00008000, 0x00ff58f8, 0x00ff58f9, 0x00ff58fa, 0x00fb577f,
+    0x00008000, 0x00008000, 0x00008000, 0x00008000
+  },
+  { /* 4 ones */
+    0x00ff0800, 0x00fd0701, 0x00ff0802, 0x00008000, 0x00ff0804, 0x00fd0703,
+    0x00ff0806, 0x00008000, 0x00ff0808, 0x00fd0705, 0x00ff080a, 0x00008000,
+    0x00ff080c, 0x00fd0707, 0x00ff080e, 0x00008000, 0x00ff0810, 0x00fd0709,
+    0x00ff0812, 0x00008000, 0x00ff0814, 0x00fd070b, 0x00ff0816, 0x00008000,
+    0x00ff0818, 0x00fd070d, 0x00ff081a, 0x00008000, 0x00ff081c, 0x00fd070f,
+    0x00ff081e, 0x00008000, 0x00ff0820, 0x00fd0711, 0x00ff0822, 0x00008000,
+    0x00ff0824, 0x00fd0713, 0x00ff0826, 0x00008000, 0x00ff0828, 0x00fd0715,
+    0x00ff082a, 0x00008000, 0x00ff082c, 0x00fd0717, 0x00ff082e, 0x00008000,
+    0x00ff0830, 0x00fd0719, 0x00ff0832, 0x00008000, 0x00ff0834, 0x00fd071b,
+    0x00ff0836, 0x00008000, 0x00ff0838, 0x00fd071d, 0x00ff083a, 0x00008000,
+    0x00ff083c, 0x00fd071f, 0x00bf073e, 0x00008000, 0x00ff0840, 0x00fd0721,
+    0x00ff0842, 0x00008000, 0x00ff0844, 0x00fd0723, 0x00ff0846, 0x00008000,
+    0x00ff0848, 0x00fd0725, 0x00ff084a, 0x00008000, 0x00ff084c, 0x00fd0727,
+    0x00ff084e, 0x00008000, 0x00ff0850, 0x00fd0729, 0x00ff0852, 0x00008000,
+    0x00ff0854, 0x00fd072b, 0x00ff0856, 0x00008000, 0x00ff0858, 0x00fd072d,
+    0x00ff085a, 0x00008000, 0x00ff085c, 0x00fd072f, 0x00ff085e, 0x00008000,
+    0x00ff0860, 0x00fd0731, 0x00ff0862, 0x00008000, 0x00ff0864, 0x00fd0733,
+    0x00ff0866, 0x00008000, 0x00ff0868, 0x00fd0735, 0x00ff086a, 0x00008000,
+    0x00ff086c, 0x00fd0737, 0x00ff086e, 0x00008000, 0x00ff0870, 0x00fd0739,
+    0x00ff0872, 0x00008000, 0x00ff0874, 0x00fd073b, 0x00ff0876, 0x00008000,
+    0x00ff0878, 0x00fd073d, 0x00ff087a, 0x00008000, 0x007f077c, 0x007d063f,
+    0x00008000, 0x00008000, 0x00ff1880, 0x00fd1741, 0x00ff1882, 0x00008000,
+    0x00ff1884, 0x00fd1743, 0x00ff1886, 0x00008000, 0x00ff1888, 0x00fd1745,
+    0x00ff188a, 0x00008000, 0x00ff188c, 0x00fd1747, 0x00ff188e, 0x00008000,
+    0x00ff1890, 0x00fd1749, 0x00ff1892, 0x00008000, 0x00ff1894, 0x00fd174b,
+    0x00ff1896, 0x00008000, 0x00ff1898, 0x00fd174d, 0x00ff189a, 0x00008000,
+    0x00ff189c, 0x00fd174f, 0x00ff189e, 0x00008000, 0x00ff18a0, 0x00fd1751,
+    0x00ff18a2, 0x00008000, 0x00ff18a4, 0x00fd1753, 0x00ff18a6, 0x00008000,
+    0x00ff18a8, 0x00fd1755, 0x00ff18aa, 0x00008000, 0x00ff18ac, 0x00fd1757,
+    0x00ff18ae, 0x00008000, 0x00ff18b0, 0x00fd1759, 0x00ff18b2, 0x00008000,
+    0x00ff18b4, 0x00fd175b, 0x00ff18b6, 0x00008000, 0x00ff18b8, 0x00fd175d,
+    0x00ff18ba, 0x00008000, 0x00ff18bc, 0x00fd175f, 0x00bf177e, 0x00008000,
+    0x00ff28c0, 0x00fd2761, 0x00ff28c2, 0x00008000, 0x00ff28c4, 0x00fd2763,
+    0x00ff28c6, 0x00008000, 0x00ff28c8, 0x00fd2765, 0x00ff28ca, 0x00008000,
+    0x00ff28cc, 0x00fd2767, 0x00ff28ce, 0x00008000, 0x00ff28d0, 0x00fd2769,
+    0x00ff28d2, 0x00008000, 0x00ff28d4, 0x00fd276b, 0x00ff28d6, 0x00008000,
+    0x00ff28d8, 0x00fd276d, 0x00ff28da, 0x00008000, 0x00ff28dc, 0x00fd276f,
+    0x00ff28de, 0x00008000, 0x00ff38e0, 0x00fd3771, 0x00ff38e2, 0x00008000,
+    0x00ff38e4, 0x00fd3773, 0x00ff38e6, 0x00008000, 0x00ff38e8, 0x00fd3775,
+    0x00ff38ea, 0x00008000, 0x00ff38ec, 0x00fd3777, 0x00ff38ee, 0x00008000,
+    0x00ff48f0, 0x00fd4779, 0x00ff48f2, 0x00008000, 0x00ff48f4, 0x00fd477b,
+    0x00ff48f6, 0x00008000, 0x00ff58f8, 0x00fd577d, 0x00ff58fa, 0x00008000,
+    0x00008000, 0x00008000, 0x00008000, 0x00008000
+  },
+  { /* 5 ones */
+    0x00fe0700, 0x00008000, 0x00fe0701, 0x00008000, 0x00fe0702, 0x00008000,
+    0x00fe0703, 0x00008000, 0x00fe0704, 0x00008000, 0x00fe0705, 0x00008000,
+    0x00fe0706, 0x00008000, 0x00fe0707, 0x00008000, 0x00fe0708, 0x00008000,
+    0x00fe0709, 0x00008000, 0x00fe070a, 0x00008000, 0x00fe070b, 0x00008000,
+    0x00fe070c, 0x00008000, 0x00fe070d, 0x00008000, 0x00fe070e, 0x00008000,
+    0x00fe070f, 0x00008000, 0x00fe0710, 0x00008000, 0x00fe0711, 0x00008000,
+    0x00fe0712, 0x00008000, 0x00fe0713, 0x00008000, 0x00fe0714, 0x00008000,
+    0x00fe0715, 0x00008000, 0x00fe0716, 0x00008000, 0x00fe0717, 0x00008000,
+    0x00fe0718, 0x00008000, 0x00fe0719, 0x00008000, 0x00fe071a, 0x00008000,
+    0x00fe071b, 0x00008000, 0x00fe071c, 0x00008000, 0x00fe071d, 0x00008000,
+    0x00fe071e, 0x00008000, 0x00be061f, 0x00008000, 0x00fe0720, 0x00008000,
+    0x00fe0721, 0x00008000, 0x00fe0722, 0x00008000, 0x00fe0723, 0x00008000,
+    0x00fe0724, 0x00008000, 0x00fe0725, 0x00008000, 0x00fe0726, 0x00008000,
+    0x00fe0727, 0x00008000, 0x00fe0728, 0x00008000, 0x00fe0729, 0x00008000,
+    0x00fe072a, 0x00008000, 0x00fe072b, 0x00008000, 0x00fe072c, 0x00008000,
+    0x00fe072d, 0x00008000, 0x00fe072e, 0x00008000, 0x00fe072f, 0x00008000,
+    0x00fe0730, 0x00008000, 0x00fe0731, 0x00008000, 0x00fe0732, 0x00008000,
+    0x00fe0733, 0x00008000, 0x00fe0734, 0x00008000, 0x00fe0735, 0x00008000,
+    0x00fe0736, 0x00008000, 0x00fe0737, 0x00008000, 0x00fe0738, 0x00008000,
+    0x00fe0739, 0x00008000, 0x00fe073a, 0x00008000, 0x00fe073b, 0x00008000,
+    0x00fe073c, 0x00008000, 0x00fe073d, 0x00008000, 0x007e063e, 0x00008000,
+    0x00008000, 0x00008000, 0x00fe1740, 0x00008000, 0x00fe1741, 0x00008000,
+    0x00fe1742, 0x00008000, 0x00fe1743, 0x00008000, 0x00fe1744, 0x00008000,
+    0x00fe1745, 0x00008000, 0x00fe1746, 0x00008000, 0x00fe1747, 0x00008000,
+    0x00fe1748, 0x00008000, 0x00fe1749, 0x00008000, 0x00fe174a, 0x00008000,
+    0x00fe174b, 0x00008000, 0x00fe174c, 0x00008000, 0x00fe174d, 0x00008000,
+    0x00fe174e, 0x00008000, 0x00fe174f, 0x00008000, 0x00fe1750, 0x00008000,
+    0x00fe1751, 0x00008000, 0x00fe1752, 0x00008000, 0x00fe1753, 0x00008000,
+    0x00fe1754, 0x00008000, 0x00fe1755, 0x00008000, 0x00fe1756, 0x00008000,
+    0x00fe1757, 0x00008000, 0x00fe1758, 0x00008000, 0x00fe1759, 0x00008000,
+    0x00fe175a, 0x00008000, 0x00fe175b, 0x00008000, 0x00fe175c, 0x00008000,
+    0x00fe175d, 0x00008000, 0x00fe175e, 0x00008000, 0x00be163f, 0x00008000,
+    0x00fe2760, 0x00008000, 0x00fe2761, 0x00008000, 0x00fe2762, 0x00008000,
+    0x00fe2763, 0x00008000, 0x00fe2764, 0x00008000, 0x00fe2765, 0x00008000,
+    0x00fe2766, 0x00008000, 0x00fe2767, 0x00008000, 0x00fe2768, 0x00008000,
+    0x00fe2769, 0x00008000, 0x00fe276a, 0x00008000, 0x00fe276b, 0x00008000,
+    0x00fe276c, 0x00008000, 0x00fe276d, 0x00008000, 0x00fe276e, 0x00008000,
+    0x00fe276f, 0x00008000, 0x00fe3770, 0x00008000, 0x00fe3771, 0x00008000,
+    0x00fe3772, 0x00008000, 0x00fe3773, 0x00008000, 0x00fe3774, 0x00008000,
+    0x00fe3775, 0x00008000, 0x00fe3776, 0x00008000, 0x00fe3777, 0x00008000,
+    0x00fe4778, 0x00008000, 0x00fe4779, 0x00008000, 0x00fe477a, 0x00008000,
+    0x00fe477b, 0x00008000, 0x00fe577c, 0x00008000, 0x00fe577d, 0x00008000,
+    0x00008000, 0x00008000, 0x00008000, 0x00008000
+  }
+};
+
+#endif
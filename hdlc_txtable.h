@@ -0,0 +1,245 @@
+/*
+ * Bit stuffing and NRZI tables for the HDLC encoder. 
+ * Generated by tools/mk_hdlc_txtable.py. Do not edit. 
+ */
+
+#if !defined __HDLC_TXTABLE_H__
+#define __HDLC_TXTABLE_H__
+
+#define HDLC_ST_BITS(e)     ((e) & 0x03ff)
+#define HDLC_ST_NBITS(e)    (8 + (((e) >> 10) & 0x03))
+#define HDLC_ST_ONES(e)     (((e) >> 12) & 0x07)
+
+static const uint16_t hdlc_stab[6][256] = {
+  { /* 0 ones */
+    0x0000, 0x0001, 0x0002, 0x0003, 0x0004, 0x0005, 0x0006, 0x0007,
+    0x0008, 0x0009, 0x000a, 0x000b, 0x000c, 0x000d, 0x000e, 0x000f,
+    0x0010, 0x0011, 0x0012, 0x0013, 0x0014, 0x0015, 0x0016, 0x0017,
+    0x0018, 0x0019, 0x001a, 0x001b, 0x001c, 0x001d, 0x001e, 0x041f,
+    0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027,
+    0x0028, 0x0029, 0x002a, 0x002b, 0x002c, 0x002d, 0x002e, 0x002f,
+    0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+    0x0038, 0x0039, 0x003a, 0x003b, 0x003c, 0x003d, 0x043e, 0x045f,
+    0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+    0x0048, 0x0049, 0x004a, 0x004b, 0x004c, 0x004d, 0x004e, 0x004f,
+    0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+    0x0058, 0x0059, 0x005a, 0x005b, 0x005c, 0x005d, 0x005e, 0x049f,
+    0x0060, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+    0x0068, 0x0069, 0x006a, 0x006b, 0x006c, 0x006d, 0x006e, 0x006f,
+    0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+    0x0078, 0x0079, 0x007a, 0x007b, 0x047c, 0x047d, 0x04be, 0x04df,
+    0x1080, 0x1081, 0x1082, 0x1083, 0x1084, 0x1085, 0x1086, 0x1087,
+    0x1088, 0x1089, 0x108a, 0x108b, 0x108c, 0x108d, 0x108e, 0x108f,
+    0x1090, 0x1091, 0x1092, 0x1093, 0x1094, 0x1095, 0x1096, 0x1097,
+    0x1098, 0x1099, 0x109a, 0x109b, 0x109c, 0x109d, 0x109e, 0x151f,
+    0x10a0, 0x10a1, 0x10a2, 0x10a3, 0x10a4, 0x10a5, 0x10a6, 0x10a7,
+    0x10a8, 0x10a9, 0x10aa, 0x10ab, 0x10ac, 0x10ad, 0x10ae, 0x10af,
+    0x10b0, 0x10b1, 0x10b2, 0x10b3, 0x10b4, 0x10b5, 0x10b6, 0x10b7,
+    0x10b8, 0x10b9, 0x10ba, 0x10bb, 0x10bc, 0x10bd, 0x153e, 0x155f,
+    0x20c0, 0x20c1, 0x20c2, 0x20c3, 0x20c4, 0x20c5, 0x20c6, 0x20c7,
+    0x20c8, 0x20c9, 0x20ca, 0x20cb, 0x20cc, 0x20cd, 0x20ce, 0x20cf,
+    0x20d0, 0x20d1, 0x20d2, 0x20d3, 0x20d4, 0x20d5, 0x20d6, 0x20d7,
+    0x20d8, 0x20d9, 0x20da, 0x20db, 0x20dc, 0x20dd, 0x20de, 0x259f,
+    0x30e0, 0x30e1, 0x30e2, 0x30e3, 0x30e4, 0x30e5, 0x30e6, 0x30e7,
+    0x30e8, 0x30e9, 0x30ea, 0x30eb, 0x30ec, 0x30ed, 0x30ee, 0x30ef,
+    0x40f0, 0x40f1, 0x40f2, 0x40f3, 0x40f4, 0x40f5, 0x40f6, 0x40f7,
+    0x50f8, 0x50f9, 0x50fa, 0x50fb, 0x157c, 0x157d, 0x25be, 0x35df
+  },
+  { /* 1 ones */
+    0x0000, 0x0001, 0x0002, 0x0003, 0x0004, 0x0005, 0x0006, 0x0007,
+    0x0008, 0x0009, 0x000a, 0x000b, 0x000c, 0x000d, 0x000e, 0x040f,
+    0x0010, 0x0011, 0x0012, 0x0013, 0x0014, 0x0015, 0x0016, 0x0017,
+    0x0018, 0x0019, 0x001a, 0x001b, 0x001c, 0x001d, 0x001e, 0x042f,
+    0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027,
+    0x0028, 0x0029, 0x002a, 0x002b, 0x002c, 0x002d, 0x002e, 0x044f,
+    0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+    0x0038, 0x0039, 0x003a, 0x003b, 0x003c, 0x003d, 0x043e, 0x046f,
+    0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+    0x0048, 0x0049, 0x004a, 0x004b, 0x004c, 0x004d, 0x004e, 0x048f,
+    0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+    0x0058, 0x0059, 0x005a, 0x005b, 0x005c, 0x005d, 0x005e, 0x04af,
+    0x0060, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+    0x0068, 0x0069, 0x006a, 0x006b, 0x006c, 0x006d, 0x006e, 0x04cf,
+    0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+    0x0078, 0x0079, 0x007a, 0x007b, 0x047c, 0x047d, 0x04be, 0x04ef,
+    0x1080, 0x1081, 0x1082, 0x1083, 0x1084, 0x1085, 0x1086, 0x1087,
+    0x1088, 0x1089, 0x108a, 0x108b, 0x108c, 0x108d, 0x108e, 0x150f,
+    0x1090, 0x1091, 0x1092, 0x1093, 0x1094, 0x1095, 0x1096, 0x1097,
+    0x1098, 0x1099, 0x109a, 0x109b, 0x109c, 0x109d, 0x109e, 0x152f,
+    0x10a0, 0x10a1, 0x10a2, 0x10a3, 0x10a4, 0x10a5, 0x10a6, 0x10a7,
+    0x10a8, 0x10a9, 0x10aa, 0x10ab, 0x10ac, 0x10ad, 0x10ae, 0x154f,
+    0x10b0, 0x10b1, 0x10b2, 0x10b3, 0x10b4, 0x10b5, 0x10b6, 0x10b7,
+    0x10b8, 0x10b9, 0x10ba, 0x10bb, 0x10bc, 0x10bd, 0x153e, 0x156f,
+    0x20c0, 0x20c1, 0x20c2, 0x20c3, 0x20c4, 0x20c5, 0x20c6, 0x20c7,
+    0x20c8, 0x20c9, 0x20ca, 0x20cb, 0x20cc, 0x20cd, 0x20ce, 0x258f,
+    0x20d0, 0x20d1, 0x20d2, 0x20d3, 0x20d4, 0x20d5, 0x20d6, 0x20d7,
+    0x20d8, 0x20d9, 0x20da, 0x20db, 0x20dc, 0x20dd, 0x20de, 0x25af,
+    0x30e0, 0x30e1, 0x30e2, 0x30e3, 0x30e4, 0x30e5, 0x30e6, 0x30e7,
+    0x30e8, 0x30e9, 0x30ea, 0x30eb, 0x30ec, 0x30ed, 0x30ee, 0x35cf,
+    0x40f0, 0x40f1, 0x40f2, 0x40f3, 0x40f4, 0x40f5, 0x40f6, 0x40f7,
+    0x50f8, 0x50f9, 0x50fa, 0x50fb, 0x157c, 0x157d, 0x25be, 0x45ef
+  },
+  { /* 2 ones */
+    0x0000, 0x0001, 0x0002, 0x0003, 0x0004, 0x0005, 0x0006, 0x0407,
+    0x0008, 0x0009, 0x000a, 0x000b, 0x000c, 0x000d, 0x000e, 0x0417,
+    0x0010, 0x0011, 0x0012, 0x0013, 0x0014, 0x0015, 0x0016, 0x0427,
+    0x0018, 0x0019, 0x001a, 0x001b, 0x001c, 0x001d, 0x001e, 0x0437,
+    0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0447,
+    0x0028, 0x0029, 0x002a, 0x002b, 0x002c, 0x002d, 0x002e, 0x0457,
+    0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0467,
+    0x0038, 0x0039, 0x003a, 0x003b, 0x003c, 0x003d, 0x043e, 0x0477,
+    0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0487,
+    0x0048, 0x0049, 0x004a, 0x004b, 0x004c, 0x004d, 0x004e, 0x0497,
+    0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x04a7,
+    0x0058, 0x0059, 0x005a, 0x005b, 0x005c, 0x005d, 0x005e, 0x04b7,
+    0x0060, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x04c7,
+    0x0068, 0x0069, 0x006a, 0x006b, 0x006c, 0x006d, 0x006e, 0x04d7,
+    0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x04e7,
+    0x0078, 0x0079, 0x007a, 0x007b, 0x047c, 0x047d, 0x04be, 0x04f7,
+    0x1080, 0x1081, 0x1082, 0x1083, 0x1084, 0x1085, 0x1086, 0x1507,
+    0x1088, 0x1089, 0x108a, 0x108b, 0x108c, 0x108d, 0x108e, 0x1517,
+    0x1090, 0x1091, 0x1092, 0x1093, 0x1094, 0x1095, 0x1096, 0x1527,
+    0x1098, 0x1099, 0x109a, 0x109b, 0x109c, 0x109d, 0x109e, 0x1537,
+    0x10a0, 0x10a1, 0x10a2, 0x10a3, 0x10a4, 0x10a5, 0x10a6, 0x1547,
+    0x10a8, 0x10a9, 0x10aa, 0x10ab, 0x10ac, 0x10ad, 0x10ae, 0x1557,
+    0x10b0, 0x10b1, 0x10b2, 0x10b3, 0x10b4, 0x10b5, 0x10b6, 0x1567,
+    0x10b8, 0x10b9, 0x10ba, 0x10bb, 0x10bc, 0x10bd, 0x153e, 0x1577,
+    0x20c0, 0x20c1, 0x20c2, 0x20c3, 0x20c4, 0x20c5, 0x20c6, 0x2587,
+    0x20c8, 0x20c9, 0x20ca, 0x20cb, 0x20cc, 0x20cd, 0x20ce, 0x2597,
+    0x20d0, 0x20d1, 0x20d2, 0x20d3, 0x20d4, 0x20d5, 0x20d6, 0x25a7,
+    0x20d8, 0x20d9, 0x20da, 0x20db, 0x20dc, 0x20dd, 0x20de, 0x25b7,
+    0x30e0, 0x30e1, 0x30e2, 0x30e3, 0x30e4, 0x30e5, 0x30e6, 0x35c7,
+    0x30e8, 0x30e9, 0x30ea, 0x30eb, 0x30ec, 0x30ed, 0x30ee, 0x35d7,
+    0x40f0, 0x40f1, 0x40f2, 0x40f3, 0x40f4, 0x40f5, 0x40f6, 0x45e7,
+    0x50f8, 0x50f9, 0x50fa, 0x50fb, 0x157c, 0x157d, 0x25be, 0x55f7
+  },
+  { /* 3 ones */
+    0x0000, 0x0001, 0x0002, 0x0403, 0x0004, 0x0005, 0x0006, 0x040b,
+    0x0008, 0x0009, 0x000a, 0x0413, 0x000c, 0x000d, 0x000e, 0x041b,
+    0x0010, 0x0011, 0x0012, 0x0423, 0x0014, 0x0015, 0x0016, 0x042b,
+    0x0018, 0x0019, 0x001a, 0x0433, 0x001c, 0x001d, 0x001e, 0x043b,
+    0x0020, 0x0021, 0x0022, 0x0443, 0x0024, 0x0025, 0x0026, 0x044b,
+    0x0028, 0x0029, 0x002a, 0x0453, 0x002c, 0x002d, 0x002e, 0x045b,
+    0x0030, 0x0031, 0x0032, 0x0463, 0x0034, 0x0035, 0x0036, 0x046b,
+    0x0038, 0x0039, 0x003a, 0x0473, 0x003c, 0x003d, 0x043e, 0x047b,
+    0x0040, 0x0041, 0x0042, 0x0483, 0x0044, 0x0045, 0x0046, 0x048b,
+    0x0048, 0x0049, 0x004a, 0x0493, 0x004c, 0x004d, 0x004e, 0x049b,
+    0x0050, 0x0051, 0x0052, 0x04a3, 0x0054, 0x0055, 0x0056, 0x04ab,
+    0x0058, 0x0059, 0x005a, 0x04b3, 0x005c, 0x005d, 0x005e, 0x04bb,
+    0x0060, 0x0061, 0x0062, 0x04c3, 0x0064, 0x0065, 0x0066, 0x04cb,
+    0x0068, 0x0069, 0x006a, 0x04d3, 0x006c, 0x006d, 0x006e, 0x04db,
+    0x0070, 0x0071, 0x0072, 0x04e3, 0x0074, 0x0075, 0x0076, 0x04eb,
+    0x0078, 0x0079, 0x007a, 0x04f3, 0x047c, 0x047d, 0x04be, 0x08fb,
+    0x1080, 0x1081, 0x1082, 0x1503, 0x1084, 0x1085, 0x1086, 0x150b,
+    0x1088, 0x1089, 0x108a, 0x1513, 0x108c, 0x108d, 0x108e, 0x151b,
+    0x1090, 0x1091, 0x1092, 0x1523, 0x1094, 0x1095, 0x1096, 0x152b,
+    0x1098, 0x1099, 0x109a, 0x1533, 0x109c, 0x109d, 0x109e, 0x153b,
+    0x10a0, 0x10a1, 0x10a2, 0x1543, 0x10a4, 0x10a5, 0x10a6, 0x154b,
+    0x10a8, 0x10a9, 0x10aa, 0x1553, 0x10ac, 0x10ad, 0x10ae, 0x155b,
+    0x10b0, 0x10b1, 0x10b2, 0x1563, 0x10b4, 0x10b5, 0x10b6, 0x156b,
+    0x10b8, 0x10b9, 0x10ba, 0x1573, 0x10bc, 0x10bd, 0x153e, 0x157b,
+    0x20c0, 0x20c1, 0x20c2, 0x2583, 0x20c4, 0x20c5, 0x20c6, 0x258b,
+    0x20c8, 0x20c9, 0x20ca, 0x2593, 0x20cc, 0x20cd, 0x20ce, 0x259b,
+    0x20d0, 0x20d1, 0x20d2, 0x25a3, 0x20d4, 0x20d5, 0x20d6, 0x25ab,
+    0x20d8, 0x20d9, 0x20da, 0x25b3, 0x20dc, 0x20dd, 0x20de, 0x25bb,
+    0x30e0, 0x30e1, 0x30e2, 0x35c3, 0x30e4, 0x30e5, 0x30e6, 0x35cb,
+    0x30e8, 0x30e9, 0x30ea, 0x35d3, 0x30ec, 0x30ed, 0x30ee, 0x35db,
+    0x40f0, 0x40f1, 0x40f2, 0x45e3, 0x40f4, 0x40f5, 0x40f6, 0x45eb,
+    0x50f8, 0x50f9, 0x50fa, 0x55f3, 0x157c, 0x157d, 0x25be, 0x1afb
+  },
+  { /* 4 ones */
+    0x0000, 0x0401, 0x0002, 0x0405, 0x0004, 0x0409, 0x0006, 0x040d,
+    0x0008, 0x0411, 0x000a, 0x0415, 0x000c, 0x0419, 0x000e, 0x041d,
+    0x0010, 0x0421, 0x0012, 0x0425, 0x0014, 0x0429, 0x0016, 0x042d,
+    0x0018, 0x0431, 0x001a, 0x0435, 0x001c, 0x0439, 0x001e, 0x043d,
+    0x0020, 0x0441, 0x0022, 0x0445, 0x0024, 0x0449, 0x0026, 0x044d,
+    0x0028, 0x0451, 0x002a, 0x0455, 0x002c, 0x0459, 0x002e, 0x045d,
+    0x0030, 0x0461, 0x0032, 0x0465, 0x0034, 0x0469, 0x0036, 0x046d,
+    0x0038, 0x0471, 0x003a, 0x0475, 0x003c, 0x0479, 0x043e, 0x087d,
+    0x0040, 0x0481, 0x0042, 0x0485, 0x0044, 0x0489, 0x0046, 0x048d,
+    0x0048, 0x0491, 0x004a, 0x0495, 0x004c, 0x0499, 0x004e, 0x049d,
+    0x0050, 0x04a1, 0x0052, 0x04a5, 0x0054, 0x04a9, 0x0056, 0x04ad,
+    0x0058, 0x04b1, 0x005a, 0x04b5, 0x005c, 0x04b9, 0x005e, 0x04bd,
+    0x0060, 0x04c1, 0x0062, 0x04c5, 0x0064, 0x04c9, 0x0066, 0x04cd,
+    0x0068, 0x04d1, 0x006a, 0x04d5, 0x006c, 0x04d9, 0x006e, 0x04dd,
+    0x0070, 0x04e1, 0x0072, 0x04e5, 0x0074, 0x04e9, 0x0076, 0x04ed,
+    0x0078, 0x04f1, 0x007a, 0x04f5, 0x047c, 0x08f9, 0x04be, 0x097d,
+    0x1080, 0x1501, 0x1082, 0x1505, 0x1084, 0x1509, 0x1086, 0x150d,
+    0x1088, 0x1511, 0x108a, 0x1515, 0x108c, 0x1519, 0x108e, 0x151d,
+    0x1090, 0x1521, 0x1092, 0x1525, 0x1094, 0x1529, 0x1096, 0x152d,
+    0x1098, 0x1531, 0x109a, 0x1535, 0x109c, 0x1539, 0x109e, 0x153d,
+    0x10a0, 0x1541, 0x10a2, 0x1545, 0x10a4, 0x1549, 0x10a6, 0x154d,
+    0x10a8, 0x1551, 0x10aa, 0x1555, 0x10ac, 0x1559, 0x10ae, 0x155d,
+    0x10b0, 0x1561, 0x10b2, 0x1565, 0x10b4, 0x1569, 0x10b6, 0x156d,
+    0x10b8, 0x1571, 0x10ba, 0x1575, 0x10bc, 0x1579, 0x153e, 0x1a7d,
+    0x20c0, 0x2581, 0x20c2, 0x2585, 0x20c4, 0x2589, 0x20c6, 0x258d,
+    0x20c8, 0x2591, 0x20ca, 0x2595, 0x20cc, 0x2599, 0x20ce, 0x259d,
+    0x20d0, 0x25a1, 0x20d2, 0x25a5, 0x20d4, 0x25a9, 0x20d6, 0x25ad,
+    0x20d8, 0x25b1, 0x20da, 0x25b5, 0x20dc, 0x25b9, 0x20de, 0x25bd,
+    0x30e0, 0x35c1, 0x30e2, 0x35c5, 0x30e4, 0x35c9, 0x30e6, 0x35cd,
+    0x30e8, 0x35d1, 0x30ea, 0x35d5, 0x30ec, 0x35d9, 0x30ee, 0x35dd,
+    0x40f0, 0x45e1, 0x40f2, 0x45e5, 0x40f4, 0x45e9, 0x40f6, 0x45ed,
+    0x50f8, 0x55f1, 0x50fa, 0x55f5, 0x157c, 0x1af9, 0x25be, 0x2b7d
+  },
+  { /* 5 ones */
+    0x0400, 0x0402, 0x0404, 0x0406, 0x0408, 0x040a, 0x040c, 0x040e,
+    0x0410, 0x0412, 0x0414, 0x0416, 0x0418, 0x041a, 0x041c, 0x041e,
+    0x0420, 0x0422, 0x0424, 0x0426, 0x0428, 0x042a, 0x042c, 0x042e,
+    0x0430, 0x0432, 0x0434, 0x0436, 0x0438, 0x043a, 0x043c, 0x083e,
+    0x0440, 0x0442, 0x0444, 0x0446, 0x0448, 0x044a, 0x044c, 0x044e,
+    0x0450, 0x0452, 0x0454, 0x0456, 0x0458, 0x045a, 0x045c, 0x045e,
+    0x0460, 0x0462, 0x0464, 0x0466, 0x0468, 0x046a, 0x046c, 0x046e,
+    0x0470, 0x0472, 0x0474, 0x0476, 0x0478, 0x047a, 0x087c, 0x08be,
+    0x0480, 0x0482, 0x0484, 0x0486, 0x0488, 0x048a, 0x048c, 0x048e,
+    0x0490, 0x0492, 0x0494, 0x0496, 0x0498, 0x049a, 0x049c, 0x049e,
+    0x04a0, 0x04a2, 0x04a4, 0x04a6, 0x04a8, 0x04aa, 0x04ac, 0x04ae,
+    0x04b0, 0x04b2, 0x04b4, 0x04b6, 0x04b8, 0x04ba, 0x04bc, 0x093e,
+    0x04c0, 0x04c2, 0x04c4, 0x04c6, 0x04c8, 0x04ca, 0x04cc, 0x04ce,
+    0x04d0, 0x04d2, 0x04d4, 0x04d6, 0x04d8, 0x04da, 0x04dc, 0x04de,
+    0x04e0, 0x04e2, 0x04e4, 0x04e6, 0x04e8, 0x04ea, 0x04ec, 0x04ee,
+    0x04f0, 0x04f2, 0x04f4, 0x04f6, 0x08f8, 0x08fa, 0x097c, 0x09be,
+    0x1500, 0x1502, 0x1504, 0x1506, 0x1508, 0x150a, 0x150c, 0x150e,
+    0x1510, 0x1512, 0x1514, 0x1516, 0x1518, 0x151a, 0x151c, 0x151e,
+    0x1520, 0x1522, 0x1524, 0x1526, 0x1528, 0x152a, 0x152c, 0x152e,
+    0x1530, 0x1532, 0x1534, 0x1536, 0x1538, 0x153a, 0x153c, 0x1a3e,
+    0x1540, 0x1542, 0x1544, 0x1546, 0x1548, 0x154a, 0x154c, 0x154e,
+    0x1550, 0x1552, 0x1554, 0x1556, 0x1558, 0x155a, 0x155c, 0x155e,
+    0x1560, 0x1562, 0x1564, 0x1566, 0x1568, 0x156a, 0x156c, 0x156e,
+    0x1570, 0x1572, 0x1574, 0x1576, 0x1578, 0x157a, 0x1a7c, 0x1abe,
+    0x2580, 0x2582, 0x2584, 0x2586, 0x2588, 0x258a, 0x258c, 0x258e,
+    0x2590, 0x2592, 0x2594, 0x2596, 0x2598, 0x259a, 0x259c, 0x259e,
+    0x25a0, 0x25a2, 0x25a4, 0x25a6, 0x25a8, 0x25aa, 0x25ac, 0x25ae,
+    0x25b0, 0x25b2, 0x25b4, 0x25b6, 0x25b8, 0x25ba, 0x25bc, 0x2b3e,
+    0x35c0, 0x35c2, 0x35c4, 0x35c6, 0x35c8, 0x35ca, 0x35cc, 0x35ce,
+    0x35d0, 0x35d2, 0x35d4, 0x35d6, 0x35d8, 0x35da, 0x35dc, 0x35de,
+    0x45e0, 0x45e2, 0x45e4, 0x45e6, 0x45e8, 0x45ea, 0x45ec, 0x45ee,
+    0x55f0, 0x55f2, 0x55f4, 0x55f6, 0x1af8, 0x1afa, 0x2b7c, 0x3bbe
+  }
+};
+
+static const uint8_t hdlc_nrzi[256] = {
+  0x55, 0xaa, 0xab, 0x54, 0xa9, 0x56, 0x57, 0xa8, 0xad, 0x52, 0x53, 0xac,
+  0x51, 0xae, 0xaf, 0x50, 0xa5, 0x5a, 0x5b, 0xa4, 0x59, 0xa6, 0xa7, 0x58,
+  0x5d, 0xa2, 0xa3, 0x5c, 0xa1, 0x5e, 0x5f, 0xa0, 0xb5, 0x4a, 0x4b, 0xb4,
+  0x49, 0xb6, 0xb7, 0x48, 0x4d, 0xb2, 0xb3, 0x4c, 0xb1, 0x4e, 0x4f, 0xb0,
+  0x45, 0xba, 0xbb, 0x44, 0xb9, 0x46, 0x47, 0xb8, 0xbd, 0x42, 0x43, 0xbc,
+  0x41, 0xbe, 0xbf, 0x40, 0x95, 0x6a, 0x6b, 0x94, 0x69, 0x96, 0x97, 0x68,
+  0x6d, 0x92, 0x93, 0x6c, 0x91, 0x6e, 0x6f, 0x90, 0x65, 0x9a, 0x9b, 0x64,
+  0x99, 0x66, 0x67, 0x98, 0x9d, 0x62, 0x63, 0x9c, 0x61, 0x9e, 0x9f, 0x60,
+  0x75, 0x8a, 0x8b, 0x74, 0x89, 0x76, 0x77, 0x88, 0x8d, 0x72, 0x73, 0x8c,
+  0x71, 0x8e, 0x8f, 0x70, 0x85, 0x7a, 0x7b, 0x84, 0x79, 0x86, 0x87, 0x78,
+  0x7d, 0x82, 0x83, 0x7c, 0x81, 0x7e, 0x7f, 0x80, 0xd5, 0x2a, 0x2b, 0xd4,
+  0x29, 0xd6, 0xd7, 0x28, 0x2d, 0xd2, 0xd3, 0x2c, 0xd1, 0x2e, 0x2f, 0xd0,
+  0x25, 0xda, 0xdb, 0x24, 0xd9, 0x26, 0x27, 0xd8, 0xdd, 0x22, 0x23, 0xdc,
+  0x21, 0xde, 0xdf, 0x20, 0x35, 0xca, 0xcb, 0x34, 0xc9, 0x36, 0x37, 0xc8,
+  0xcd, 0x32, 0x33, 0xcc, 0x31, 0xce, 0xcf, 0x30, 0xc5, 0x3a, 0x3b, 0xc4,
+  0x39, 0xc6, 0xc7, 0x38, 0x3d, 0xc2, 0xc3, 0x3c, 0xc1, 0x3e, 0x3f, 0xc0,
+  0x15, 0xea, 0xeb, 0x14, 0xe9, 0x16, 0x17, 0xe8, 0xed, 0x12, 0x13, 0xec,
+  0x11, 0xee, 0xef, 0x10, 0xe5, 0x1a, 0x1b, 0xe4, 0x19, 0xe6, 0xe7, 0x18,
+  0x1d, 0xe2, 0xe3, 0x1c, 0xe1, 0x1e, 0x1f, 0xe0, 0xf5, 0x0a, 0x0b, 0xf4,
+  0x09, 0xf6, 0xf7, 0x08, 0x0d, 0xf2, 0xf3, 0x0c, 0xf1, 0x0e, 0x0f, 0xf0,
+  0x05, 0xfa, 0xfb, 0x04, 0xf9, 0x06, 0x07, 0xf8, 0xfd, 0x02, 0x03, 0xfc,
+  0x01, 0xfe, 0xff, 0x00
+};
+
+#endif
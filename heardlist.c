@@ -134,16 +134,13 @@
    uint16_t crc = 0xFFFF;
    uint8_t i = 0;
    while (from->callsign[i] != 0)
-     crc = _crc_ccitt_update(crc, from->callsign[i++]); 
-   crc = _crc_ccitt_update(crc, from->ssid);
+     crc = crc_ccitt_update(crc, from->callsign[i++]); 
+   crc = crc_ccitt_update(crc, from->ssid);
    i=0;
    while (to->callsign[i] != 0)
-     crc = _crc_ccitt_update(crc, to->callsign[i++]);
-   crc = _crc_ccitt_update(crc, to->ssid);
-   fbuf_rseek(f, AX25_HDR_LEN(ndigis)); 
-   for (i=AX25_HDR_LEN(ndigis); i<fbuf_length(f); i++)
-     crc = _crc_ccitt_update(crc, fbuf_getChar(f)); 
-   return crc;
+     crc = crc_ccitt_update(crc, to->callsign[i++]);
+   crc = crc_ccitt_update(crc, to->ssid);
+   return fbuf_crc(f, AX25_HDR_LEN(ndigis), crc);
  }
  
 
@@ -53,8 +53,8 @@ static uint32_t _tracker_icount = 0;
 
 
 static FBQ rxqueue;           /* Frames from radio or tracker */
+static hdlc_sub_t igate_sub;  /* Subscription to frames from radio */
 
-extern fbq_t* outframes;      /* Frames to be transmitted on radio */
 extern fbq_t* mon;            /* Do we need to monitor igate? */
 
 static char buf[128];
@@ -142,7 +142,7 @@ static THD_FUNCTION(igate_main, arg)
     
        /* Start child thread to listen for frames from radio or tracker */
        igt = THREAD_DSTART(igate_radio, STACK_IGATE_RADIO, NORMALPRIO, NULL);
-       hdlc_subscribe_rx(&rxqueue, 2);
+       hdlc_subscribe_rx(&igate_sub, "igate", &rxqueue, HDLC_DROP_NEWEST, 0);
        
        /* Listen for data from APRS/IS server */
        while (inet_is_connected() && _igate_on) {
@@ -158,7 +158,7 @@ static THD_FUNCTION(igate_main, arg)
        _igate_run = false; 
        fbq_signal(&rxqueue);
        sleep(10);
-       hdlc_subscribe_rx(NULL, 2);
+       hdlc_unsubscribe_rx(&igate_sub);
        
        if (igt!=NULL) 
           chThdWait(igt);
@@ -215,7 +215,7 @@ void igate_activate(bool m)
    
    if (tstart) {
       /* Subscribe to RX (and tracker) packets and start treads */
-      hdlc_subscribe_rx(mq, 2);
+      hdlc_subscribe_rx(&igate_sub, "igate", mq, HDLC_DROP_NEWEST, 0);
       tracker_setGate(mq);
       igtm = THREAD_DSTART(igate_main, STACK_IGATE, NORMALPRIO, NULL);  
       hlist_start();
@@ -236,7 +236,7 @@ void igate_activate(bool m)
       if (igtm!=NULL)
         chThdWait(igtm);
       igtm=NULL;
-      hdlc_subscribe_rx(NULL, 2);
+      hdlc_unsubscribe_rx(&igate_sub);
       tracker_setGate(NULL);
       _icount = _rcvd = _tracker_icount = 0;
    }
@@ -272,7 +272,7 @@ static void rf2inet(FBUF *frame)
   beeps("- ");
       
   /* Write header in plain text -> newHdr */
-  fbuf_new(&newHdr);
+  fbuf_new(&newHdr, FBUF_ACC_IGATE, 0);
   fbuf_putstr(&newHdr, addr2str(buf,&from)); 
   fbuf_putstr(&newHdr, ">");
   fbuf_putstr(&newHdr, addr2str(buf,&to));
@@ -291,7 +291,11 @@ static void rf2inet(FBUF *frame)
   /* Replace header in original packet with new header. 
    * Do this non-destructively: Just add rest of existing packet to new header 
    */
-  fbuf_connect(&newHdr, frame, AX25_HDR_LEN(ndigis) );
+  if (!fbuf_writable(&newHdr) || !fbuf_connect(&newHdr, frame, AX25_HDR_LEN(ndigis))) {
+     /* Out of buffer space */
+     fbuf_release(&newHdr);
+     return;
+  }
   
   /* Send to internet server */
   inet_writeFB(&newHdr);
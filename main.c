@@ -6,10 +6,12 @@
 #include <math.h>
 #include <stdio.h>
 #include "util/eeprom.h"
+#include "util/crc16.h"
 #include "radio.h"
 #include "gps.h"
 #include "fbuf.h"
 #include "hdlc.h"
+#include "csma.h"
 #include "afsk.h"
 #include "defines.h"
 #include "ui/lcd.h"
@@ -32,7 +34,7 @@ extern void mon_init(Stream*);
 
 extern SerialUSBDriver SDU1;
 
-fbq_t *outframes, *inframes;  
+fbq_t *inframes;  
 
 
 
@@ -89,6 +91,7 @@ int main(void)
    thread_t *shelltp = NULL;
    halInit();
    chSysInit();
+   fbuf_init();
    ext_init();
    spi_init();
    usb_initialize();
@@ -98,10 +101,13 @@ int main(void)
    gui_welcome();
    eeprom_initialize(); 
    adc_init();
-   hdlc_init_decoder(afsk_rx_init());
-   outframes = hdlc_init_encoder(afsk_tx_init());
-   afsk_tx_start(); // Call this only when needed and stop it when not needed??
-   // FIXME: Rename to afsk_tx_enable
+   crc_init();
+   afsk_rx_init();
+   for (uint8_t i=0; i<AFSK_RX_VARIANTS; i++)
+      hdlc_init_decoder(afsk_rx_queue(i), i);
+   afsk_tx_init();
+   hdlc_init_encoder();
+   csma_init();
    gps_init(&GPS_SERIAL, (Stream*) &SHELL_SERIAL);
    tracker_init(); 
    sleep(100);
@@ -60,6 +60,9 @@
 #define KINETIS_GPT_PIT2_IRQ_PRIORITY 15
 #define KINETIS_GPT_PIT3_IRQ_PRIORITY 15
 
+/* DAC buffer refill for tone generator (see tone.c) */
+#define KINETIS_DAC0_IRQ_PRIORITY     6
+
 
 
 
@@ -9,6 +9,7 @@ static bool mon_on = false;
 static bool mon_ax25 = true; 
 static Stream *out;
 FBQ mon;
+static hdlc_sub_t mon_sub;
 
 
 
@@ -70,7 +71,7 @@ void mon_activate(bool m)
    
    if (tstart) {
       FBQ* mq = (mon_on? &mon : NULL);
-      hdlc_subscribe_rx(mq, 0);
+      hdlc_subscribe_rx(&mon_sub, "monitor", mq, HDLC_DROP_OLDEST, 0);
       if ( true || !mon_on || GET_BYTE_PARAM(TXMON_ON) )
          hdlc_monitor_tx(mq);
       mont = THREAD_DSTART(monitor, STACK_MONITOR, NORMALPRIO, NULL);  
@@ -81,7 +82,7 @@ void mon_activate(bool m)
            chThdWait(mont);
       mont=NULL;
       hdlc_monitor_tx(NULL);
-      hdlc_subscribe_rx(NULL, 0);
+      hdlc_unsubscribe_rx(&mon_sub);
    }
 }
 
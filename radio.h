@@ -18,5 +18,6 @@
  bool radio_isLowTxPower(void); 
  void squelch_handler(EXTDriver *extp, expchannel_t channel);
  void wait_channel_ready(void);
+ void radio_dcd(bool on);
  
 #endif
@@ -11,6 +11,7 @@
 #include "radio.h"
 #include "hdlc.h"
 #include "afsk.h"
+#include "csma.h"
 
 #define FLAG_BUSY_LOCK  0x01
 #define FLAG_COMP_EXP   0x02
@@ -19,6 +20,7 @@
 
 static bool     _on = false;
 static bool     _sq_on = false; 
+static bool     _dcd_on = false;
 static uint8_t  _widebw; 
 static uint8_t  _flags;        
 static uint32_t _txfreq;       // TX frequency in 100 Hz units
@@ -164,29 +166,57 @@ bool radio_setSquelch(uint8_t sq)
 }
 
 
+/************************************************
+ * Update channel state. The channel is busy if 
+ * data carrier is detected by the demodulator or 
+ * if the squelch is open (unless squelch level is 
+ * 0, meaning that it is always open). 
+ ************************************************/
+
+static void _channel_updateI(void) {
+  bool rdy = !_dcd_on && !(_sq_on && _squelch > 0);
+  csma_busyI(!rdy);
+  if (rdy && !channel_rdy) 
+    chCondBroadcastI(&_channel_rdy);
+  channel_rdy = rdy;
+}
+
+
 /************************************************
  * Squelch handler. 
+ * Note that the receiver is running as long as 
+ * the radio is on. Decoding does not depend on 
+ * the squelch. 
  ************************************************/
 
 void squelch_handler(EXTDriver *extp, expchannel_t channel) {
   (void)extp;
   (void)channel;
   
-  chSysLock();
+  chSysLockFromISR();
   if (!_sq_on && radio_rdy && !pinIsHigh(TRX_SQ)) {
     _sq_on = true;
     pri_rgb_led_on(true, true, false);
-    afsk_rx_enable();
-    channel_rdy = false;
   }
   else if (_sq_on) {
     _sq_on = false; 
     pri_rgb_led_off();
-    afsk_rx_disable();
-    channel_rdy = true;
-    chCondBroadcastI(&_channel_rdy);
-    chSchRescheduleS();
   }
+  _channel_updateI();
+  chSysUnlockFromISR();
+}
+
+
+/************************************************
+ * Data carrier detect on/off. 
+ * Called from the demodulator (thread context).
+ ************************************************/
+
+void radio_dcd(bool on) {
+  chSysLock();
+  _dcd_on = on;
+  _channel_updateI();
+  chSchRescheduleS();
   chSysUnlock();
 }
 
@@ -209,7 +239,7 @@ void radio_wait_enabled() {
 void wait_channel_ready()
 {
   MUTEX2_LOCK;
-  /* Wait to radio is on and squelch is closed */
+  /* Wait until no carrier is detected */
   rgb_led_on(false, false, true);
   while (!channel_rdy)
      WAIT_CHANNEL_READY;
@@ -233,8 +263,10 @@ void radio_on(bool on)
       _initialize();
       radio_rdy=true;
       SIGNAL_RADIO_READY;
+      afsk_rx_enable();
    }
    else {
+      afsk_rx_disable();
       clearPin(TRX_PD);
       radio_rdy=false;
    }
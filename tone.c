@@ -1,5 +1,14 @@
 /* 
  * Generate a tone (sine wave) using the DAC.
+ * 
+ * Direct digital synthesis: A phase accumulator indexes a sine table 
+ * at a fixed sample rate. The samples are put in the 16 word buffer of 
+ * the DAC, which is stepped by the PDB at the sample rate. The buffer 
+ * is refilled, half of it at a time, from the DAC interrupt. 
+ * 
+ * The sample rate is a multiple of the bit rate, so mark/space is 
+ * switched exactly at bit boundaries: The tone generator calls 
+ * afsk_tx_nextBit() for each bit while it is running. 
  */
 
 #include "hal.h"
@@ -8,58 +17,140 @@
 #include "defines.h"
 
 
-#define STEPS 16
-
-/* 
- * Use the least common multiplier (LCM) of the sampling frequencies 
- * (16 x 1200 and 16 x 2200) as the clock frequency of the timer 
- */
-#define CLOCK_FREQ 211200
-#define FREQ(f) (CLOCK_FREQ/(f*STEPS))
-
-/* The sine wave is generated in 16 steps */
-#define STEPS 16
+#define SAMPLERATE      26400   /* 22 x 1200 and 12 x 2200 */
+#define SAMPLES_PER_BIT (SAMPLERATE/1200)
+#define PHASE_INC(f)    ((uint32_t) (((uint64_t) (f) << 32) / SAMPLERATE))
+#define DAC_MIDLEVEL    2048
+
+/* DAC buffer. Half of it is refilled at a time */
+#define DACBUF_SIZE     16
+#define DACBUF_HALF     (DACBUF_SIZE/2)
+
+
+/* "Borrowed" from Teensyduino kinetis.h */
+
+#define SIM_SCGC6              (*(volatile uint32_t *)0x4004803C) // System Clock Gating Control Register 6
+#define SIM_SCGC6_PDB          ((uint32_t)0x00400000)             // PDB Clock Gate Control
+#define DAC0_DAT               ((volatile uint16_t *)0x400CC000)  // DAC Data Registers (buffer)
+#define DAC0_SR                (*(volatile uint8_t  *)0x400CC020) // DAC Status Register
+#define DAC0_C0                (*(volatile uint8_t  *)0x400CC021) // DAC Control Register
+#define DAC0_C1                (*(volatile uint8_t  *)0x400CC022) // DAC Control Register 1
+#define DAC0_C2                (*(volatile uint8_t  *)0x400CC023) // DAC Control Register 2
+#define DAC_SR_DACBFWMF        0x04                               // Buffer Watermark Flag
+#define DAC_SR_DACBFRPTF       0x02                               // Buffer Read Pointer Top Position Flag
+#define DAC_C0_DACEN           0x80                               // DAC Enable
+#define DAC_C0_DACRFS          0x40                               // DAC Reference Select
+#define DAC_C0_DACBWIEN        0x04                               // Buffer Watermark Interrupt Enable
+#define DAC_C0_DACBTIEN        0x02                               // Buffer Read Pointer Top Flag Interrupt Enable
+#define DAC_C1_DACBFWM(n)      (((n) & 3) << 3)                   // Buffer Watermark Select
+#define DAC_C1_DACBFEN         0x01                               // Buffer Enable
+#define DAC_C2_DACBFUP(n)      ((n) & 15)                         // Buffer Upper Limit
+#define PDB0_SC                (*(volatile uint32_t *)0x40036000) // Status and Control Register
+#define PDB0_MOD               (*(volatile uint32_t *)0x40036004) // Modulus Register
+#define PDB0_IDLY              (*(volatile uint32_t *)0x4003600C) // Interrupt Delay Register
+#define PDB0_DACINTC0          (*(volatile uint32_t *)0x40036150) // DAC Interval Trigger Control Register
+#define PDB0_DACINT0           (*(volatile uint32_t *)0x40036154) // DAC Interval Register
+#define PDB_SC_TRGSEL(n)       (((n) & 15) << 8)                  // Trigger Input Source Select
+#define PDB_SC_PDBEN           0x00000080                         // PDB Module Enable
+#define PDB_SC_CONT            0x00000002                         // Continuous Mode Enable
+#define PDB_SC_LDOK            0x00000001                         // Load OK
+#define PDB_SC_SWTRIG          0x00010000                         // Software Trigger
+#define PDB_DACINTC_TOE        0x01                               // DAC Interval Trigger Enable
+
+#define DAC0_IRQ_NUMBER        81
+#define DAC0_IRQ_VECTOR        Vector184
+#define PDB_INTERVAL           (KINETIS_BUSCLK_FREQUENCY / SAMPLERATE)
+
+
+/* Sine table. 256 steps */
+static const uint16_t sine[256] = {
+    2050, 2099, 2148, 2197, 2246, 2295, 2343, 2392, 2440, 2488, 2536, 2583,
+    2631, 2677, 2724, 2770, 2815, 2860, 2905, 2949, 2993, 3036, 3078, 3120,
+    3161, 3202, 3241, 3280, 3319, 3356, 3393, 3429, 3464, 3498, 3532, 3564,
+    3596, 3627, 3656, 3685, 3713, 3740, 3765, 3790, 3814, 3836, 3858, 3878,
+    3898, 3916, 3933, 3949, 3964, 3978, 3990, 4001, 4012, 4021, 4028, 4035,
+    4040, 4045, 4048, 4049, 4050, 4049, 4048, 4045, 4040, 4035, 4028, 4021,
+    4012, 4001, 3990, 3978, 3964, 3949, 3933, 3916, 3898, 3878, 3858, 3836,
+    3814, 3790, 3765, 3740, 3713, 3685, 3656, 3627, 3596, 3564, 3532, 3498,
+    3464, 3429, 3393, 3356, 3319, 3280, 3241, 3202, 3161, 3120, 3078, 3036,
+    2993, 2949, 2905, 2860, 2815, 2770, 2724, 2677, 2631, 2583, 2536, 2488,
+    2440, 2392, 2343, 2295, 2246, 2197, 2148, 2099, 2050, 2001, 1952, 1903,
+    1854, 1805, 1757, 1708, 1660, 1612, 1564, 1517, 1469, 1423, 1376, 1330,
+    1285, 1240, 1195, 1151, 1107, 1064, 1022,  980,  939,  898,  859,  820,
+     781,  744,  707,  671,  636,  602,  568,  536,  504,  473,  444,  415,
+     387,  360,  335,  310,  286,  264,  242,  222,  202,  184,  167,  151,
+     136,  122,  110,   99,   88,   79,   72,   65,   60,   55,   52,   51,
+      50,   51,   52,   55,   60,   65,   72,   79,   88,   99,  110,  122,
+     136,  151,  167,  184,  202,  222,  242,  264,  286,  310,  335,  360,
+     387,  415,  444,  473,  504,  536,  568,  602,  636,  671,  707,  744,
+     781,  820,  859,  898,  939,  980, 1022, 1064, 1107, 1151, 1195, 1240,
+    1285, 1330, 1376, 1423, 1469, 1517, 1564, 1612, 1660, 1708, 1757, 1805,
+    1854, 1903, 1952, 2001
+  };
 
 static bool _toneHigh = false;
 static bool _on = false; 
-static uint8_t i = 0;
-static const uint16_t sine[STEPS] = 
-  { 2059, 2815, 3464, 3898, 4050, 3898, 3464, 2815, 2050, 
-    1285, 636, 202, 50, 202, 636, 1285 };
-
-static void sinewave(GPTDriver *gptp); 
-    
-    
-    
-static const GPTConfig gpt_cfg = {
-   CLOCK_FREQ,  
-   sinewave    /* Timer callback.*/
-};
-    
-    
+static uint32_t phase = 0;
+static uint32_t phase_inc = PHASE_INC(AFSK_MARK);
+static uint8_t bitcnt;
+static uint32_t irqs = 0;          // Number of DAC interrupts
+
+
+
 /*****************************************************************
- * Call periodically from timer ISR to generate a sine wave.
- * This is to be done 16 X the frequency of the generated tone. 
+ * Put the next n samples into the DAC buffer, starting at 
+ * position pos. Called from the DAC interrupt (and when 
+ * starting) to fill the half of the buffer not being read. 
  *****************************************************************/
 
-static void sinewave(GPTDriver *gptp) {
-  (void)gptp;
-  analogWrite(sine[i++]);
-  if (i >= STEPS) 
-     i=0;
+static void fill(uint8_t pos, uint8_t n) {
+  while (n-- > 0) {
+    if (--bitcnt == 0) {
+      bitcnt = SAMPLES_PER_BIT; 
+      afsk_tx_nextBit();
+      if (!_on) 
+        return;
+    }
+    DAC0_DAT[pos++] = sine[phase >> 24];
+    phase += phase_inc;
+  }
 }
 
 
+OSAL_IRQ_HANDLER(DAC0_IRQ_VECTOR) {
+  OSAL_IRQ_PROLOGUE();
+  uint8_t sr = DAC0_SR; 
+  irqs++;
+  
+  /* Read pointer wrapped to the top: Refill second half */
+  if (sr & DAC_SR_DACBFRPTF) {
+    DAC0_SR = sr & ~DAC_SR_DACBFRPTF;
+    fill(DACBUF_HALF, DACBUF_HALF);
+  }
+  /* Read pointer near the end: Refill first half */
+  else if (sr & DAC_SR_DACBFWMF) {
+    DAC0_SR = sr & ~DAC_SR_DACBFWMF;
+    fill(0, DACBUF_HALF);
+  }
+  OSAL_IRQ_EPILOGUE();
+}
+
+
+
+uint32_t tone_irqCount()
+   { return irqs; }
+
+
+
 /**************************************************************************
  * Set the frequency of the tone to mark or space. 
  * argument to true to set it to MARK. Otherwise, SPACE. 
+ * Takes effect from the next sample, the phase is continuous. 
  **************************************************************************/
 
 void tone_setHigh(bool hi) { 
    _toneHigh = hi; 
-   if (_on) 
-      gptChangeInterval(&AFSK_TONEGEN_GPT, 
-         _toneHigh ? FREQ(AFSK_SPACE) : FREQ(AFSK_MARK) ); 
+   phase_inc = _toneHigh ? PHASE_INC(AFSK_SPACE) : PHASE_INC(AFSK_MARK); 
   } 
 
   
@@ -72,15 +163,33 @@ void tone_toggle()
    
    
 /**************************************************************************
- * Start generating a tone using the DAC.
+ * Start generating a tone using the DAC. The first bit is requested 
+ * right away. 
  **************************************************************************/
 
 void tone_start() {
    _on = true;
+   bitcnt = 1;
    dac_init();
-   gptStart(&AFSK_TONEGEN_GPT, &gpt_cfg);
-   gptStartContinuous(&AFSK_TONEGEN_GPT, 
-      _toneHigh ? FREQ(AFSK_SPACE) : FREQ(AFSK_MARK));  
+   DAC0_C2 = DAC_C2_DACBFUP(DACBUF_SIZE-1);
+   fill(0, DACBUF_SIZE); 
+   if (!_on)
+      return;
+   
+   /* Buffer stepped by hardware trigger (PDB), interrupt at the top  
+    * and 4 words before the end (watermark) */
+   DAC0_C1 = DAC_C1_DACBFEN | DAC_C1_DACBFWM(3);
+   DAC0_SR = 0;
+   DAC0_C0 = DAC_C0_DACEN | DAC_C0_DACRFS | DAC_C0_DACBWIEN | DAC_C0_DACBTIEN;
+   nvicEnableVector(DAC0_IRQ_NUMBER, KINETIS_DAC0_IRQ_PRIORITY);
+   
+   SIM_SCGC6 |= SIM_SCGC6_PDB;
+   PDB0_IDLY = 0;
+   PDB0_MOD = PDB_INTERVAL - 1;
+   PDB0_DACINT0 = PDB_INTERVAL - 1; 
+   PDB0_DACINTC0 = PDB_DACINTC_TOE;
+   PDB0_SC = PDB_SC_TRGSEL(15) | PDB_SC_PDBEN | PDB_SC_CONT | PDB_SC_LDOK;
+   PDB0_SC |= PDB_SC_SWTRIG;
 }
 
 
@@ -89,9 +198,13 @@ void tone_start() {
  **************************************************************************/
 
 void tone_stop() {
+   if (!_on)
+      return;
    _on = false; 
-   gptStopTimer(&AFSK_TONEGEN_GPT);
-//   gptStop(&AFSK_TONEGEN_GPT);
+   nvicDisableVector(DAC0_IRQ_NUMBER);
+   PDB0_SC = 0;
+   DAC0_C0 = DAC_C0_DACEN | DAC_C0_DACRFS;
+   DAC0_C1 = 0; 
+   DAC0_SR = 0;
+   DAC0_DAT[0] = DAC_MIDLEVEL;
 }
-
-
@@ -0,0 +1,30 @@
+/*
+ * Checks for the host tests. A failed check is reported and counted,
+ * and the test goes on. check_done prints the result and gives the
+ * exit status.
+ */
+
+#ifndef _HOST_CHECK_H_
+#define _HOST_CHECK_H_
+
+#include <stdio.h>
+
+static int check_failed = 0;
+
+#define CHECK(c) do { \
+      if (!(c)) { \
+         fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #c); \
+         check_failed++; \
+      } \
+   } while (0)
+
+static inline int check_done(const char* name)
+{
+   if (check_failed)
+      printf("%s: %d checks FAILED\n", name, check_failed);
+   else
+      printf("%s: ok\n", name);
+   return check_failed ? 1 : 0;
+}
+
+#endif
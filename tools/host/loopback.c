@@ -0,0 +1,694 @@
+/*
+ * Loopback benchmark. Frames go through the HDLC encoder, the AFSK
+ * transmitter and tone generator, a model of the radio channel, and
+ * back through the demodulator and the HDLC decoder. Reports the
+ * packet error rate, CPU time per frame and how the DCD behaves.
+ *
+ * The channel (at the DAC rate, then resampled to the ADC rate):
+ *   - audio passband of the radio (low pass at 3 kHz)
+ *   - twist: level of space relative to mark, in dB
+ *   - frequency offset, in Hz (SSB style shift of the whole signal)
+ *   - clock drift of the transmitter relative to the receiver, in ppm
+ *   - white gaussian noise, SNR in dB over the 0-4800 Hz band
+ *   - clipping, at a fraction of the peak level
+ *   - 8 bit quantisation at the given peak level, as the ADC delivers it
+ *
+ * With -9, the transmitter and receiver are in G3RUH 9600 baud mode.
+ * The DAC and ADC then both run at 38400 Hz, the passband of the radio
+ * goes to 6 kHz, the noise band to 19200 Hz, and twist and frequency
+ * offset are not used. The bit/s column is the information delivered
+ * per second of air time, flags and all, for comparing the modes.
+ *
+ * CPU times are measured on the host and are only useful for comparing
+ * versions of the code with each other, not as target cycle counts.
+ *
+ * With -i, a WAV file (8 or 16 bit PCM, any rate) is decoded instead
+ * and the number of frames is reported.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "rig.h"
+#include "hdlc.h"
+#include "afsk.h"
+#include "defines.h"
+
+#define MAX_AUDIO    (RIG_TX_RATE * 4)
+#define MAX_INFO     256
+#define FIR_TAPS     63
+#define FIR_DELAY    (FIR_TAPS / 2)
+#define TWIST_STAGES 4
+#define RATIO        ((double) tx_rate / rx_rate)
+
+
+/* Settings, see usage() */
+static int    nframes = 200;
+static int    maxinfo = 100;
+static double snr = 30;
+static double twist = 0;
+static double offset = 0;
+static double drift = 0;
+static double clip = 0;
+static double level = 60;
+static int    blocksize = AFSK_RX_BLOCKSIZE;
+static int    gap_ms = 200;
+static int    noise_sec = 10;
+static bool   sweep = false;
+static const char* infile = NULL;
+static const char* outfile = NULL;
+static bool   verbose = false;
+static bool   g3ruh = false;
+
+/* Sample rates and bit rate of the mode */
+static int    tx_rate = RIG_TX_RATE;
+static int    rx_rate = RIG_RX_RATE;
+static int    bitrate = 1200;
+
+
+static void usage(void)
+{
+   fprintf(stderr,
+      "Usage: loopback [options]\n"
+      "  -n frames   Number of frames (%d)\n"
+      "  -l bytes    Max length of information field (%d)\n"
+      "  -s dB       Signal to noise ratio, 0-4800 Hz, 0-19200 Hz with -9 (%.0f)\n"
+      "  -t dB       Twist, space relative to mark (%.0f)\n"
+      "  -f Hz       Frequency offset (%.0f)\n"
+      "  -d ppm      Clock drift of transmitter (%.0f)\n"
+      "  -c frac     Clip at this fraction of the peak level, 0 for none\n"
+      "  -a counts   Peak level at the ADC (%.0f)\n"
+      "  -b samples  Block size given to the demodulator (%d)\n"
+      "  -g ms       Gap between transmissions (%d)\n"
+      "  -q sec      Noise alone, for false DCD (%d)\n"
+      "  -S          Sweep SNR from 30 to 0 dB\n"
+      "  -r seed     Seed for frames and noise\n"
+      "  -i file     Decode a WAV file instead\n"
+      "  -o file     Write the ADC input to a WAV file (16 bit)\n"
+      "  -v          Print frames received\n"
+      "  -9          G3RUH 9600 baud instead of AFSK 1200 (no -t or -f)\n",
+      nframes, maxinfo, snr, twist, offset, drift, level, blocksize, gap_ms, noise_sec);
+   exit(1);
+}
+
+
+
+/*********************************************************************
+ * Random numbers (xorshift), reproducible with the same seed
+ *********************************************************************/
+
+static uint64_t rng = 88172645463325252ULL;
+
+static uint32_t rnd(void)
+{
+   rng ^= rng << 13;
+   rng ^= rng >> 7;
+   rng ^= rng << 17;
+   return (uint32_t) (rng >> 16);
+}
+
+static double gauss(void)
+{
+   double u1 = (rnd() + 1.0) / 4294967297.0;
+   double u2 = rnd() / 4294967296.0;
+   return sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+
+static double cputime(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+
+/*********************************************************************
+ * Frames: AX.25 UI frames with a sequence number and random text
+ *********************************************************************/
+
+static uint16_t make_frame(uint8_t* f, int seq)
+{
+   static const char* dest = "APZARC";
+   static const char* src = "LA0TST";
+   uint16_t n = 0;
+
+   for (int i=0; i<6; i++)
+      f[n++] = dest[i] << 1;
+   f[n++] = 0x60;
+   for (int i=0; i<6; i++)
+      f[n++] = src[i] << 1;
+   f[n++] = 0x61 | ((seq % 16) << 1);
+   f[n++] = 0x03;
+   f[n++] = 0xF0;
+   n += sprintf((char*) f+n, ">%06d ", seq);
+   int len = rnd() % (maxinfo > 8 ? maxinfo - 8 : 1);
+   for (int i=0; i<len; i++)
+      f[n++] = ' ' + rnd() % 95;
+   return n;
+}
+
+
+
+/*********************************************************************
+ * Channel model
+ *********************************************************************/
+
+static double lp_coef[FIR_TAPS];
+static double hilbert_coef[FIR_TAPS];
+static double twist_k, twist_g;
+
+
+/* Gain of y = x + k(x - x') at frequency f (DAC rate) */
+static double shelf_gain(double k, double f)
+{
+   double w = 2 * M_PI * f / tx_rate;
+   double re = 1 + k - k * cos(w), im = k * sin(w);
+   return sqrt(re*re + im*im);
+}
+
+
+static void channel_init(void)
+{
+   double fc = (g3ruh ? 6000.0 : 3000.0) / tx_rate, sum = 0;
+   for (int i=0; i<FIR_TAPS; i++) {
+      int k = i - FIR_DELAY;
+      double win = 0.54 - 0.46 * cos(2 * M_PI * i / (FIR_TAPS - 1));
+      lp_coef[i] = (k == 0 ? 2 * fc : sin(2 * M_PI * fc * k) / (M_PI * k)) * win;
+      sum += lp_coef[i];
+      hilbert_coef[i] = (k % 2 != 0 ? 2.0 / (M_PI * k) * win : 0);
+   }
+   for (int i=0; i<FIR_TAPS; i++)
+      lp_coef[i] /= sum;
+
+   /* Find k so that each shelving stage gives its share of the twist,
+    * and the gain that keeps the mark level */
+   double t = twist / TWIST_STAGES, lo = -0.499, hi = 100;
+   for (int i=0; i<100; i++) {
+      double k = (lo + hi) / 2;
+      double r = 20 * log10(shelf_gain(k, AFSK_SPACE) / shelf_gain(k, AFSK_MARK));
+      if (r < t)
+         lo = k;
+      else
+         hi = k;
+   }
+   twist_k = (lo + hi) / 2;
+   twist_g = 1 / shelf_gain(twist_k, AFSK_MARK);
+}
+
+
+static double fir(const double* coef, const double* x, size_t i)
+{
+   double y = 0;
+   for (int j=0; j<FIR_TAPS; j++)
+      if (i >= (size_t) j)
+         y += coef[j] * x[i-j];
+   return y;
+}
+
+
+/*
+ * Run n DAC samples through the channel.
+ * Returns the number of ADC samples put in out.
+ */
+static double tmp1[MAX_AUDIO], tmp2[MAX_AUDIO];
+
+static size_t channel(const uint16_t* dac, size_t n, int8_t* out)
+{
+   double sigma = level / sqrt(2) * pow(10, -snr / 20);
+   size_t i, m;
+
+   /* DAC output (50-4050 around 2048) to +-1 */
+   for (i=0; i<n; i++)
+      tmp1[i] = ((double) dac[i] - 2048) / 2000;
+
+   /* Twist */
+   if (twist != 0)
+      for (int s=0; s<TWIST_STAGES; s++) {
+         double prev = 0;
+         for (i=0; i<n; i++) {
+            double x = tmp1[i];
+            tmp1[i] = twist_g * (x + twist_k * (x - prev));
+            prev = x;
+         }
+      }
+
+   /* Radio audio passband */
+   for (i=0; i<n; i++)
+      tmp2[i] = fir(lp_coef, tmp1, i);
+
+   /* Frequency offset: Shift the analytic signal */
+   if (offset != 0) {
+      double ph = 0, dph = 2 * M_PI * offset / tx_rate;
+      for (i=0; i<n; i++) {
+         double q = fir(hilbert_coef, tmp2, i);
+         double re = (i >= FIR_DELAY ? tmp2[i - FIR_DELAY] : 0);
+         tmp1[i] = re * cos(ph) - q * sin(ph);
+         ph = fmod(ph + dph, 2 * M_PI);
+      }
+      memcpy(tmp2, tmp1, n * sizeof(double));
+   }
+
+   /* Resample to the ADC rate with the transmitter clock off by drift */
+   double step = RATIO * (1 + drift * 1e-6);
+   for (m=0; ; m++) {
+      double p = m * step;
+      size_t k = (size_t) p;
+      if (k + 1 >= n)
+         break;
+      double x = tmp2[k] + (tmp2[k+1] - tmp2[k]) * (p - k);
+
+      x = x * level + sigma * gauss();
+      if (clip > 0) {
+         if (x > clip * level)  x = clip * level;
+         if (x < -clip * level) x = -clip * level;
+      }
+      long v = lrint(x);
+      out[m] = (int8_t) (v > 127 ? 127 : v < -128 ? -128 : v);
+   }
+   return m;
+}
+
+
+/* Noise alone, for n ADC samples */
+static void channel_noise(int8_t* out, size_t n, double sigma)
+{
+   for (size_t i=0; i<n; i++) {
+      long v = lrint(sigma * gauss());
+      out[i] = (int8_t) (v > 127 ? 127 : v < -128 ? -128 : v);
+   }
+}
+
+
+
+/*********************************************************************
+ * WAV files
+ *********************************************************************/
+
+static FILE* wav_out = NULL;
+static uint32_t wav_samples = 0;
+
+static void put32(FILE* f, uint32_t x)
+   { fputc(x, f); fputc(x >> 8, f); fputc(x >> 16, f); fputc(x >> 24, f); }
+
+static void put16(FILE* f, uint16_t x)
+   { fputc(x, f); fputc(x >> 8, f); }
+
+
+static void wav_header(FILE* f, uint32_t nsamples)
+{
+   fwrite("RIFF", 1, 4, f); put32(f, 36 + nsamples * 2);
+   fwrite("WAVEfmt ", 1, 8, f); put32(f, 16);
+   put16(f, 1); put16(f, 1); put32(f, rx_rate); put32(f, rx_rate * 2);
+   put16(f, 2); put16(f, 16);
+   fwrite("data", 1, 4, f); put32(f, nsamples * 2);
+}
+
+
+static void wav_write(const int8_t* x, size_t n)
+{
+   if (wav_out == NULL)
+      return;
+   for (size_t i=0; i<n; i++)
+      put16(wav_out, (uint16_t) (x[i] * 256));
+   wav_samples += n;
+}
+
+
+static void wav_close(void)
+{
+   if (wav_out == NULL)
+      return;
+   rewind(wav_out);
+   wav_header(wav_out, wav_samples);
+   fclose(wav_out);
+}
+
+
+/*********************************************************************
+ * Receiver side
+ *********************************************************************/
+
+static FBQ rxq;
+static hdlc_sub_t rxsub;
+static double rx_cpu = 0;
+
+/* DCD statistics, in ADC samples */
+typedef struct {
+   uint32_t on_events;     // DCD turned on
+   uint64_t on_samples;    // Samples with DCD on
+   uint64_t samples;
+} dcdstat_t;
+
+static bool dcd_prev = false;
+
+
+/*
+ * Feed samples to the demodulator in blocks. For each block, record
+ * the DCD state in dcd (one entry per sample) if not NULL.
+ */
+static void receive(int8_t* x, size_t n, uint8_t* dcd)
+{
+   double t0 = cputime();
+   for (size_t i=0; i<n; i += blocksize) {
+      size_t b = (n - i < (size_t) blocksize ? n - i : (size_t) blocksize);
+      rig_rx_block(x+i, b);
+      rig_dec_poll(false);
+      if (dcd != NULL)
+         memset(dcd+i, afsk_rx_dcd(), b);
+   }
+   rig_dec_poll(true);
+   rx_cpu += cputime() - t0;
+}
+
+
+static void dcd_count(const uint8_t* dcd, size_t from, size_t to, dcdstat_t* st)
+{
+   for (size_t i=from; i<to; i++) {
+      if (dcd[i] && !dcd_prev)
+         st->on_events++;
+      st->on_samples += dcd[i];
+      dcd_prev = dcd[i];
+   }
+   st->samples += to - from;
+}
+
+
+static void print_frame(FBUF* fb)
+{
+   char buf[MAX_INFO + 20];
+   uint16_t n = fbuf_read(fb, sizeof(buf) - 1, buf);
+   for (uint16_t i=0; i<n; i++)
+      putchar(i < 16 ? "0123456789abcdef"[(uint8_t) buf[i] >> 4] : (buf[i] >= ' ' && buf[i] < 127 ? buf[i] : '.'));
+   putchar('\n');
+}
+
+
+
+/*********************************************************************
+ * Frames through the channel
+ *********************************************************************/
+
+typedef struct {
+   int sent, ok, bad;
+   double tx_cpu, rx_cpu;
+   dcdstat_t gap;         // Between transmissions
+   uint32_t dcd_miss;     // Frames without DCD
+   uint32_t dcd_drop;     // DCD off during frame
+   double latency, latency_max;
+   double hang;
+   uint64_t samples;      // Given to the receiver
+   double airtime;        // Of the transmissions, seconds
+   uint32_t ok_bytes;     // In frames received right
+} result_t;
+
+static uint16_t audio[MAX_AUDIO];
+static int8_t adc[MAX_AUDIO];
+static uint8_t dcdv[MAX_AUDIO];
+
+
+static void run(result_t* r)
+{
+   static uint8_t frame[MAX_INFO + 32];
+   size_t gap = (size_t) gap_ms * tx_rate / 1000;
+   size_t delay = (size_t) ((FIR_DELAY + (offset != 0 ? FIR_DELAY : 0)) / RATIO);
+   uint32_t latency_n = 0;
+   FBUF b, rb;
+
+   memset(r, 0, sizeof(result_t));
+   rx_cpu = 0;
+   dcd_prev = false;
+   rig_rx_reset();
+
+   for (int seq=0; seq<nframes; seq++) {
+      uint16_t len = make_frame(frame, seq);
+      const uint8_t* bits;
+      uint16_t pre, post, nbits;
+
+      /* Encode and transmit */
+      double t0 = cputime();
+      fbuf_new(&b, FBUF_ACC_OTHER, len);
+      fbuf_write(&b, (char*) frame, len);
+      hdlc_tx_put(b, HDLC_TX_OTHER, 0);
+      nbits = rig_enc_render(&bits, &pre, &post);
+      size_t n = (g3ruh ? rig_tx_g3ruh : rig_tx_audio)(bits, nbits, pre, post, audio + gap, MAX_AUDIO - gap);
+      r->tx_cpu += cputime() - t0;
+      r->sent++;
+      r->airtime += (double) n / tx_rate;
+
+      /* Silence before it, through the channel */
+      for (size_t i=0; i<gap; i++)
+         audio[i] = 2048;
+      size_t m = channel(audio, n + gap, adc);
+      size_t start = (size_t) (gap / RATIO) + delay;
+      size_t end = (size_t) ((gap + n) / RATIO) + delay;
+      if (end > m)
+         end = m;
+      wav_write(adc, m);
+      receive(adc, m, dcdv);
+      r->samples += m;
+
+      /* DCD: false detects in the gap (after the hang time of the
+       * previous frame), latency and dropouts during the frame */
+      size_t i = 0;
+      if (seq > 0) {
+         while (i < start && dcdv[i])
+            i++;
+         r->hang += (double) i / rx_rate;
+         dcd_prev = false;
+      }
+      dcd_count(dcdv, i, start, &r->gap);
+      size_t on = start;
+      while (on < end && !dcdv[on])
+         on++;
+      if (on == end)
+         r->dcd_miss++;
+      else {
+         double lat = (double) (on - start) / rx_rate;
+         r->latency += lat;
+         if (lat > r->latency_max)
+            r->latency_max = lat;
+         latency_n++;
+         /* Count drops until the end of the frame, less the tail */
+         size_t tail = end - (size_t) (post * 8 * rx_rate / bitrate);
+         for (size_t j=on; j<tail; j++)
+            if (!dcdv[j] && dcdv[j-1])
+               r->dcd_drop++;
+      }
+      dcd_prev = dcdv[m-1];
+
+      /* Compare what was received */
+      while (fbq_tryGet(&rxq, &rb)) {
+         if (verbose)
+            print_frame(&rb);
+         fbuf_rseek(&rb, 0);
+         char got[MAX_INFO + 32];
+         uint16_t glen = fbuf_read(&rb, sizeof(got), got);
+         if (glen == len && memcmp(got, frame, len) == 0) {
+            r->ok++;
+            r->ok_bytes += len;
+         }
+         else
+            r->bad++;
+         fbuf_release(&rb);
+      }
+   }
+   r->rx_cpu = rx_cpu;
+   if (latency_n > 0)
+      r->latency /= latency_n;
+   if (nframes > 1)
+      r->hang /= nframes - 1;
+}
+
+
+/* DCD on noise alone, at the level of the signal */
+static void run_noise(dcdstat_t* st)
+{
+   size_t n = (size_t) noise_sec * rx_rate;
+   size_t chunk = rx_rate;
+
+   memset(st, 0, sizeof(dcdstat_t));
+   rig_rx_reset();
+   dcd_prev = false;
+   for (size_t i=0; i<n; i += chunk) {
+      channel_noise(adc, chunk, level / sqrt(2));
+      receive(adc, chunk, dcdv);
+      dcd_count(dcdv, 0, chunk, st);
+   }
+}
+
+
+static void report(result_t* r, bool header)
+{
+   double per = r->sent > 0 ? 1.0 - (double) r->ok / r->sent : 0;
+   double gapmin = r->gap.samples / (60.0 * rx_rate);
+   if (header)
+      printf("%6s %6s %6s %5s %7s %7s %9s %9s %7s %7s %6s %6s %7s %6s\n",
+         "SNR", "sent", "ok", "bad", "PER", "bit/s", "TX us/fr", "RX us/fr",
+         "DCD ms", "max ms", "miss", "drops", "hang ms", "gap/m");
+   printf("%6.1f %6d %6d %5d %7.4f %7.0f %9.1f %9.1f %7.1f %7.1f %6u %6u %7.1f %6.2f\n",
+      snr, r->sent, r->ok, r->bad, per, r->airtime > 0 ? r->ok_bytes * 8 / r->airtime : 0,
+      r->tx_cpu / r->sent * 1e6, r->rx_cpu / r->sent * 1e6,
+      r->latency * 1000, r->latency_max * 1000, r->dcd_miss, r->dcd_drop,
+      r->hang * 1000, gapmin > 0 ? r->gap.on_events / gapmin : 0);
+}
+
+
+
+/*********************************************************************
+ * Decode a WAV file
+ *********************************************************************/
+
+static void decode_file(const char* fname)
+{
+   double *in, *x;
+   uint32_t rate = 0;
+   size_t n = rig_wav_read(fname, &in, &rate);
+   if (n == 0 || rate == 0) {
+      fprintf(stderr, "%s: No audio\n", fname);
+      exit(1);
+   }
+   size_t m = rig_resample(in, n, rate, rx_rate, &x);
+   size_t chunk = rx_rate;
+   int frames = 0;
+   FBUF rb;
+
+   rig_rx_reset();
+   for (size_t i=0; i<m; i += chunk) {
+      size_t c = (m - i < chunk ? m - i : chunk);
+      for (size_t j=0; j<c; j++) {
+         long v = lrint(x[i+j] * level);
+         adc[j] = (int8_t) (v > 127 ? 127 : v < -128 ? -128 : v);
+      }
+      wav_write(adc, c);
+      receive(adc, c, NULL);
+      while (fbq_tryGet(&rxq, &rb)) {
+         frames++;
+         if (verbose)
+            print_frame(&rb);
+         fbuf_release(&rb);
+      }
+   }
+   printf("%s: %.1f s at %u Hz, %d frames, RX %.3f s CPU (%.1f x real time)\n",
+      fname, (double) m / rx_rate, rate, frames, rx_cpu,
+      rx_cpu > 0 ? m / (double) rx_rate / rx_cpu : 0);
+   free(in);
+   free(x);
+}
+
+
+
+int main(int argc, char** argv)
+{
+   int opt;
+   bool level_set = false;
+
+   while ((opt = getopt(argc, argv, "n:l:s:t:f:d:c:a:b:g:q:Sr:i:o:v9h")) != -1)
+      switch (opt) {
+         case 'n': nframes = atoi(optarg); break;
+         case 'l': maxinfo = atoi(optarg); break;
+         case 's': snr = atof(optarg); break;
+         case 't': twist = atof(optarg); break;
+         case 'f': offset = atof(optarg); break;
+         case 'd': drift = atof(optarg); break;
+         case 'c': clip = atof(optarg); break;
+         case 'a': level = atof(optarg); level_set = true; break;
+         case 'b': blocksize = atoi(optarg); break;
+         case 'g': gap_ms = atoi(optarg); break;
+         case 'q': noise_sec = atoi(optarg); break;
+         case 'S': sweep = true; break;
+         case 'r': rng = strtoull(optarg, NULL, 0) | 1; break;
+         case 'i': infile = optarg; break;
+         case 'o': outfile = optarg; break;
+         case 'v': verbose = true; break;
+         case '9': g3ruh = true; break;
+         default: usage();
+      }
+   if (maxinfo > MAX_INFO || maxinfo < 1 || blocksize < 1 || blocksize > AFSK_RX_BLOCKSIZE
+         || nframes < 1 || gap_ms < 50 || gap_ms > 1000 || (g3ruh && (twist != 0 || offset != 0)))
+      usage();
+   if (g3ruh) {
+      tx_rate = rx_rate = RIG_G3RUH_RATE;
+      bitrate = 9600;
+   }
+
+   if (outfile != NULL) {
+      if ((wav_out = fopen(outfile, "wb")) == NULL) {
+         perror(outfile);
+         return 1;
+      }
+      wav_header(wav_out, 0);
+   }
+
+   fbuf_init();
+   rig_enc_init();
+   afsk_tx_init();
+   rig_rx_init();
+   rig_dec_init();
+   if (g3ruh) {
+      afsk_tx_setMode(MODEM_G3RUH9600);
+      rig_rx_setMode(MODEM_G3RUH9600);
+   }
+   FBQ_INIT(rxq, HDLC_DECODER_QUEUE_SIZE);
+   hdlc_subscribe_rx(&rxsub, "LOOP", &rxq, HDLC_DROP_OLDEST, 0);
+   channel_init();
+
+   if (infile != NULL) {
+      if (!level_set)
+         level = 127;
+      decode_file(infile);
+      wav_close();
+      return 0;
+   }
+
+   printf("%s, SNR over 0-%d Hz, %d demodulator variants\n", g3ruh ? "G3RUH 9600 baud" : "AFSK 1200 baud",
+      rx_rate / 2, g3ruh ? 1 : AFSK_RX_VARIANTS);
+   printf("Block %d, level %.0f, twist %.1f dB, offset %.1f Hz, drift %.0f ppm, clip %.2f, info <= %d bytes\n",
+      blocksize, level, twist, offset, drift, clip, maxinfo);
+   printf("Times are host CPU time per frame; DCD latency from start of preamble\n");
+
+   result_t r;
+   if (sweep)
+      for (int s=30; s>=0; s -= 3) {
+         snr = s;
+         run(&r);
+         report(&r, s == 30);
+      }
+   else {
+      hdlc_rxstat_t st;
+      uint32_t decoded, unique, recovered;
+      afsk_prof_t p;
+      hdlc_rx_getStats(&st, true);
+      afsk_rx_getProfile(&p, true);
+      run(&r);
+      report(&r, true);
+      hdlc_rx_getStats(&st, false);
+      printf("Decoder: %u frames started, %u aborts, %u oversize, %u FCS errors\n",
+         st.frames, st.aborts, st.oversize, st.fcs_errors);
+      for (uint8_t v=0; v<AFSK_RX_VARIANTS; v++) {
+         hdlc_rx_variantStats(v, &decoded, &unique, &recovered);
+         printf("Variant %u: %u frames decoded, %u by it alone, %u repaired\n",
+            v, decoded, unique, recovered);
+      }
+      printf("Receiver, host ns per sample: %.0f\n", r.rx_cpu / r.samples * 1e9);
+      afsk_rx_getProfile(&p, false);
+      printf("Demodulator, host ticks per sample: bandpass %.1f, AGC %.1f, lowpass %.1f, PLL %.1f\n",
+         (double) p.cycles[AFSK_PROF_BANDPASS] / p.samples, (double) p.cycles[AFSK_PROF_AGC] / p.samples,
+         (double) p.cycles[AFSK_PROF_LOWPASS] / p.samples, (double) p.cycles[AFSK_PROF_PLL] / p.samples);
+   }
+
+   if (noise_sec > 0) {
+      dcdstat_t st;
+      run_noise(&st);
+      printf("Noise only (%d s, rms = signal rms): DCD on %.2f times/min, %.2f%% of the time\n",
+         noise_sec, st.on_events / (st.samples / (60.0 * rx_rate)),
+         100.0 * st.on_samples / st.samples);
+   }
+   wav_close();
+   return 0;
+}
@@ -0,0 +1,89 @@
+/*
+ * Test rig for running the modem and HDLC code on the host. Each
+ * rig_*.c file includes one firmware source file, to get at its
+ * static functions, and drives it the way the threads and interrupts
+ * on the target would. All of it runs in the calling thread.
+ */
+
+#ifndef _HOST_RIG_H_
+#define _HOST_RIG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "fbuf.h"
+
+/* Sample rates of the tone generator (DAC) and the receiver (ADC) */
+#define RIG_TX_RATE  26400
+#define RIG_RX_RATE   9600
+
+/* Sample rate of both in G3RUH 9600 baud mode */
+#define RIG_G3RUH_RATE 38400
+
+
+/* Encoder (rig_enc.c): Set up the queues, without the thread */
+void rig_enc_init(void);
+
+/* Render the frames queued with hdlc_tx_put into
+ * a transmission, as the encoder thread does before keying. Returns
+ * the number of bits (0 if nothing to send). */
+uint16_t rig_enc_render(const uint8_t** buf, uint16_t* preamble, uint16_t* postamble);
+
+/* True if a frame was taken from the queues but did not fit */
+bool rig_enc_pending(void);
+
+
+/* Transmitter (rig_tx.c): Send a rendered transmission through
+ * afsk_tx and the tone generator, emulating the bit clock and the DAC
+ * buffer interrupts. Up to max DAC samples (0-4095, RIG_TX_RATE) are
+ * put in out. Returns the number of samples. */
+size_t rig_tx_audio(const uint8_t* buf, uint16_t nbits, uint16_t preamble, uint16_t postamble,
+                    uint16_t* out, size_t max);
+
+/* The same in G3RUH mode. The samples are the DAC levels written by
+ * the bit clock interrupt, at RIG_G3RUH_RATE. The mode must be set
+ * with afsk_tx_setMode before the frames are rendered, since the
+ * encoder gives the preamble in flags at the bit rate of the mode. */
+size_t rig_tx_g3ruh(const uint8_t* buf, uint16_t nbits, uint16_t preamble, uint16_t postamble,
+                    uint16_t* out, size_t max);
+
+
+/* Synthesiser (rig_synth.c): The same transmission as ideal AFSK at
+ * the receiver sample rate, peak level amp. Returns the number of
+ * samples put in out. */
+size_t rig_synth(const uint8_t* buf, uint16_t nbits, uint16_t preamble, uint16_t postamble,
+                 int amp, int8_t* out, size_t max);
+
+
+/* Receiver (rig_rx.c): Run a block of ADC samples through the
+ * demodulator. The decoded bits go to the queue of each variant.
+ * Samples can also be given to afsk_rx_sample, as from the ADC, for
+ * the demodulator thread. rig_rx_ringlen is the number of those
+ * waiting. rig_rx_setMode changes the modem mode (MODEM_AFSK1200 or
+ * MODEM_G3RUH9600) at once, as the thread does, and resets. */
+void rig_rx_init(void);
+void rig_rx_block(int8_t* block, size_t n);
+void rig_rx_reset(void);
+void rig_rx_setMode(uint8_t m);
+uint16_t rig_rx_ringlen(void);
+
+
+/* Decoder (rig_dec.c): Decode what the demodulator has put in the
+ * queues and deliver complete frames to the subscribers. Frames held
+ * for duplicate detection are released when they have waited, or all
+ * of them if flush is true. */
+void rig_dec_init(void);
+void rig_dec_poll(bool flush);
+
+
+/* WAV files (rig_wav.c). rig_wav_write writes 16 bit mono PCM. It
+ * returns false if the file could not be written. rig_wav_read reads
+ * the first channel of an 8 or 16 bit PCM file, scaled to +-1, into
+ * a buffer it allocates. It returns the number of samples, 0 if the
+ * file could not be read. rig_resample converts from rate to the
+ * rate to, into a buffer it allocates. */
+bool rig_wav_write(const char* fname, const int16_t* x, size_t n, uint32_t rate);
+size_t rig_wav_read(const char* fname, double** data, uint32_t* rate);
+size_t rig_resample(const double* in, size_t n, uint32_t rate, uint32_t to, double** out);
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * Decoder rig: hdlc_decoder.c without its threads. See rig.h.
+ */
+
+#include "hdlc_decoder.c"
+#include "afsk.h"
+#include "rig.h"
+
+
+void rig_dec_init(void)
+{
+   for (uint8_t i=0; i<AFSK_RX_VARIANTS; i++) {
+      hdlc_rx_t *rx = &decoder[i];
+      rx->id = i;
+      rx->inq = afsk_rx_queue(i);
+      rx->ones = 0;
+      rx->in_frame = false;
+   }
+   hdlc_rx_setFcsTries(GET_BYTE_PARAM(FCS_TRIES));
+}
+
+
+void rig_dec_poll(bool flush)
+{
+   rxheld_t h;
+   
+   for (uint8_t i=0; i<AFSK_RX_VARIANTS; i++) {
+      hdlc_rx_t *rx = &decoder[i];
+      while (iqGetFullI(rx->inq) >= AFSK_RX_RECSIZE) {
+         uint8_t octet = iqGet(rx->inq);
+         uint32_t conf = 0;
+         for (uint8_t j=0; j<4; j++)
+            conf |= (uint32_t) ((uint8_t) iqGet(rx->inq)) << (j*8);
+         deframe_octet(rx, octet, conf);
+      }
+   }
+   
+   /* What the deliver thread does */
+   while (held_cnt > 0 && (flush || chVTTimeElapsedSinceX(held[held_first].time) >= MS2ST(DEDUP_WAIT))) {
+      chSemWait(&held_frames);
+      h = held[held_first];
+      held_first = (held_first + 1) % DEDUP_SIZE;
+      held_cnt--;
+      rx_release(&h);
+   }
+}
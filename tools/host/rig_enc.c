@@ -0,0 +1,34 @@
+/*
+ * Encoder rig: hdlc_encoder.c without its thread. See rig.h.
+ */
+
+#include "hdlc_encoder.c"
+#include "rig.h"
+
+
+void rig_enc_init(void)
+{
+   chSemObjectInit(&tx_frames, 0);
+   for (uint8_t i=0; i<HDLC_TX_CLASSES; i++) 
+      chSemObjectInit(&txclass[i].capacity, HDLC_TXCLASS_QUEUE_SIZE);
+}
+
+
+uint16_t rig_enc_render(const uint8_t** buf, uint16_t* preamble, uint16_t* postamble)
+{
+   if (!pending) {
+      pending_cls = HDLC_TX_CLASSES;
+      pending = tx_get(&current, &pending_cls, false);
+   }
+   if (!pending)
+      return 0;
+   hdlc_encode_frames();
+   *buf = txbuf;
+   *preamble = txdelay;
+   *postamble = txtail;
+   return txbits;
+}
+
+
+bool rig_enc_pending(void)
+   { return pending; }
@@ -0,0 +1,40 @@
+/*
+ * Receiver rig: afsk_rx.c with blocks of samples fed directly to the
+ * demodulator, instead of through the ADC and the sample ring. See
+ * rig.h.
+ */
+
+#include "afsk_rx.c"
+#include "rig.h"
+
+
+void rig_rx_init(void)
+   { afsk_rx_init(); }
+
+
+void rig_rx_block(int8_t* block, size_t n)
+   { afsk_process_block(block, n); }
+
+
+/* Start over, as after a mode change, and with filters and AGC cleared */
+void rig_rx_reset(void)
+{
+   memset(bp_state, 0, sizeof(bp_state));
+   for (int i = 0; i < FIR_BANDPASS; i++) {
+      bp_agc[i].peak = 2*AGC_LEVEL;
+      bp_agc[i].gain = 1 << 8;
+   }
+   rx_reset();
+}
+
+
+void rig_rx_setMode(uint8_t m)
+{
+   mode = new_mode = m;
+   adc_set_highrate(m == MODEM_G3RUH9600);
+   rig_rx_reset();
+}
+
+
+uint16_t rig_rx_ringlen(void)
+   { return ring_len(&rxring); }
@@ -0,0 +1,53 @@
+/*
+ * Synthesiser rig: Ideal phase continuous AFSK at the receiver sample
+ * rate, for tests of the receiver that should not depend on the tone
+ * generator. The bits are walked as afsk_tx does: preamble flags from
+ * level 0, the NRZI encoded bits, and postamble flags from the level
+ * the bits end at. See rig.h.
+ */
+
+#include <math.h>
+#include "afsk.h"
+#include "rig.h"
+
+#define SAMPLES_PER_BIT (RIG_RX_RATE / 1200)
+
+
+static size_t put_bit(uint8_t level, int amp, double* phase, int8_t* out, size_t n, size_t max)
+{
+   double inc = 2 * M_PI * (level ? AFSK_SPACE : AFSK_MARK) / RIG_RX_RATE;
+   for (int i=0; i<SAMPLES_PER_BIT && n < max; i++) {
+      out[n++] = (int8_t) lrint(amp * sin(*phase));
+      *phase = fmod(*phase + inc, 2 * M_PI);
+   }
+   return n;
+}
+
+
+static size_t put_byte(uint8_t bits, uint8_t nbits, int amp, double* phase, int8_t* out, size_t n, size_t max)
+{
+   for (uint8_t i=0; i<nbits; i++, bits >>= 1)
+      n = put_bit(bits & 1, amp, phase, out, n, max);
+   return n;
+}
+
+
+size_t rig_synth(const uint8_t* buf, uint16_t nbits, uint16_t preamble, uint16_t postamble,
+                 int amp, int8_t* out, size_t max)
+{
+   double phase = 0;
+   size_t n = 0;
+   uint8_t level = 0;
+
+   while (preamble-- > 0)
+      n = put_byte(0x7F, 8, amp, &phase, out, n, max);
+   for (uint16_t i=0; i<nbits; i += 8) {
+      uint8_t k = (nbits - i < 8 ? nbits - i : 8);
+      n = put_byte(buf[i >> 3], k, amp, &phase, out, n, max);
+      level = (buf[i >> 3] >> (k - 1)) & 1;
+   }
+   /* A flag has two zeros, the level after it is the level before it */
+   while (postamble-- > 0)
+      n = put_byte(level ? 0x80 : 0x7F, 8, amp, &phase, out, n, max);
+   return n;
+}
@@ -0,0 +1,100 @@
+/*
+ * Transmitter rig: afsk_tx.c and tone.c with the bit clock and the
+ * DAC emulated. See rig.h.
+ *
+ * The DAC steps through its 16 word buffer at RIG_TX_RATE. When the
+ * read pointer reaches the watermark (4 words before the end) or wraps
+ * to the top, it sets a flag in DAC0_SR and the interrupt handler in
+ * tone.c refills the half not being read.
+ *
+ * In G3RUH mode, the timer interrupt writes the DAC directly, once per
+ * tick. The transmission ends when the PTT is turned off.
+ */
+
+#include "ch.h"
+#include "hal.h"
+#include "afsk.h"
+#include "defines.h"
+#include "rig.h"
+
+#define DAC0_DAT           ((volatile uint16_t *)0x400CC000)
+#define DAC0_SR            (*(volatile uint8_t  *)0x400CC020)
+#define DAC0_C0            (*(volatile uint8_t  *)0x400CC021)
+#define DAC_SR_DACBFWMF    0x04
+#define DAC_SR_DACBFRPTF   0x02
+#define DAC_C0_DACBWIEN    0x04
+
+#define DACBUF_SIZE        16
+#define DACBUF_WATERMARK   (DACBUF_SIZE - 4)
+
+void Vector184(void);
+
+static bool ptt;
+static void (*next_hook)(int ev, void* arg);
+
+static void ptt_hook(int ev, void* arg)
+{
+   if (ev == HOST_EV_PTT_ON || ev == HOST_EV_PTT_OFF)
+      ptt = (ev == HOST_EV_PTT_ON);
+   if (next_hook != NULL)
+      next_hook(ev, arg);
+}
+
+
+size_t rig_tx_audio(const uint8_t* buf, uint16_t nbits, uint16_t preamble, uint16_t postamble,
+                    uint16_t* out, size_t max)
+{
+   size_t n = 0;
+   uint8_t rp = 0;
+
+   afsk_tx_send(buf, nbits, preamble, postamble, false);
+
+   /* First bit clock interrupt keys the transmitter and starts the tone */
+   host_gpt_tick(&AFSK_TX_GPT);
+
+   while ((DAC0_C0 & DAC_C0_DACBWIEN) && n < max) {
+      out[n++] = DAC0_DAT[rp++];
+      if (rp == DACBUF_WATERMARK) {
+         DAC0_SR |= DAC_SR_DACBFWMF;
+         Vector184();
+      }
+      else if (rp == DACBUF_SIZE) {
+         rp = 0;
+         DAC0_SR |= DAC_SR_DACBFRPTF;
+         Vector184();
+      }
+   }
+   /* If out is full, let the transmission end */
+   while (DAC0_C0 & DAC_C0_DACBWIEN) {
+      DAC0_SR |= DAC_SR_DACBFRPTF;
+      Vector184();
+   }
+   afsk_tx_wait();
+   afsk_tx_stop();
+   return n;
+}
+
+
+size_t rig_tx_g3ruh(const uint8_t* buf, uint16_t nbits, uint16_t preamble, uint16_t postamble,
+                    uint16_t* out, size_t max)
+{
+   size_t n = 0;
+
+   next_hook = host_event_hook;
+   host_event_hook = ptt_hook;
+   afsk_tx_send(buf, nbits, preamble, postamble, false);
+
+   /* First tick keys the transmitter and writes the first sample */
+   ptt = false;
+   host_gpt_tick(&AFSK_TX_GPT);
+   while (ptt && n < max) {
+      out[n++] = DAC0_DAT[0];
+      host_gpt_tick(&AFSK_TX_GPT);
+   }
+   while (ptt)
+      host_gpt_tick(&AFSK_TX_GPT);
+   afsk_tx_wait();
+   afsk_tx_stop();
+   host_event_hook = next_hook;
+   return n;
+}
@@ -0,0 +1,105 @@
+/*
+ * WAV files (rig_wav.c): Writing 16 bit mono, reading 8 or 16 bit PCM,
+ * and resampling. See rig.h.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rig.h"
+
+
+static void put32(FILE* f, uint32_t x)
+   { fputc(x, f); fputc(x >> 8, f); fputc(x >> 16, f); fputc(x >> 24, f); }
+
+static void put16(FILE* f, uint16_t x)
+   { fputc(x, f); fputc(x >> 8, f); }
+
+
+bool rig_wav_write(const char* fname, const int16_t* x, size_t n, uint32_t rate)
+{
+   FILE* f = fopen(fname, "wb");
+   if (f == NULL)
+      return false;
+   fwrite("RIFF", 1, 4, f); put32(f, 36 + n * 2);
+   fwrite("WAVEfmt ", 1, 8, f); put32(f, 16);
+   put16(f, 1); put16(f, 1); put32(f, rate); put32(f, rate * 2);
+   put16(f, 2); put16(f, 16);
+   fwrite("data", 1, 4, f); put32(f, n * 2);
+   for (size_t i=0; i<n; i++)
+      put16(f, (uint16_t) x[i]);
+   return fclose(f) == 0;
+}
+
+
+size_t rig_wav_read(const char* fname, double** data, uint32_t* rate)
+{
+   FILE* f = fopen(fname, "rb");
+   uint8_t hdr[12], ch[8], fmt[16];
+   uint16_t channels = 0, bits = 0;
+   size_t n = 0;
+
+   if (f == NULL || fread(hdr, 1, 12, f) != 12 || memcmp(hdr, "RIFF", 4) || memcmp(hdr+8, "WAVE", 4)) {
+      fprintf(stderr, "%s: Not a WAV file\n", fname);
+      if (f != NULL)
+         fclose(f);
+      return 0;
+   }
+   while (fread(ch, 1, 8, f) == 8) {
+      uint32_t size = ch[4] | ch[5] << 8 | ch[6] << 16 | (uint32_t) ch[7] << 24;
+      if (memcmp(ch, "fmt ", 4) == 0 && size >= 16) {
+         if (fread(fmt, 1, 16, f) != 16)
+            break;
+         fseek(f, size - 16 + (size & 1), SEEK_CUR);
+         channels = fmt[2] | fmt[3] << 8;
+         *rate = fmt[4] | fmt[5] << 8 | fmt[6] << 16 | (uint32_t) fmt[7] << 24;
+         bits = fmt[14] | fmt[15] << 8;
+         if ((fmt[0] | fmt[1] << 8) != 1 || (bits != 8 && bits != 16) || channels == 0) {
+            fprintf(stderr, "%s: Only 8 or 16 bit PCM is supported\n", fname);
+            break;
+         }
+      }
+      else if (memcmp(ch, "data", 4) == 0 && channels > 0) {
+         size_t frame = channels * bits / 8;
+         uint8_t* raw = malloc(size);
+         size = fread(raw, 1, size, f);
+         *data = malloc((size / frame + 1) * sizeof(double));
+         for (size_t i=0; i + frame <= size; i += frame)
+            (*data)[n++] = (bits == 8 ? (raw[i] - 128) / 128.0
+                                      : (int16_t) (raw[i] | raw[i+1] << 8) / 32768.0);
+         free(raw);
+         break;
+      }
+      else
+         fseek(f, size + (size & 1), SEEK_CUR);
+   }
+   fclose(f);
+   return n;
+}
+
+
+/* Windowed sinc, low pass below both Nyquist rates */
+size_t rig_resample(const double* in, size_t n, uint32_t rate, uint32_t to, double** out)
+{
+   double ratio = (double) rate / to;
+   double fc = 0.45 / (ratio > 1 ? ratio : 1);
+   int half = (int) (16 * (ratio > 1 ? ratio : 1));
+   size_t m = (size_t) (n / ratio);
+
+   *out = malloc((m + 1) * sizeof(double));
+   for (size_t i=0; i<m; i++) {
+      double t = i * ratio, y = 0;
+      long c = (long) t;
+      for (long k = c - half + 1; k <= c + half; k++) {
+         if (k < 0 || k >= (long) n)
+            continue;
+         double d = t - k;
+         double s = (d == 0 ? 2 * fc : sin(2 * M_PI * fc * d) / (M_PI * d));
+         double w = 0.5 + 0.5 * cos(M_PI * d / half);
+         y += in[k] * s * w;
+      }
+      (*out)[i] = y;
+   }
+   return m;
+}
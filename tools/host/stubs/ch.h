@@ -0,0 +1,171 @@
+/*
+ * Host (Linux) stand-in for the ChibiOS/RT kernel API used by the
+ * firmware. Threads are POSIX threads. The system lock is one global
+ * mutex, semaphores and queues wait on a global condition variable
+ * under that lock. Time is the monotonic clock in system ticks.
+ *
+ * Only what the modem, HDLC and FBUF code needs is provided. See
+ * chstub.c.
+ */
+
+#ifndef _HOST_CH_H_
+#define _HOST_CH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "chconf.h"
+
+#define TRUE  1
+#define FALSE 0
+
+typedef int32_t  msg_t;
+typedef uint32_t systime_t;
+typedef uint32_t tprio_t;
+typedef int32_t  cnt_t;
+typedef uint32_t syssts_t;
+
+#define MSG_OK        0
+#define MSG_TIMEOUT  -1
+#define MSG_RESET    -2
+
+#define TIME_IMMEDIATE ((systime_t) 0)
+#define TIME_INFINITE  ((systime_t) -1)
+
+#define NORMALPRIO 128
+#define HIGHPRIO   255
+#define LOWPRIO      2
+
+#define S2ST(sec)   ((systime_t) ((uint32_t) (sec) * (uint32_t) CH_CFG_ST_FREQUENCY))
+#define MS2ST(msec) ((systime_t) ((((uint32_t) (msec)) * ((uint32_t) CH_CFG_ST_FREQUENCY) + 999UL) / 1000UL))
+#define US2ST(usec) ((systime_t) ((((uint32_t) (usec)) * ((uint32_t) CH_CFG_ST_FREQUENCY) + 999999UL) / 1000000UL))
+#define ST2MS(n)    (((uint32_t) (n) * 1000UL + CH_CFG_ST_FREQUENCY - 1UL) / CH_CFG_ST_FREQUENCY)
+
+
+/* Threads */
+typedef struct thread {
+   pthread_t pt;
+   const char* name;
+   tprio_t prio;
+   bool terminate;
+} thread_t;
+
+#define THD_WORKING_AREA(s, n)      uint8_t s[(n)]
+#define THD_WORKING_AREA_SIZE(n)    (n)
+#define THD_FUNCTION(tname, arg)    void tname(void *arg)
+
+thread_t* chThdCreateStatic(void* wa, size_t size, tprio_t prio, void (*fn)(void*), void* arg);
+thread_t* chThdCreateFromHeap(void* heap, size_t size, const char* name, tprio_t prio, void (*fn)(void*), void* arg);
+msg_t     chThdWait(thread_t* tp);
+void      chThdRelease(thread_t* tp);
+void      chThdTerminate(thread_t* tp);
+bool      chThdShouldTerminateX(void);
+thread_t* chThdGetSelfX(void);
+tprio_t   chThdSetPriority(tprio_t prio);
+void      chThdSleep(systime_t time);
+void      chThdSleepMilliseconds(uint32_t ms);
+void      chThdSleepUntil(systime_t time);
+void      chThdYield(void);
+void      chThdExit(msg_t msg);
+void      chRegSetThreadName(const char* name);
+
+
+/* System lock. Interrupt handlers run in the calling thread on the host */
+void chSysLock(void);
+void chSysUnlock(void);
+#define chSysLockFromISR()    chSysLock()
+#define chSysUnlockFromISR()  chSysUnlock()
+void chSchRescheduleS(void);
+syssts_t chSysGetStatusAndLockX(void);
+void chSysRestoreStatusX(syssts_t sts);
+void chSysHalt(const char* reason);
+
+
+/* Semaphores */
+typedef struct {
+   cnt_t cnt;
+} semaphore_t;
+
+typedef struct {
+   semaphore_t sem;
+} binary_semaphore_t;
+
+#define _SEMAPHORE_DATA(name, n)    {(n)}
+#define SEMAPHORE_DECL(name, n)     semaphore_t name = _SEMAPHORE_DATA(name, n)
+#define _BSEMAPHORE_DATA(name, taken) {_SEMAPHORE_DATA(name.sem, ((taken) ? 0 : 1))}
+#define BSEMAPHORE_DECL(name, taken) binary_semaphore_t name = _BSEMAPHORE_DATA(name, taken)
+
+void  chSemObjectInit(semaphore_t* sp, cnt_t n);
+msg_t chSemWait(semaphore_t* sp);
+msg_t chSemWaitS(semaphore_t* sp);
+msg_t chSemWaitTimeout(semaphore_t* sp, systime_t time);
+msg_t chSemWaitTimeoutS(semaphore_t* sp, systime_t time);
+void  chSemSignal(semaphore_t* sp);
+void  chSemSignalI(semaphore_t* sp);
+void  chSemReset(semaphore_t* sp, cnt_t n);
+void  chSemResetI(semaphore_t* sp, cnt_t n);
+void  chSemFastWaitI(semaphore_t* sp);
+#define chSemGetCounterI(sp)  ((sp)->cnt)
+
+void  chBSemObjectInit(binary_semaphore_t* bsp, bool taken);
+msg_t chBSemWait(binary_semaphore_t* bsp);
+msg_t chBSemWaitTimeout(binary_semaphore_t* bsp, systime_t time);
+void  chBSemSignal(binary_semaphore_t* bsp);
+void  chBSemSignalI(binary_semaphore_t* bsp);
+void  chBSemReset(binary_semaphore_t* bsp, bool taken);
+void  chBSemResetI(binary_semaphore_t* bsp, bool taken);
+
+
+/* Mutexes and condition variables */
+typedef struct mutex {
+   pthread_mutex_t pm;
+} mutex_t;
+
+typedef struct {
+   pthread_cond_t pc;
+} condition_variable_t;
+
+#define _MUTEX_DATA(name)     {PTHREAD_MUTEX_INITIALIZER}
+#define MUTEX_DECL(name)      mutex_t name = _MUTEX_DATA(name)
+#define _CONDVAR_DATA(name)   {PTHREAD_COND_INITIALIZER}
+#define CONDVAR_DECL(name)    condition_variable_t name = _CONDVAR_DATA(name)
+
+void  chMtxObjectInit(mutex_t* mp);
+void  chMtxLock(mutex_t* mp);
+bool  chMtxTryLock(mutex_t* mp);
+void  chMtxUnlock(mutex_t* mp);
+void  chCondObjectInit(condition_variable_t* cp);
+msg_t chCondWait(condition_variable_t* cp);
+msg_t chCondWaitTimeout(condition_variable_t* cp, systime_t time);
+void  chCondSignal(condition_variable_t* cp);
+void  chCondBroadcast(condition_variable_t* cp);
+
+
+/* System time */
+systime_t chVTGetSystemTimeX(void);
+#define chVTGetSystemTime()          chVTGetSystemTimeX()
+#define chVTTimeElapsedSinceX(start) ((systime_t) (chVTGetSystemTimeX() - (start)))
+#define chVTIsSystemTimeWithinX(start, end) \
+   ((systime_t) (chVTGetSystemTimeX() - (start)) < (systime_t) ((end) - (start)))
+
+/* Virtual timers do not run on the host. The callback is recorded,
+ * and a test calls it itself. */
+typedef void (*vtfunc_t)(void* p);
+typedef struct {
+   vtfunc_t func;
+   void* par;
+   systime_t delay;
+} virtual_timer_t;
+
+void chVTObjectInit(virtual_timer_t* vtp);
+void chVTSet(virtual_timer_t* vtp, systime_t delay, vtfunc_t vtfunc, void* par);
+void chVTReset(virtual_timer_t* vtp);
+#define chVTSetI(vtp, d, f, p)  chVTSet(vtp, d, f, p)
+#define chVTResetI(vtp)         chVTReset(vtp)
+
+
+#define chDbgAssert(c, r)  do { if (!(c)) chSysHalt(r); } while (0)
+#define chDbgCheck(c)      chDbgAssert((c), __func__)
+
+#endif
@@ -0,0 +1,11 @@
+/* Host stand-in for chprintf.h. The shell is not built for the host */
+
+#ifndef _HOST_CHPRINTF_H_
+#define _HOST_CHPRINTF_H_
+
+#include "hal.h"
+
+int chprintf(BaseSequentialStream* chp, const char* fmt, ...);
+int chsnprintf(char* str, size_t size, const char* fmt, ...);
+
+#endif
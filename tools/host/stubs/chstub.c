@@ -0,0 +1,572 @@
+/*
+ * Host (Linux) implementation of the ChibiOS/RT subset in ch.h and of
+ * the HAL stand-ins in hal.h.
+ *
+ * The system lock is a recursive mutex, so that chSysGetStatusAndLockX
+ * works from code that may or may not hold it. Everything that waits
+ * (semaphores, queues) waits on one condition variable under that lock
+ * and is woken by a broadcast when anything is signalled.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "ch.h"
+#include "hal.h"
+
+
+static pthread_mutex_t sys_lock;
+static pthread_cond_t sys_cond = PTHREAD_COND_INITIALIZER;
+static __thread int sys_depth = 0;
+static __thread thread_t* self = NULL;
+static __thread mutex_t* owned[8];      // Mutexes held by this thread, last on top
+static __thread int nowned = 0;
+
+
+
+/*********************************************************************
+ * Peripheral register window. The firmware writes the Kinetis
+ * registers at their real addresses (DAC, PDB, SIM, CRC ...). Plain
+ * memory is mapped there, so those writes land somewhere the tests
+ * can look at them.
+ *********************************************************************/
+
+#define PERIPH_BASE 0x40000000UL
+#define PERIPH_SIZE 0x00100000UL
+
+__attribute__((constructor))
+static void host_init(void)
+{
+   pthread_mutexattr_t a;
+   pthread_mutexattr_init(&a);
+   pthread_mutexattr_settype(&a, PTHREAD_MUTEX_RECURSIVE);
+   pthread_mutex_init(&sys_lock, &a);
+
+   void* p = mmap((void*) PERIPH_BASE, PERIPH_SIZE, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+   if (p != (void*) PERIPH_BASE) {
+      fprintf(stderr, "Cannot map peripheral register window at 0x%lx\n", PERIPH_BASE);
+      exit(2);
+   }
+}
+
+
+void chSysHalt(const char* reason)
+{
+   fprintf(stderr, "chSysHalt: %s\n", reason);
+   abort();
+}
+
+
+
+/*********************************************************************
+ * System lock
+ *********************************************************************/
+
+void chSysLock(void)
+{
+   pthread_mutex_lock(&sys_lock);
+   sys_depth++;
+}
+
+void chSysUnlock(void)
+{
+   sys_depth--;
+   pthread_mutex_unlock(&sys_lock);
+}
+
+void chSchRescheduleS(void)
+   { }
+
+syssts_t chSysGetStatusAndLockX(void)
+{
+   if (sys_depth > 0)
+      return 0;
+   chSysLock();
+   return 1;
+}
+
+void chSysRestoreStatusX(syssts_t sts)
+{
+   if (sts)
+      chSysUnlock();
+}
+
+
+static void wake_all(void)
+   { pthread_cond_broadcast(&sys_cond); }
+
+
+/* Wait for a wakeup under the system lock, until the deadline if not NULL */
+static bool sys_wait(const struct timespec* deadline)
+{
+   int d = sys_depth;
+   int rc;
+   sys_depth = 0;
+   if (deadline == NULL)
+      rc = pthread_cond_wait(&sys_cond, &sys_lock);
+   else
+      rc = pthread_cond_timedwait(&sys_cond, &sys_lock, deadline);
+   sys_depth = d;
+   return rc != ETIMEDOUT;
+}
+
+
+static void deadline_after(struct timespec* ts, systime_t time)
+{
+   uint64_t ns = (uint64_t) time * 1000000000ULL / CH_CFG_ST_FREQUENCY;
+   clock_gettime(CLOCK_REALTIME, ts);
+   ts->tv_sec += ns / 1000000000ULL;
+   ts->tv_nsec += ns % 1000000000ULL;
+   if (ts->tv_nsec >= 1000000000L) {
+      ts->tv_sec++;
+      ts->tv_nsec -= 1000000000L;
+   }
+}
+
+
+
+/*********************************************************************
+ * Time
+ *********************************************************************/
+
+/* Added to the system time by host_time_advance, for simulations.
+ * After host_time_stop, it is all of the system time. */
+static volatile systime_t time_offset = 0;
+static volatile bool time_stopped = false;
+
+systime_t chVTGetSystemTimeX(void)
+{
+   struct timespec ts;
+   if (time_stopped)
+      return time_offset;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (systime_t) ((uint64_t) ts.tv_sec * CH_CFG_ST_FREQUENCY
+                       + (uint64_t) ts.tv_nsec * CH_CFG_ST_FREQUENCY / 1000000000ULL)
+          + time_offset;
+}
+
+void host_time_advance(systime_t time)
+   { time_offset += time; }
+
+void host_time_stop(void)
+{
+   time_offset = chVTGetSystemTimeX();
+   time_stopped = true;
+}
+
+
+void chVTObjectInit(virtual_timer_t* vtp)
+   { memset(vtp, 0, sizeof(virtual_timer_t)); }
+
+void chVTSet(virtual_timer_t* vtp, systime_t delay, vtfunc_t vtfunc, void* par)
+{
+   vtp->func = vtfunc;
+   vtp->par = par;
+   vtp->delay = delay;
+}
+
+void chVTReset(virtual_timer_t* vtp)
+   { vtp->func = NULL; }
+
+
+void chThdSleep(systime_t time)
+{
+   struct timespec ts;
+   uint64_t ns = (uint64_t) time * 1000000000ULL / CH_CFG_ST_FREQUENCY;
+   ts.tv_sec = ns / 1000000000ULL;
+   ts.tv_nsec = ns % 1000000000ULL;
+   while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+      ;
+}
+
+void chThdSleepMilliseconds(uint32_t ms)
+   { chThdSleep(MS2ST(ms)); }
+
+void chThdSleepUntil(systime_t time)
+{
+   systime_t d = time - chVTGetSystemTimeX();
+   if (d > 0 && d < (systime_t) 0x80000000)
+      chThdSleep(d);
+}
+
+void chThdYield(void)
+   { sched_yield(); }
+
+
+
+/*********************************************************************
+ * Threads
+ *********************************************************************/
+
+typedef struct {
+   thread_t* tp;
+   void (*fn)(void*);
+   void* arg;
+} start_t;
+
+static void* thread_start(void* p)
+{
+   start_t s = *(start_t*) p;
+   free(p);
+   self = s.tp;
+   s.fn(s.arg);
+   return NULL;
+}
+
+
+thread_t* chThdCreateFromHeap(void* heap, size_t size, const char* name, tprio_t prio, void (*fn)(void*), void* arg)
+{
+   (void) heap; (void) size;
+   thread_t* tp = calloc(1, sizeof(thread_t));
+   start_t* s = malloc(sizeof(start_t));
+   tp->name = name;
+   tp->prio = prio;
+   s->tp = tp; s->fn = fn; s->arg = arg;
+   if (pthread_create(&tp->pt, NULL, thread_start, s) != 0)
+      chSysHalt("pthread_create");
+   return tp;
+}
+
+thread_t* chThdCreateStatic(void* wa, size_t size, tprio_t prio, void (*fn)(void*), void* arg)
+   { return chThdCreateFromHeap(wa, size, "-", prio, fn, arg); }
+
+msg_t chThdWait(thread_t* tp)
+{
+   pthread_join(tp->pt, NULL);
+   free(tp);
+   return MSG_OK;
+}
+
+void chThdRelease(thread_t* tp)
+{
+   pthread_detach(tp->pt);
+   free(tp);
+}
+
+void chThdTerminate(thread_t* tp)
+   { tp->terminate = true; }
+
+bool chThdShouldTerminateX(void)
+   { return self != NULL && self->terminate; }
+
+thread_t* chThdGetSelfX(void)
+   { return self; }
+
+tprio_t chThdSetPriority(tprio_t prio)
+{
+   tprio_t old = (self ? self->prio : NORMALPRIO);
+   if (self)
+      self->prio = prio;
+   return old;
+}
+
+void chThdExit(msg_t msg)
+{
+   (void) msg;
+   pthread_exit(NULL);
+}
+
+void chRegSetThreadName(const char* name)
+{
+   if (self)
+      self->name = name;
+}
+
+
+
+/*********************************************************************
+ * Semaphores
+ *********************************************************************/
+
+void chSemObjectInit(semaphore_t* sp, cnt_t n)
+   { sp->cnt = n; }
+
+msg_t chSemWaitTimeoutS(semaphore_t* sp, systime_t time)
+{
+   struct timespec dl;
+   if (sp->cnt > 0) {
+      sp->cnt--;
+      return MSG_OK;
+   }
+   if (time == TIME_IMMEDIATE)
+      return MSG_TIMEOUT;
+   if (time != TIME_INFINITE)
+      deadline_after(&dl, time);
+   while (sp->cnt <= 0)
+      if (!sys_wait(time == TIME_INFINITE ? NULL : &dl))
+         return MSG_TIMEOUT;
+   sp->cnt--;
+   return MSG_OK;
+}
+
+msg_t chSemWaitS(semaphore_t* sp)
+   { return chSemWaitTimeoutS(sp, TIME_INFINITE); }
+
+msg_t chSemWaitTimeout(semaphore_t* sp, systime_t time)
+{
+   chSysLock();
+   msg_t m = chSemWaitTimeoutS(sp, time);
+   chSysUnlock();
+   return m;
+}
+
+msg_t chSemWait(semaphore_t* sp)
+   { return chSemWaitTimeout(sp, TIME_INFINITE); }
+
+void chSemSignalI(semaphore_t* sp)
+{
+   sp->cnt++;
+   wake_all();
+}
+
+void chSemSignal(semaphore_t* sp)
+{
+   chSysLock();
+   chSemSignalI(sp);
+   chSysUnlock();
+}
+
+void chSemResetI(semaphore_t* sp, cnt_t n)
+{
+   sp->cnt = n;
+   wake_all();
+}
+
+void chSemReset(semaphore_t* sp, cnt_t n)
+{
+   chSysLock();
+   chSemResetI(sp, n);
+   chSysUnlock();
+}
+
+void chSemFastWaitI(semaphore_t* sp)
+   { sp->cnt--; }
+
+
+void chBSemObjectInit(binary_semaphore_t* bsp, bool taken)
+   { bsp->sem.cnt = (taken ? 0 : 1); }
+
+msg_t chBSemWaitTimeout(binary_semaphore_t* bsp, systime_t time)
+   { return chSemWaitTimeout(&bsp->sem, time); }
+
+msg_t chBSemWait(binary_semaphore_t* bsp)
+   { return chSemWait(&bsp->sem); }
+
+void chBSemSignalI(binary_semaphore_t* bsp)
+{
+   if (bsp->sem.cnt < 1)
+      chSemSignalI(&bsp->sem);
+}
+
+void chBSemSignal(binary_semaphore_t* bsp)
+{
+   chSysLock();
+   chBSemSignalI(bsp);
+   chSysUnlock();
+}
+
+void chBSemResetI(binary_semaphore_t* bsp, bool taken)
+   { chSemResetI(&bsp->sem, taken ? 0 : 1); }
+
+void chBSemReset(binary_semaphore_t* bsp, bool taken)
+   { chSemReset(&bsp->sem, taken ? 0 : 1); }
+
+
+
+/*********************************************************************
+ * Mutexes and condition variables. chCondWait releases the mutex
+ * last locked by the thread, as in ChibiOS.
+ *********************************************************************/
+
+void chMtxObjectInit(mutex_t* mp)
+   { pthread_mutex_init(&mp->pm, NULL); }
+
+void chMtxLock(mutex_t* mp)
+{
+   pthread_mutex_lock(&mp->pm);
+   owned[nowned++] = mp;
+}
+
+bool chMtxTryLock(mutex_t* mp)
+{
+   if (pthread_mutex_trylock(&mp->pm) != 0)
+      return false;
+   owned[nowned++] = mp;
+   return true;
+}
+
+void chMtxUnlock(mutex_t* mp)
+{
+   chDbgAssert(nowned > 0 && owned[nowned-1] == mp, "mutex not owned or not last locked");
+   nowned--;
+   pthread_mutex_unlock(&mp->pm);
+}
+
+void chCondObjectInit(condition_variable_t* cp)
+   { pthread_cond_init(&cp->pc, NULL); }
+
+msg_t chCondWaitTimeout(condition_variable_t* cp, systime_t time)
+{
+   struct timespec dl;
+   chDbgAssert(nowned > 0, "no mutex held");
+   mutex_t* mp = owned[nowned-1];
+   if (time == TIME_INFINITE)
+      pthread_cond_wait(&cp->pc, &mp->pm);
+   else {
+      deadline_after(&dl, time);
+      if (pthread_cond_timedwait(&cp->pc, &mp->pm, &dl) == ETIMEDOUT)
+         return MSG_TIMEOUT;
+   }
+   return MSG_OK;
+}
+
+msg_t chCondWait(condition_variable_t* cp)
+   { return chCondWaitTimeout(cp, TIME_INFINITE); }
+
+void chCondSignal(condition_variable_t* cp)
+   { pthread_cond_signal(&cp->pc); }
+
+void chCondBroadcast(condition_variable_t* cp)
+   { pthread_cond_broadcast(&cp->pc); }
+
+
+
+/*********************************************************************
+ * Input queues
+ *********************************************************************/
+
+void iqObjectInit(input_queue_t* iqp, uint8_t* bp, size_t size, qnotify_t infy, void* link)
+{
+   iqp->q_buffer = iqp->q_rdptr = iqp->q_wrptr = bp;
+   iqp->q_top = bp + size;
+   iqp->q_counter = 0;
+   iqp->q_notify = infy;
+   iqp->q_link = link;
+}
+
+msg_t iqPutI(input_queue_t* iqp, uint8_t b)
+{
+   if (iqIsFullI(iqp))
+      return MSG_TIMEOUT;
+   iqp->q_counter++;
+   *iqp->q_wrptr++ = b;
+   if (iqp->q_wrptr >= iqp->q_top)
+      iqp->q_wrptr = iqp->q_buffer;
+   wake_all();
+   return MSG_OK;
+}
+
+msg_t iqGetTimeout(input_queue_t* iqp, systime_t time)
+{
+   struct timespec dl;
+   uint8_t b;
+   chSysLock();
+   if (time != TIME_INFINITE && time != TIME_IMMEDIATE)
+      deadline_after(&dl, time);
+   while (iqp->q_counter == 0) {
+      if (time == TIME_IMMEDIATE || !sys_wait(time == TIME_INFINITE ? NULL : &dl)) {
+         chSysUnlock();
+         return MSG_TIMEOUT;
+      }
+   }
+   iqp->q_counter--;
+   b = *iqp->q_rdptr++;
+   if (iqp->q_rdptr >= iqp->q_top)
+      iqp->q_rdptr = iqp->q_buffer;
+   chSysUnlock();
+   return b;
+}
+
+msg_t iqGet(input_queue_t* iqp)
+   { return iqGetTimeout(iqp, TIME_INFINITE); }
+
+void iqResetI(input_queue_t* iqp)
+{
+   iqp->q_rdptr = iqp->q_wrptr = iqp->q_buffer;
+   iqp->q_counter = 0;
+}
+
+
+
+/*********************************************************************
+ * GPT: Timers do not run by themselves. A test fires the callback
+ * with host_gpt_tick, as the timer interrupt would.
+ *********************************************************************/
+
+GPTDriver GPTD1, GPTD2, GPTD3, GPTD4;
+
+void gptStart(GPTDriver* gptp, const GPTConfig* config)
+{
+   gptp->config = config;
+   gptp->state = GPT_READY;
+   host_event(HOST_EV_GPT_START, gptp);
+}
+
+void gptStop(GPTDriver* gptp)
+{
+   gptp->state = GPT_STOP;
+   host_event(HOST_EV_GPT_STOP, gptp);
+}
+
+void gptStartContinuous(GPTDriver* gptp, gptcnt_t interval)
+{
+   (void) interval;
+   gptp->state = GPT_CONTINUOUS;
+   host_event(HOST_EV_GPT_RUN, gptp);
+}
+
+void gptStopTimer(GPTDriver* gptp)
+{
+   if (gptp->state == GPT_CONTINUOUS)
+      gptp->state = GPT_READY;
+   host_event(HOST_EV_GPT_HALT, gptp);
+}
+
+bool host_gpt_tick(GPTDriver* gptp)
+{
+   if (gptp->state != GPT_CONTINUOUS || gptp->config->callback == NULL)
+      return false;
+   gptp->config->callback(gptp);
+   return true;
+}
+
+
+CoreDebug_Type host_coredebug;
+
+
+void nvicEnableVector(uint32_t n, uint32_t prio)
+{
+   (void) prio;
+   host_event(HOST_EV_IRQ_ON, (void*) (uintptr_t) n);
+}
+
+void nvicDisableVector(uint32_t n)
+   { host_event(HOST_EV_IRQ_OFF, (void*) (uintptr_t) n); }
+
+
+void palSetPad(int port, int pad)    { (void) port; (void) pad; }
+void palClearPad(int port, int pad)  { (void) port; (void) pad; }
+void palTogglePad(int port, int pad) { (void) port; (void) pad; }
+void palSetPadMode(int port, int pad, int mode) { (void) port; (void) pad; (void) mode; }
+int  palReadPad(int port, int pad)   { (void) port; (void) pad; return 0; }
+
+
+
+/*********************************************************************
+ * Event hook. Tests that check the order of things (PTT, timers,
+ * DAC interrupt) set it.
+ *********************************************************************/
+
+static void no_event(int ev, void* arg)
+   { (void) ev; (void) arg; }
+
+void (*host_event_hook)(int ev, void* arg) = no_event;
+
+void host_event(int ev, void* arg)
+   { host_event_hook(ev, arg); }
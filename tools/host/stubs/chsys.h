@@ -0,0 +1,2 @@
+/* Host stand-in for chsys.h, see ch.h */
+#include "ch.h"
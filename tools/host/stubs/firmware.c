@@ -0,0 +1,96 @@
+/*
+ * Host stand-ins for the parts of the firmware the modem, HDLC and
+ * FBUF code call, but that are not built for the host: radio, ADC,
+ * CSMA, EEPROM and the shell output.
+ */
+
+#include <string.h>
+#include "ch.h"
+#include "hal.h"
+#include "util/eeprom.h"
+
+
+/* Radio. PTT changes are passed to the test event hook */
+void radio_PTT(bool on)
+   { host_event(on ? HOST_EV_PTT_ON : HOST_EV_PTT_OFF, NULL); }
+
+void radio_dcd(bool on)
+   { (void) on; }
+
+
+/* ADC. The tests feed samples themselves */
+bool host_adc_sampling = false;
+bool host_adc_highrate = false;
+
+void adc_start_sampling(void)  { host_adc_sampling = true; }
+void adc_stop_sampling(void)   { host_adc_sampling = false; }
+void adc_set_highrate(bool hi) { host_adc_highrate = hi; }
+
+
+/* The channel is always free */
+void csma_wait(void)
+   { }
+
+
+/* EEPROM in RAM, erased. Settings read their defaults until set */
+static uint8_t eeprom[2048];
+static bool eeprom_erased = false;
+
+static uint8_t* ee(const void* addr)
+{
+   if (!eeprom_erased) {
+      memset(eeprom, 0xff, sizeof(eeprom));
+      eeprom_erased = true;
+   }
+   return &eeprom[(uintptr_t) addr % sizeof(eeprom)];
+}
+
+int eeprom_is_ready(void)
+   { return 1; }
+
+uint8_t eeprom_read_byte(const uint16_t* addr)
+   { return *ee(addr); }
+
+void eeprom_write_byte(uint16_t* addr, uint8_t value)
+   { *ee(addr) = value; }
+
+void eeprom_read_block(void* buf, const void* addr, uint32_t len)
+   { memcpy(buf, ee(addr), len); }
+
+void eeprom_write_block(const void* buf, void* addr, uint32_t len)
+   { memcpy(ee(addr), buf, len); }
+
+
+/* Shell output is dropped, except to a host_stream_t */
+static const int host_stream_vmt;
+
+void host_stream_init(host_stream_t* st, uint8_t* buf, size_t size)
+{
+   st->s.vmt = &host_stream_vmt;
+   st->buf = buf;
+   st->size = size;
+   st->len = 0;
+   st->calls = 0;
+}
+
+msg_t streamPut(void* ip, uint8_t b)
+   { return (streamWrite(ip, &b, 1) == 1 ? MSG_OK : MSG_RESET); }
+
+msg_t streamGet(void* ip)
+   { (void) ip; return MSG_TIMEOUT; }
+
+size_t streamWrite(void* ip, const uint8_t* bp, size_t n)
+{
+   host_stream_t* st = ip;
+   if (st == NULL || st->s.vmt != &host_stream_vmt)
+      return n;
+   st->calls++;
+   if (n > st->size - st->len)
+      n = st->size - st->len;
+   memcpy(st->buf + st->len, bp, n);
+   st->len += n;
+   return n;
+}
+
+int chprintf(BaseSequentialStream* chp, const char* fmt, ...)
+   { (void) chp; (void) fmt; return 0; }
@@ -0,0 +1,227 @@
+/*
+ * Host (Linux) stand-in for the ChibiOS HAL subset used by the modem,
+ * HDLC and FBUF code: I/O queues, GPT, pins, NVIC and the CMSIS
+ * intrinsics. Peripheral registers are real memory on the host, see
+ * chstub.c.
+ */
+
+#ifndef _HOST_HAL_H_
+#define _HOST_HAL_H_
+
+#include <time.h>
+#include "ch.h"
+
+#define KINETIS_SYSCLK_FREQUENCY  72000000
+#define KINETIS_BUSCLK_FREQUENCY  36000000
+#define KINETIS_DAC0_IRQ_PRIORITY 5
+
+
+/* Streams (shell output). Output is dropped, except to a host_stream_t */
+typedef struct BaseSequentialStream BaseSequentialStream;
+struct BaseSequentialStream { const void* vmt; };
+typedef struct { const void* vmt; } BaseChannel;
+typedef struct { BaseSequentialStream s; } SerialDriver;
+typedef struct { BaseSequentialStream s; } SerialUSBDriver;
+typedef struct { int x; } EXTDriver;
+typedef uint32_t expchannel_t;
+
+msg_t  streamPut(void* ip, uint8_t b);
+msg_t  streamGet(void* ip);
+size_t streamWrite(void* ip, const uint8_t* bp, size_t n);
+
+/* Stream into memory, counting the calls (test hook) */
+typedef struct {
+   BaseSequentialStream s;
+   uint8_t* buf;
+   size_t size, len;
+   uint32_t calls;
+} host_stream_t;
+
+void host_stream_init(host_stream_t* st, uint8_t* buf, size_t size);
+
+
+/* I/O queues */
+typedef void (*qnotify_t)(void* qp);
+
+typedef struct io_queue {
+   volatile size_t q_counter;
+   uint8_t* q_buffer;
+   uint8_t* q_top;
+   uint8_t* q_wrptr;
+   uint8_t* q_rdptr;
+   qnotify_t q_notify;
+   void* q_link;
+} io_queue_t;
+
+typedef io_queue_t input_queue_t;
+
+#define iqGetFullI(iqp)   ((size_t) (iqp)->q_counter)
+#define iqGetEmptyI(iqp)  ((size_t) ((iqp)->q_top - (iqp)->q_buffer) - (iqp)->q_counter)
+#define iqIsEmptyI(iqp)   ((iqp)->q_counter == 0)
+#define iqIsFullI(iqp)    (iqGetEmptyI(iqp) == 0)
+
+void  iqObjectInit(input_queue_t* iqp, uint8_t* bp, size_t size, qnotify_t infy, void* link);
+msg_t iqPutI(input_queue_t* iqp, uint8_t b);
+msg_t iqGet(input_queue_t* iqp);
+msg_t iqGetTimeout(input_queue_t* iqp, systime_t time);
+void  iqResetI(input_queue_t* iqp);
+
+
+/* General purpose timers */
+typedef uint32_t gptcnt_t;
+typedef struct GPTDriver GPTDriver;
+typedef void (*gptcallback_t)(GPTDriver* gptp);
+
+typedef struct {
+   uint32_t frequency;
+   gptcallback_t callback;
+} GPTConfig;
+
+typedef enum { GPT_STOP, GPT_READY, GPT_CONTINUOUS } gptstate_t;
+
+struct GPTDriver {
+   gptstate_t state;
+   const GPTConfig* config;
+};
+
+extern GPTDriver GPTD1, GPTD2, GPTD3, GPTD4;
+
+void gptStart(GPTDriver* gptp, const GPTConfig* config);
+void gptStop(GPTDriver* gptp);
+void gptStartContinuous(GPTDriver* gptp, gptcnt_t interval);
+void gptStopTimer(GPTDriver* gptp);
+
+
+/* Pins and interrupts */
+#define PAL_HIGH                 1
+#define PAL_MODE_INPUT           0
+#define PAL_MODE_INPUT_PULLUP    1
+#define PAL_MODE_OUTPUT_PUSHPULL 2
+
+void palSetPad(int port, int pad);
+void palClearPad(int port, int pad);
+void palTogglePad(int port, int pad);
+void palSetPadMode(int port, int pad, int mode);
+int  palReadPad(int port, int pad);
+
+#define OSAL_IRQ_HANDLER(id) void id(void)
+#define OSAL_IRQ_PROLOGUE()
+#define OSAL_IRQ_EPILOGUE()
+
+void nvicEnableVector(uint32_t n, uint32_t prio);
+void nvicDisableVector(uint32_t n);
+
+
+/*
+ * DWT cycle counter, for util/cycles.h. On the host, CYCCNT reads the
+ * time stamp counter of the CPU (or nanoseconds where there is none),
+ * so profiles are in host ticks, not target cycles.
+ */
+typedef struct { uint32_t CTRL, CYCCNT; } DWT_Type;
+typedef struct { uint32_t DEMCR; } CoreDebug_Type;
+
+static inline DWT_Type* host_dwt(void)
+{
+   static DWT_Type dwt;
+#if defined(__x86_64__) || defined(__i386__)
+   dwt.CYCCNT = (uint32_t) __builtin_ia32_rdtsc();
+#else
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   dwt.CYCCNT = (uint32_t) (ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+#endif
+   return &dwt;
+}
+
+extern CoreDebug_Type host_coredebug;
+#define DWT        host_dwt()
+#define CoreDebug  (&host_coredebug)
+#define CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk      1UL
+
+
+/* CMSIS intrinsics, as plain C */
+static inline void __DMB(void) { __sync_synchronize(); }
+static inline uint32_t __RBIT(uint32_t x)
+{
+   uint32_t r = 0;
+   for (int i=0; i<32; i++, x >>= 1)
+      r = (r << 1) | (x & 1);
+   return r;
+}
+
+
+/* Teensy 3.2 pins (only the numbers matter here) */
+#define TEENSY_PIN0   0
+#define TEENSY_PIN1   1
+#define TEENSY_PIN2   2
+#define TEENSY_PIN3   3
+#define TEENSY_PIN4   4
+#define TEENSY_PIN5   5
+#define TEENSY_PIN6   6
+#define TEENSY_PIN7   7
+#define TEENSY_PIN8   8
+#define TEENSY_PIN9   9
+#define TEENSY_PIN10 10
+#define TEENSY_PIN11 11
+#define TEENSY_PIN12 12
+#define TEENSY_PIN13 13
+#define TEENSY_PIN14 14
+#define TEENSY_PIN15 15
+#define TEENSY_PIN16 16
+#define TEENSY_PIN17 17
+#define TEENSY_PIN18 18
+#define TEENSY_PIN19 19
+#define TEENSY_PIN20 20
+#define TEENSY_PIN21 21
+#define TEENSY_PIN22 22
+#define TEENSY_PIN23 23
+#define TEENSY_PIN0_IOPORT   0
+#define TEENSY_PIN1_IOPORT   0
+#define TEENSY_PIN2_IOPORT   0
+#define TEENSY_PIN3_IOPORT   0
+#define TEENSY_PIN4_IOPORT   0
+#define TEENSY_PIN5_IOPORT   0
+#define TEENSY_PIN6_IOPORT   0
+#define TEENSY_PIN7_IOPORT   0
+#define TEENSY_PIN8_IOPORT   0
+#define TEENSY_PIN9_IOPORT   0
+#define TEENSY_PIN10_IOPORT  0
+#define TEENSY_PIN11_IOPORT  0
+#define TEENSY_PIN12_IOPORT  0
+#define TEENSY_PIN13_IOPORT  0
+#define TEENSY_PIN14_IOPORT  0
+#define TEENSY_PIN15_IOPORT  0
+#define TEENSY_PIN16_IOPORT  0
+#define TEENSY_PIN17_IOPORT  0
+#define TEENSY_PIN18_IOPORT  0
+#define TEENSY_PIN19_IOPORT  0
+#define TEENSY_PIN20_IOPORT  0
+#define TEENSY_PIN21_IOPORT  0
+#define TEENSY_PIN22_IOPORT  0
+#define TEENSY_PIN23_IOPORT  0
+
+
+/*
+ * Test hooks (chstub.c). host_event is called when timers, interrupts
+ * or the PTT change state. host_gpt_tick runs the callback of a running
+ * timer, as one timer interrupt. Returns false if it is not running.
+ * host_time_advance moves the system time forward, without waiting.
+ * After host_time_stop, the system time only moves that way.
+ */
+#define HOST_EV_GPT_START  1
+#define HOST_EV_GPT_RUN    2
+#define HOST_EV_GPT_HALT   3
+#define HOST_EV_GPT_STOP   4
+#define HOST_EV_IRQ_ON     5
+#define HOST_EV_IRQ_OFF    6
+#define HOST_EV_PTT_ON     7
+#define HOST_EV_PTT_OFF    8
+
+extern void (*host_event_hook)(int ev, void* arg);
+void host_event(int ev, void* arg);
+bool host_gpt_tick(GPTDriver* gptp);
+void host_time_advance(systime_t time);
+void host_time_stop(void);
+
+#endif
@@ -0,0 +1,2 @@
+/* Host stand-in for hal_streams.h, see hal.h */
+#include "hal.h"
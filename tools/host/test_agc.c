@@ -0,0 +1,119 @@
+/*
+ * AGC of the demodulator (agc in afsk_rx.c). Checks that a steady
+ * envelope is scaled to AGC_LEVEL, that the peak decays by the set
+ * amount per sample, and that weak signals are not amplified beyond
+ * what the floor allows.
+ *
+ * Also times it against the floating point AGC it replaced, on the
+ * envelope of a filtered AFSK signal. These are host times: the host
+ * has an FPU, the MK20DX256 does not, so they say nothing about the
+ * cost of the soft float calls the old one needed on the target.
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include "afsk_rx.c"
+#include "rig.h"
+#include "check.h"
+
+#define NSAMPLES  (RIG_RX_RATE * 2)
+#define ROUNDS    200
+
+
+/* The AGC before the fixed point one, as it was (including the cast) */
+static int8_t old_agc(int8_t in, uint8_t* ppeak)
+{
+    if (*ppeak > 100)
+       *ppeak -= 5;
+    if (in*2 > *ppeak)
+       *ppeak = in*2;
+
+    float factor = 250.0f / *ppeak;
+    return (int8_t) factor * (float) in;
+}
+
+
+static int16_t env[NSAMPLES];
+static int16_t out[NSAMPLES];
+static int8_t out8[NSAMPLES];
+static volatile int32_t sink;
+
+static double now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+int main(void)
+{
+   Agc a;
+   int i;
+
+   afsk_rx_setAgc(5, 100);
+
+   /* Steady envelope: Scaled to AGC_LEVEL */
+   a.peak = 2*AGC_LEVEL; a.gain = 1 << 8;
+   for (i=0; i<1000; i++)
+      out[0] = agc(80, &a);
+   CHECK(out[0] >= AGC_LEVEL - 1 && out[0] <= AGC_LEVEL);
+   CHECK(a.peak == 160);
+
+   /* Peak decays by agc_decay per sample, down to the floor */
+   a.peak = 1000;
+   agc(0, &a);
+   CHECK(a.peak == 995);
+   for (i=0; i<1000; i++)
+      agc(0, &a);
+   CHECK(a.peak == 100);
+
+   /* Weak signal: Gain is limited by the floor */
+   out[0] = agc(10, &a);
+   CHECK(out[0] == 10 * AGC_LEVEL * 2 / 100);
+
+   /* Strong signal, above the 8 bit range of the old AGC */
+   out[0] = agc(2000, &a);
+   CHECK(a.peak == 4000 && out[0] >= AGC_LEVEL - 1 && out[0] <= AGC_LEVEL);
+
+   /* Settings are taken at once, floor of 0 is made 1 */
+   afsk_rx_setAgc(0, 0);
+   CHECK(agc_decay == 0 && agc_floor == 1);
+   afsk_rx_setAgc(5, 100);
+
+   /* Envelope of the mark filter output for an AFSK signal */
+   {
+      static uint8_t bits[300];
+      static int8_t audio[NSAMPLES];
+      static int16_t x[NSAMPLES];
+      FirState st;
+      for (i=0; i<300; i++)
+         bits[i] = rand();
+      size_t n = rig_synth(bits, 2400, 0, 0, 60, audio, NSAMPLES);
+      memset(&st, 0, sizeof(st));
+      for (i=0; i<(int) n; i++)
+         x[i] = audio[i];
+      fir_filter(FIR_1200_BP, &st, x, env, n);
+      for (i=0; i<NSAMPLES; i++)
+         env[i] = ABS(env[i]);
+   }
+
+   double t0 = now();
+   for (int r=0; r<ROUNDS; r++) {
+      a.peak = 2*AGC_LEVEL; a.gain = 1 << 8;
+      for (i=0; i<NSAMPLES; i++)
+         out[i] = agc(env[i], &a);
+   }
+   double t1 = now();
+   for (int r=0; r<ROUNDS; r++) {
+      uint8_t peak = 250;
+      for (i=0; i<NSAMPLES; i++)
+         out8[i] = old_agc((int8_t) (env[i] > 127 ? 127 : env[i]), &peak);
+   }
+   double t2 = now();
+   for (i=0; i<NSAMPLES; i++)
+      sink += out[i] + out8[i];
+   printf("Host ns/sample: fixed point AGC %.2f, old float AGC %.2f\n",
+      (t1 - t0) / ((double) ROUNDS * NSAMPLES), (t2 - t1) / ((double) ROUNDS * NSAMPLES));
+   return check_done("test_agc");
+}
@@ -0,0 +1,206 @@
+/*
+ * CRC-CCITT (util/crc16.c and fbuf_crc). The table driven update and
+ * crc_ccitt_block (slice-by-4) must give the same result as the bit
+ * level _crc_ccitt_update, for any length, alignment and seed, and
+ * so must fbuf_crc over chains of slots from any position.
+ *
+ * The hardware CRC path cannot run on the host. It is checked with a
+ * model of the K20 CRC module (16 bit mode, transposition on write and
+ * read, seed written with WAS), driven the way crc_hw_block drives the
+ * registers.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "util/crc16.h"
+#include "fbuf.h"
+#include "check.h"
+
+#define TRIALS  20000
+
+static uint16_t serial(uint16_t crc, const uint8_t* p, size_t n)
+{
+   while (n-- > 0)
+      crc = _crc_ccitt_update(crc, *p++);
+   return crc;
+}
+
+static uint32_t rbit(uint32_t x)
+{
+   uint32_t r = 0;
+   for (int i=0; i<32; i++, x >>= 1)
+      r = (r << 1) | (x & 1);
+   return r;
+}
+
+
+/*
+ * K20 CRC module, 16 bit CRC (CTRL[TCRC] = 0), polynomial in GPOLY.
+ * TOT = 2 / TOTR = 2 transpose bits and bytes of the 32 bit word.
+ * A 32 bit data write shifts in all 32 bits, MSB first.
+ */
+static struct { uint32_t ctrl, crc, gpoly; } k20;
+
+#define K20_WAS      0x02000000
+#define K20_TOT(n)   ((uint32_t) (n) << 30)
+#define K20_TOTR(n)  ((uint32_t) (n) << 28)
+
+static void k20_write(uint32_t x)
+{
+   if ((k20.ctrl >> 30) == 2)
+      x = rbit(x);
+   if (k20.ctrl & K20_WAS) {
+      k20.crc = x;
+      return;
+   }
+   uint16_t crc = (uint16_t) k20.crc;
+   for (int i=31; i>=0; i--) {
+      bool fb = ((crc >> 15) ^ (x >> i)) & 1;
+      crc <<= 1;
+      if (fb)
+         crc ^= k20.gpoly;
+   }
+   k20.crc = (k20.crc & 0xFFFF0000) | crc;
+}
+
+static uint32_t k20_read(void)
+   { return ((k20.ctrl >> 28) & 3) == 2 ? rbit(k20.crc) : k20.crc; }
+
+
+/* As crc_hw_block, with the registers of the model */
+static uint16_t model_hw_block(uint16_t crc, const uint8_t* p, size_t n)
+{
+   uint32_t x;
+   k20.ctrl = K20_WAS | K20_TOTR(2);
+   k20_write(rbit(crc) >> 16);
+   k20.ctrl = K20_TOT(2) | K20_TOTR(2);
+   while (n >= 4) {
+      memcpy(&x, p, 4);
+      k20_write(x);
+      p += 4; n -= 4;
+   }
+   crc = k20_read() >> 16;
+   return serial(crc, p, n);
+}
+
+
+static double now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+int main(void)
+{
+   static uint8_t buf[1024 + 4];
+   const uint8_t* check = (const uint8_t*) "123456789";
+   int bad;
+
+   srand(12);
+   crc_init();
+
+   /* Known answer: Reflected 0x8408, init 0xFFFF, no final xor */
+   CHECK(serial(0xFFFF, check, 9) == 0x6F91);
+   CHECK(crc_ccitt_block(0xFFFF, check, 9) == 0x6F91);
+   uint16_t crc = 0xFFFF;
+   for (int i=0; i<9; i++)
+      crc = crc_ccitt_update(crc, check[i]);
+   CHECK(crc == 0x6F91);
+
+   /* A frame with its FCS appended gives the residue */
+   uint16_t fcs = serial(0xFFFF, check, 9) ^ 0xFFFF;
+   memcpy(buf, check, 9);
+   buf[9] = fcs & 0xFF;
+   buf[10] = fcs >> 8;
+   CHECK(crc_ccitt_block(0xFFFF, buf, 11) == 0xF0B8);
+
+   /* Slice-by-4 and the bytewise table against the bit level update,
+    * any length, alignment and seed, and split at any point */
+   for (int i=0; i<sizeof(buf); i++)
+      buf[i] = rand();
+   bad = 0;
+   for (int t=0; t<TRIALS; t++) {
+      size_t n = rand() % 300, off = rand() % 4, split = (n ? rand() % n : 0);
+      uint16_t seed = rand();
+      uint16_t ref = serial(seed, buf + off, n);
+      uint16_t c = seed;
+      for (size_t i=0; i<n; i++)
+         c = crc_ccitt_update(c, buf[off + i]);
+      bad += (crc_ccitt_block(seed, buf + off, n) != ref) || (c != ref)
+         || (crc_ccitt_block(crc_ccitt_block(seed, buf + off, split), buf + off + split, n - split) != ref);
+   }
+   CHECK(bad == 0);
+
+   /* Hardware path (model): the self test in crc_init, then random spans */
+   k20.ctrl = 0;
+   k20.gpoly = 0x1021;
+   CHECK(model_hw_block(0xFFFF, check, 9) == 0x6F91);
+   bad = 0;
+   for (int t=0; t<TRIALS; t++) {
+      size_t n = rand() % 300, off = rand() % 4;
+      uint16_t seed = rand();
+      bad += (model_hw_block(seed, buf + off, n) != serial(seed, buf + off, n));
+   }
+   CHECK(bad == 0);
+
+   /* fbuf_crc over chains of slots, from any position. Inserts split
+    * slots, so spans start and end at odd places */
+   fbuf_init();
+   bad = 0;
+   for (int t=0; t<2000; t++) {
+      static uint8_t data[1200];
+      FBUF b, x;
+      uint16_t len = 0;
+      fbuf_new(&b, FBUF_ACC_OTHER, 0);
+      for (int k = rand() % 6; k >= 0; k--) {
+         uint16_t n = rand() % 200;
+         for (int i=0; i<n; i++)
+            data[len + i] = rand();
+         fbuf_write(&b, (char*) data + len, n);
+         len += n;
+      }
+      if (len > 0 && rand() % 2) {
+         uint16_t pos = rand() % len, n = 1 + rand() % 60;
+         uint8_t ins[60];
+         for (int i=0; i<n; i++)
+            ins[i] = rand();
+         fbuf_new(&x, FBUF_ACC_OTHER, 0);
+         fbuf_write(&x, (char*) ins, n);
+         if (fbuf_insert(&b, &x, pos)) {
+            memmove(data + pos + n, data + pos, len - pos);
+            memcpy(data + pos, ins, n);
+            len += n;
+         }
+         fbuf_release(&x);
+      }
+      uint16_t pos = rand() % (len + 2), seed = rand();
+      uint16_t ref = (pos < len ? serial(seed, data + pos, len - pos) : seed);
+      bad += (fbuf_length(&b) != len || fbuf_crc(&b, pos, seed) != ref);
+      fbuf_release(&b);
+   }
+   CHECK(bad == 0);
+   CHECK(fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0);
+
+   /* For information: host time per byte */
+   volatile uint16_t sink = 0;
+   double t0 = now();
+   for (int r=0; r<2000; r++)
+      sink += serial(r, buf, 1024);
+   double t1 = now();
+   for (int r=0; r<2000; r++) {
+      uint16_t c = r;
+      for (int i=0; i<1024; i++)
+         c = crc_ccitt_update(c, buf[i]);
+      sink += c;
+   }
+   double t2 = now();
+   for (int r=0; r<2000; r++)
+      sink += crc_ccitt_block(r, buf, 1024);
+   double t3 = now();
+   printf("Host ns/byte: bitwise %.2f, table %.2f, slice-by-4 %.2f\n",
+      (t1 - t0) / 2048000, (t2 - t1) / 2048000, (t3 - t2) / 2048000);
+   return check_done("test_crc");
+}
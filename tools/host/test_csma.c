@@ -0,0 +1,207 @@
+/*
+ * Channel access (csma.c) for N stations that all hear each other.
+ * Each station has its own copy of the state of csma.c (utilisation
+ * measurement, random generator), swapped in when it runs. The
+ * persistence is from csma_persistence, the draws from rand_u8, the
+ * channel is reported with csma_busyI and the utilisation updated by
+ * load_update every 5 s, as on the target. The loop of csma_wait is
+ * stepped here, since it blocks: wait until the channel is free, then
+ * transmit with probability p, else wait a slot time and try again.
+ *
+ * Frames come at random, and a transmission is lost if another one
+ * overlaps it. A station hears another one some time (DCD latency)
+ * after it keys up. The collision rate, throughput and access delay
+ * are printed with fixed and with adaptive persistence.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define csma_wait csma_wait_target
+#include "csma.c"
+#undef csma_wait
+#include "check.h"
+
+#define MAXNODES     32
+#define TICK_MS      10
+#define TICK         MS2ST(TICK_MS)
+#define SIM_SEC      3600
+#define SENSE_MS     100                 /* Until others hear a transmission */
+#define INTERVAL_SEC 15                  /* Mean time between frames, each station */
+#define FRAME_BYTES  80
+#define QUEUE        8
+
+
+/* csma_wait is not run, but still needs these */
+void radio_wait_enabled(void) { }
+void wait_channel_ready(void) { }
+
+
+typedef struct {
+   /* State of csma.c */
+   bool busy;
+   systime_t busy_since, busy_time;
+   uint32_t load[3];
+   uint32_t seed;
+
+   /* Station */
+   uint32_t arrival[QUEUE];     // Ticks, of frames waiting
+   int queued;
+   bool contending, sensed, tx, collided;
+   uint8_t p;
+   uint32_t wait_until, tx_start, tx_end;
+} node_t;
+
+typedef struct {
+   int sent, collided;
+   double delay;                // Ticks, sum over frames sent
+   double good_ticks;           // Of frames not collided
+   double load_sum;             // csma_load (1 minute), percent
+   double busy_sum;             // Busy as heard, percent
+   int load_n;
+} simstat_t;
+
+static node_t node[MAXNODES];
+
+
+static void enter(node_t* n)
+{
+   busy = n->busy;
+   busy_since = n->busy_since;
+   busy_time = n->busy_time;
+   memcpy(load, n->load, sizeof(load));
+   seed = n->seed;
+}
+
+static void leave(node_t* n)
+{
+   n->busy = busy;
+   n->busy_since = busy_since;
+   n->busy_time = busy_time;
+   memcpy(n->load, load, sizeof(load));
+   n->seed = seed;
+}
+
+
+static double frand(void)
+   { return rand() / (RAND_MAX + 1.0); }
+
+
+static void simulate(int nn, bool adapt, simstat_t* st)
+{
+   uint32_t txticks = ((GET_BYTE_PARAM(TXDELAY) + GET_BYTE_PARAM(TXTAIL)) * 8
+                       + (FRAME_BYTES + 2) * 8 * 21 / 20) * 1000 / 1200 / TICK_MS;
+   uint32_t slot = GET_BYTE_PARAM(SLOTTIME) * 10 / TICK_MS;
+   uint32_t sense = SENSE_MS / TICK_MS, load_ticks = LOAD_INTERVAL * 1000 / TICK_MS;
+   uint32_t others_busy[MAXNODES];
+   double arrive = (double) TICK_MS / 1000 / INTERVAL_SEC;
+
+   SET_BYTE_PARAM(CSMA_ADAPT_ON, adapt);
+   memset(st, 0, sizeof(simstat_t));
+   memset(node, 0, sizeof(node));
+   memset(others_busy, 0, sizeof(others_busy));
+   for (int i=0; i<nn; i++)
+      node[i].seed = 2463534242UL ^ ((i + 1) * 2654435761UL);
+   srand(nn);
+
+   for (uint32_t t=0; t < SIM_SEC * 1000 / TICK_MS; t++) {
+      host_time_advance(TICK);
+      int heard = 0, keyed = 0;
+      for (int i=0; i<nn; i++) {
+         node[i].tx &= (t < node[i].tx_end);
+         heard += (node[i].tx && t >= node[i].tx_start + sense);
+         keyed += node[i].tx;
+      }
+      for (int i=0; i<nn; i++) {
+         node_t* n = &node[i];
+         bool sensed = heard - (n->tx && t >= n->tx_start + sense) > 0;
+         n->collided |= (n->tx && keyed > 1);
+         others_busy[i] += sensed;
+         if (sensed != n->sensed) {
+            enter(n);
+            csma_busyI(sensed);
+            leave(n);
+            n->sensed = sensed;
+         }
+         if (t % load_ticks == 0 && t > 0) {
+            enter(n);
+            load_update(NULL);
+            if (t >= 60 * 1000 / TICK_MS) {
+               st->load_sum += csma_load(CSMA_LOAD_1MIN);
+               st->busy_sum += 100.0 * others_busy[i] / load_ticks;
+               st->load_n++;
+            }
+            leave(n);
+            others_busy[i] = 0;
+         }
+
+         /* A transmission ended */
+         if (n->tx_end == t && t > 0) {
+            st->collided += n->collided;
+            st->good_ticks += (n->collided ? 0 : txticks);
+         }
+         if (frand() < arrive && n->queued < QUEUE)
+            n->arrival[n->queued++] = t;
+         if (n->tx || n->queued == 0)
+            continue;
+
+         /* csma_wait, one step */
+         if (!n->contending) {
+            enter(n);
+            n->p = csma_persistence();
+            leave(n);
+            n->contending = true;
+            n->wait_until = t;
+         }
+         if (t < n->wait_until || n->sensed)
+            continue;
+         enter(n);
+         uint8_t r = rand_u8();
+         leave(n);
+         if (r > n->p) {
+            n->wait_until = t + slot;
+            continue;
+         }
+         n->tx = true;
+         n->collided = false;
+         n->tx_start = t;
+         n->tx_end = t + txticks;
+         n->contending = false;
+         st->sent++;
+         st->delay += t - n->arrival[0];
+         memmove(n->arrival, n->arrival + 1, --n->queued * sizeof(uint32_t));
+      }
+   }
+}
+
+
+int main(void)
+{
+   static const int sizes[] = {4, 8, 16, 32};
+   double rate[2][4];
+
+   host_time_stop();
+   csma_init();
+   printf("Frames every %d s from each station, %d bytes, heard after %d ms, slot %d ms, p = %d/255\n",
+      INTERVAL_SEC, FRAME_BYTES, SENSE_MS, GET_BYTE_PARAM(SLOTTIME) * 10, GET_BYTE_PARAM(PERSISTENCE));
+   printf("%8s %9s %6s %9s %7s %9s %8s %7s %7s\n",
+      "stations", "mode", "sent", "collided", "rate", "S (good)", "delay s", "load %", "busy %");
+   for (int k=0; k<4; k++)
+      for (int a=0; a<2; a++) {
+         simstat_t st;
+         simulate(sizes[k], a, &st);
+         rate[a][k] = st.sent > 0 ? (double) st.collided / st.sent : 0;
+         double ld = st.load_sum / st.load_n, bs = st.busy_sum / st.load_n;
+         printf("%8d %9s %6d %9d %7.3f %9.3f %8.2f %7.1f %7.1f\n",
+            sizes[k], a ? "adaptive" : "fixed", st.sent, st.collided, rate[a][k],
+            st.good_ticks * TICK_MS / 1000 / SIM_SEC, st.delay * TICK_MS / 1000 / st.sent, ld, bs);
+
+         /* The measured utilisation follows what the station heard */
+         CHECK(st.sent > 0 && fabs(ld - bs) < 2);
+      }
+
+   /* Adaptive persistence must help where the channel is loaded */
+   CHECK(rate[1][3] < rate[0][3] && rate[1][2] < rate[0][2]);
+   return check_done("test_csma");
+}
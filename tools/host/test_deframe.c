@@ -0,0 +1,151 @@
+/*
+ * Table driven deframer (deframe_octet in hdlc_decoder.c) against the
+ * bit at a time one it falls back to. Two decoders get the same
+ * octets, one through deframe_octet and one through deframe_bit. After
+ * each octet, their state must be the same: frame so far, bits and
+ * confidence not yet in the frame, weak bits and statistics.
+ *
+ * The input is random data, flags, aborts and stuffed frames (some not
+ * ending at an octet boundary), with random confidence for each bit.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "hdlc_decoder.c"
+#include "check.h"
+
+#define OCTETS   400000
+#define MAXBITS  (OCTETS * 8 + 4096)
+
+static hdlc_rx_t table, bitwise;
+static uint8_t air[MAXBITS], air_conf[MAXBITS];
+static int nair;
+
+
+static void put_air(uint8_t bit)
+{
+   air[nair] = bit;
+   air_conf[nair++] = rand() % 16;
+}
+
+static void put_octet(uint8_t octet)
+{
+   for (int i=0; i<8; i++)
+      put_air((octet >> i) & 1);
+}
+
+
+/* A frame of n bits, stuffed, with its FCS right or not */
+static void put_frame(int n, bool fcs_ok)
+{
+   static uint8_t f[MAX_HDLC_FRAME_SIZE + 2];
+   int len = (n + 7) / 8, ones = 0;
+   for (int i=0; i<len; i++)
+      f[i] = (rand() % 3 == 0 ? 0xFF : rand());
+   if (fcs_ok && n % 8 == 0 && len > 2) {
+      uint16_t crc = crc_ccitt_block(0xFFFF, f, len-2) ^ 0xFFFF;
+      f[len-2] = crc & 0xFF;
+      f[len-1] = crc >> 8;
+   }
+   for (int i=0; i<n; i++) {
+      uint8_t bit = (f[i/8] >> (i%8)) & 1;
+      put_air(bit);
+      ones = (bit ? ones + 1 : 0);
+      if (ones == 5) {
+         put_air(0);
+         ones = 0;
+      }
+   }
+}
+
+
+static void make_stream(void)
+{
+   nair = 0;
+   while (nair < OCTETS * 8) {
+      switch (rand() % 6) {
+         case 0:
+            for (int i = rand() % 4; i >= 0; i--)
+               put_octet(0x7E);
+            break;
+         case 1:
+            put_octet(0xFF);
+            if (rand() % 2)
+               put_air(1);
+            break;
+         case 2:
+            for (int i = rand() % 20; i >= 0; i--)
+               put_octet(rand() % 2 ? 0xFF : rand());
+            break;
+         case 3:
+            put_frame(8 * (17 + rand() % 60), true);
+            break;
+         case 4:
+            put_frame(8 * (17 + rand() % 60), false);
+            break;
+         default:
+            put_frame(1 + rand() % 500, false);
+      }
+      if (rand() % 3 == 0)
+         put_octet(0x7E);
+      /* Shift the next part relative to octet boundaries */
+      for (int i = rand() % 8; i > 0; i--)
+         put_air(rand() % 2);
+   }
+}
+
+
+static bool same(const hdlc_rx_t* a, const hdlc_rx_t* b)
+{
+   if (a->ones != b->ones || a->in_frame != b->in_frame)
+      return false;
+   if (!a->in_frame)
+      return true;
+   uint64_t mask = (a->nacc == 0 ? 0 : ~0ULL >> (64 - a->nacc*4));
+   return a->nacc == b->nacc && a->length == b->length && a->crc == b->crc
+      && ((a->acc ^ b->acc) & ((1 << a->nacc) - 1)) == 0
+      && ((a->acc_conf ^ b->acc_conf) & mask) == 0
+      && memcmp(a->frame, b->frame, a->length) == 0
+      && (a->length == 0 || (a->nweak == b->nweak && a->weak_max == b->weak_max
+         && memcmp(a->weak_pos, b->weak_pos, a->nweak * sizeof(a->weak_pos[0])) == 0
+         && memcmp(a->weak_conf, b->weak_conf, a->nweak) == 0));
+}
+
+
+int main(void)
+{
+   uint32_t fast = 0, diffs = 0;
+
+   srand(10);
+   fbuf_init();
+   hdlc_rx_setFcsTries(0);
+   make_stream();
+
+   for (int i=0; i+8 <= nair; i += 8) {
+      uint8_t octet = 0;
+      uint32_t conf = 0;
+      for (int j=0; j<8; j++) {
+         octet |= air[i+j] << j;
+         conf |= (uint32_t) air_conf[i+j] << (j*4);
+      }
+      if (table.ones < 6 && !(hdlc_dtab[table.ones][octet] & HDLC_DT_SLOW))
+         fast++;
+      deframe_octet(&table, octet, conf);
+      for (int j=0; j<8; j++, octet >>= 1, conf >>= 4)
+         deframe_bit(&bitwise, octet & 0x01, conf & 0x0f);
+
+      if (!same(&table, &bitwise)) {
+         if (diffs++ == 0)
+            printf("First difference at octet %d\n", i/8);
+         table = bitwise;
+      }
+   }
+   printf("%d octets, %u by table, %u frames, %u flags, %u aborts, %u FCS errors\n",
+      nair/8, fast, table.stat.frames, table.stat.flags, table.stat.aborts, table.stat.fcs_errors);
+
+   CHECK(diffs == 0);
+   CHECK(memcmp(&table.stat, &bitwise.stat, sizeof(table.stat)) == 0);
+   CHECK(fast > nair/8 / 2);
+   CHECK(table.stat.frames > 1000 && table.stat.aborts > 1000 && table.stat.fcs_errors > 1000);
+   return check_done("test_deframe");
+}
@@ -0,0 +1,226 @@
+/*
+ * Frame buffer chains (fbuf.c) against a model: a byte array per
+ * buffer. Random sequences of new, write, putChar, removeLast, insert,
+ * connect, newRef, rseek with getChar and release are done on a few
+ * buffers, and after each operation every buffer must hold what the
+ * model says. Chains get partly filled and empty slots this way.
+ *
+ * Writing, removeLast, and being the target of insert or connect are
+ * for the owner, before the buffer is shared; writing must fail after
+ * insert or connect. The tail of a buffer still owned must be the last
+ * slot of its chain. The pool must be consistent (fbuf_check) and
+ * empty at the end of each sequence.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "fbuf.c"
+#include "check.h"
+
+#define NB      8
+#define MAXL    1200
+#define SEQS    20000
+#define STEPS   200
+
+enum { FREE, OWNED, SHARED, SEALED };
+
+static struct {
+   FBUF fb;
+   uint8_t data[MAXL];
+   int len, state;
+} m[NB];
+
+static int bad_content, bad_tail, bad_seal, bad_seek, bad_check;
+static int n_insert, n_connect, n_remove, n_seek;
+
+
+static int pick(int state)
+{
+   int i = rand() % NB;
+   for (int k=0; k<NB; k++, i = (i+1) % NB)
+      if (m[i].state == state || (state < 0 && m[i].state != FREE))
+         return i;
+   return -1;
+}
+
+
+static void rand_bytes(uint8_t* d, int n)
+{
+   for (int i=0; i<n; i++)
+      d[i] = rand();
+}
+
+
+/* Last slot of the chain, and the sum of the slot lengths */
+static fbindex_t last_slot(FBUF* b, int* sum)
+{
+   fbindex_t s = b->head;
+   *sum = 0;
+   while (s != NILPTR) {
+      *sum += _pool[s].length;
+      if (_pool[s].next == NILPTR)
+         return s;
+      s = _pool[s].next;
+   }
+   return NILPTR;
+}
+
+
+static void verify(void)
+{
+   static uint8_t out[MAXL];
+   for (int i=0; i<NB; i++) {
+      if (m[i].state == FREE)
+         continue;
+      FBUF* b = &m[i].fb;
+      if (fbuf_length(b) != m[i].len || fbuf_read(b, 0, (char*) out) != m[i].len
+            || memcmp(out, m[i].data, m[i].len) != 0)
+         bad_content++;
+      if (m[i].state == OWNED) {
+         int sum;
+         fbindex_t last = last_slot(b, &sum);
+         if (last != b->tail || b->wslot != b->tail || sum != m[i].len)
+            bad_tail++;
+      }
+   }
+}
+
+
+static void step(void)
+{
+   int b, x, pos, n;
+   uint8_t tmp[MAXL];
+   switch (rand() % 11) {
+      case 0:
+         if ((b = pick(FREE)) >= 0) {
+            static const uint16_t hints[] = {0, 0, 14, 40, 100, 250};
+            fbuf_new(&m[b].fb, FBUF_ACC_RX, hints[rand() % 6]);
+            m[b].len = 0;
+            m[b].state = OWNED;
+         }
+         break;
+      case 1:
+         if ((b = pick(OWNED)) >= 0 && m[b].len < MAXL/4) {
+            n = rand() % 70;
+            rand_bytes(m[b].data + m[b].len, n);
+            fbuf_write(&m[b].fb, (char*) m[b].data + m[b].len, n);
+            m[b].len += n;
+         }
+         break;
+      case 2:
+         if ((b = pick(OWNED)) >= 0 && m[b].len < MAXL/4) {
+            m[b].data[m[b].len] = rand();
+            fbuf_putChar(&m[b].fb, m[b].data[m[b].len++]);
+         }
+         break;
+      case 3:
+         if ((b = pick(OWNED)) >= 0) {
+            for (n = rand() % 40; n > 0; n--) {
+               fbuf_removeLast(&m[b].fb);
+               if (m[b].len > 0)
+                  m[b].len--;
+            }
+            n_remove++;
+         }
+         break;
+      case 4:
+         b = pick(OWNED);
+         x = pick(OWNED);
+         if (b >= 0 && x >= 0 && b != x && m[b].len + m[x].len <= MAXL) {
+            pos = rand() % (m[b].len + 1);
+            if (fbuf_insert(&m[b].fb, &m[x].fb, pos)) {
+               memmove(m[b].data + pos + m[x].len, m[b].data + pos, m[b].len - pos);
+               memcpy(m[b].data + pos, m[x].data, m[x].len);
+               m[b].len += m[x].len;
+               m[b].state = m[x].state = SEALED;
+               n_insert++;
+            }
+         }
+         break;
+      case 5:
+         b = pick(OWNED);
+         x = pick(-1);
+         if (b >= 0 && x >= 0 && b != x) {
+            pos = rand() % (m[x].len + 1);
+            if (m[b].len + m[x].len - pos <= MAXL && fbuf_connect(&m[b].fb, &m[x].fb, pos)) {
+               memcpy(m[b].data + m[b].len, m[x].data + pos, m[x].len - pos);
+               m[b].len += m[x].len - pos;
+               m[b].state = SEALED;
+               if (m[x].state == OWNED)
+                  m[x].state = SEALED;
+               n_connect++;
+            }
+         }
+         break;
+      case 6:
+         x = pick(-1);
+         b = pick(FREE);
+         if (x >= 0 && b >= 0) {
+            m[b].fb = fbuf_newRef(&m[x].fb);
+            memcpy(m[b].data, m[x].data, m[x].len);
+            m[b].len = m[x].len;
+            if (m[x].state == OWNED)
+               m[x].state = SHARED;
+            m[b].state = m[x].state;
+         }
+         break;
+      case 7:
+      case 8:
+         /* Seek forward a few times, and sometimes back */
+         if ((b = pick(-1)) >= 0 && m[b].len > 0) {
+            pos = rand() % m[b].len;
+            for (int k=0; k<4 && pos < m[b].len; k++) {
+               fbuf_rseek(&m[b].fb, pos);
+               n = 1 + rand() % 40;
+               if (n > m[b].len - pos)
+                  n = m[b].len - pos;
+               for (int i=0; i<n; i++)
+                  bad_seek += ((uint8_t) fbuf_getChar(&m[b].fb) != m[b].data[pos + i]);
+               pos = (rand() % 4 ? pos + n + rand() % 20 : rand() % m[b].len);
+               n_seek++;
+            }
+         }
+         break;
+      case 9:
+         if ((b = pick(SEALED)) >= 0) {
+            rand_bytes(tmp, 10);
+            bad_seal += fbuf_write(&m[b].fb, (char*) tmp, 10);
+            bad_seal += fbuf_putChar(&m[b].fb, 'x');
+         }
+         break;
+      default:
+         if ((b = pick(-1)) >= 0) {
+            fbuf_release(&m[b].fb);
+            m[b].state = FREE;
+         }
+   }
+}
+
+
+int main(void)
+{
+   srand(23);
+   fbuf_init();
+   for (int s=0; s<SEQS; s++) {
+      for (int i=0; i<STEPS; i++) {
+         step();
+         verify();
+      }
+      bad_check += !fbuf_check();
+      for (int i=0; i<NB; i++)
+         if (m[i].state != FREE) {
+            fbuf_release(&m[i].fb);
+            m[i].state = FREE;
+         }
+      bad_check += !(fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0
+                     && fbuf_check());
+   }
+   printf("%d sequences of %d operations: %d inserts, %d connects, %d removeLast runs, %d seeks\n",
+      SEQS, STEPS, n_insert, n_connect, n_remove, n_seek);
+   CHECK(bad_content == 0);
+   CHECK(bad_tail == 0);
+   CHECK(bad_seal == 0);
+   CHECK(bad_seek == 0);
+   CHECK(bad_check == 0);
+   return check_done("test_fbmodel");
+}
@@ -0,0 +1,183 @@
+/*
+ * Slot allocation in the frame buffer pool (fbuf.c). Buffers are
+ * allocated until the pool is full and released in random order, and
+ * random allocations, writes, new references and releases are done;
+ * fbuf_check must find the pool consistent all along, and empty at
+ * the end.
+ *
+ * Also times allocating and freeing a slot, with the pool 10%, 50% and
+ * 90% full, against the linear scan for a free slot used before (900
+ * slots). These are host times.
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include "fbuf.c"
+#include "check.h"
+
+#define MAXBUF   1000
+#define OPS      200000
+#define STEPS    1000000
+#define OLD_SLOTS 900
+
+static FBUF buf[MAXBUF];
+static bool shared[MAXBUF];   /* No writing after fbuf_newRef */
+
+
+static double now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static bool pool_empty(void)
+{
+   fbacc_t a;
+   fbuf_getAccount(FBUF_ACC_RX, &a);
+   return fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0
+      && _free_units == FBUF_UNITS && a.used == 0 && fbuf_check();
+}
+
+
+/* The allocator before: First slot with no references */
+static uint8_t old_refcnt[OLD_SLOTS];
+
+static int old_newslot(void)
+{
+   for (int i=0; i<OLD_SLOTS; i++)
+      if (old_refcnt[i] == 0) {
+         old_refcnt[i] = 1;
+         return i;
+      }
+   return -1;
+}
+
+
+/* Keep n slots allocated, and free a random one and allocate another
+ * one, steps times. Returns ns per step */
+static double churn(int n, bool old)
+{
+   static fbindex_t held[OLD_SLOTS];
+   for (int i=0; i<n; i++)
+      held[i] = (old ? old_newslot() : _fbuf_newslot(FBUF_ACC_RX, FBUF_SMALL));
+   for (int i=0; i<STEPS/10; i++) {
+      int k = rand() % n;
+      if (old) {
+         old_refcnt[held[k]] = 0;
+         held[k] = old_newslot();
+      }
+      else {
+         _fbuf_unref(held[k]);
+         held[k] = _fbuf_newslot(FBUF_ACC_RX, FBUF_SMALL);
+      }
+   }
+   static int pick[STEPS];
+   for (int i=0; i<STEPS; i++)
+      pick[i] = rand() % n;
+   double t0 = now();
+   if (old)
+      for (int i=0; i<STEPS; i++) {
+         old_refcnt[held[pick[i]]] = 0;
+         held[pick[i]] = old_newslot();
+      }
+   else
+      for (int i=0; i<STEPS; i++) {
+         _fbuf_unref(held[pick[i]]);
+         held[pick[i]] = _fbuf_newslot(FBUF_ACC_RX, FBUF_SMALL);
+      }
+   double t = (now() - t0) / STEPS;
+   for (int i=0; i<n; i++)
+      if (old)
+         old_refcnt[held[i]] = 0;
+      else
+         _fbuf_unref(held[i]);
+   return t;
+}
+
+
+int main(void)
+{
+   int n;
+   fbacc_t a;
+
+   srand(20);
+   fbuf_init();
+   CHECK(pool_empty());
+   for (int k=0; k<MAXBUF; k++) {
+      buf[k].head = NILPTR;
+      fbuf_release(&buf[k]);
+   }
+
+   /* Fill up: The account gets all but what the others have reserved */
+   fbindex_t avail = fbuf_available(FBUF_ACC_RX);
+   for (n=0; n<MAXBUF && fbuf_new(&buf[n], FBUF_ACC_RX, 0); n++)
+      ;
+   fbuf_getAccount(FBUF_ACC_RX, &a);
+   printf("Filled: %d buffers, %u of %u units, %u small and %u large slots\n",
+      n, a.used, avail, fbuf_usedSlots(FBUF_SMALL), fbuf_usedSlots(FBUF_LARGE));
+   CHECK(n < MAXBUF && a.fails == 1 && fbuf_check());
+   CHECK(fbuf_usedSlots(FBUF_SMALL) == FBUF_SLOTS && avail - a.used < LUNITS);
+   CHECK(!fbuf_writable(&buf[n]) && fbuf_length(&buf[n]) == 0);
+   while (n > 0) {
+      int k = rand() % n;
+      FBUF b = buf[k];
+      buf[k] = buf[--n];
+      fbuf_release(&b);
+      buf[n] = b;
+   }
+   CHECK(pool_empty());
+
+   /* Random use */
+   int checks = 0, bad = 0;
+   for (int op=0; op<OPS; op++) {
+      int k = rand() % MAXBUF;
+      switch (rand() % 4) {
+         case 0:
+            if (buf[k].head == NILPTR)
+               fbuf_new(&buf[k], FBUF_ACC_RX, rand() % 3 ? 0 : rand() % 300);
+            break;
+         case 1:
+            if (buf[k].head != NILPTR && !shared[k]) {
+               char data[200];
+               fbuf_write(&buf[k], data, rand() % sizeof(data));
+            }
+            break;
+         case 2:
+            if (buf[k].head != NILPTR) {
+               int j = rand() % MAXBUF;
+               if (buf[j].head == NILPTR) {
+                  buf[j] = fbuf_newRef(&buf[k]);
+                  shared[j] = shared[k] = true;
+               }
+            }
+            break;
+         default:
+            fbuf_release(&buf[k]);
+            shared[k] = false;
+      }
+      if (op % 1000 == 0) {
+         checks++;
+         bad += !fbuf_check();
+      }
+   }
+   fbuf_getAccount(FBUF_ACC_RX, &a);
+   printf("Random use: %d operations, %u allocations refused, %d checks\n", OPS, a.fails, checks);
+   CHECK(bad == 0 && a.fails > 0);
+   for (int k=0; k<MAXBUF; k++)
+      fbuf_release(&buf[k]);
+   CHECK(pool_empty());
+
+   /* Host times */
+   static const int occ[] = {10, 50, 90};
+   printf("Host ns per slot freed and allocated: ");
+   for (int i=0; i<3; i++) {
+      double t_new = churn(FBUF_SLOTS * occ[i] / 100, false);
+      double t_old = churn(OLD_SLOTS * occ[i] / 100, true);
+      printf("%s%d%% %.1f (scan %.1f)", i ? ", " : "", occ[i], t_new, t_old);
+   }
+   printf("\n");
+   CHECK(pool_empty());
+   return check_done("test_fbpool");
+}
@@ -0,0 +1,210 @@
+/*
+ * Sharing of frame buffers between threads (fbuf.c). In each round, a
+ * frame is written and a reference to it is given to each of several
+ * threads. These make and release more references and read the frame
+ * back while the first reference is released. Like the digipeater and
+ * the igate, they also connect new headers of their own to the rest of
+ * the frame, at the header boundary the decoder leaves between slots
+ * and within a slot, and the frame must stay unchanged. Other threads
+ * allocate and release buffers all the time. A slot freed too early
+ * would be reused and its content changed. After each round the
+ * frame's slots must be free, and at the end the pool must be empty
+ * and fbuf_check find it consistent. Broken chains may loop, so the
+ * test gives up after a minute.
+ *
+ * Before that, one interleaving is done in order: a holder reads the
+ * middle of a slot while another connects within it.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include "fbuf.h"
+#include "check.h"
+
+#define NREADERS  8
+#define NALLOC    2
+#define ROUNDS    2000
+#define REFS      100
+#define FLEN      100
+#define HLEN      23       /* Header with one digipeater */
+#define CONNECTS  20
+#define NHLEN     30
+
+static pthread_barrier_t start, end;
+static FBUF given[NREADERS];
+static int round_no;
+static volatile bool running = true;
+static int bad[NREADERS], bad_conn[NREADERS], conns[NREADERS];
+static uint32_t allocs[NALLOC];
+
+
+static void pattern(char* f, int r)
+{
+   for (int i=0; i<FLEN; i++)
+      f[i] = (char) (r * 7 + i);
+}
+
+
+static void* reader(void* arg)
+{
+   int t = (int) arg;
+   char expect[FLEN], got[FLEN];
+   for (int r=0; r<ROUNDS; r++) {
+      pthread_barrier_wait(&start);
+      pattern(expect, round_no);
+      for (int i=0; i<REFS; i++) {
+         FBUF ref = fbuf_newRef(&given[t]);
+         if (i % 4 == 0)
+            sched_yield();
+         if (i % 10 == 0) {
+            if (fbuf_read(&ref, FLEN, got) != FLEN || memcmp(got, expect, FLEN) != 0)
+               bad[t]++;
+         }
+         fbuf_release(&ref);
+      }
+
+      /* New header connected to the rest, as the digipeater does */
+      char hexp[NHLEN + FLEN];
+      memset(hexp, 'H' + t, NHLEN);
+      for (int i=0; i<CONNECTS; i++) {
+         FBUF ref = fbuf_newRef(&given[t]), hdr;
+         int pos = (i % 2 ? HLEN : HLEN + i);
+         fbuf_new(&hdr, FBUF_ACC_TX, NHLEN);
+         fbuf_write(&hdr, hexp, NHLEN);
+         if (i % 3 == 0)
+            sched_yield();
+         if (fbuf_connect(&hdr, &ref, pos)) {
+            memcpy(hexp + NHLEN, expect + pos, FLEN - pos);
+            if (fbuf_read(&hdr, 0, got) != NHLEN + FLEN - pos
+                  || memcmp(got, hexp, NHLEN) != 0 || memcmp(got + NHLEN, expect + pos, FLEN - pos) != 0)
+               bad_conn[t]++;
+            conns[t]++;
+         }
+         if (fbuf_read(&ref, 0, got) != FLEN || memcmp(got, expect, FLEN) != 0)
+            bad_conn[t]++;
+         fbuf_release(&hdr);
+         fbuf_release(&ref);
+      }
+      fbuf_release(&given[t]);
+      pthread_barrier_wait(&end);
+   }
+   return NULL;
+}
+
+
+static void timeout(int sig)
+{
+   static const char msg[] = "test_fbref: FAILED, no progress (loop in a chain?)\n";
+   write(1, msg, sizeof(msg) - 1);
+   _exit(1);
+}
+
+
+/* Allocate, fill and release buffers, to reuse any slot freed */
+static void* allocator(void* arg)
+{
+   int t = (int) arg;
+   char junk[FLEN];
+   memset(junk, 0xAA, FLEN);
+   while (running) {
+      FBUF b;
+      if (fbuf_new(&b, FBUF_ACC_OTHER, 0)) {
+         fbuf_write(&b, junk, FLEN);
+         fbuf_release(&b);
+         allocs[t]++;
+      }
+      sched_yield();
+   }
+   return NULL;
+}
+
+
+int main(void)
+{
+   pthread_t rt[NREADERS], at[NALLOC];
+   char f[FLEN];
+   int leaked = 0;
+
+   signal(SIGALRM, timeout);
+   alarm(60);
+   fbuf_init();
+
+   /* Connect within the slot another holder is reading */
+   char got[FLEN];
+   FBUF frame, ref, hdr;
+   pattern(f, 1);
+   fbuf_new(&frame, FBUF_ACC_RX, FLEN);
+   fbuf_write(&frame, f, FLEN);
+   ref = fbuf_newRef(&frame);
+   fbuf_rseek(&ref, 50);
+   fbuf_new(&hdr, FBUF_ACC_TX, NHLEN);
+   fbuf_write(&hdr, f, NHLEN);
+   CHECK(fbuf_connect(&hdr, &frame, 30));
+   for (int i=50; i<FLEN; i++)
+      got[i] = fbuf_getChar(&ref);
+   CHECK(memcmp(got + 50, f + 50, FLEN - 50) == 0);
+   fbuf_release(&hdr);
+   fbuf_release(&ref);
+   fbuf_release(&frame);
+   CHECK(fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0);
+
+   pthread_barrier_init(&start, NULL, NREADERS + 1);
+   pthread_barrier_init(&end, NULL, NREADERS + 1);
+   for (int t=0; t<NREADERS; t++)
+      pthread_create(&rt[t], NULL, reader, (void*) t);
+   for (int t=0; t<NALLOC; t++)
+      pthread_create(&at[t], NULL, allocator, (void*) t);
+
+   for (int r=0; r<ROUNDS; r++) {
+      round_no = r;
+      pattern(f, r);
+      /* As the decoder, with the header in a slot of its own, or not */
+      fbuf_new(&frame, FBUF_ACC_RX, HLEN);
+      if (r % 2) {
+         fbuf_write(&frame, f, HLEN);
+         fbuf_nextSlot(&frame, FLEN - HLEN);
+         fbuf_write(&frame, f + HLEN, FLEN - HLEN);
+      }
+      else
+         fbuf_write(&frame, f, FLEN);
+      for (int t=0; t<NREADERS; t++)
+         given[t] = fbuf_newRef(&frame);
+      pthread_barrier_wait(&start);
+      fbuf_release(&frame);
+      pthread_barrier_wait(&end);
+
+      fbacc_t a, tx;
+      fbuf_getAccount(FBUF_ACC_RX, &a);
+      fbuf_getAccount(FBUF_ACC_TX, &tx);
+      leaked += (a.used != 0 || tx.used != 0);
+   }
+   running = false;
+   for (int t=0; t<NALLOC; t++)
+      pthread_join(at[t], NULL);
+   for (int t=0; t<NREADERS; t++)
+      pthread_join(rt[t], NULL);
+
+   int nbad = 0, nbad_conn = 0, nconn = 0;
+   uint32_t nalloc = 0;
+   for (int t=0; t<NREADERS; t++) {
+      nbad += bad[t];
+      nbad_conn += bad_conn[t];
+      nconn += conns[t];
+   }
+   for (int t=0; t<NALLOC; t++)
+      nalloc += allocs[t];
+   printf("%d rounds, %d threads with %d references each, %u allocations meanwhile\n",
+      ROUNDS, NREADERS, REFS, nalloc);
+   printf("%d connects, %d frames read wrong, %d connected frames wrong, %d rounds with slots left\n",
+      nconn, nbad, nbad_conn, leaked);
+   CHECK(nbad == 0 && nbad_conn == 0 && leaked == 0);
+   CHECK(nconn == ROUNDS * NREADERS * CONNECTS);
+   CHECK(nalloc > 0);
+   CHECK(fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0);
+   CHECK(fbuf_check());
+   return check_done("test_fbref");
+}
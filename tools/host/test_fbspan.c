@@ -0,0 +1,197 @@
+/*
+ * Reading frame buffer chains by spans (fbuf.c). Random binary data,
+ * with many zero bytes, is written in random pieces, sometimes with
+ * another chain inserted, which leaves partly filled slots. The spans
+ * from fbuf_getSpan (from the start and after fbuf_rseek), fbuf_read,
+ * fbuf_getChar and fbuf_print must all give the data back, and
+ * fbuf_print must write one block per span.
+ *
+ * Also gives host bytes per second for writing, reading and printing
+ * frames in blocks, and a byte at a time as before.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "fbuf.h"
+#include "check.h"
+
+#define FRAMES    20000
+#define MAXLEN    600
+#define BENCH     1000000
+#define BLEN      100
+#define RING      16
+
+
+static double now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+static void rand_data(uint8_t* d, int n)
+{
+   for (int i=0; i<n; i++)
+      d[i] = (rand() % 3 == 0 ? 0 : rand());
+}
+
+
+/* Write data to b in random pieces */
+static void write_pieces(FBUF* b, const uint8_t* d, int n)
+{
+   int i = 0;
+   while (i < n) {
+      int k = 1 + rand() % 80;
+      if (k > n - i)
+         k = n - i;
+      fbuf_write(b, (const char*) d + i, k);
+      i += k;
+   }
+}
+
+
+/* Concatenate the spans from the read position. Returns the number of spans */
+static int spans(FBUF* b, uint8_t* out, int* len)
+{
+   const char* data;
+   uint16_t n;
+   int k = 0;
+   *len = 0;
+   while ((n = fbuf_getSpan(b, &data)) > 0) {
+      memcpy(out + *len, data, n);
+      *len += n;
+      k++;
+   }
+   return k;
+}
+
+
+int main(void)
+{
+   static uint8_t data[2*MAXLEN], ins[MAXLEN], out[2*MAXLEN], sbuf[2*MAXLEN];
+   host_stream_t st;
+   int bad_span = 0, bad_seek = 0, bad_read = 0, bad_char = 0, bad_print = 0;
+   int inserted = 0, zeros = 0;
+
+   srand(22);
+   fbuf_init();
+   for (int f=0; f<FRAMES; f++) {
+      FBUF b;
+      int len = rand() % MAXLEN, olen, nspans;
+      rand_data(data, len);
+      fbuf_new(&b, FBUF_ACC_OTHER, rand() % 2 ? 0 : len);
+      write_pieces(&b, data, len);
+      if (rand() % 3 == 0) {
+         FBUF x;
+         int n = rand() % 50, pos = rand() % (len + 1);
+         rand_data(ins, n);
+         fbuf_new(&x, FBUF_ACC_OTHER, 0);
+         fbuf_write(&x, (char*) ins, n);
+         if (fbuf_insert(&b, &x, pos)) {
+            memmove(data + pos + n, data + pos, len - pos);
+            memcpy(data + pos, ins, n);
+            len += n;
+            inserted++;
+         }
+         fbuf_release(&x);
+      }
+      for (int i=0; i<len; i++)
+         zeros += (data[i] == 0);
+
+      fbuf_reset(&b);
+      nspans = spans(&b, out, &olen);
+      bad_span += (olen != len || memcmp(out, data, len) != 0 || (len > 0 && !fbuf_eof(&b)));
+
+      int pos = rand() % (len + 1);
+      fbuf_rseek(&b, pos);
+      spans(&b, out, &olen);
+      bad_seek += (olen != len - pos || memcmp(out, data + pos, olen) != 0);
+
+      memset(out, 0xff, len);
+      bad_read += (fbuf_read(&b, 0, (char*) out) != len || memcmp(out, data, len) != 0);
+
+      fbuf_reset(&b);
+      for (int i=0; i<len; i++)
+         out[i] = fbuf_getChar(&b);
+      bad_char += (memcmp(out, data, len) != 0);
+
+      host_stream_init(&st, sbuf, sizeof(sbuf));
+      fbuf_print((Stream*) &st, &b);
+      bad_print += (st.len != len || memcmp(sbuf, data, len) != 0 || st.calls != nspans);
+      fbuf_release(&b);
+   }
+   printf("%d frames, %d with a chain inserted, %d zero bytes\n", FRAMES, inserted, zeros);
+   CHECK(bad_span == 0);
+   CHECK(bad_seek == 0);
+   CHECK(bad_read == 0);
+   CHECK(bad_char == 0);
+   CHECK(bad_print == 0);
+   CHECK(fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0 && fbuf_check());
+
+   /* Host bytes per second, 100 byte frames */
+   static FBUF fb[RING];
+   int ok = 0;
+   double t, wr_blk, wr_chr, rd_blk, rd_chr, pr_blk, pr_chr;
+   rand_data(data, BLEN);
+   for (int i=0; i<RING; i++)
+      fbuf_new(&fb[i], FBUF_ACC_RX, 0);
+
+   t = now();
+   for (int i=0; i<BENCH; i++) {
+      FBUF* b = &fb[i % RING];
+      fbuf_release(b);
+      fbuf_new(b, FBUF_ACC_RX, BLEN);
+      ok += fbuf_write(b, (char*) data, BLEN);
+   }
+   wr_blk = BENCH * BLEN / (now() - t);
+   t = now();
+   for (int i=0; i<BENCH; i++) {
+      FBUF* b = &fb[i % RING];
+      fbuf_release(b);
+      fbuf_new(b, FBUF_ACC_RX, BLEN);
+      for (int j=0; j<BLEN; j++)
+         ok += fbuf_putChar(b, data[j]);
+   }
+   wr_chr = BENCH * BLEN / (now() - t);
+   CHECK(ok == BENCH + BENCH * BLEN);
+
+   t = now();
+   for (int i=0; i<BENCH; i++)
+      fbuf_read(&fb[i % RING], BLEN, (char*) out);
+   rd_blk = BENCH * BLEN / (now() - t);
+   t = now();
+   for (int i=0; i<BENCH; i++) {
+      FBUF* b = &fb[i % RING];
+      fbuf_reset(b);
+      for (int j=0; j<BLEN; j++)
+         out[j] = fbuf_getChar(b);
+   }
+   rd_chr = BENCH * BLEN / (now() - t);
+   CHECK(memcmp(out, data, BLEN) == 0);
+
+   t = now();
+   for (int i=0; i<BENCH; i++) {
+      host_stream_init(&st, sbuf, sizeof(sbuf));
+      fbuf_print((Stream*) &st, &fb[i % RING]);
+   }
+   pr_blk = BENCH * BLEN / (now() - t);
+   t = now();
+   for (int i=0; i<BENCH; i++) {
+      FBUF* b = &fb[i % RING];
+      host_stream_init(&st, sbuf, sizeof(sbuf));
+      fbuf_reset(b);
+      for (int j=0; j<BLEN; j++)
+         streamPut(&st, fbuf_getChar(b));
+   }
+   pr_chr = BENCH * BLEN / (now() - t);
+   CHECK(st.len == BLEN && memcmp(sbuf, data, BLEN) == 0);
+
+   printf("Host MB/s, blocks vs bytes: write %.0f vs %.0f, read %.0f vs %.0f, print %.0f vs %.0f\n",
+      wr_blk / 1e6, wr_chr / 1e6, rd_blk / 1e6, rd_chr / 1e6, pr_blk / 1e6, pr_chr / 1e6);
+   for (int i=0; i<RING; i++)
+      fbuf_release(&fb[i]);
+   CHECK(fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0 && fbuf_check());
+   return check_done("test_fbspan");
+}
@@ -0,0 +1,236 @@
+/*
+ * Small and large slots in the frame buffer pool (fbuf.c). The class
+ * of a new slot must follow the size hint: the first slot from the
+ * hint given to fbuf_new, later ones from what is still expected or
+ * being written. When one class is used up, the other is used, but
+ * the rest of a slot copied for fbuf_connect must not go into a slot
+ * too small.
+ *
+ * Then replays synthetic APRS traffic (lengths of header and info
+ * field drawn from typical packet types) the way the decoder and the
+ * digipeater allocate, and gives slots and pool RAM per frame, and how
+ * many received frames the pool holds. The decoder leaves the header
+ * in slots of its own, so the digipeater's copy must not need any
+ * slots but those of its new header. The single class pool before
+ * (900 slots of 32 bytes) is computed for the same frames.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "fbuf.c"
+#include "ax25.h"
+#include "check.h"
+
+#define FRAMES      100000
+#define OLD_SLOTS   900
+#define OLD_SLOTSIZE 32
+#define OLD_SLOTRAM (OLD_SLOTSIZE + 4)             /* refcnt, length, next */
+#define SLOTRAM(i)  (SLOT_SIZE(i) + sizeof(fbslot_t) + 1)   /* and _slot_acc */
+
+
+static int chain_len(FBUF* b)
+{
+   int n = 0;
+   for (fbindex_t s = b->head; s != NILPTR; s = _pool[s].next)
+      n++;
+   return n;
+}
+
+static int chain_ram(FBUF* b, fbindex_t from)
+{
+   int n = 0;
+   for (fbindex_t s = (from == NILPTR ? b->head : from); s != NILPTR; s = _pool[s].next)
+      n += SLOTRAM(s);
+   return n;
+}
+
+/* Pool RAM of the slots in use */
+static int pool_used(void)
+{
+   return fbuf_usedSlots(FBUF_SMALL) * SLOTRAM(0)
+        + fbuf_usedSlots(FBUF_LARGE) * SLOTRAM(FBUF_SLOTS);
+}
+
+static int classes(FBUF* b, char* out)
+{
+   int n = 0;
+   for (fbindex_t s = b->head; s != NILPTR; s = _pool[s].next)
+      out[n++] = (SLOT_CLASS(s) == FBUF_LARGE ? 'L' : 's');
+   out[n] = '\0';
+   return n;
+}
+
+
+/* Write n bytes with the given hint, and give the classes of the chain */
+static const char* written(uint16_t hint, int n, bool bytewise)
+{
+   static char cls[40];
+   static char data[600];
+   FBUF b;
+   fbuf_new(&b, FBUF_ACC_OTHER, hint);
+   if (bytewise)
+      for (int i=0; i<n; i++)
+         fbuf_putChar(&b, data[i]);
+   else
+      fbuf_write(&b, data, n);
+   classes(&b, cls);
+   fbuf_release(&b);
+   return cls;
+}
+
+
+/* Number of digipeaters and length of info field, roughly as heard */
+static int rand_ndigis(void)
+{
+   int r = rand() % 100;
+   return (r < 10 ? 0 : r < 40 ? 1 : r < 85 ? 2 : 3);
+}
+
+static int rand_info(void)
+{
+   int r = rand() % 100;
+   if (r < 30) return 13 + rand() % 38;     /* Mic-E, short comment */
+   if (r < 65) return 27 + rand() % 64;     /* Position with comment */
+   if (r < 80) return 20 + rand() % 51;     /* Status, message */
+   if (r < 90) return 45 + rand() % 46;     /* Weather */
+   return 40 + rand() % 71;                 /* Object, telemetry */
+}
+
+/* As hdlc_decoder.c: the header in slots of its own */
+static bool received(FBUF* b, const char* f, int hlen, int len)
+{
+   return fbuf_new(b, FBUF_ACC_RX, hlen) && fbuf_write(b, f, hlen)
+       && fbuf_nextSlot(b, len - hlen) && fbuf_write(b, f + hlen, len - hlen);
+}
+
+static int old_slots(int n)
+   { return (n + OLD_SLOTSIZE - 1) / OLD_SLOTSIZE; }
+
+
+int main(void)
+{
+   static char frame[300];
+   for (int i=0; i<FBUF_ACCOUNTS; i++)
+      if (i != FBUF_ACC_RX)
+         _acc[i].min = 0;         /* RX may use all of the pool */
+   fbuf_init();
+
+   /* Class from hint */
+   CHECK(strcmp(written(0, 20, false), "s") == 0);
+   CHECK(strcmp(written(32, 32, false), "s") == 0);
+   CHECK(strcmp(written(33, 33, false), "L") == 0);
+   CHECK(strcmp(written(64, 64, false), "L") == 0);
+   CHECK(strcmp(written(65, 65, false), "Ls") == 0);
+   CHECK(strcmp(written(300, 300, false), "LLLLL") == 0);
+   CHECK(strcmp(written(0, 100, false), "sLs") == 0);
+   CHECK(strcmp(written(0, 100, true), "ssss") == 0);
+   CHECK(strcmp(written(100, 100, true), "LL") == 0);
+   CHECK(strcmp(written(40, 100, true), "Lss") == 0);
+   CHECK(strcmp(written(AX25_HDR_LEN(2), AX25_HDR_LEN(2), false), "s") == 0);
+   CHECK(fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0);
+
+   /* When small slots are used up, a small request gets a large slot */
+   static FBUF hold[FBUF_SLOTS + 1];
+   for (int i=0; i<FBUF_SLOTS; i++)
+      fbuf_new(&hold[i], FBUF_ACC_RX, 0);
+   CHECK(fbuf_freeSlots(FBUF_SMALL) == 0);
+   CHECK(fbuf_new(&hold[FBUF_SLOTS], FBUF_ACC_RX, 0) && SLOT_CLASS(hold[FBUF_SLOTS].head) == FBUF_LARGE);
+   for (int i=0; i<=FBUF_SLOTS; i++)
+      fbuf_release(&hold[i]);
+   CHECK(fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0 && fbuf_check());
+
+   /* No large slot left to copy the rest of a large slot into */
+   static FBUF lhold[FBUF_LSLOTS];
+   FBUF x, hdr;
+   char got[60];
+   memset(frame, 'x', 60);
+   for (int i=0; i<FBUF_LSLOTS; i++)
+      fbuf_new(&lhold[i], FBUF_ACC_RX, FBUF_LSLOTSIZE);
+   fbuf_release(&lhold[0]);
+   fbuf_new(&x, FBUF_ACC_RX, 60);
+   fbuf_write(&x, frame, 60);
+   fbuf_new(&hdr, FBUF_ACC_TX, 0);
+   fbuf_write(&hdr, frame, 16);
+   CHECK(fbuf_freeSlots(FBUF_LARGE) == 0 && SLOT_CLASS(x.head) == FBUF_LARGE);
+   CHECK(!fbuf_connect(&hdr, &x, 20));
+   CHECK(fbuf_length(&x) == 60 && chain_len(&x) == 1 && fbuf_read(&x, 0, got) == 60
+         && memcmp(got, frame, 60) == 0 && fbuf_check());
+   fbuf_release(&lhold[1]);
+   CHECK(fbuf_connect(&hdr, &x, 20) && fbuf_length(&hdr) == 56 && fbuf_check());
+   fbuf_release(&hdr);
+   fbuf_release(&x);
+   for (int i=1; i<FBUF_LSLOTS; i++)
+      fbuf_release(&lhold[i]);
+   CHECK(fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0 && fbuf_check());
+
+   /* Replay: Received frames, and a digipeated copy of each */
+   double rx_slots = 0, rx_ram = 0, dg_slots = 0, dg_ram = 0, len_sum = 0;
+   double old_rx = 0, old_dg = 0;
+   int copied = 0, bad_len = 0;
+   srand(25);
+   for (int f=0; f<FRAMES; f++) {
+      int nd = rand_ndigis(), hlen = AX25_HDR_LEN(nd), len = hlen + rand_info();
+      FBUF rx, hdr;
+      len_sum += len;
+
+      received(&rx, frame, hlen, len);
+      rx_slots += chain_len(&rx);
+      rx_ram += chain_ram(&rx, NILPTR);
+      old_rx += old_slots(len);
+
+      /* As digipeater.c: new header, connected to the rest of the frame */
+      int nd2 = (nd < 3 ? nd + 1 : nd), h2 = AX25_HDR_LEN(nd2);
+      int before = pool_used();
+      fbuf_new(&hdr, FBUF_ACC_TX, h2);
+      fbuf_write(&hdr, frame, h2);
+      int hdr_ram = pool_used() - before;
+      fbuf_connect(&hdr, &rx, hlen);
+      copied += (pool_used() - before != hdr_ram);
+      dg_slots += chain_len(&hdr);
+      dg_ram += pool_used() - before;
+      old_dg += old_slots(h2) + (hlen % OLD_SLOTSIZE != 0);
+      bad_len += (fbuf_length(&hdr) != h2 + len - hlen);
+      fbuf_release(&hdr);
+      fbuf_release(&rx);
+   }
+   CHECK(copied == 0 && bad_len == 0);
+   CHECK(fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0 && fbuf_check());
+
+   printf("%d frames, mean length %.1f bytes\n", FRAMES, len_sum / FRAMES);
+   printf("Received frame:   %.2f slots, %.0f bytes of pool (before: %.2f slots, %.0f bytes)\n",
+      rx_slots / FRAMES, rx_ram / FRAMES, old_rx / FRAMES, old_rx / FRAMES * OLD_SLOTRAM);
+   printf("Digipeated copy:  %.2f slots in chain, %.0f bytes more (before: %.2f slots more, %.0f bytes)\n",
+      dg_slots / FRAMES, dg_ram / FRAMES, old_dg / FRAMES, old_dg / FRAMES * OLD_SLOTRAM);
+
+   /* Hold received frames until the pool is full */
+   static FBUF held[2000];
+   int n = 0, old_n = 0, old_used = 0;
+   bool full = false, old_full = false;
+   srand(26);
+   while (!(full && old_full) && n < 2000) {
+      int hlen = AX25_HDR_LEN(rand_ndigis()), len = hlen + rand_info();
+      if (!old_full && old_used + old_slots(len) <= OLD_SLOTS) {
+         old_used += old_slots(len);
+         old_n++;
+      }
+      else
+         old_full = true;
+      if (!full && received(&held[n], frame, hlen, len))
+         n++;
+      else if (!full) {
+         fbuf_release(&held[n]);
+         full = true;
+      }
+   }
+   int pool_ram = FBUF_SLOTS * SLOTRAM(0) + FBUF_LSLOTS * SLOTRAM(FBUF_SLOTS);
+   printf("Frames held: %d in %d bytes (before: %d in %d bytes)\n",
+      n, pool_ram, old_n, OLD_SLOTS * OLD_SLOTRAM);
+   CHECK(fbuf_check());
+   for (int i=0; i<n; i++)
+      fbuf_release(&held[i]);
+
+   CHECK(rx_slots < old_rx && dg_ram < old_dg * OLD_SLOTRAM);
+   CHECK(pool_ram <= OLD_SLOTS * OLD_SLOTRAM);
+   CHECK(fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0 && fbuf_check());
+   return check_done("test_fbtier");
+}
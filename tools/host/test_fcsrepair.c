@@ -0,0 +1,204 @@
+/*
+ * FCS repair in the HDLC decoder (fcs_recover in hdlc_decoder.c).
+ * Frames are given to the deframer as the demodulator gives them:
+ * octets of bits with a confidence (0-15) for each bit. Bit errors are
+ * put in with low confidence, among other bits of low confidence that
+ * are right. Frames with up to two such errors must come out intact
+ * and be counted as repaired. More errors, errors in bits that are
+ * not among the least confident ones, or FCS_TRIES set to 0 must not
+ * give a frame.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "hdlc_decoder.c"
+#include "check.h"
+
+#define TRIALS   400
+#define MAXBITS  ((MAX_HDLC_FRAME_SIZE + 8) * 10)
+
+static FBQ rxq;
+static hdlc_sub_t sub;
+static hdlc_rx_t* rx = &decoder[0];
+
+/* Bits on the air (stuffed, with flags) and their confidence */
+static uint8_t air[MAXBITS], air_conf[MAXBITS];
+static int nair;
+
+
+static void put_air(uint8_t bit, uint8_t conf)
+{
+   air[nair] = bit;
+   air_conf[nair++] = conf;
+}
+
+static void put_flag(void)
+{
+   for (int i=0; i<8; i++)
+      put_air((0x7E >> i) & 1, 15);
+}
+
+
+/* Stuff the data bits, with a flag before and after */
+static void transmit(const uint8_t* bits, const uint8_t* conf, int n)
+{
+   int ones = 0;
+   nair = 0;
+   put_flag();
+   put_flag();
+   for (int i=0; i<n; i++) {
+      put_air(bits[i], conf[i]);
+      ones = (bits[i] ? ones + 1 : 0);
+      if (ones == 5) {
+         put_air(0, 15);
+         ones = 0;
+      }
+   }
+   put_flag();
+   put_flag();
+}
+
+
+/* Give the bits to the deframer, an octet (and its confidence) at a time */
+static void receive(void)
+{
+   while (nair % 8 != 0)
+      put_air(nair % 2, 15);     // Fill with alternating bits, not a flag
+   for (int i=0; i<nair; i += 8) {
+      uint8_t octet = 0;
+      uint32_t conf = 0;
+      for (int j=0; j<8; j++) {
+         octet |= air[i+j] << j;
+         conf |= (uint32_t) air_conf[i+j] << (j*4);
+      }
+      deframe_octet(rx, octet, conf);
+   }
+}
+
+
+static uint16_t make_frame(uint8_t* f)
+{
+   static const char call[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+   uint16_t n = 0, len = 20 + rand() % 200;
+   for (int i=0; i<14; i++)
+      f[n++] = (i % 7 == 6 ? 0x60 | (i == 13) : call[rand() % 36] << 1);
+   f[n++] = 0x03;
+   f[n++] = 0xF0;
+   while (n < len)
+      f[n++] = rand();
+   return n;
+}
+
+
+/*
+ * Send a frame with the given number of errors. 'decoys' correct bits
+ * also get low confidence. If 'strong', the errors have high
+ * confidence. Returns 1 if the frame came out right, 0 if nothing
+ * came out, -1 if a wrong frame came out.
+ */
+static int trial(int errors, int decoys, bool strong)
+{
+   static uint8_t frame[MAX_HDLC_FRAME_SIZE], bits[MAXBITS], conf[MAXBITS], used[MAXBITS];
+   uint16_t len = make_frame(frame);
+   uint16_t crc = crc_ccitt_block(0xFFFF, frame, len) ^ 0xFFFF;
+   int n = 0, result = 0;
+   FBUF b;
+
+   for (int i=0; i<len+2; i++) {
+      uint8_t octet = (i < len ? frame[i] : i == len ? crc & 0xFF : crc >> 8);
+      for (int j=0; j<8; j++) {
+         bits[n] = (octet >> j) & 1;
+         used[n] = false;
+         conf[n++] = 8 + rand() % 8;
+      }
+   }
+   /* Errors and decoys at distinct positions, after the address field */
+   for (int i=0; i<errors + decoys; i++) {
+      int pos;
+      do
+         pos = 16*8 + rand() % (n - 16*8);
+      while (used[pos]);
+      used[pos] = true;
+      if (i < errors) {
+         bits[pos] ^= 1;
+         conf[pos] = (strong ? 15 : rand() % 3);
+      }
+      else
+         conf[pos] = rand() % 4;
+   }
+   transmit(bits, conf, n);
+   receive();
+
+   while (fbq_tryGet(&rxq, &b)) {
+      char got[MAX_HDLC_FRAME_SIZE];
+      uint16_t glen = fbuf_read(&b, sizeof(got), got);
+      result = (result == 0 && glen == len && memcmp(got, frame, len) == 0 ? 1 : -1);
+      fbuf_release(&b);
+   }
+   return result;
+}
+
+
+int main(void)
+{
+   int ok[4] = {0}, wrong[4] = {0};
+   uint32_t decoded, unique, recovered, before;
+
+   srand(2);
+   fbuf_init();
+   FBQ_INIT(rxq, 4);
+   hdlc_subscribe_rx(&sub, "TEST", &rxq, HDLC_DROP_NEWEST, 0);
+   rx->id = 0;
+
+   /* 0, 1 and 2 errors among 8 weak bits are repaired, with enough
+    * tries for all single bits and pairs of the WEAK_BITS remembered.
+    * 3 are not */
+   hdlc_rx_setFcsTries(WEAK_BITS + WEAK_BITS * (WEAK_BITS-1) / 2);
+   for (int e=0; e<4; e++) {
+      hdlc_rx_variantStats(0, &decoded, &unique, &before);
+      for (int t=0; t<TRIALS; t++) {
+         int r = trial(e, 8 - e, false);
+         ok[e] += (r > 0);
+         wrong[e] += (r < 0);
+      }
+      hdlc_rx_variantStats(0, &decoded, &unique, &recovered);
+      printf("%d errors: %d of %d frames right, %d wrong, %u repaired\n",
+         e, ok[e], TRIALS, wrong[e], recovered - before);
+      CHECK(wrong[e] == 0);
+      if (e == 0)
+         CHECK(ok[e] == TRIALS && recovered == before);
+      else if (e <= 2)
+         CHECK(ok[e] == TRIALS && recovered - before == TRIALS);
+      else
+         CHECK(ok[e] == 0);
+   }
+
+   /* For information: Two errors with the default number of tries */
+   int def = 0;
+   hdlc_rx_setFcsTries(FCS_TRIES_default);
+   for (int t=0; t<TRIALS; t++)
+      def += (trial(2, 6, false) > 0);
+   printf("2 errors, FCS_TRIES=%d: %d of %d frames repaired\n", FCS_TRIES_default, def, TRIALS);
+
+   /* Errors in bits that are not among the weak ones */
+   int r = 0;
+   for (int t=0; t<TRIALS; t++)
+      r += (trial(1, WEAK_BITS, true) != 0);
+   CHECK(r == 0);
+
+   /* Repair turned off */
+   r = 0;
+   hdlc_rx_setFcsTries(0);
+   for (int t=0; t<TRIALS; t++)
+      r += (trial(1, 0, false) != 0);
+   CHECK(r == 0);
+
+   /* Single bits are tried before pairs, so as many tries as there
+    * are weak bits repair a single error */
+   r = 0;
+   hdlc_rx_setFcsTries(WEAK_BITS);
+   for (int t=0; t<TRIALS; t++)
+      r += (trial(1, WEAK_BITS - 1, false) <= 0);
+   CHECK(r == 0);
+   return check_done("test_fcsrepair");
+}
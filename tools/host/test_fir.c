@@ -0,0 +1,120 @@
+/*
+ * FIR kernels of the demodulator (fir_filter in afsk_rx.c) against a
+ * plain reference: shifting delay line, one sample at a time. The
+ * output must be the same, bit for bit, for all filters, for blocks
+ * of any size (the delay line carries over between blocks), in place
+ * or not, and when the result saturates.
+ *
+ * Built twice: test_fir uses the portable C kernel, test_fir_dsp the
+ * Cortex-M4 one (SMLAD), with the DSP instructions emulated. Both
+ * also print the time per sample on the host.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(HOST_DSP)
+#define __ARM_FEATURE_DSP 1
+static inline uint32_t __SMLAD(uint32_t x, uint32_t y, uint32_t acc)
+{
+   return acc + (int32_t) (int16_t) x * (int16_t) y
+              + (int32_t) (int16_t) (x >> 16) * (int16_t) (y >> 16);
+}
+#define __SSAT(x, n) ((x) > (1 << ((n)-1)) - 1 ? (1 << ((n)-1)) - 1 : (x) < -(1 << ((n)-1)) ? -(1 << ((n)-1)) : (x))
+#endif
+
+#include "afsk_rx.c"
+#include "check.h"
+
+#define NSAMPLES 20000
+#define NFILTERS (FIR_9600_LP + 1)
+
+
+/* Reference filter: mem[0] is the newest sample */
+typedef struct {
+   int16_t mem[FIR_MAX_TAPS];
+} RefState;
+
+static int16_t ref_filter(enum fir_filters f, RefState* st, int16_t in)
+{
+   int32_t y = 0;
+   for (int k = fir_table[f].taps - 1; k > 0; k--)
+      st->mem[k] = st->mem[k-1];
+   st->mem[0] = in;
+   for (int k = 0; k < fir_table[f].taps; k++)
+      y += (int32_t) st->mem[k] * fir_table[f].coef[k];
+   y >>= 7;
+   return (int16_t) (y > INT16_MAX ? INT16_MAX : y < INT16_MIN ? INT16_MIN : y);
+}
+
+
+static int16_t in[NSAMPLES], out[NSAMPLES], ref[NSAMPLES];
+
+static void check_filter(enum fir_filters f, int range, bool inplace)
+{
+   FirState st;
+   RefState rst;
+   size_t i, n;
+
+   memset(&st, 0, sizeof(st));
+   memset(&rst, 0, sizeof(rst));
+   for (i=0; i<NSAMPLES; i++) {
+      in[i] = (int16_t) (rand() % (2*range + 1) - range);
+      ref[i] = ref_filter(f, &rst, in[i]);
+   }
+   memcpy(out, in, sizeof(out));
+   for (i=0; i<NSAMPLES; i += n) {
+      n = 1 + rand() % AFSK_RX_BLOCKSIZE;
+      if (i + n > NSAMPLES)
+         n = NSAMPLES - i;
+      if (inplace)
+         fir_filter(f, &st, out+i, out+i, n);
+      else
+         fir_filter(f, &st, in+i, out+i, n);
+   }
+   for (i=0; i<NSAMPLES && out[i] == ref[i]; i++)
+      ;
+   if (i < NSAMPLES)
+      fprintf(stderr, "filter %d, range %d: sample %zu is %d, expected %d\n", f, range, i, out[i], ref[i]);
+   CHECK(i == NSAMPLES);
+}
+
+
+static double ns_per_sample(enum fir_filters f)
+{
+   FirState st;
+   struct timespec t0, t1;
+   int rounds = 200;
+
+   memset(&st, 0, sizeof(st));
+   clock_gettime(CLOCK_MONOTONIC, &t0);
+   for (int r=0; r<rounds; r++)
+      for (size_t i=0; i + AFSK_RX_BLOCKSIZE <= NSAMPLES; i += AFSK_RX_BLOCKSIZE)
+         fir_filter(f, &st, in+i, out+i, AFSK_RX_BLOCKSIZE);
+   clock_gettime(CLOCK_MONOTONIC, &t1);
+   double ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+   return ns / ((double) rounds * (NSAMPLES - NSAMPLES % AFSK_RX_BLOCKSIZE));
+}
+
+
+int main(void)
+{
+   srand(1);
+   for (int f=0; f<NFILTERS; f++) {
+      CHECK(fir_table[f].taps % 2 == 0 && fir_table[f].taps <= FIR_MAX_TAPS);
+      check_filter(f, 128, false);      // ADC samples
+      check_filter(f, 256, true);       // Tone difference, in place
+      check_filter(f, 32767, false);    // Saturates
+   }
+   printf("Host ns/sample:");
+   for (int f=0; f<NFILTERS; f++)
+      printf(" %.2f", ns_per_sample(f));
+   printf(" (filters 0-%d)\n", NFILTERS-1);
+#if defined(HOST_DSP)
+   return check_done("test_fir_dsp");
+#else
+   return check_done("test_fir");
+#endif
+}
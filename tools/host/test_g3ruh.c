@@ -0,0 +1,233 @@
+/*
+ * G3RUH 9600 baud (afsk_tx.c, afsk_rx.c). The bits on the line are
+ * scrambled with x^17 + x^12 + 1 and each is sent as a raised cosine
+ * pulse (alpha = 1) over 4 bits, 4 DAC samples per bit. The DAC output
+ * of the transmitter is compared with this model, sample by sample,
+ * over several transmissions (the scrambler is not reset between them).
+ *
+ * The descrambler is then given unshaped bits scrambled by the model,
+ * from a random state, and must sync up within the preamble. Last, the
+ * transmitter output goes through a noisy channel to the receiver, and
+ * every frame must come out. The air time and throughput on the clean
+ * channel are printed, with those of AFSK 1200 for the same frames.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rig.h"
+#include "hdlc.h"
+#include "afsk.h"
+#include "check.h"
+
+#define NFRAMES     20
+#define SPB         4                   /* Samples per bit */
+#define MAXBITS     (1 << 18)
+#define MAXAUDIO    (RIG_G3RUH_RATE * 2)
+#define MIDLEVEL    2048
+#define AMPLITUDE   1811                /* Of a long run of equal bits */
+#define TOLERANCE   8
+#define LEVEL       60                  /* At the ADC */
+
+static FBQ rxq;
+static hdlc_sub_t sub;
+
+/* Scrambled bits, of all transmissions in G3RUH mode so far */
+static uint8_t scr[MAXBITS];
+static int nscr;
+
+
+static double noise(double rms)
+{
+   double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = rand() / (RAND_MAX + 1.0);
+   return rms * sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+
+/* Frame number seq, the same each time */
+static uint16_t make_frame(FBUF* b, int seq, char* f)
+{
+   uint32_t r = seq * 2654435761u;
+   uint16_t n = 16;
+   memcpy(f, "\x82\xa0\xb4\x82\xa4\x86\x60\x98\x82\x60\xa8\xa6\xa8\x61\x03\xf0", 16);
+   n += sprintf(f+n, ">G3RUH %d ", seq);
+   for (int i = (r >> 8) % 200; i > 0; i--) {
+      r = r * 1103515245 + 12345;
+      f[n++] = ' ' + (r >> 16) % 95;
+   }
+   fbuf_new(b, FBUF_ACC_OTHER, n);
+   fbuf_write(b, f, n);
+   return n;
+}
+
+
+/* Bits on the line, as the transmitter sends them: NRZI flags before
+ * and after the rendered bits, starting at level 0 */
+static int line_bits(const uint8_t* buf, uint16_t nbits, uint16_t pre, uint16_t post, uint8_t* out)
+{
+   uint8_t last = 0;
+   int n = 0;
+   for (int i=0; i<pre; i++)
+      for (int j=0; j<8; j++)
+         out[n++] = (0x7F >> j) & 1;
+   for (int i=0; i<nbits; i++)
+      out[n++] = last = (buf[i >> 3] >> (i & 7)) & 1;
+   for (int i=0; i<post; i++)
+      for (int j=0; j<8; j++)
+         out[n++] = ((last ? 0x80 : 0x7F) >> j) & 1;
+   return n;
+}
+
+
+/* s(n) = d(n) + s(n-12) + s(n-17), mod 2 */
+static void scramble(const uint8_t* d, int n)
+{
+   for (int i=0; i<n; i++, nscr++)
+      scr[nscr] = d[i] ^ (nscr >= 12 ? scr[nscr-12] : 0) ^ (nscr >= 17 ? scr[nscr-17] : 0);
+}
+
+
+/* Raised cosine pulse, alpha = 1, t in bits */
+static double pulse(double t)
+{
+   if (fabs(fabs(t) - 0.5) < 1e-9)
+      return M_PI / 4 * sin(M_PI * t) / (M_PI * t);
+   double sinc = (t == 0 ? 1 : sin(M_PI * t) / (M_PI * t));
+   return sinc * cos(M_PI * t) / (1 - 4 * t * t);
+}
+
+
+/* DAC level at sample j of scrambled bit i. The pulse of a bit peaks
+ * two bits after it is sent. */
+static double model(int i, int j)
+{
+   double y = 0;
+   for (int k=0; k<4; k++)
+      y += (i >= k && scr[i-k] ? 1 : -1) * pulse((j + 0.5) / SPB + k - 2);
+   return MIDLEVEL + AMPLITUDE * y;
+}
+
+
+/* Demodulate and decode, and count the frames that came out right */
+static int receive(int8_t* x, size_t n, char frames[][300], const uint16_t* len, int nf)
+{
+   int ok = 0;
+   FBUF b;
+   for (size_t i=0; i<n; i += AFSK_RX_BLOCKSIZE) {
+      rig_rx_block(x + i, (n - i < AFSK_RX_BLOCKSIZE ? n - i : AFSK_RX_BLOCKSIZE));
+      rig_dec_poll(false);
+   }
+   rig_dec_poll(true);
+   while (fbq_tryGet(&rxq, &b)) {
+      char got[300];
+      uint16_t glen = fbuf_read(&b, sizeof(got), got);
+      for (int i=0; i<nf; i++)
+         if (glen == len[i] && memcmp(got, frames[i], glen) == 0) {
+            ok++;
+            break;
+         }
+      fbuf_release(&b);
+   }
+   return ok;
+}
+
+
+int main(void)
+{
+   static uint16_t audio[MAXAUDIO];
+   static int8_t adc[MAXAUDIO];
+   static uint8_t line[MAXBITS];
+   static char frames[NFRAMES][300];
+   static uint16_t len[NFRAMES];
+   const uint8_t* bits;
+   uint16_t pre, post, nbits;
+   FBUF b;
+
+   srand(7);
+   fbuf_init();
+   rig_enc_init();
+   afsk_tx_init();
+   rig_rx_init();
+   rig_dec_init();
+   FBQ_INIT(rxq, NFRAMES);
+   hdlc_subscribe_rx(&sub, "TEST", &rxq, HDLC_DROP_NEWEST, 0);
+
+   /* AFSK 1200 air time, for comparison */
+   double afsk_time = 0;
+   afsk_tx_setMode(MODEM_AFSK1200);
+   for (int i=0; i<NFRAMES; i++) {
+      len[i] = make_frame(&b, i, frames[i]);
+      hdlc_tx_put(b, HDLC_TX_OTHER, 0);
+      nbits = rig_enc_render(&bits, &pre, &post);
+      afsk_time += (nbits + (pre + post) * 8) / 1200.0;
+   }
+
+   /* Transmitter output against the model */
+   double g3ruh_time = 0;
+   int bad = 0, wrong_len = 0, ok = 0;
+   afsk_tx_setMode(MODEM_G3RUH9600);
+   rig_rx_setMode(MODEM_G3RUH9600);
+   for (int i=0; i<NFRAMES; i++) {
+      int first = nscr;
+      len[i] = make_frame(&b, i, frames[i]);
+      hdlc_tx_put(b, HDLC_TX_OTHER, 0);
+      nbits = rig_enc_render(&bits, &pre, &post);
+      int nl = line_bits(bits, nbits, pre, post, line);
+      scramble(line, nl);
+      size_t n = rig_tx_g3ruh(bits, nbits, pre, post, audio, MAXAUDIO);
+      wrong_len += (n != (size_t) nl * SPB);
+      for (size_t k=0; k<n; k++)
+         bad += (fabs(audio[k] - model(first + k / SPB, k % SPB)) > TOLERANCE);
+      g3ruh_time += (double) n / RIG_G3RUH_RATE;
+
+      /* The same through a channel with noise */
+      for (size_t k=0; k<n; k++)
+         adc[k] = (int8_t) lrint((audio[k] - MIDLEVEL) * LEVEL / (double) AMPLITUDE + noise(LEVEL / 10.0));
+      memset(adc + n, 0, RIG_G3RUH_RATE / 10);
+      ok += receive(adc, n + RIG_G3RUH_RATE / 10, &frames[i], &len[i], 1);
+   }
+   CHECK(wrong_len == 0);
+   CHECK(bad == 0);
+   CHECK(ok == NFRAMES);
+
+   /* Descrambler, from a random state, without the shaping */
+   int dok = 0;
+   rig_rx_reset();
+   for (int i=0; i<NFRAMES; i++) {
+      nscr = 0;
+      for (int k=0; k<17; k++)
+         scr[nscr++] = rand() & 1;
+      len[i] = make_frame(&b, i, frames[i]);
+      hdlc_tx_put(b, HDLC_TX_OTHER, 0);
+      nbits = rig_enc_render(&bits, &pre, &post);
+      int nl = line_bits(bits, nbits, pre, post, line);
+      scramble(line, nl);
+      for (int k=0; k<nl * SPB; k++)
+         adc[k] = (scr[17 + k / SPB] ? LEVEL : -LEVEL);
+      memset(adc + nl * SPB, 0, RIG_G3RUH_RATE / 10);
+      dok += receive(adc, nl * SPB + RIG_G3RUH_RATE / 10, &frames[i], &len[i], 1);
+   }
+   CHECK(dok == NFRAMES);
+
+   /* Back to AFSK */
+   afsk_tx_setMode(MODEM_AFSK1200);
+   rig_rx_setMode(MODEM_AFSK1200);
+   len[0] = make_frame(&b, 0, frames[0]);
+   hdlc_tx_put(b, HDLC_TX_OTHER, 0);
+   nbits = rig_enc_render(&bits, &pre, &post);
+   size_t n = rig_synth(bits, nbits, pre, post, LEVEL, adc, MAXAUDIO);
+   memset(adc + n, 0, RIG_RX_RATE / 10);
+   CHECK(receive(adc, n + RIG_RX_RATE / 10, frames, len, 1) == 1);
+
+   int payload = 0;
+   for (int i=0; i<NFRAMES; i++)
+      payload += len[i] * 8;
+   printf("%d frames, %d bytes: G3RUH %.1f ms/frame, %.0f bit/s; AFSK 1200 %.1f ms/frame, %.0f bit/s\n",
+      NFRAMES, payload / 8, g3ruh_time / NFRAMES * 1000, payload / g3ruh_time,
+      afsk_time / NFRAMES * 1000, payload / afsk_time);
+   printf("G3RUH at SNR 20 dB: %d of %d frames; descrambler from random state: %d of %d\n",
+      ok, NFRAMES, dok, NFRAMES);
+   CHECK(fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0);
+   return check_done("test_g3ruh");
+}
@@ -0,0 +1,125 @@
+/*
+ * Receiving noise (hdlc_decoder.c): The demodulator finds flags and
+ * starts frames in noise all the time. These garbage frames must not
+ * take anything from the frame buffer pool, since a frame is only
+ * copied there when its FCS is right. Frames that are right must
+ * still get through, and their buffers must go back to the pool.
+ *
+ * Also prints the host time the decoder spends on noise.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rig.h"
+#include "hdlc.h"
+#include "afsk.h"
+#include "check.h"
+
+#define NOISE_SEC  120
+#define NFRAMES    10
+#define BLOCK      32
+#define MAXAUDIO   (RIG_RX_RATE * 2)
+
+static FBQ rxq;
+static hdlc_sub_t sub;
+static double dec_ns;
+
+
+static double now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static int8_t noise(double rms)
+{
+   double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = rand() / (RAND_MAX + 1.0);
+   double x = rms * sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+   return (int8_t) (x > 127 ? 127 : x < -127 ? -127 : x);
+}
+
+
+/* Demodulate and decode, timing the decoder */
+static void receive(int8_t* x, size_t n)
+{
+   for (size_t i=0; i+BLOCK <= n; i += BLOCK) {
+      rig_rx_block(x + i, BLOCK);
+      double t = now();
+      rig_dec_poll(false);
+      dec_ns += now() - t;
+   }
+}
+
+
+static bool pool_idle(void)
+{
+   fbacc_t a;
+   fbuf_getAccount(FBUF_ACC_RX, &a);
+   return a.used == 0 && a.hwm == 0 && a.fails == 0
+      && fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0;
+}
+
+
+int main(void)
+{
+   static int8_t audio[MAXAUDIO];
+   hdlc_rxstat_t st;
+   FBUF b;
+
+   srand(11);
+   fbuf_init();
+   rig_enc_init();
+   rig_rx_init();
+   rig_dec_init();
+   FBQ_INIT(rxq, NFRAMES);
+   hdlc_subscribe_rx(&sub, "TEST", &rxq, HDLC_DROP_NEWEST, 0);
+   hdlc_rx_getStats(&st, true);
+
+   /* Noise alone */
+   for (int s=0; s<NOISE_SEC; s++) {
+      for (int i=0; i<RIG_RX_RATE; i++)
+         audio[i] = noise(40);
+      receive(audio, RIG_RX_RATE);
+   }
+   rig_dec_poll(true);
+   hdlc_rx_getStats(&st, false);
+   printf("%d s of noise: %u flags, %u frames started, %u aborts, %u oversize, %u FCS errors\n",
+      NOISE_SEC, st.flags, st.frames, st.aborts, st.oversize, st.fcs_errors);
+   printf("Host time in the decoder: %.0f ns per second of noise\n", dec_ns / NOISE_SEC);
+   CHECK(st.frames > 100 && st.fcs_errors > 0);
+   CHECK(st.delivered == 0 && !fbq_tryGet(&rxq, &b));
+   CHECK(pool_idle());
+
+   /* Frames in the noise get through, and their buffers are released */
+   int got = 0;
+   for (int seq=0; seq<NFRAMES; seq++) {
+      const uint8_t* bits;
+      uint16_t pre, post, nbits;
+      char text[32];
+      int tlen = sprintf(text, ">Frame %d in noise", seq);
+      fbuf_new(&b, FBUF_ACC_OTHER, 0);
+      fbuf_write(&b, "\x82\xa0\xb4\x82\xa4\x86\x60\x98\x82\x60\xa8\xa6\xa8\x61\x03\xf0", 16);
+      fbuf_write(&b, text, tlen);
+      hdlc_tx_put(b, HDLC_TX_OTHER, 0);
+      nbits = rig_enc_render(&bits, &pre, &post);
+      size_t n = rig_synth(bits, nbits, pre, post, 60, audio, MAXAUDIO);
+      for (size_t i=0; i<n + RIG_RX_RATE/10; i++)
+         audio[i] = (i < n ? audio[i] : 0) / 2 + noise(4);
+      receive(audio, n + RIG_RX_RATE/10);
+      rig_dec_poll(true);
+      while (fbq_tryGet(&rxq, &b)) {
+         got++;
+         fbuf_release(&b);
+      }
+   }
+   fbacc_t a;
+   fbuf_getAccount(FBUF_ACC_RX, &a);
+   CHECK(got == NFRAMES);
+   CHECK(a.used == 0 && a.hwm > 0 && fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0);
+   return check_done("test_noiserx");
+}
@@ -0,0 +1,108 @@
+/*
+ * Receive path with its threads, as on the target: Samples are given
+ * one at a time to afsk_rx_sample (as from the ADC callback), the
+ * demodulator thread takes them from the ring a block at a time, and
+ * the HDLC decoder thread decodes the bits and delivers the frames.
+ *
+ * The samples are fed in bursts of odd sizes, so that blocks are
+ * handed over at every position in the bursts, and at about the rate
+ * of the ADC, so that the ring does not overflow.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "rig.h"
+#include "hdlc.h"
+#include "afsk.h"
+#include "defines.h"
+#include "check.h"
+
+#define NFRAMES   40
+#define MAXAUDIO  (RIG_RX_RATE * 2)
+
+static int8_t audio[MAXAUDIO];
+static FBQ rxq;
+static hdlc_sub_t sub;
+
+
+static uint16_t make_frame(uint8_t* f, int seq)
+{
+   static const uint8_t hdr[16] = {
+      'A'<<1, 'P'<<1, 'Z'<<1, 'A'<<1, 'R'<<1, 'C'<<1, 0x60,
+      'L'<<1, 'A'<<1, '0'<<1, 'T'<<1, 'S'<<1, 'T'<<1, 0x61,
+      0x03, 0xF0 };
+   memcpy(f, hdr, sizeof(hdr));
+   uint16_t n = sizeof(hdr) + sprintf((char*) f + sizeof(hdr), ">%04d ", seq);
+   for (int i=0; i < seq * 7 % 120; i++)
+      f[n++] = "0123456789ABCDEF~"[(seq + i) % 17];
+   return n;
+}
+
+
+static void feed(const int8_t* x, size_t n, size_t* burst)
+{
+   size_t i = 0;
+   while (i < n) {
+      size_t b = (*burst % 45) + 1;
+      *burst += 7;
+      for (size_t j=0; j<b && i<n; j++)
+         afsk_rx_sample(x[i++]);
+      while (rig_rx_ringlen() > AFSK_RX_RINGSIZE / 2)
+         usleep(200);
+   }
+}
+
+
+int main(void)
+{
+   static uint8_t frame[NFRAMES][200];
+   static uint16_t len[NFRAMES];
+   size_t burst = 0;
+   const uint8_t* bits;
+   uint16_t pre, post, nbits;
+   FBUF b;
+
+   fbuf_init();
+   rig_enc_init();
+   rig_rx_init();
+   hdlc_init_decoder(afsk_rx_queue(0), 0);
+   FBQ_INIT(rxq, NFRAMES);
+   hdlc_subscribe_rx(&sub, "TEST", &rxq, HDLC_DROP_NEWEST, MS2ST(1000));
+   afsk_rx_enable();
+
+   for (int seq=0; seq<NFRAMES; seq++) {
+      len[seq] = make_frame(frame[seq], seq);
+      fbuf_new(&b, FBUF_ACC_OTHER, len[seq]);
+      fbuf_write(&b, (char*) frame[seq], len[seq]);
+      hdlc_tx_put(b, HDLC_TX_OTHER, 0);
+      nbits = rig_enc_render(&bits, &pre, &post);
+      CHECK(nbits > 0);
+      size_t n = rig_synth(bits, nbits, pre, post, 60, audio, MAXAUDIO);
+      memset(audio + n, 0, RIG_RX_RATE / 10);
+      feed(audio, n + RIG_RX_RATE / 10, &burst);
+   }
+   /* Let the threads finish */
+   while (rig_rx_ringlen() >= AFSK_RX_BLOCKSIZE)
+      usleep(1000);
+   usleep(200000);
+
+   int got = 0;
+   while (fbq_tryGet(&rxq, &b)) {
+      char buf[200];
+      uint16_t n = fbuf_read(&b, sizeof(buf), buf);
+      CHECK(got < NFRAMES && n == len[got] && memcmp(buf, frame[got], n) == 0);
+      fbuf_release(&b);
+      got++;
+   }
+   CHECK(got == NFRAMES);
+   CHECK(afsk_rx_overruns() == 0);
+
+   afsk_prof_t p;
+   afsk_rx_getProfile(&p, false);
+   CHECK(p.samples > 0 && p.samples % AFSK_RX_BLOCKSIZE == 0);
+   printf("%d of %d frames, %u samples in blocks of %d, ring max %u\n",
+      got, NFRAMES, p.samples, AFSK_RX_BLOCKSIZE, p.ring_hwm);
+   return check_done("test_rxpath");
+}
@@ -0,0 +1,191 @@
+/*
+ * Receive fan-out with a stalled subscriber (hdlc_decoder.c). The
+ * receive path runs with its threads, and samples are given at twice
+ * the ADC rate. One subscriber takes its frames at once; the others
+ * never read their queues. A thread subscribes and unsubscribes all
+ * the time, while frames are delivered.
+ *
+ * With HDLC_DROP_NEWEST and HDLC_DROP_OLDEST, the stalled queues must
+ * not hold up the decoder: the prompt subscriber gets every frame,
+ * and the stalled ones count what they miss. For comparison, a stalled
+ * HDLC_BLOCK subscriber with a long timeout (as the old blocking
+ * delivery) must lose frames for everyone.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "rig.h"
+#include "hdlc.h"
+#include "afsk.h"
+#include "defines.h"
+#include "check.h"
+
+#define NFRAMES   12
+#define MAXAUDIO  (RIG_RX_RATE * 2)
+
+static int8_t audio[MAXAUDIO];
+static FBQ fastq, newq, oldq, blockq, churnq;
+static hdlc_sub_t fast, stall_new, stall_old, stall_block, churn;
+static uint16_t len[NFRAMES];
+static uint8_t frame[NFRAMES][100];
+static int got, got_bad;
+static volatile bool churning;
+static uint32_t churns;
+
+
+static uint16_t make_frame(uint8_t* f, int seq)
+{
+   static const uint8_t hdr[16] = {
+      'A'<<1, 'P'<<1, 'Z'<<1, 'A'<<1, 'R'<<1, 'C'<<1, 0x60,
+      'L'<<1, 'A'<<1, '0'<<1, 'T'<<1, 'S'<<1, 'T'<<1, 0x61,
+      0x03, 0xF0 };
+   memcpy(f, hdr, sizeof(hdr));
+   return sizeof(hdr) + sprintf((char*) f + sizeof(hdr), ">Stall test %04d", seq);
+}
+
+
+/* The prompt subscriber */
+static void take_frames(void)
+{
+   FBUF b;
+   while (fbq_tryGet(&fastq, &b)) {
+      char buf[100];
+      uint16_t n = fbuf_read(&b, sizeof(buf), buf);
+      bool ok = false;
+      for (int i=0; i<NFRAMES; i++)
+         ok |= (n == len[i] && memcmp(buf, frame[i], n) == 0);
+      got += ok;
+      got_bad += !ok;
+      fbuf_release(&b);
+   }
+}
+
+
+/* Give samples to afsk_rx_sample at twice the ADC rate */
+static void feed(const int8_t* x, size_t n)
+{
+   struct timespec t0, t;
+   clock_gettime(CLOCK_MONOTONIC, &t0);
+   for (size_t i=0; i<n; i += 32) {
+      for (size_t j=i; j<i+32 && j<n; j++)
+         afsk_rx_sample(x[j]);
+      take_frames();
+      double due = (double) i / (2 * RIG_RX_RATE);
+      do {
+         clock_gettime(CLOCK_MONOTONIC, &t);
+         if ((t.tv_sec - t0.tv_sec) + (t.tv_nsec - t0.tv_nsec) * 1e-9 >= due)
+            break;
+         usleep(100);
+      } while (true);
+   }
+}
+
+
+static THD_WORKING_AREA(wa_churn, 1024);
+static THD_FUNCTION(churner, arg)
+{
+   while (churning) {
+      hdlc_subscribe_rx(&churn, "CHURN", &churnq, HDLC_DROP_NEWEST, 0);
+      usleep(300);
+      hdlc_unsubscribe_rx(&churn);
+      usleep(200);
+      churns++;
+   }
+}
+
+
+/* Send all frames, return number of octets lost in the decoder queue */
+static uint32_t run(void)
+{
+   const uint8_t* bits;
+   uint16_t pre, post, nbits;
+   afsk_rxstat_t st;
+   FBUF b;
+
+   afsk_rx_getStats(&st, true);
+   got = got_bad = 0;
+   for (int seq=0; seq<NFRAMES; seq++) {
+      fbuf_new(&b, FBUF_ACC_OTHER, len[seq]);
+      fbuf_write(&b, (char*) frame[seq], len[seq]);
+      hdlc_tx_put(b, HDLC_TX_OTHER, 0);
+      nbits = rig_enc_render(&bits, &pre, &post);
+      size_t n = rig_synth(bits, nbits, pre, post, 60, audio, MAXAUDIO);
+      memset(audio + n, 0, RIG_RX_RATE / 10);
+      feed(audio, n + RIG_RX_RATE / 10);
+   }
+   usleep(200000);
+   take_frames();
+   afsk_rx_getStats(&st, false);
+   return st.iq_overflows;
+}
+
+
+int main(void)
+{
+   hdlc_substat_t ss[HDLC_MAX_SUBSCRIBERS];
+   FBUF b;
+
+   fbuf_init();
+   rig_enc_init();
+   rig_rx_init();
+   hdlc_init_decoder(afsk_rx_queue(0), 0);
+   FBQ_INIT(fastq, NFRAMES);
+   FBQ_INIT(newq, 2);
+   FBQ_INIT(oldq, 2);
+   FBQ_INIT(blockq, 1);
+   FBQ_INIT(churnq, 2);
+   for (int i=0; i<NFRAMES; i++)
+      len[i] = make_frame(frame[i], i);
+   afsk_rx_enable();
+
+   /* Stalled subscribers that drop */
+   hdlc_subscribe_rx(&fast, "FAST", &fastq, HDLC_DROP_NEWEST, 0);
+   hdlc_subscribe_rx(&stall_new, "NEWEST", &newq, HDLC_DROP_NEWEST, 0);
+   hdlc_subscribe_rx(&stall_old, "OLDEST", &oldq, HDLC_DROP_OLDEST, 0);
+   churning = true;
+   chThdCreateStatic(wa_churn, sizeof(wa_churn), NORMALPRIO, churner, NULL);
+   uint32_t lost = run();
+   churning = false;
+   usleep(10000);
+
+   printf("Dropping: prompt subscriber got %d of %d frames, %u octets lost, %u (un)subscribes\n",
+      got, NFRAMES, lost, churns);
+   CHECK(got == NFRAMES && got_bad == 0 && lost == 0);
+   CHECK(churns > 100);
+   CHECK(hdlc_rx_subStats(ss, HDLC_MAX_SUBSCRIBERS) == 3);
+   for (int i=0; i<3; i++) {
+      printf("  %-6s delivered %u, dropped %u\n", ss[i].name, ss[i].delivered, ss[i].dropped);
+      if (strcmp(ss[i].name, "FAST") == 0)
+         CHECK(ss[i].delivered == NFRAMES && ss[i].dropped == 0);
+      else if (strcmp(ss[i].name, "NEWEST") == 0)
+         CHECK(ss[i].delivered == 2 && ss[i].dropped == NFRAMES - 2);
+      else
+         CHECK(ss[i].delivered == NFRAMES && ss[i].dropped == NFRAMES - 2);
+   }
+   /* Drop oldest keeps the last two */
+   for (int i=NFRAMES-2; i<NFRAMES; i++) {
+      char buf[100];
+      CHECK(fbq_tryGet(&oldq, &b));
+      CHECK(fbuf_read(&b, sizeof(buf), buf) == len[i] && memcmp(buf, frame[i], len[i]) == 0);
+      fbuf_release(&b);
+   }
+
+   /* For comparison: A stalled subscriber that blocks the decoder */
+   hdlc_subscribe_rx(&stall_block, "BLOCK", &blockq, HDLC_BLOCK, MS2ST(500));
+   lost = run();
+   printf("Blocking (500 ms): prompt subscriber got %d of %d frames, %u octets lost\n",
+      got, NFRAMES, lost);
+   CHECK(got < NFRAMES && lost > 0);
+
+   /* Everything goes back to the pool */
+   hdlc_unsubscribe_rx(&stall_block);
+   hdlc_unsubscribe_rx(&stall_old);
+   hdlc_unsubscribe_rx(&stall_new);
+   hdlc_unsubscribe_rx(&fast);
+   CHECK(hdlc_rx_subStats(ss, HDLC_MAX_SUBSCRIBERS) == 0);
+   CHECK(fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0);
+   return check_done("test_substall");
+}
@@ -0,0 +1,173 @@
+/*
+ * Tone generator (tone.c) through a WAV file. The real sample
+ * generator is run from the emulated DAC interrupts (rig_tx.c), and
+ * asks afsk_tx_nextBit for a new bit every 22 samples at 26400 Hz.
+ * The output is compared with a model of the phase accumulator, bit
+ * by bit: the tone must switch at the boundaries and nowhere else,
+ * with the phase running on. The tone stops when the bit after the
+ * last is asked for, so the samples of the last bit still in the DAC
+ * buffer are not sent (the postamble flags are there for that).
+ *
+ * All transmissions are written to a WAV file at the DAC rate, which
+ * is then read back, resampled to the ADC rate and decoded. Every
+ * frame must come out.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rig.h"
+#include "hdlc.h"
+#include "afsk.h"
+#include "check.h"
+
+#define NFRAMES     30
+#define SPB         (RIG_TX_RATE / 1200)
+#define GAP         (RIG_TX_RATE / 5)
+#define MAXAUDIO    (RIG_TX_RATE * 60)
+#define MAXBITS     (1 << 14)
+#define DACBUF_SIZE 16
+#define TOLERANCE   2
+#define WAVGAIN     8                   /* DAC counts to WAV */
+#define LEVEL       60                  /* Peak at the ADC */
+#define WAVFILE     "build/test_tonewav.wav"
+
+static FBQ rxq;
+static hdlc_sub_t sub;
+
+
+/* Frame number seq, the same each time */
+static uint16_t make_frame(FBUF* b, int seq, char* f)
+{
+   uint32_t r = seq * 2654435761u;
+   uint16_t n = 16;
+   memcpy(f, "\x82\xa0\xb4\x82\xa4\x86\x60\x98\x82\x60\xa8\xa6\xa8\x61\x03\xf0", 16);
+   n += sprintf(f+n, ">Tone %d ", seq);
+   for (int i = (r >> 8) % 200; i > 0; i--) {
+      r = r * 1103515245 + 12345;
+      f[n++] = ' ' + (r >> 16) % 95;
+   }
+   fbuf_new(b, FBUF_ACC_OTHER, n);
+   fbuf_write(b, f, n);
+   return n;
+}
+
+
+/* Line levels, as the transmitter sends them: NRZI flags before and
+ * after the rendered bits, starting at level 0 */
+static int line_bits(const uint8_t* buf, uint16_t nbits, uint16_t pre, uint16_t post, uint8_t* out)
+{
+   uint8_t last = 0;
+   int n = 0;
+   for (int i=0; i<pre; i++)
+      for (int j=0; j<8; j++)
+         out[n++] = (0x7F >> j) & 1;
+   for (int i=0; i<nbits; i++)
+      out[n++] = last = (buf[i >> 3] >> (i & 7)) & 1;
+   for (int i=0; i<post; i++)
+      for (int j=0; j<8; j++)
+         out[n++] = ((last ? 0x80 : 0x7F) >> j) & 1;
+   return n;
+}
+
+
+/* Phase accumulator of the tone generator. The tone and the phase
+ * carry over from one transmission to the next. */
+static uint32_t phase = 0;
+static bool high = false;
+
+static int model(const uint8_t* line, int nl, const uint16_t* out, size_t n)
+{
+   uint32_t inc = 0;
+   uint8_t level = 0;
+   int bad = 0;
+   for (size_t k=0; k<n; k++) {
+      if (k % SPB == 0) {
+         uint8_t b = (k / SPB < (size_t) nl ? line[k / SPB] : level);
+         high ^= (b != level);
+         level = b;
+         inc = (uint32_t) (((uint64_t) (high ? AFSK_SPACE : AFSK_MARK) << 32) / RIG_TX_RATE);
+      }
+      double y = 2050 + 2000 * sin(2 * M_PI * (phase >> 24) / 256.0);
+      bad += (fabs(out[k] - y) > TOLERANCE);
+      phase += inc;
+   }
+   /* The rest of the last bit was generated, but not sent */
+   for (size_t k=n; k < (size_t) nl * SPB; k++)
+      phase += inc;
+   return bad;
+}
+
+
+int main(void)
+{
+   static uint16_t audio[MAXAUDIO];
+   static int16_t wav[MAXAUDIO];
+   static uint8_t line[MAXBITS];
+   static char frames[NFRAMES][300];
+   static uint16_t len[NFRAMES];
+   const uint8_t* bits;
+   uint16_t pre, post, nbits;
+   size_t nwav = GAP;
+   int bad = 0, short_tx = 0;
+   FBUF b;
+
+   fbuf_init();
+   rig_enc_init();
+   afsk_tx_init();
+   rig_rx_init();
+   rig_dec_init();
+   FBQ_INIT(rxq, NFRAMES);
+   hdlc_subscribe_rx(&sub, "TEST", &rxq, HDLC_DROP_NEWEST, 0);
+
+   /* Transmit, against the model, and into the WAV file with a gap
+    * before each transmission */
+   memset(wav, 0, sizeof(wav));
+   for (int i=0; i<NFRAMES; i++) {
+      len[i] = make_frame(&b, i, frames[i]);
+      hdlc_tx_put(b, HDLC_TX_OTHER, 0);
+      nbits = rig_enc_render(&bits, &pre, &post);
+      int nl = line_bits(bits, nbits, pre, post, line);
+      size_t n = rig_tx_audio(bits, nbits, pre, post, audio, MAXAUDIO - nwav - GAP);
+      short_tx += (n > (size_t) nl * SPB || n + DACBUF_SIZE < (size_t) nl * SPB);
+      bad += model(line, nl, audio, n);
+      for (size_t k=0; k<n; k++)
+         wav[nwav + k] = (int16_t) ((audio[k] - 2048) * WAVGAIN);
+      nwav += n + GAP;
+   }
+   CHECK(short_tx == 0);
+   CHECK(bad == 0);
+   CHECK(rig_wav_write(WAVFILE, wav, nwav, RIG_TX_RATE));
+
+   /* Read it back and decode it, at the level the ADC gives */
+   static int8_t adc[MAXAUDIO];
+   double *in, *x;
+   uint32_t rate = 0;
+   size_t n = rig_wav_read(WAVFILE, &in, &rate);
+   CHECK(n == nwav && rate == RIG_TX_RATE);
+   size_t m = rig_resample(in, n, rate, RIG_RX_RATE, &x);
+   for (size_t k=0; k<m; k++)
+      adc[k] = (int8_t) lrint(x[k] * 32768 / (2000 * WAVGAIN) * LEVEL);
+   for (size_t k=0; k<m; k += AFSK_RX_BLOCKSIZE) {
+      rig_rx_block(adc + k, (m - k < AFSK_RX_BLOCKSIZE ? m - k : AFSK_RX_BLOCKSIZE));
+      rig_dec_poll(false);
+   }
+   rig_dec_poll(true);
+
+   int ok = 0, seq = 0;
+   while (fbq_tryGet(&rxq, &b)) {
+      char got[300];
+      uint16_t glen = fbuf_read(&b, sizeof(got), got);
+      ok += (seq < NFRAMES && glen == len[seq] && memcmp(got, frames[seq], glen) == 0);
+      seq++;
+      fbuf_release(&b);
+   }
+   printf("%d frames, %.1f s at %u Hz in %s: %d decoded, %d samples off the model\n",
+      NFRAMES, (double) nwav / RIG_TX_RATE, rate, WAVFILE, ok, bad);
+   CHECK(ok == NFRAMES && seq == NFRAMES);
+   free(in);
+   free(x);
+   CHECK(fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0);
+   return check_done("test_tonewav");
+}
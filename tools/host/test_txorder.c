@@ -0,0 +1,108 @@
+/*
+ * Order of bit clock, PTT and tone (afsk_tx.c). The bit clock (GPT)
+ * and DAC are only to run while there is something to send: started
+ * when a transmission is ready (or before, to warm up while waiting
+ * for the channel) and stopped when it is done. The transmitter is
+ * keyed by the first clock interrupt after that, and the tone is
+ * started after the PTT. At the end, the PTT goes off and the tone
+ * stops before the clock does. A stop request while sending is
+ * ignored.
+ *
+ * The timer, interrupt and PTT stubs report what happens through
+ * host_event_hook.
+ */
+
+#include <string.h>
+#include "ch.h"
+#include "hal.h"
+#include "rig.h"
+#include "hdlc.h"
+#include "afsk.h"
+#include "check.h"
+
+#define MAXAUDIO  (RIG_TX_RATE * 4)
+
+static char events[256];
+static bool ptt;
+
+static void record(int ev, void* arg)
+{
+   static const char* name[] = { "", "start ", "run ", "halt ", "stop ", "irq+ ", "irq- ", "ptt+ ", "ptt- " };
+   if (ev == HOST_EV_PTT_ON || ev == HOST_EV_PTT_OFF)
+      ptt = (ev == HOST_EV_PTT_ON);
+   if (strlen(events) + 8 < sizeof(events))
+      strcat(events, name[ev]);
+}
+
+
+/* Render a transmission of one frame */
+static uint16_t render(const uint8_t** bits, uint16_t* pre, uint16_t* post)
+{
+   static const char f[] = "\x82\xa0\xb4\x82\xa4\x86\x60\x98\x82\x60\xa8\xa6\xa8\x61\x03\xf0>Test";
+   FBUF b;
+   fbuf_new(&b, FBUF_ACC_OTHER, 0);
+   fbuf_write(&b, f, sizeof(f) - 1);
+   hdlc_tx_put(b, HDLC_TX_OTHER, 0);
+   return rig_enc_render(bits, pre, post);
+}
+
+
+int main(void)
+{
+   static uint16_t audio[MAXAUDIO];
+   const uint8_t* bits;
+   uint16_t pre, post, nbits;
+
+   fbuf_init();
+   rig_enc_init();
+   afsk_tx_init();
+   host_event_hook = record;
+
+   /* Idle: Nothing runs */
+   CHECK(!host_gpt_tick(&AFSK_TX_GPT));
+   CHECK(afsk_tx_irqCount() == 0);
+
+   /* One transmission */
+   nbits = render(&bits, &pre, &post);
+   rig_tx_audio(bits, nbits, pre, post, audio, MAXAUDIO);
+   printf("Send:              %s\n", events);
+   CHECK(strcmp(events, "start run ptt+ irq+ ptt- irq- halt stop ") == 0);
+   CHECK(!ptt && !host_gpt_tick(&AFSK_TX_GPT));
+
+   /* Warmed up before the transmission is handed over, as the encoder
+    * does while waiting for the channel: Not keyed until then, and
+    * the clock is not started twice */
+   events[0] = '\0';
+   nbits = render(&bits, &pre, &post);
+   afsk_tx_start();
+   for (int i=0; i<10; i++)
+      host_gpt_tick(&AFSK_TX_GPT);
+   CHECK(strcmp(events, "start run ") == 0 && !ptt);
+   rig_tx_audio(bits, nbits, pre, post, audio, MAXAUDIO);
+   printf("Warm up, send:     %s\n", events);
+   CHECK(strcmp(events, "start run ptt+ irq+ ptt- irq- halt stop ") == 0);
+
+   /* G3RUH: No tone, the clock drives the DAC. Stopping while sending
+    * is ignored */
+   afsk_tx_setMode(MODEM_G3RUH9600);
+   events[0] = '\0';
+   nbits = render(&bits, &pre, &post);
+   afsk_tx_send(bits, nbits, pre, post, false);
+   host_gpt_tick(&AFSK_TX_GPT);
+   CHECK(ptt);
+   afsk_tx_stop();
+   int ticks = 0;
+   while (ptt && host_gpt_tick(&AFSK_TX_GPT))
+      ticks++;
+   afsk_tx_wait();
+   CHECK(!ptt && ticks > (pre + post) * 8 * 4);
+   afsk_tx_stop();
+   printf("G3RUH, stop, send: %s\n", events);
+   CHECK(strcmp(events, "start run ptt+ ptt- halt stop ") == 0);
+   afsk_tx_setMode(MODEM_AFSK1200);
+
+   /* Idle again */
+   uint32_t irqs = afsk_tx_irqCount();
+   CHECK(!host_gpt_tick(&AFSK_TX_GPT) && afsk_tx_irqCount() == irqs);
+   return check_done("test_txorder");
+}
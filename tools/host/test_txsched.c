@@ -0,0 +1,305 @@
+/*
+ * Transmit scheduler (hdlc_encoder.c): classes served in priority
+ * order, time to live, MAXFRAME bundling and the frame left pending
+ * when a bundle is full. Frames are queued with hdlc_tx_put and the
+ * transmissions rendered as the encoder thread does; the monitor
+ * queue tells what went into each. Time is moved forward with
+ * host_time_advance.
+ *
+ * Then a simulation of an hour of mixed load on a shared channel:
+ * digipeats, beacons and bursts of object reports. It prints the
+ * time digipeats wait, with the classes and with all frames in one
+ * FIFO as before.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ch.h"
+#include "hal.h"
+#include "rig.h"
+#include "hdlc.h"
+#include "config.h"
+#include "defines.h"
+#include "check.h"
+
+#define HDRLEN    16
+#define MAXID     20000
+
+static FBQ monq;
+static const uint8_t* bits;
+static uint16_t pre, post;
+
+
+/* Queue a frame with an id and a kind in the info field */
+static void put(char kind, int id, uint16_t len, uint8_t cls, systime_t ttl)
+{
+   static const uint8_t hdr[HDRLEN] = {
+      'A'<<1, 'P'<<1, 'Z'<<1, 'A'<<1, 'R'<<1, 'C'<<1, 0x60,
+      'L'<<1, 'A'<<1, '0'<<1, 'T'<<1, 'S'<<1, 'T'<<1, 0x61,
+      0x03, 0xF0 };
+   char info[1024];
+   FBUF b;
+   sprintf(info, "%c%05d", kind, id);
+   memset(info + 6, 'x', len - 6);
+   fbuf_new(&b, FBUF_ACC_OTHER, 0);
+   fbuf_write(&b, (const char*) hdr, HDRLEN);
+   fbuf_write(&b, info, len);
+   hdlc_tx_put(b, cls, ttl);
+}
+
+
+/* Render a transmission. Put the kind and id of each frame in it into
+ * sent (up to max of them), return the number of frames */
+static int render(char* kinds, int* ids, int max, uint16_t* nbits)
+{
+   FBUF b;
+   int n = 0;
+   *nbits = rig_enc_render(&bits, &pre, &post);
+   while (fbq_tryGet(&monq, &b)) {
+      char f[HDRLEN + 8] = {0};
+      char* info = f + HDRLEN;
+      fbuf_read(&b, HDRLEN + 6, f);
+      if (n < max) {
+         kinds[n] = info[0];
+         ids[n] = atoi(info + 1);
+      }
+      n++;
+      fbuf_release(&b);
+   }
+   return n;
+}
+
+static int render_ids(int* ids, int max)
+{
+   char kinds[8];
+   uint16_t nbits;
+   return render(kinds, ids, max, &nbits);
+}
+
+
+
+/*********************************************************************
+ * Simulation. Times in system ticks. The channel is also used by
+ * other stations, a random half second every 4 s on average.
+ *********************************************************************/
+
+#define SIM_TIME     S2ST(3600)
+#define DIGI_EVERY   S2ST(4)
+#define BEACON_EVERY S2ST(30)
+#define REPORT_EVERY S2ST(60)
+#define REPORT_BURST 6
+#define OTHER_EVERY  S2ST(4)
+#define OTHER_LEN    MS2ST(500)
+#define TX_GAP       MS2ST(100)
+
+typedef struct {
+   uint32_t sent, expired, full;
+   double wait_sum, wait_max;
+} simstat_t;
+
+static systime_t arrived[MAXID];
+
+static systime_t exp_interval(systime_t mean)
+   { return (systime_t) (-log((rand() + 1.0) / (RAND_MAX + 2.0)) * mean); }
+
+
+static void simulate(bool classes, simstat_t* digi, simstat_t* other)
+{
+   systime_t start = chVTGetSystemTimeX(), now = 0;
+   systime_t next_digi = exp_interval(DIGI_EVERY), next_beacon = BEACON_EVERY / 2;
+   systime_t next_report = REPORT_EVERY / 3, next_other = exp_interval(OTHER_EVERY);
+   systime_t free = 0, busy_until = 0;
+   int id = 0, ndigi = 0;
+   hdlc_txstat_t st;
+
+   memset(digi, 0, sizeof(*digi));
+   memset(other, 0, sizeof(*other));
+   for (int c=0; c<HDLC_TX_CLASSES; c++)
+      hdlc_tx_getStats(c, &st, true);
+
+   while (now < SIM_TIME && id < MAXID - REPORT_BURST) {
+      /* New frames */
+      if (now >= next_digi) {
+         uint8_t cls = (classes ? HDLC_TX_DIGI : HDLC_TX_OTHER);
+         if (hdlc_tx_waiting(cls) < HDLC_TXCLASS_QUEUE_SIZE) {
+            arrived[id] = now;
+            put('D', id++, 60, cls, HDLC_TTL_DIGI);
+            ndigi++;
+         }
+         else
+            digi->full++;
+         next_digi += exp_interval(DIGI_EVERY);
+         continue;
+      }
+      if (now >= next_beacon || now >= next_report) {
+         bool beacon = (now >= next_beacon);
+         uint8_t cls = (!classes ? HDLC_TX_OTHER : beacon ? HDLC_TX_BEACON : HDLC_TX_REPORT);
+         for (int i=0; i < (beacon ? 1 : REPORT_BURST); i++)
+            if (hdlc_tx_waiting(cls) < HDLC_TXCLASS_QUEUE_SIZE) {
+               arrived[id] = now;
+               put(beacon ? 'B' : 'R', id++, beacon ? 50 : 90, cls,
+                   beacon ? HDLC_TTL_BEACON : HDLC_TTL_NONE);
+            }
+            else
+               other->full++;
+         if (beacon)
+            next_beacon += BEACON_EVERY;
+         else
+            next_report += REPORT_EVERY;
+         continue;
+      }
+      if (now >= next_other) {
+         if (busy_until < now + OTHER_LEN)
+            busy_until = now + OTHER_LEN;
+         next_other += exp_interval(OTHER_EVERY);
+         continue;
+      }
+
+      /* Transmit when the channel is free */
+      if (now >= free && now >= busy_until && hdlc_enc_packets_waiting()) {
+         char kinds[8];
+         int ids[8];
+         uint16_t nbits;
+         int n = render(kinds, ids, 8, &nbits);
+         for (int i=0; i<n && i<8; i++) {
+            simstat_t* s = (kinds[i] == 'D' ? digi : other);
+            double w = (double) ST2MS(now - arrived[ids[i]]) / 1000;
+            s->sent++;
+            s->wait_sum += w;
+            if (w > s->wait_max)
+               s->wait_max = w;
+         }
+         free = now + (systime_t) (((pre + post) * 8 + nbits) * (uint64_t) CH_CFG_ST_FREQUENCY / 1200) + TX_GAP;
+         if (nbits > 0)
+            continue;
+      }
+
+      /* Go to the next event */
+      systime_t next = next_digi;
+      if (next_beacon < next) next = next_beacon;
+      if (next_report < next) next = next_report;
+      if (next_other < next) next = next_other;
+      if (hdlc_enc_packets_waiting()) {
+         systime_t t = (free > busy_until ? free : busy_until);
+         if (t > now && t < next)
+            next = t;
+      }
+      host_time_advance(next - now);
+      now = next;
+   }
+
+   /* Drop what is left */
+   host_time_advance(S2ST(60));
+   while (hdlc_enc_packets_waiting()) {
+      int ids[8];
+      render_ids(ids, 8);
+   }
+   for (int c=0; c<HDLC_TX_CLASSES; c++) {
+      hdlc_tx_getStats(c, &st, true);
+      if (c == HDLC_TX_DIGI || !classes)
+         digi->expired += st.expired;
+      else
+         other->expired += st.expired;
+   }
+   (void) start;
+   (void) ndigi;
+}
+
+
+
+int main(void)
+{
+   hdlc_txstat_t st;
+   int ids[8];
+   uint16_t nbits;
+   char kinds[8];
+
+   srand(17);
+   fbuf_init();
+   rig_enc_init();
+   FBQ_INIT(monq, 8);
+   hdlc_monitor_tx(&monq);
+
+   /* Priority: A digipeat goes before reports queued earlier */
+   SET_BYTE_PARAM(MAXFRAME, 1);
+   put('R', 1, 20, HDLC_TX_REPORT, 0);
+   put('B', 2, 20, HDLC_TX_BEACON, 0);
+   put('D', 3, 20, HDLC_TX_DIGI, HDLC_TTL_DIGI);
+   CHECK(render_ids(ids, 8) == 1 && ids[0] == 3);
+   CHECK(render_ids(ids, 8) == 1 && ids[0] == 2);
+   CHECK(render_ids(ids, 8) == 1 && ids[0] == 1);
+   CHECK(render_ids(ids, 8) == 0 && !hdlc_enc_packets_waiting());
+
+   /* Bundling: Frames of the class of the first one go first, then
+    * the others in order of priority */
+   SET_BYTE_PARAM(MAXFRAME, 3);
+   put('R', 4, 20, HDLC_TX_REPORT, 0);
+   put('O', 5, 20, HDLC_TX_OTHER, 0);
+   put('R', 6, 20, HDLC_TX_REPORT, 0);
+   put('B', 7, 20, HDLC_TX_BEACON, 0);
+   CHECK(render_ids(ids, 8) == 3 && ids[0] == 7 && ids[1] == 4 && ids[2] == 6);
+   CHECK(render_ids(ids, 8) == 1 && ids[0] == 5);
+
+   /* Time to live: An expired frame is dropped and counted, one that
+    * has not expired is sent, and the wait is counted */
+   for (int c=0; c<HDLC_TX_CLASSES; c++)
+      hdlc_tx_getStats(c, &st, true);
+   put('D', 8, 20, HDLC_TX_DIGI, HDLC_TTL_DIGI);
+   put('B', 9, 20, HDLC_TX_BEACON, HDLC_TTL_BEACON);
+   host_time_advance(HDLC_TTL_DIGI + S2ST(1));
+   CHECK(render_ids(ids, 8) == 1 && ids[0] == 9);
+   hdlc_tx_getStats(HDLC_TX_DIGI, &st, true);
+   CHECK(st.expired == 1 && st.sent == 0);
+   hdlc_tx_getStats(HDLC_TX_BEACON, &st, true);
+   CHECK(st.expired == 0 && st.sent == 1 && st.wait_max >= 6000 && st.wait_max < 6100);
+
+   /* A frame that does not fit is left pending for the next
+    * transmission, and dropped if it expires before that */
+   put('R', 10, 390, HDLC_TX_REPORT, 0);
+   put('R', 11, 390, HDLC_TX_REPORT, 0);
+   put('D', 12, 390, HDLC_TX_DIGI, HDLC_TTL_DIGI);
+   CHECK(render(kinds, ids, 8, &nbits) == 2 && ids[0] == 12 && ids[1] == 10);
+   CHECK(rig_enc_pending());
+   put('D', 13, 20, HDLC_TX_DIGI, HDLC_TTL_DIGI);
+   CHECK(render_ids(ids, 8) == 2 && ids[0] == 11 && ids[1] == 13);
+
+   put('D', 14, 390, HDLC_TX_DIGI, HDLC_TTL_DIGI);
+   put('D', 15, 390, HDLC_TX_DIGI, HDLC_TTL_DIGI);
+   put('D', 16, 390, HDLC_TX_DIGI, HDLC_TTL_DIGI);
+   put('R', 17, 20, HDLC_TX_REPORT, 0);
+   CHECK(render_ids(ids, 8) == 2 && ids[0] == 14 && ids[1] == 15 && rig_enc_pending());
+   host_time_advance(HDLC_TTL_DIGI + S2ST(1));
+   CHECK(render_ids(ids, 8) == 1 && ids[0] == 17 && !rig_enc_pending());
+   hdlc_tx_getStats(HDLC_TX_DIGI, &st, true);
+   CHECK(st.expired == 1);
+
+   /* Too large for the transmit buffer: Dropped */
+   put('O', 18, 900, HDLC_TX_OTHER, 0);
+   CHECK(render_ids(ids, 8) == 0 && !hdlc_enc_packets_waiting());
+   hdlc_tx_getStats(HDLC_TX_OTHER, &st, true);
+   CHECK(st.oversize == 1);
+   CHECK(fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0);
+
+   /* Simulation, MAXFRAME 2 */
+   simstat_t d[2], o[2];
+   SET_BYTE_PARAM(MAXFRAME, 2);
+   for (int c=0; c<2; c++) {
+      srand(17);
+      simulate(c == 1, &d[c], &o[c]);
+   }
+   printf("One hour: digipeat every %u s, beacon every %u s, %d reports every %u s, "
+          "other stations %u ms every %u s\n",
+      (unsigned) ST2MS(DIGI_EVERY) / 1000, (unsigned) ST2MS(BEACON_EVERY) / 1000, REPORT_BURST,
+      (unsigned) ST2MS(REPORT_EVERY) / 1000, (unsigned) ST2MS(OTHER_LEN), (unsigned) ST2MS(OTHER_EVERY) / 1000);
+   printf("           digipeats: sent  wait s  max s  expired  full | others: sent  wait s  max s\n");
+   for (int c=0; c<2; c++)
+      printf("%-8s %16u  %6.2f  %5.2f  %7u  %4u | %13u  %6.2f  %5.2f\n", c ? "Classes" : "FIFO",
+         d[c].sent, d[c].wait_sum / d[c].sent, d[c].wait_max, d[c].expired, d[c].full,
+         o[c].sent, o[c].wait_sum / o[c].sent, o[c].wait_max);
+   CHECK(d[1].wait_sum / d[1].sent < d[0].wait_sum / d[0].sent);
+   CHECK(d[1].wait_max < d[0].wait_max && d[1].expired <= d[0].expired);
+   CHECK(fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0);
+   return check_done("test_txsched");
+}
@@ -0,0 +1,126 @@
+/*
+ * Table driven HDLC encoder (hdlc_encode_frames in hdlc_encoder.c)
+ * against a bit at a time reference: FCS, a zero stuffed after every
+ * five ones, a flag between frames and NRZI. The transmissions must
+ * be the same, bit for bit, with one or more frames in each, and also
+ * when a frame ends with five ones (the zero then goes before the
+ * flag after it).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "rig.h"
+#include "hdlc.h"
+#include "config.h"
+#include "defines.h"
+#include "util/crc16.h"
+#include "check.h"
+
+#define TRIALS   3000
+#define MAXBITS  (HDLC_TXBUF_SIZE * 8 * 2)
+
+static uint8_t ref[MAXBITS];
+static int nref, ones;
+
+
+static void put_bit(uint8_t bit, bool stuff)
+{
+   ref[nref++] = bit;
+   ones = (bit ? ones + 1 : 0);
+   if (stuff && ones == 5) {
+      ref[nref++] = 0;
+      ones = 0;
+   }
+}
+
+static void put_byte(uint8_t b, bool stuff)
+{
+   for (int i=0; i<8; i++)
+      put_bit((b >> i) & 1, stuff);
+}
+
+static void ref_frame(const uint8_t* f, int len)
+{
+   uint16_t crc = 0xFFFF;
+   for (int i=0; i<len; i++) {
+      crc = _crc_ccitt_update(crc, f[i]);
+      put_byte(f[i], true);
+   }
+   put_byte(crc ^ 0xFF, true);
+   put_byte((crc >> 8) ^ 0xFF, true);
+}
+
+/* NRZI: The level changes for each zero bit, starting at 0 */
+static void ref_nrzi(void)
+{
+   uint8_t level = 0;
+   for (int i=0; i<nref; i++) {
+      if (ref[i] == 0)
+         level ^= 1;
+      ref[i] = level;
+   }
+}
+
+
+/* Up to 4 of them fit into txbuf */
+static uint16_t make_frame(uint8_t* f)
+{
+   uint16_t len = 1 + rand() % 200;
+   int mode = rand() % 3;
+   for (int i=0; i<len; i++)
+      f[i] = (mode == 0 ? rand() : mode == 1 ? 0xFF : (rand() % 2 ? 0xFF : 0x7E));
+   return len;
+}
+
+
+int main(void)
+{
+   static uint8_t frame[4][200];
+   static uint16_t len[4];
+   int bad = 0, five = 0, multi = 0;
+
+   srand(14);
+   fbuf_init();
+   rig_enc_init();
+
+   for (int t=0; t<TRIALS; t++) {
+      int nf = 1 + rand() % 4;
+      SET_BYTE_PARAM(MAXFRAME, nf);
+      nref = ones = 0;
+      for (int k=0; k<nf; k++) {
+         FBUF b;
+         len[k] = make_frame(frame[k]);
+         fbuf_new(&b, FBUF_ACC_OTHER, 0);
+         fbuf_write(&b, (char*) frame[k], len[k]);
+         hdlc_tx_put(b, HDLC_TX_OTHER, 0);
+
+         if (k > 0) {
+            if (ones == 5)
+               put_bit(0, false);
+            put_byte(HDLC_FLAG, false);
+            ones = 0;
+         }
+         ref_frame(frame[k], len[k]);
+         /* Five ones at the end of the frame. The stuffed zero is already in ref */
+         if (nref >= 6 && ref[nref-1] == 0 && ref[nref-2] && ref[nref-3] && ref[nref-4] && ref[nref-5] && ref[nref-6])
+            five++;
+      }
+      multi += (nf > 1);
+      ref_nrzi();
+
+      const uint8_t* buf;
+      uint16_t pre, post;
+      uint16_t nbits = rig_enc_render(&buf, &pre, &post);
+      bool same = (nbits == nref && !rig_enc_pending());
+      for (int i=0; same && i<nbits; i++)
+         same = (((buf[i/8] >> (i%8)) & 1) == ref[i]);
+      if (!same && bad++ == 0)
+         printf("First difference in trial %d: %d frames, %u bits, reference %d\n", t, nf, nbits, nref);
+   }
+   printf("%d transmissions, %d with several frames, %d frames ending with five ones\n",
+      TRIALS, multi, five);
+   CHECK(bad == 0);
+   CHECK(five > 100 && multi > 1000);
+   CHECK(fbuf_usedSlots(FBUF_SMALL) == 0 && fbuf_usedSlots(FBUF_LARGE) == 0);
+   return check_done("test_txtable");
+}
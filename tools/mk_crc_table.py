@@ -0,0 +1,34 @@
+#!/usr/bin/env python3
+#
+# Generate the lookup tables for the CRC-CCITT (reflected, polynomial 
+# 0x8408, as used for the AX.25 FCS) in util/crc16.c. Usage: 
+#    python3 tools/mk_crc_table.py > util/crc16_table.h
+#
+# Table 0 is the usual byte-at-a-time table. Table k gives the effect 
+# of a byte followed by k zero bytes, for slice-by-4. 
+#
+
+POLY = 0x8408
+
+t = [[0] * 256 for _ in range(4)]
+for i in range(256):
+    crc = i
+    for _ in range(8):
+        crc = (crc >> 1) ^ POLY if crc & 1 else crc >> 1
+    t[0][i] = crc
+for k in range(1, 4):
+    for i in range(256):
+        t[k][i] = (t[k-1][i] >> 8) ^ t[0][t[k-1][i] & 0xff]
+
+print("""/*
+ * CRC-CCITT lookup tables (reflected, polynomial 0x8408). 
+ * Generated by tools/mk_crc_table.py. Do not edit. 
+ */
+
+const uint16_t crc_ccitt_table[4][256] __attribute__((aligned(4))) = {""")
+for k in range(4):
+    print("  {")
+    for i in range(0, 256, 8):
+        print("    " + ", ".join("0x%04x" % x for x in t[k][i:i+8]) + ("," if i + 8 < 256 else ""))
+    print("  }" + ("," if k < 3 else ""))
+print("};")
@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+#
+# Generate the state transition table for the byte-at-a-time HDLC 
+# deframer in hdlc_decoder.c. Usage: 
+#    python3 tools/mk_hdlc_table.py > hdlc_table.h
+#
+# The table is indexed by state (number of consecutive one bits 
+# received so far, 0-5) and the received octet (first bit in LSB). 
+# Each entry gives the de-stuffed data bits, the number of them, the 
+# new state and a mask of the received bits that were kept (not 
+# stuffing). If six ones are found (flag or abort), the octet must 
+# be processed one bit at a time, and the entry is just HDLC_DT_SLOW. 
+#
+
+def entry(ones, octet):
+    out = nbits = keep = 0
+    for i in range(8):
+        if (octet >> i) & 1:
+            ones += 1
+            if ones >= 6:
+                return None
+            out |= 1 << nbits
+            nbits += 1
+            keep |= 1 << i
+        else:
+            if ones != 5:
+                nbits += 1
+                keep |= 1 << i
+            ones = 0
+    return out | (nbits << 8) | (ones << 12) | (keep << 16)
+
+
+print("""/*
+ * State transition table for the HDLC deframer. 
+ * Generated by tools/mk_hdlc_table.py. Do not edit. 
+ */
+
+#if !defined __HDLC_TABLE_H__
+#define __HDLC_TABLE_H__
+
+#define HDLC_DT_SLOW        0x00008000
+#define HDLC_DT_OUT(e)      ((uint8_t) (e))
+#define HDLC_DT_NBITS(e)    (((e) >> 8) & 0x0f)
+#define HDLC_DT_ONES(e)     (((e) >> 12) & 0x07)
+#define HDLC_DT_KEEP(e)     ((uint8_t) ((e) >> 16))
+
+static const uint32_t hdlc_dtab[6][256] = {""")
+for ones in range(6):
+    print("  { /* %d ones */" % ones)
+    row = []
+    for octet in range(256):
+        e = entry(ones, octet)
+        row.append("0x%08x" % (0x8000 if e is None else e))
+    for i in range(0, 256, 6):
+        print("    " + ", ".join(row[i:i+6]) + ("," if i + 6 < 256 else ""))
+    print("  }" + ("," if ones < 5 else ""))
+print("""};
+
+#endif""")
@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+#
+# Generate the tables for the byte-at-a-time HDLC encoder in 
+# hdlc_encoder.c. Usage: 
+#    python3 tools/mk_hdlc_txtable.py > hdlc_txtable.h
+#
+# The stuffing table is indexed by state (number of consecutive one 
+# bits sent so far, 0-5) and the octet to send (first bit in LSB). 
+# A zero is inserted before a data bit when the five bits before it 
+# are ones. Each entry gives the bits to send (up to 10), the number 
+# of stuffed bits and the new state. 
+#
+# The NRZI table gives the line levels for an octet (first bit in 
+# LSB) when the level before it is 0. The level changes for each 
+# zero bit. If the level before is 1, the result is inverted. 
+#
+
+def stuff(ones, octet):
+    out = nbits = 0
+    for i in range(8):
+        if ones == 5:
+            nbits += 1
+            ones = 0
+        bit = (octet >> i) & 1
+        out |= bit << nbits
+        nbits += 1
+        ones = ones + 1 if bit else 0
+    return out | ((nbits - 8) << 10) | (ones << 12)
+
+
+def nrzi(octet):
+    out = level = 0
+    for i in range(8):
+        if not (octet >> i) & 1:
+            level ^= 1
+        out |= level << i
+    return out
+
+
+print("""/*
+ * Bit stuffing and NRZI tables for the HDLC encoder. 
+ * Generated by tools/mk_hdlc_txtable.py. Do not edit. 
+ */
+
+#if !defined __HDLC_TXTABLE_H__
+#define __HDLC_TXTABLE_H__
+
+#define HDLC_ST_BITS(e)     ((e) & 0x03ff)
+#define HDLC_ST_NBITS(e)    (8 + (((e) >> 10) & 0x03))
+#define HDLC_ST_ONES(e)     (((e) >> 12) & 0x07)
+
+static const uint16_t hdlc_stab[6][256] = {""")
+for ones in range(6):
+    print("  { /* %d ones */" % ones)
+    row = ["0x%04x" % stuff(ones, octet) for octet in range(256)]
+    for i in range(0, 256, 8):
+        print("    " + ", ".join(row[i:i+8]) + ("," if i + 8 < 256 else ""))
+    print("  }" + ("," if ones < 5 else ""))
+print("""};
+
+static const uint8_t hdlc_nrzi[256] = {""")
+row = ["0x%02x" % nrzi(octet) for octet in range(256)]
+for i in range(0, 256, 12):
+    print("  " + ", ".join(row[i:i+12]) + ("," if i + 12 < 256 else ""))
+print("""};
+
+#endif""")
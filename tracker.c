@@ -10,6 +10,7 @@
 #include "config.h"
 #include "radio.h"
 #include "hdlc.h"
+#include "csma.h"
 #include "ui/ui.h"
 #include "tracker.h"
 #include "adc_input.h"
@@ -24,7 +25,6 @@ posdata_t prev_pos;
 posdata_t prev_pos_gps;
 int16_t course=-1, prev_course=-1, prev_gps_course=-1;
 
-extern fbq_t* outframes;  
 static fbq_t* gate; 
 
 static bool maxpause_reached = false;
@@ -406,7 +406,7 @@ static bool course_change(uint16_t crs, uint16_t prev, uint16_t limit)
 static void report_status(posdata_t* pos)
 {
     FBUF packet;   
-    fbuf_new(&packet);
+    fbuf_new(&packet, FBUF_ACC_TRACKER, 0);
     
     /* Create packet header */
     send_header(&packet, false);  
@@ -420,14 +420,24 @@ static void report_status(posdata_t* pos)
     char vbatt[7];
     sprintf(vbatt, "%.1f%c", ((float) adc_read_batt()/1000 ), '\0');
     
-    /* Send firmware version and battery voltage in status report */
+    /* Channel utilisation (percent) over the last 15 minutes */
+    char chload[5];
+    sprintf(chload, "%u%%", csma_load(CSMA_LOAD_15MIN));
+    
+    /* Send firmware version, battery voltage and channel load in status report */
     fbuf_putstr(&packet, "FW=AT ");
     fbuf_putstr(&packet, VERSION_STRING);
     fbuf_putstr(&packet, " / VBATT="); 
     fbuf_putstr(&packet, vbatt);
+    fbuf_putstr(&packet, " / CH="); 
+    fbuf_putstr(&packet, chload);
    
-    /* Send packet */
-    fbq_put(outframes, packet);
+    /* Send packet. Drop it if we ran out of buffer space */
+    if (!fbuf_writable(&packet)) {
+       fbuf_release(&packet);
+       return;
+    }
+    hdlc_tx_put(packet, HDLC_TX_REPORT, HDLC_TTL_NONE);
 }
 
 
@@ -451,7 +461,7 @@ static void report_station_position(posdata_t* pos, bool no_tx)
     static uint8_t ccount;
     FBUF packet;    
     char comment[COMMENT_LENGTH+1];
-    fbuf_new(&packet); 
+    fbuf_new(&packet, FBUF_ACC_TRACKER, 0); 
           
     /* Create packet header */
     send_header(&packet, no_tx);    
@@ -498,8 +508,13 @@ static void report_station_position(posdata_t* pos, bool no_tx)
      */
     bool igtrack = GET_BYTE_PARAM(IGATE_TRACK_ON);
     
+    if (!fbuf_writable(&packet)) {
+       /* Ran out of buffer space */
+       fbuf_release(&packet);
+       return;
+    }
     if (!no_tx)
-       fbq_put(outframes, fbuf_newRef(&packet));
+       hdlc_tx_put(fbuf_newRef(&packet), HDLC_TX_BEACON, HDLC_TTL_BEACON);
     if (gate != NULL && igtrack) 
        fbq_put(gate, packet);
     else
@@ -511,7 +526,7 @@ static void report_station_position(posdata_t* pos, bool no_tx)
 static void report_object_position(posdata_t* pos, char* id, bool add)
 {
     FBUF packet; 
-    fbuf_new(&packet);
+    fbuf_new(&packet, FBUF_ACC_TRACKER, 0);
     
     /* Create packet header */
     send_header(&packet, false);   
@@ -527,8 +542,12 @@ static void report_object_position(posdata_t* pos, char* id, bool add)
     
     /* Comment field may be added later */
 
-    /* Send packet */
-    fbq_put(outframes, packet);
+    /* Send packet. Drop it if we ran out of buffer space */
+    if (!fbuf_writable(&packet)) {
+       fbuf_release(&packet);
+       return;
+    }
+    hdlc_tx_put(packet, HDLC_TX_REPORT, HDLC_TTL_NONE);
 }
 
 
@@ -14,6 +14,7 @@
 #include "config.h"
 #include "afsk.h"
 #include "hdlc.h"
+#include "csma.h"
 #include "string.h"
 #include "defines.h"
 #include "util/shell.h"
@@ -69,6 +70,14 @@ static void cmd_webserver(Stream *chp, int argc, char* argv[]);
 static void cmd_connect(Stream *chp, int argc, char* argv[]);
 static void cmd_digipeater(Stream *chp, int argc, char* argv[]);
 static void cmd_igate(Stream *chp, int argc, char* argv[]);
+static void cmd_rxprof(Stream *chp, int argc, char* argv[]);
+static void cmd_demod(Stream *chp, int argc, char* argv[]);
+static void cmd_agc(Stream *chp, int argc, char* argv[]);
+static void cmd_modem(Stream *chp, int argc, char* argv[]);
+static void cmd_rxstat(Stream *chp, int argc, char* argv[]);
+static void cmd_txirq(Stream *chp, int argc, char* argv[]);
+static void cmd_txstat(Stream *chp, int argc, char* argv[]);
+static void cmd_channel(Stream *chp, int argc, char* argv[]);
 
 static void _parameter_setting_bool(Stream*, int, char**, int, uint16_t, const void*, char* );
 static void _parameter_setting_byte(Stream*, int, char**, int, uint16_t, const void*, char*, uint8_t, uint8_t );
@@ -102,6 +111,7 @@ CMD_BOOL_SETTING(TXMON_ON,        "TXMON");
 CMD_BOOL_SETTING(REPEAT_ON,       "REPEAT");
 CMD_BOOL_SETTING(EXTRATURN_ON,    "EXTRATURN");
 CMD_BOOL_SETTING(IGATE_TRACK_ON,  "IGATE_TRACK");
+CMD_BOOL_SETTING(CSMA_ADAPT_ON,   "CSMA_ADAPT");
 
 CMD_BYTE_SETTING(TXDELAY,         "TXDELAY",      0, 100);
 CMD_BYTE_SETTING(TXTAIL,          "TXTAIL",       0, 100);
@@ -110,6 +120,15 @@ CMD_BYTE_SETTING(TRACKER_MAXPAUSE,"MAXPAUSE",     0, 100);
 CMD_BYTE_SETTING(TRACKER_MINPAUSE,"MINPAUSE",     0, 100);
 CMD_BYTE_SETTING(TRACKER_MINDIST, "MINDIST",      0, 250);
 CMD_BYTE_SETTING(STATUS_TIME,     "STATUS_TIME",  0, 250);
+CMD_BYTE_SETTING(PERSISTENCE,     "PERSISTENCE",  0, 255);
+CMD_BYTE_SETTING(SLOTTIME,        "SLOTTIME",     1, 100);
+
+/* The decoder keeps its own copy of FCS_TRIES */
+static inline void cmd_FCS_TRIES(Stream* out, int argc, char** argv) 
+{ 
+   _parameter_setting_byte(out, argc, argv, 0, FCS_TRIES_offset, &FCS_TRIES_default, "FCS_TRIES", 0, 78); 
+   hdlc_rx_setFcsTries(GET_BYTE_PARAM(FCS_TRIES));
+}
 
 /*********************************************************************************
  * Shell config
@@ -134,6 +153,18 @@ static const ShellCommand shell_commands[] =
   { "testpacket", "Send test APRS packet",                     5, cmd_testpacket },
   { "teston",     "Generate test signal with data byte",       6, cmd_teston },
   { "adc",        "Get test samples from ADC",                 3, cmd_adc },
+  { "rxprof",     "Demodulator CPU usage (cycles per sample)", 4, cmd_rxprof },
+  { "demod",      "Frames decoded by each demodulator",        4, cmd_demod },
+  { "rxstat",     "Receiver statistics [reset | <seconds>]",   4, cmd_rxstat },
+  { "fcstries",   "Max attempts to repair frame with bad FCS", 4, cmd_FCS_TRIES },
+  { "agc",        "Set/get receiver AGC decay and floor",      3, cmd_agc },
+  { "modem",      "Set/get modem (1200 AFSK or 9600 G3RUH)",   3, cmd_modem },
+  { "txirq",      "Transmitter interrupts per second",         4, cmd_txirq },
+  { "txstat",     "Transmit queue statistics [reset]",         4, cmd_txstat },
+  { "persistence","Set/get CSMA persistence (p = x/255)",      4, cmd_PERSISTENCE },
+  { "slottime",   "Set/get CSMA slot time (milliseconds/10)",  5, cmd_SLOTTIME },
+  { "csmaadapt",  "Lower persistence on busy channel on/off",  5, cmd_CSMA_ADAPT_ON },
+  { "channel",    "Channel utilisation (1, 5, 15 minutes)",    2, cmd_channel },
   { "led",        "Test RGB LED",                              3, cmd_led },
   { "listen",     "Listen to radio",                           3, cmd_listen },
   { "converse",   "Converse mode",                             4, cmd_converse },
@@ -325,12 +356,202 @@ static void cmd_mem(Stream *chp, int argc, char *argv[]) {
     return;
   }  
   chprintf(chp, "core free memory : %u bytes\r\n", chCoreGetStatusX());
-  chprintf(chp, "fbuf used slots  : %u\r\n", fbuf_usedSlots());
-  chprintf(chp, "fbuf free slots  : %u\r\n", fbuf_freeSlots());
+  chprintf(chp, "fbuf used slots  : %u small, %u large\r\n", 
+     fbuf_usedSlots(FBUF_SMALL), fbuf_usedSlots(FBUF_LARGE));
+  chprintf(chp, "fbuf free slots  : %u small, %u large\r\n", 
+     fbuf_freeSlots(FBUF_SMALL), fbuf_freeSlots(FBUF_LARGE));
   chprintf(chp, "fbuf free total  : %u bytes\r\n", fbuf_freeMem());
+  chprintf(chp, "fbuf consistency : %s\r\n", (fbuf_check() ? "ok" : "ERROR"));
+  
+  /* Pool accounts: Units in use, high water mark, limits and refused allocations */
+  chprintf(chp, "\r\naccount   used   max-used   min    max  avail  fails\r\n");
+  for (uint8_t i=0; i<FBUF_ACCOUNTS; i++) {
+    fbacc_t a; 
+    fbuf_getAccount(i, &a);
+    chprintf(chp, "%-8s %5u %10u %5u %6u %6u %6lu%s\r\n", a.name, a.used, a.hwm, 
+       a.min, a.max, fbuf_available(i), a.fails, (a.low ? "  LOW" : ""));
+  }
+}
+
+
+/****************************************************************************
+ * Receiver profiling: CPU cycles per sample for each stage of the 
+ * demodulator since last reset. 
+ ****************************************************************************/
+
+static void cmd_rxprof(Stream *chp, int argc, char *argv[]) {
+  static const char *stages[] = {"bandpass", "agc", "lowpass", "pll"};
+  afsk_prof_t p;
+  uint32_t total = 0;
+  
+  if (argc > 1 || (argc == 1 && strncasecmp(argv[0], "reset", 2) != 0)) {
+    chprintf(chp, "Usage: rxprof [reset]\r\n");
+    return;
+  }
+  afsk_rx_getProfile(&p, argc == 1);
+  if (p.samples == 0) {
+    chprintf(chp, "No samples processed\r\n");
+    return;
+  }
+  chprintf(chp, "samples   : %lu\r\n", p.samples);
+  for (int i=0; i<AFSK_PROF_STAGES; i++) {
+    chprintf(chp, "%-10s: %lu cycles/sample\r\n", stages[i], p.cycles[i] / p.samples);
+    total += p.cycles[i];
+  }
+  chprintf(chp, "total     : %lu cycles/sample\r\n", total / p.samples);
+  chprintf(chp, "overflows : %lu samples dropped\r\n", p.overflows);
+  chprintf(chp, "ring max  : %u of %u samples\r\n", p.ring_hwm, AFSK_RX_RINGSIZE);
+  chprintf(chp, "isr max   : %lu cycles\r\n", p.isr_max);
+}
+
+
+
+/****************************************************************************
+ * Transmitter interrupt rates (bit clock and DAC refill), measured 
+ * over one second. When idle, these should be zero. 
+ ****************************************************************************/
+
+static void cmd_txirq(Stream *chp, int argc, char *argv[]) {
+  (void) argc;
+  (void) argv;
+  uint32_t clk = afsk_tx_irqCount();
+  uint32_t dac = tone_irqCount();
+  sleep(1000);
+  chprintf(chp, "bit clock : %lu/s\r\n", afsk_tx_irqCount() - clk);
+  chprintf(chp, "dac refill: %lu/s\r\n", tone_irqCount() - dac);
 }
 
 
+
+/****************************************************************************
+ * Transmit queue statistics for each class of frames: Frames sent, 
+ * frames dropped since they waited too long and time waited in queue. 
+ ****************************************************************************/
+
+static void cmd_txstat(Stream *chp, int argc, char *argv[]) {
+  static const char *classes[] = {"digi", "beacon", "report", "other"};
+  hdlc_txstat_t st;
+  
+  if (argc > 1 || (argc == 1 && strncasecmp(argv[0], "reset", 2) != 0)) {
+    chprintf(chp, "Usage: txstat [reset]\r\n");
+    return;
+  }
+  chprintf(chp, "class    waiting   sent  expired  oversize  avg-wait  max-wait (ms)\r\n");
+  for (uint8_t i=0; i<HDLC_TX_CLASSES; i++) {
+    hdlc_tx_getStats(i, &st, argc == 1);
+    chprintf(chp, "%-8s %7u %6lu %8lu %9lu %9lu %9lu\r\n", classes[i], hdlc_tx_waiting(i), 
+      st.sent, st.expired, st.oversize, (st.sent > 0 ? st.wait_total / st.sent : 0), st.wait_max);
+  }
+}
+
+
+
+/****************************************************************************
+ * Channel utilisation: Percentage of time the channel was busy (squelch 
+ * open or DCD), averaged over 1, 5 and 15 minutes, and the persistence 
+ * currently used by the CSMA algorithm. 
+ ****************************************************************************/
+
+static void cmd_channel(Stream *chp, int argc, char *argv[]) {
+  (void) argc;
+  (void) argv;
+  chprintf(chp, "Utilisation: %u%% %u%% %u%% (1, 5, 15 min)\r\n", 
+     csma_load(CSMA_LOAD_1MIN), csma_load(CSMA_LOAD_5MIN), csma_load(CSMA_LOAD_15MIN));
+  chprintf(chp, "Persistence: %u/255 (%s)\r\n", csma_persistence(), 
+     (GET_BYTE_PARAM(CSMA_ADAPT_ON) ? "adaptive" : "fixed"));
+}
+
+
+
+/****************************************************************************
+ * Receiver statistics. With an interval argument (seconds), show the
+ * rate of each counter per second, periodically until a key is pressed,
+ * with the average audio level. The peak level is held since the last
+ * reset, so it is only in the full display.
+ ****************************************************************************/
+
+static void cmd_rxstat(Stream *chp, int argc, char *argv[]) {
+  hdlc_rxstat_t h, h0;
+  afsk_rxstat_t a, a0;
+  hdlc_substat_t subs[HDLC_MAX_SUBSCRIBERS];
+  uint8_t n;
+  uint16_t secs = 0;
+  
+  if (argc > 1) {
+    chprintf(chp, "Usage: rxstat [reset | <seconds>]\r\n");
+    return;
+  }
+  if (argc == 1 && strncasecmp(argv[0], "reset", 2) == 0) {
+    hdlc_rx_getStats(&h, true);
+    afsk_rx_getStats(&a, true);
+    chprintf(chp, "Receiver statistics reset\r\n");
+    return;
+  }
+  if (argc == 1 && sscanf(argv[0], "%hu", &secs) != 1) {
+    chprintf(chp, "Usage: rxstat [reset | <seconds>]\r\n");
+    return;
+  }
+  
+  if (secs == 0) {
+    hdlc_rx_getStats(&h, false);
+    afsk_rx_getStats(&a, false);
+    chprintf(chp, "flags      : %lu\r\n", h.flags);
+    chprintf(chp, "frames     : %lu\r\n", h.frames);
+    chprintf(chp, "aborts     : %lu\r\n", h.aborts);
+    chprintf(chp, "oversize   : %lu\r\n", h.oversize);
+    chprintf(chp, "fcs errors : %lu\r\n", h.fcs_errors);
+    chprintf(chp, "delivered  : %lu\r\n", h.delivered);
+    n = hdlc_rx_subStats(subs, HDLC_MAX_SUBSCRIBERS);
+    for (uint8_t i=0; i<n; i++)
+       chprintf(chp, "  %-10s: %lu delivered, %lu dropped\r\n", subs[i].name, subs[i].delivered, subs[i].dropped);
+    chprintf(chp, "overflows  : %lu octets, %lu samples\r\n", a.iq_overflows, afsk_rx_overruns());
+    chprintf(chp, "pll adjust : %lu\r\n", a.pll_adjust);
+    chprintf(chp, "audio level: %u peak, %u average\r\n", a.peak, a.avg);
+    return;
+  }
+  
+  /* Periodic display of rates */
+  chprintf(chp, "  flags frames aborts  fcs-err  deliv  pll-adj  avg  (per second)\r\n");
+  hdlc_rx_getStats(&h0, false);
+  afsk_rx_getStats(&a0, false);
+  while (chnGetTimeout((BaseChannel*) chp, S2ST(secs)) == MSG_TIMEOUT) {
+    hdlc_rx_getStats(&h, false);
+    afsk_rx_getStats(&a, false);
+    chprintf(chp, "%7lu %6lu %6lu %8lu %6lu %8lu %4u\r\n", 
+      (h.flags - h0.flags) / secs, (h.frames - h0.frames) / secs, 
+      (h.aborts - h0.aborts) / secs, (h.fcs_errors - h0.fcs_errors) / secs, 
+      (h.delivered - h0.delivered) / secs, (a.pll_adjust - a0.pll_adjust) / secs, a.avg);
+    h0 = h;
+    a0 = a;
+  }
+}
+
+
+
+/****************************************************************************
+ * Frames decoded by each demodulator variant. Unique means that 
+ * no other variant decoded the frame. Repaired means that the frame
+ * had a bad FCS and was repaired by flipping bits.
+ ****************************************************************************/
+
+static void cmd_demod(Stream *chp, int argc, char *argv[]) {
+  uint32_t decoded, unique, recovered;
+  
+  (void)argv;
+  if (argc > 0) {
+    chprintf(chp, "Usage: demod\r\n");
+    return;
+  }
+  chprintf(chp, "frames received : %lu\r\n", hdlc_rx_frames());
+  for (uint8_t i=0; i<AFSK_RX_VARIANTS; i++) {
+    hdlc_rx_variantStats(i, &decoded, &unique, &recovered);
+    chprintf(chp, "demodulator %u   : %lu decoded, %lu unique, %lu repaired\r\n", 
+       i, decoded, unique, recovered);
+  }
+}
+
+
+
 /****************************************************************************
  * Thread information
  * (borrowed from ChibiOS code by Giovanni Di Sirio. 
@@ -408,6 +629,61 @@ static void cmd_setsquelch(Stream *chp, int argc, char *argv[]) {
 
 
 
+/****************************************************************************
+ * Set/get AGC peak tracking constants of receiver: Decay per sample 
+ * and floor. 
+ ****************************************************************************/
+
+static void cmd_agc(Stream *chp, int argc, char *argv[]) {
+   unsigned int decay=0, agcfloor=0;
+   if (argc == 0) {
+      decay = GET_BYTE_PARAM(AGC_DECAY);
+      agcfloor = GET_BYTE_PARAM(AGC_FLOOR);
+   }
+   else if (argc == 2 && sscanf(argv[0], "%u", &decay) == 1 
+                      && sscanf(argv[1], "%u", &agcfloor) == 1) {
+      if (decay > 50) decay = 50;
+      if (agcfloor < 1) agcfloor = 1;
+      if (agcfloor > 255) agcfloor = 255;
+      
+      SET_BYTE_PARAM(AGC_DECAY, decay);
+      SET_BYTE_PARAM(AGC_FLOOR, agcfloor);
+      afsk_rx_setAgc(decay, agcfloor);
+   }
+   else {
+      chprintf(chp, "Usage: agc [<decay> <floor>]\r\n");
+      return;
+   }
+   chprintf(chp, "AGC DECAY: %u, FLOOR: %u\r\n", decay, agcfloor); 
+}
+
+
+
+/****************************************************************************
+ * Set/get modem mode: 1200 baud AFSK or 9600 baud G3RUH. 
+ ****************************************************************************/
+
+static void cmd_modem(Stream *chp, int argc, char *argv[]) {
+   uint8_t m;
+   if (argc == 1) {
+      if (strcmp(argv[0], "1200") == 0)
+         m = MODEM_AFSK1200;
+      else if (strcmp(argv[0], "9600") == 0)
+         m = MODEM_G3RUH9600;
+      else {
+         chprintf(chp, "Usage: modem [1200|9600]\r\n");
+         return;
+      }
+      SET_BYTE_PARAM(MODEM, m);
+      afsk_tx_setMode(m);
+      afsk_rx_setMode(m);
+   }
+   chprintf(chp, "MODEM: %s\r\n", 
+      (afsk_rx_mode() == MODEM_G3RUH9600 ? "9600 baud G3RUH" : "1200 baud AFSK"));
+}
+
+
+
 /****************************************************************************
  * Set/get volume level of receiver
  ****************************************************************************/
@@ -555,7 +831,6 @@ static void cmd_testpacket(Stream *chp, int argc, char *argv[])
   (void)argv;
   
   static FBUF packet;    
-  fbq_t* outframes = hdlc_get_encoder_queue();
   addr_t from, to; 
   addr_t digis[7];
   
@@ -565,11 +840,18 @@ static void cmd_testpacket(Stream *chp, int argc, char *argv[])
   GET_PARAM(DEST, &to);       
   uint8_t ndigis = GET_BYTE_PARAM(NDIGIS); 
   GET_PARAM(DIGIS, &digis);   
-  fbuf_new(&packet); 
+  fbuf_new(&packet, FBUF_ACC_OTHER, 0); 
   ax25_encode_header(&packet, &from, &to, digis, ndigis, FTYPE_UI, PID_NO_L3); 
   fbuf_putstr(&packet, "The lazy brown dog jumps over the quick fox 1234567890");                      
-  chprintf(chp, "Sending (AX25 UI) test packet....\r\n");       
-  fbq_put(outframes, packet); 
+  if (!fbuf_writable(&packet)) {
+     /* Ran out of buffer space */
+     chprintf(chp, "*** Cannot send test packet (out of buffers)\r\n");
+     fbuf_release(&packet);
+  }
+  else {
+     chprintf(chp, "Sending (AX25 UI) test packet....\r\n");       
+     hdlc_tx_put(packet, HDLC_TX_OTHER, HDLC_TTL_NONE); 
+  }
   sleep(10);
   radio_release(); 
 }
@@ -877,7 +1159,6 @@ static void cmd_converse(Stream *chp, int argc, char* argv[])
   chprintf(chp, "***** CONVERSE MODE. Ctrl-D to exit *****\r\n");
   radio_require();
   mon_activate(true); 
-  fbq_t* outframes = hdlc_get_encoder_queue();
   
   while (!shellGetLine(chp, buf, BUFSIZE)) { 
     addr_t from, to; 
@@ -886,10 +1167,16 @@ static void cmd_converse(Stream *chp, int argc, char* argv[])
     addr_t digis[7];
     uint8_t ndigis = GET_BYTE_PARAM(NDIGIS); 
     GET_PARAM(DIGIS, &digis);  
-    fbuf_new(&packet);
+    fbuf_new(&packet, FBUF_ACC_OTHER, 0);
     ax25_encode_header(&packet, &from, &to, digis, ndigis, FTYPE_UI, PID_NO_L3);
     fbuf_putstr(&packet, buf);                        
-    fbq_put(outframes, packet);
+    if (!fbuf_writable(&packet)) {
+       /* Ran out of buffer space */
+       chprintf(chp, "*** Cannot send packet (out of buffers)\r\n");
+       fbuf_release(&packet);
+       continue;
+    }
+    hdlc_tx_put(packet, HDLC_TX_OTHER, HDLC_TTL_NONE);
   }
   sleep(1000);
   mon_activate(false);
@@ -12,6 +12,9 @@
 #include "wifi.h"
 #include "igate.h"
 #include "ui/ui.h"
+#include "hdlc.h"
+#include "afsk.h"
+#include "csma.h"
 
 
 // static bool mon_on = false;
@@ -223,6 +226,15 @@ static bool read_disable = false;
 static FBQ* mon_queue;
 static FBQ  read_queue;
 static char chost[40];
+static bool inet_low = false;    // Buffer pool account for incoming data is low
+
+
+/* 
+ * Callback from the buffer pool when the inet account goes below or 
+ * above the low water mark. While low, incoming lines are dropped. 
+ */
+static void inet_lowmem(uint8_t acc, bool low) 
+  { (void) acc; inet_low = low; }
 
 
 char* inet_chost()
@@ -471,6 +483,37 @@ static void cmd_getParm(char* p) {
    else if (strcmp("DIGIP_SAR_ON", p) == 0)
      chprintf(_serial, "%s\r", PRINT_BOOL(DIGIP_SAR_ON, cbuf));
    
+   else if (strcmp("PERSISTENCE", p) == 0)
+     chprintf(_serial, "%u\r", GET_BYTE_PARAM(PERSISTENCE));
+   
+   else if (strcmp("SLOTTIME", p) == 0)
+     chprintf(_serial, "%u\r", GET_BYTE_PARAM(SLOTTIME));
+   
+   else if (strcmp("CSMA_ADAPT_ON", p) == 0)
+     chprintf(_serial, "%s\r", PRINT_BOOL(CSMA_ADAPT_ON, cbuf));
+   
+   else if (strcmp("CHLOAD", p) == 0)
+     /* Channel utilisation (percent) over 1, 5 and 15 minutes */
+     chprintf(_serial, "%u,%u,%u\r", 
+        csma_load(CSMA_LOAD_1MIN), csma_load(CSMA_LOAD_5MIN), csma_load(CSMA_LOAD_15MIN));
+   
+   else if (strcmp("RXSTAT", p) == 0) {
+      /* Receiver statistics as comma separated list */
+      hdlc_rxstat_t h; 
+      afsk_rxstat_t a; 
+      hdlc_rx_getStats(&h, false);
+      afsk_rx_getStats(&a, false);
+      hdlc_substat_t subs[HDLC_MAX_SUBSCRIBERS];
+      uint8_t n = hdlc_rx_subStats(subs, HDLC_MAX_SUBSCRIBERS);
+      uint32_t dropped = 0;
+      for (uint8_t i=0; i<n; i++)
+         dropped += subs[i].dropped;
+      chprintf(_serial, "%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%u,%u\r", 
+         h.flags, h.frames, h.aborts, h.oversize, h.fcs_errors, 
+         h.delivered, dropped, 
+         a.iq_overflows, afsk_rx_overruns(), a.pll_adjust, a.peak, a.avg);
+   }
+   
    else if (strncmp("WIFIAP", p, 6) == 0) {
       int i = atoi(p+6);
       if (i<0 || i>5) {
@@ -597,6 +640,15 @@ static void cmd_setParm(char* p, char* val) {
     else if (strcmp("DIGIP_SAR_ON", p) == 0)
       chprintf(_serial, "%s\r", PARSE_BOOL(DIGIP_SAR_ON, val, cbuf));
     
+    else if (strcmp("PERSISTENCE", p) == 0)
+      chprintf(_serial, "%s\r", PARSE_BYTE(PERSISTENCE, val, 0, 255, cbuf));
+    
+    else if (strcmp("SLOTTIME", p) == 0)
+      chprintf(_serial, "%s\r", PARSE_BYTE(SLOTTIME, val, 1, 100, cbuf));
+    
+    else if (strcmp("CSMA_ADAPT_ON", p) == 0)
+      chprintf(_serial, "%s\r", PARSE_BOOL(CSMA_ADAPT_ON, val, cbuf));
+    
     else if (strncmp("WIFIAP_RESET", p, 12) == 0) {
       ap_config_t x; 
       *x.ssid = '\0'; 
@@ -722,10 +774,20 @@ static THD_FUNCTION(wifi_monitor, arg)
 	         wifi_command();
 	 
 	     else if (c == ':') {
-             /* Incoming data */
+             /* Incoming data. Shed it early if buffer space is running low */
              FBUF input; 
-             fbuf_new(&input);
+             if (inet_low) {
+                while (streamGet(_serial) != '\n')
+                   ;
+                continue;
+             }
+             fbuf_new(&input, FBUF_ACC_INET, INET_LINE_HINT);
              fbuf_streamRead(_serial, &input);
+             if (!fbuf_writable(&input)) {
+                /* Out of buffer space. Line is not complete */
+                fbuf_release(&input);
+                continue;
+             }
              
              /* Insert into queues should be nonblocking. Do not 
               * try to insert if queue is full. 
@@ -758,6 +820,7 @@ void wifi_init(SerialDriver* sd)
    clearPin(WIFI_ENABLE);
    sdStart(sd, &_serialConfig);  
    FBQ_INIT(read_queue, INET_RX_QUEUE_SIZE);
+   fbuf_setLowWater(FBUF_ACC_INET, INET_LOWWATER, inet_lowmem);
    THREAD_START(wifi_monitor, NORMALPRIO, NULL);
    sleep(1000);
    if (GET_BYTE_PARAM(WIFI_ON))
@@ -26,6 +26,13 @@ void dac_init()
   }
 }
 
+
+/* Turn off DAC when not in use. The clock is left on */
+void dac_stop()
+{
+  DAC0_C0 = 0;
+}
+
  
  /* "Borrowed" from Teensyduino analog.c */
  void analogWrite(int val)
@@ -1,3 +1,4 @@
  
 void dac_init(void); 
+void dac_stop(void);
 void analogWrite(int val);
\ No newline at end of file
@@ -0,0 +1,60 @@
+ /*
+  * Atomic operations on reference counts.
+  * On Cortex-M3/M4 these use the exclusive load/store instructions
+  * (LDREX/STREX), so they are safe between threads and ISRs without
+  * disabling interrupts. Elsewhere (host builds) the GCC builtins
+  * implementing C11 atomics are used.
+  */
+
+ #ifndef _UTIL_ATOMIC_H_
+ #define _UTIL_ATOMIC_H_
+
+ #include <stdint.h>
+ #include <stdbool.h>
+ #include "hal.h"
+
+
+ /* Increment and return the new value */
+ static inline uint8_t atomic_inc_u8(volatile uint8_t* p) __attribute__((always_inline, unused));
+ static inline uint8_t atomic_inc_u8(volatile uint8_t* p)
+ {
+ #if defined(__CORTEX_M) && (__CORTEX_M >= 3)
+    uint8_t x;
+    do {
+       x = __LDREXB(p) + 1;
+    } while (__STREXB(x, p) != 0);
+    return x;
+ #else
+    return __atomic_add_fetch(p, 1, __ATOMIC_SEQ_CST);
+ #endif
+ }
+
+
+ /*
+  * Decrement unless zero. Return the value before the decrement,
+  * i.e. 1 means that this call released the last reference and 0
+  * that there was nothing to release.
+  */
+ static inline uint8_t atomic_dec_nz_u8(volatile uint8_t* p) __attribute__((always_inline, unused));
+ static inline uint8_t atomic_dec_nz_u8(volatile uint8_t* p)
+ {
+ #if defined(__CORTEX_M) && (__CORTEX_M >= 3)
+    uint8_t x;
+    do {
+       x = __LDREXB(p);
+       if (x == 0) {
+          __CLREX();
+          return 0;
+       }
+    } while (__STREXB(x - 1, p) != 0);
+    return x;
+ #else
+    uint8_t x = __atomic_load_n(p, __ATOMIC_SEQ_CST);
+    while (x > 0 && !__atomic_compare_exchange_n(p, &x, x - 1, false,
+                          __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+       ;
+    return x;
+ #endif
+ }
+
+ #endif
@@ -0,0 +1,120 @@
+/*
+ * CRC-CCITT over contiguous spans of data. 
+ * Slice-by-4 using lookup tables (see crc16_table.h) or the hardware 
+ * CRC module of the Kinetis K20 when available. 
+ */
+
+#include "ch.h"
+#include "hal.h"
+#include <string.h>
+#include "util/crc16.h"
+#include "util/crc16_table.h"
+
+
+#if defined(K20x_MCUCONF)
+
+/* "Borrowed" from Teensyduino kinetis.h */
+
+#define SIM_SCGC6              (*(volatile uint32_t *)0x4004803C) // System Clock Gating Control Register 6
+#define SIM_SCGC6_CRC          ((uint32_t)0x00040000)             // CRC Clock Gate Control
+#define CRC_CRC                (*(volatile uint32_t *)0x40032000) // CRC Data register
+#define CRC_GPOLY              (*(volatile uint32_t *)0x40032004) // CRC Polynomial register
+#define CRC_CTRL               (*(volatile uint32_t *)0x40032008) // CRC Control register
+#define CRC_CTRL_TOT(n)        ((uint32_t)(((n) & 3) << 30))      // Type Of Transpose For Writes
+#define CRC_CTRL_TOTR(n)       ((uint32_t)(((n) & 3) << 28))      // Type Of Transpose For Read
+#define CRC_CTRL_WAS           ((uint32_t)0x02000000)             // Write CRC Data Register As Seed
+
+#define CRC_HW_MIN   16   /* Shorter spans are faster done in software */
+
+static bool hw_ok = false; 
+static MUTEX_DECL(hw_mutex);
+
+static const char check_data[] = "123456789";
+#define CHECK_VALUE 0x6F91   /* Reflected 0x8408, init 0xFFFF, no final xor */
+
+#endif
+
+
+
+/***************************************************************
+ * Slice-by-4: Fold four bytes into the CRC at a time. 
+ ***************************************************************/
+
+static uint16_t crc_sw_block(uint16_t crc, const uint8_t* p, size_t n)
+{
+   uint32_t x; 
+   while (n >= 4) {
+      memcpy(&x, p, 4);
+      x ^= crc; 
+      crc = crc_ccitt_table[3][x & 0xff] ^ crc_ccitt_table[2][(x >> 8) & 0xff] 
+          ^ crc_ccitt_table[1][(x >> 16) & 0xff] ^ crc_ccitt_table[0][x >> 24];
+      p += 4; n -= 4;
+   }
+   while (n-- > 0)
+      crc = crc_ccitt_update(crc, *p++);
+   return crc;
+}
+
+
+
+#if defined(K20x_MCUCONF)
+
+/***************************************************************
+ * Hardware CRC module. The register holds the non-reflected 
+ * CRC, so the seed is bit-reversed. Data is written as 32 bit 
+ * words with bits and bytes transposed (LSB first). Remaining 
+ * bytes are done in software. 
+ ***************************************************************/
+
+static uint16_t crc_hw_block(uint16_t crc, const uint8_t* p, size_t n)
+{
+   uint32_t x;
+   chMtxLock(&hw_mutex);
+   CRC_CTRL = CRC_CTRL_WAS | CRC_CTRL_TOTR(2);
+   CRC_CRC = __RBIT(crc) >> 16;
+   CRC_CTRL = CRC_CTRL_TOT(2) | CRC_CTRL_TOTR(2);
+   while (n >= 4) {
+      memcpy(&x, p, 4);
+      CRC_CRC = x; 
+      p += 4; n -= 4;
+   }
+   crc = CRC_CRC >> 16; 
+   chMtxUnlock(&hw_mutex);
+   return crc_sw_block(crc, p, n);
+}
+
+#endif
+
+
+
+/***************************************************************
+ * Initialise. If the hardware CRC module is present, enable it
+ * and check it against the tables before using it. 
+ ***************************************************************/
+
+void crc_init()
+{
+#if defined(K20x_MCUCONF)
+   SIM_SCGC6 |= SIM_SCGC6_CRC;
+   CRC_CTRL = 0;           // 16 bit CRC
+   CRC_GPOLY = 0x1021;
+   hw_ok = (crc_hw_block(0xFFFF, (const uint8_t*) check_data, 9) == CHECK_VALUE);
+   if (!hw_ok)
+      SIM_SCGC6 &= ~SIM_SCGC6_CRC;
+#endif
+}
+
+
+
+/***************************************************************
+ * Update CRC with a contiguous span of n bytes. 
+ ***************************************************************/
+
+uint16_t crc_ccitt_block(uint16_t crc, const void* data, size_t n)
+{
+#if defined(K20x_MCUCONF)
+   if (hw_ok && n >= CRC_HW_MIN)
+      return crc_hw_block(crc, (const uint8_t*) data, n);
+#endif
+   return crc_sw_block(crc, (const uint8_t*) data, n);
+}
@@ -4,6 +4,7 @@
  #define _UTIL_CRC16_H_
  
  #include <stdint.h>
+ #include <stddef.h>
  
  static inline uint16_t _crc16_update(uint16_t crc, uint8_t data) __attribute__((always_inline, unused));
  static inline uint16_t _crc16_update(uint16_t crc, uint8_t data)
@@ -47,6 +48,24 @@
    ^ ((uint16_t)data << 3));
  }
  
+ 
+ /*
+  * Table driven CRC-CCITT (reflected, as used for the AX.25 FCS). 
+  * Gives the same result as _crc_ccitt_update. crc_ccitt_block 
+  * processes a contiguous span, four bytes at a time, or using the 
+  * hardware CRC module where available. See crc16.c. 
+  */
+ extern const uint16_t crc_ccitt_table[4][256];
+ 
+ void     crc_init(void);
+ uint16_t crc_ccitt_block(uint16_t crc, const void* data, size_t n);
+ 
+ static inline uint16_t crc_ccitt_update (uint16_t crc, uint8_t data) __attribute__((always_inline, unused));
+ static inline uint16_t crc_ccitt_update (uint16_t crc, uint8_t data)
+ {
+   return (crc >> 8) ^ crc_ccitt_table[0][(crc ^ data) & 0xff];
+ }
+ 
  static inline uint8_t _crc_ibutton_update(uint8_t crc, uint8_t data) __attribute__((always_inline, unused));
  static inline uint8_t _crc_ibutton_update(uint8_t crc, uint8_t data)
  {
@@ -0,0 +1,34 @@
+ /*
+  * CPU cycle counter (DWT CYCCNT) on Cortex-M3/M4.
+  * Used for profiling time critical code.
+  */
+
+ #ifndef _UTIL_CYCLES_H_
+ #define _UTIL_CYCLES_H_
+
+ #include <stdint.h>
+ #include "hal.h"
+
+
+ static inline void cycles_init(void) __attribute__((always_inline, unused));
+ static inline void cycles_init(void)
+ {
+ #if defined(DWT)
+   CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+   DWT->CYCCNT = 0;
+   DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+ #endif
+ }
+
+
+ static inline uint32_t cycles_get(void) __attribute__((always_inline, unused));
+ static inline uint32_t cycles_get(void)
+ {
+ #if defined(DWT)
+   return DWT->CYCCNT;
+ #else
+   return 0;
+ #endif
+ }
+
+ #endif
@@ -0,0 +1,95 @@
+ /*
+  * Single producer, single consumer ring buffer of samples.
+  * Lock free: The producer (typically an ISR) only writes the head
+  * index and the consumer (a thread) only writes the tail index.
+  * Size must be a power of two (max 32768).
+  */
+
+ #ifndef _UTIL_RING_H_
+ #define _UTIL_RING_H_
+
+ #include <stdint.h>
+ #include <stdbool.h>
+ #include <string.h>
+ #include "hal.h"
+
+
+ typedef struct {
+    volatile uint16_t head;     // Next position to write. Written by producer
+    volatile uint16_t tail;     // Next position to read. Written by consumer
+    uint16_t mask;              // Size - 1
+    uint16_t hwm;               // High water mark (max number of samples in ring)
+    uint32_t overflows;         // Samples dropped since ring was full
+    int8_t *buf;
+ } ring_t;
+
+
+ /* Memory barrier between writing data and publishing the index */
+ #define RING_BARRIER() __DMB()
+
+
+ static inline void ring_init(ring_t* r, int8_t* buf, uint16_t size) __attribute__((unused));
+ static inline void ring_init(ring_t* r, int8_t* buf, uint16_t size)
+ {
+    r->head = r->tail = 0;
+    r->mask = size - 1;
+    r->hwm = 0;
+    r->overflows = 0;
+    r->buf = buf;
+ }
+
+
+ /* Number of samples in ring. May be called by both sides */
+ static inline uint16_t ring_len(ring_t* r) __attribute__((unused));
+ static inline uint16_t ring_len(ring_t* r)
+    { return (uint16_t) (r->head - r->tail) & r->mask; }
+
+
+ /*
+  * Producer side. Put a sample into the ring. If full, the sample
+  * is dropped and counted. One position is always left free to
+  * distinguish a full ring from an empty one. Returns the number
+  * of samples in the ring after the put.
+  */
+ static inline uint16_t ring_put(ring_t* r, int8_t x) __attribute__((unused));
+ static inline uint16_t ring_put(ring_t* r, int8_t x)
+ {
+    uint16_t head = r->head;
+    uint16_t len = (uint16_t) (head - r->tail) & r->mask;
+    if (len == r->mask) {
+       r->overflows++;
+       return len;
+    }
+    r->buf[head] = x;
+    RING_BARRIER();
+    r->head = (head + 1) & r->mask;
+    if (++len > r->hwm)
+       r->hwm = len;
+    return len;
+ }
+
+
+ /*
+  * Consumer side. Get up to n samples from the ring into dst.
+  * Returns number of samples actually read.
+  */
+ static inline uint16_t ring_read(ring_t* r, int8_t* dst, uint16_t n) __attribute__((unused));
+ static inline uint16_t ring_read(ring_t* r, int8_t* dst, uint16_t n)
+ {
+    uint16_t tail = r->tail;
+    uint16_t len = (uint16_t) (r->head - tail) & r->mask;
+    if (n > len)
+       n = len;
+
+    /* At most two contiguous pieces */
+    uint16_t first = r->mask + 1 - tail;
+    if (first > n)
+       first = n;
+    memcpy(dst, r->buf + tail, first);
+    memcpy(dst + first, r->buf, n - first);
+    RING_BARRIER();
+    r->tail = (tail + n) & r->mask;
+    return n;
+ }
+
+ #endif